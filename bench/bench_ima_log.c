@@ -0,0 +1,252 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file bench_ima_log.c
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Micro-benchmark of indexing, parsing and replaying an IMA event log
+ * of 1M events, built by repeating the events of the bundled sample log.
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+/* clock_gettime(), mkdtemp() */
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <tss2/tss2_tpm2_types.h>
+#include <unistd.h>
+
+#include "../src/common/charra_error.h"
+#include "../src/common/charra_log.h"
+#include "../src/common/charra_macro.h"
+#include "../src/core/charra_ima_log.h"
+#include "../src/util/ima_util.h"
+#include "../src/util/io_util.h"
+
+/* the bundled sample log, relative to the repository root */
+#define BENCH_IMA_SAMPLE_LOG "logs/ima/binary_runtime_measurements"
+
+/* number of events of the generated log */
+#define BENCH_IMA_EVENTS 1000000
+
+/* runs per measurement, the median is reported */
+#define BENCH_RUNS 3
+
+static double bench_now_ms(void) {
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static int bench_compare_ms(const void* a, const void* b) {
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_report(const char* name, double* ms, uint64_t events) {
+    qsort(ms, BENCH_RUNS, sizeof(*ms), bench_compare_ms);
+    const double median = ms[BENCH_RUNS / 2];
+    printf("%-32s %12.1f %14.0f\n", name, median,
+            (median > 0.0) ? (double)events / median * 1000.0 : 0.0);
+}
+
+/**
+ * @brief Writes a log of \a events events to \a filename by repeating the
+ * events of the sample log \a sample_path, cut at an event boundary.
+ */
+static CHARRA_RC bench_generate(
+        const char* sample_path, const char* filename, uint64_t events) {
+    CHARRA_RC r = CHARRA_RC_ERROR;
+    FILE* sample = NULL;
+    FILE* out = NULL;
+    uint8_t* entry = NULL;
+    size_t* entry_lens = NULL;
+    size_t entries_len = 0;
+    charra_io_file_buffer content = {0};
+
+    /* split the sample into its events */
+    if ((sample = fopen(sample_path, "rb")) == NULL) {
+        fprintf(stderr, "Cannot open sample log '%s'.\n", sample_path);
+        goto cleanup;
+    }
+    if ((entry = malloc(CHARRA_IMA_ENTRY_MAX_LEN)) == NULL) {
+        goto cleanup;
+    }
+    for (;;) {
+        size_t entry_len = 0;
+        CHARRA_RC read_r = charra_ima_read_entry(
+                sample, CHARRA_IMA_ENTRY_MAX_LEN, entry, &entry_len);
+        if (read_r == CHARRA_RC_NO_MATCH) {
+            break;
+        } else if (read_r != CHARRA_RC_SUCCESS) {
+            fprintf(stderr, "Malformed sample log '%s'.\n", sample_path);
+            goto cleanup;
+        }
+        size_t* lens =
+                realloc(entry_lens, (entries_len + 1) * sizeof(*entry_lens));
+        if (lens == NULL) {
+            goto cleanup;
+        }
+        entry_lens = lens;
+        entry_lens[entries_len++] = entry_len;
+    }
+    if (entries_len == 0 ||
+            charra_io_map_file(sample_path, &content) != CHARRA_RC_SUCCESS) {
+        goto cleanup;
+    }
+
+    /* repeat the events */
+    if ((out = fopen(filename, "wb")) == NULL) {
+        fprintf(stderr, "Cannot create file '%s'.\n", filename);
+        goto cleanup;
+    }
+    size_t offset = 0;
+    for (uint64_t i = 0; i < events; ++i) {
+        const size_t e = (size_t)(i % entries_len);
+        if (e == 0) {
+            offset = 0;
+        }
+        if (fwrite(content.data + offset, 1, entry_lens[e], out) !=
+                entry_lens[e]) {
+            goto cleanup;
+        }
+        offset += entry_lens[e];
+    }
+    r = CHARRA_RC_SUCCESS;
+
+cleanup:
+    if (out != NULL && fclose(out) != 0) {
+        r = CHARRA_RC_ERROR;
+    }
+    if (sample != NULL) {
+        fclose(sample);
+    }
+    charra_io_unmap_file(&content);
+    charra_free_if_not_null(entry_lens);
+    charra_free_if_not_null(entry);
+
+    return r;
+}
+
+/**
+ * @brief Parses and replays the log in \a content into PCR 10 of \a banks
+ * and returns the time in milliseconds, or a negative value on errors.
+ */
+static double bench_replay(const charra_io_file_buffer* content,
+        uint32_t banks_len, const TPMI_ALG_HASH* banks,
+        charra_ima_replay* replay) {
+    const double start = bench_now_ms();
+
+    if (charra_ima_replay_init(replay, banks_len, banks, CHARRA_IMA_PCR) !=
+                    CHARRA_RC_SUCCESS ||
+            charra_ima_replay_log(replay, content->len, content->data) !=
+                    CHARRA_RC_SUCCESS ||
+            replay->events != BENCH_IMA_EVENTS) {
+        return -1.0;
+    }
+
+    return bench_now_ms() - start;
+}
+
+int main(int argc, char** argv) {
+    static const TPMI_ALG_HASH banks[] = {TPM2_ALG_SHA1, TPM2_ALG_SHA256};
+    const char* sample_path = BENCH_IMA_SAMPLE_LOG;
+    char dir[] = "/tmp/charra-bench-XXXXXX";
+    char filename[sizeof(dir) + 32] = {0};
+    charra_io_file_buffer content = {0};
+    charra_ima_replay replay = {0};
+    double ms[BENCH_RUNS] = {0};
+    int result = EXIT_FAILURE;
+
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [SAMPLE_LOG]\n", argv[0]);
+        return EXIT_FAILURE;
+    } else if (argc == 2) {
+        sample_path = argv[1];
+    }
+    charra_log_set_level(CHARRA_LOG_WARN);
+
+    if (mkdtemp(dir) == NULL) {
+        fprintf(stderr, "Cannot create temporary directory.\n");
+        return EXIT_FAILURE;
+    }
+    snprintf(filename, sizeof(filename), "%s/binary_runtime_measurements",
+            dir);
+    if (bench_generate(sample_path, filename, BENCH_IMA_EVENTS) !=
+            CHARRA_RC_SUCCESS) {
+        goto cleanup;
+    }
+    if (charra_io_map_file(filename, &content) != CHARRA_RC_SUCCESS) {
+        goto cleanup;
+    }
+    printf("%" PRIu64 " events, %zu bytes\n\n", (uint64_t)BENCH_IMA_EVENTS,
+            content.len);
+    printf("%-32s %12s %14s\n", "measurement", "median [ms]", "events/s");
+
+    /* attester: index the log (parses the event framing only) */
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        charra_ima_index index = {0};
+        const double start = bench_now_ms();
+        if (charra_ima_index_init(&index, filename) != CHARRA_RC_SUCCESS) {
+            fprintf(stderr, "Cannot index '%s'.\n", filename);
+            goto cleanup;
+        }
+        ms[run] = bench_now_ms() - start;
+        const uint64_t count = index.count;
+        charra_ima_index_free(&index);
+        if (count != BENCH_IMA_EVENTS) {
+            fprintf(stderr, "Indexed %" PRIu64 " events.\n", count);
+            goto cleanup;
+        }
+    }
+    bench_report("index (attester)", ms, BENCH_IMA_EVENTS);
+
+    /* verifier: parse and replay into the SHA-1 bank, then both banks */
+    for (uint32_t banks_len = 1; banks_len <= 2; ++banks_len) {
+        for (int run = 0; run < BENCH_RUNS; ++run) {
+            if ((ms[run] = bench_replay(&content, banks_len, banks,
+                         &replay)) < 0.0) {
+                fprintf(stderr, "Cannot replay '%s'.\n", filename);
+                goto cleanup;
+            }
+        }
+        bench_report((banks_len == 1) ? "parse + replay (SHA-1)"
+                                      : "parse + replay (SHA-1, SHA-256)",
+                ms, BENCH_IMA_EVENTS);
+    }
+
+    /* the expected PCR values, to compare runs on different builds */
+    printf("\n");
+    for (size_t b = 0; b < sizeof(banks) / sizeof(*banks); ++b) {
+        const uint8_t* pcr = charra_ima_replay_get_pcr(&replay, banks[b]);
+        printf("PCR %d (%s): ", CHARRA_IMA_PCR,
+                (banks[b] == TPM2_ALG_SHA1) ? "SHA-1" : "SHA-256");
+        for (uint16_t i = 0; i < replay.banks[b].pcr_size; ++i) {
+            printf("%02x", pcr[i]);
+        }
+        printf("\n");
+    }
+    result = EXIT_SUCCESS;
+
+cleanup:
+    charra_io_unmap_file(&content);
+    unlink(filename);
+    rmdir(dir);
+
+    return result;
+}
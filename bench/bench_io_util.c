@@ -0,0 +1,239 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file bench_io_util.c
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Micro-benchmark of loading 1 MB, 10 MB and 100 MB event logs with
+ * the former per-byte cvector reader, charra_io_read_file() and
+ * charra_io_map_file().
+ * @version 0.1
+ * @date 2026-10-16
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+/* clock_gettime(), mkdtemp() */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/common/charra_error.h"
+#include "../src/common/charra_log.h"
+#include "../src/common/charra_macro.h"
+#include "../src/core/charra_cvector.h"
+#include "../src/util/io_util.h"
+
+/* sizes of the generated logs */
+static const size_t bench_sizes[] = {
+        1024 * 1024, 10 * 1024 * 1024, 100 * 1024 * 1024};
+
+/* runs per reader and size, the median is reported */
+#define BENCH_RUNS 5
+
+/**
+ * @brief The reader as it was before bulk reads: 1 KiB chunks pushed into a
+ * cvector byte by byte. Kept verbatim; as the cvector header is included
+ * before CVECTOR_LOGARITHMIC_GROWTH is defined, the vector grows by one
+ * element per push.
+ */
+static CHARRA_RC bench_read_cvector(const char* const filename,
+        uint8_t** const file_content, size_t* const file_content_len) {
+    /* the size of the event log chunks which get read at once */
+#define IMA_EVENT_LOG_STEP_SIZE 1024
+    /*
+     * Use logarithmic growth for the cvector. Otherwise it would grow on
+     * every call to cvector_push_back().
+     */
+#define CVECTOR_LOGARITHMIC_GROWTH
+
+    cvector_vector_type(uint8_t) file_content_cvector = NULL;
+    FILE* fp = NULL;
+    if ((fp = fopen(filename, "rb")) == NULL) {
+        charra_log_error("Cannot open file '%s'.", filename);
+        return CHARRA_RC_ERROR;
+    }
+    uint8_t processing_array[IMA_EVENT_LOG_STEP_SIZE] = {0};
+    size_t read_size = 0;
+    do {
+        read_size = fread(processing_array, sizeof(*processing_array),
+                IMA_EVENT_LOG_STEP_SIZE, fp);
+        for (size_t i = 0; i < read_size; ++i) {
+            cvector_push_back(file_content_cvector, processing_array[i]);
+        }
+    } while (read_size == IMA_EVENT_LOG_STEP_SIZE);
+
+    /* flush and close file */
+    if (fflush(fp) != 0) {
+        charra_log_error("Error flushing file '%s'.", filename);
+        charra_free_if_not_null_ex(file_content_cvector, cvector_free);
+        return CHARRA_RC_ERROR;
+    }
+    if (fclose(fp) != 0) {
+        charra_log_error("Error closing file '%s'.", filename);
+        charra_free_if_not_null_ex(file_content_cvector, cvector_free);
+        return CHARRA_RC_ERROR;
+    }
+    *file_content_len = cvector_size(file_content_cvector);
+    *file_content = file_content_cvector;
+    return CHARRA_RC_SUCCESS;
+}
+
+/**
+ * @brief Touches every page of \a buf as a consumer of the log would, so
+ * that lazily mapped files are compared fairly.
+ */
+static uint64_t bench_touch(const uint8_t* buf, size_t len) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < len; i += 4096) {
+        sum += buf[i];
+    }
+    return sum;
+}
+
+static double bench_now_ms(void) {
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static int bench_compare_ms(const void* a, const void* b) {
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Loads \a filename with one of the readers and returns the time in
+ * milliseconds, or a negative value on errors.
+ */
+static double bench_load(const char* filename, size_t size, int reader) {
+    uint64_t sum = 0;
+    size_t len = 0;
+    const double start = bench_now_ms();
+
+    if (reader == 0) {
+        uint8_t* content = NULL;
+        if (bench_read_cvector(filename, &content, &len) !=
+                CHARRA_RC_SUCCESS) {
+            return -1.0;
+        }
+        sum = bench_touch(content, len);
+        charra_free_if_not_null_ex(content, cvector_free);
+    } else if (reader == 1) {
+        char* content = NULL;
+        if (charra_io_read_file(filename, &content, &len) !=
+                CHARRA_RC_SUCCESS) {
+            return -1.0;
+        }
+        sum = bench_touch((const uint8_t*)content, len);
+        charra_io_free_file_buffer(&content);
+    } else {
+        charra_io_file_buffer buffer = {0};
+        if (charra_io_map_file(filename, &buffer) != CHARRA_RC_SUCCESS) {
+            return -1.0;
+        }
+        len = buffer.len;
+        sum = bench_touch(buffer.data, buffer.len);
+        charra_io_unmap_file(&buffer);
+    }
+
+    const double elapsed = bench_now_ms() - start;
+    if (len != size || sum == UINT64_MAX) {
+        return -1.0;
+    }
+    return elapsed;
+}
+
+/**
+ * @brief Writes \a size pseudo-random bytes to \a filename.
+ */
+static CHARRA_RC bench_generate(const char* filename, size_t size) {
+    FILE* fp = NULL;
+    uint8_t chunk[64 * 1024] = {0};
+    uint32_t x = 2463534242u;
+
+    if ((fp = fopen(filename, "wb")) == NULL) {
+        fprintf(stderr, "Cannot create file '%s'.\n", filename);
+        return CHARRA_RC_ERROR;
+    }
+    for (size_t done = 0; done < size; done += sizeof(chunk)) {
+        for (size_t i = 0; i < sizeof(chunk); ++i) {
+            /* xorshift32 */
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            chunk[i] = (uint8_t)x;
+        }
+        const size_t n =
+                (size - done < sizeof(chunk)) ? size - done : sizeof(chunk);
+        if (fwrite(chunk, 1, n, fp) != n) {
+            fclose(fp);
+            return CHARRA_RC_ERROR;
+        }
+    }
+
+    return (fclose(fp) == 0) ? CHARRA_RC_SUCCESS : CHARRA_RC_ERROR;
+}
+
+int main(void) {
+    static const char* const readers[] = {
+            "cvector_push_back", "charra_io_read_file", "charra_io_map_file"};
+    char dir[] = "/tmp/charra-bench-XXXXXX";
+    char filename[sizeof(dir) + 32] = {0};
+    int result = EXIT_SUCCESS;
+
+    charra_log_set_level(CHARRA_LOG_WARN);
+
+    if (mkdtemp(dir) == NULL) {
+        fprintf(stderr, "Cannot create temporary directory.\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("%-10s %-20s %12s %12s\n", "size", "reader", "median [ms]",
+            "MB/s");
+    for (size_t s = 0; s < sizeof(bench_sizes) / sizeof(*bench_sizes); ++s) {
+        const size_t size = bench_sizes[s];
+        snprintf(filename, sizeof(filename), "%s/log-%zu", dir, size);
+        if (bench_generate(filename, size) != CHARRA_RC_SUCCESS) {
+            result = EXIT_FAILURE;
+            break;
+        }
+
+        for (int reader = 0; reader < 3; ++reader) {
+            double ms[BENCH_RUNS] = {0};
+            int run = 0;
+            while (run < BENCH_RUNS &&
+                    (ms[run] = bench_load(filename, size, reader)) >= 0.0) {
+                run += 1;
+            }
+            if (run < BENCH_RUNS) {
+                fprintf(stderr, "Loading '%s' with %s failed.\n", filename,
+                        readers[reader]);
+                result = EXIT_FAILURE;
+                continue;
+            }
+            qsort(ms, BENCH_RUNS, sizeof(*ms), bench_compare_ms);
+            const double median = ms[BENCH_RUNS / 2];
+            printf("%6zu MB  %-20s %12.2f %12.0f\n", size / (1024 * 1024),
+                    readers[reader], median,
+                    (median > 0.0) ? (double)size / 1048576.0 / median * 1000.0
+                                   : 0.0);
+        }
+        unlink(filename);
+    }
+    rmdir(dir);
+
+    return result;
+}
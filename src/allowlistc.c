@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file allowlistc.c
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Compiles a file digest list into the allowlist index the verifier
+ * appraises IMA logs against.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <tss2/tss2_tpm2_types.h>
+
+#include "common/charra_error.h"
+#include "common/charra_log.h"
+#include "core/charra_allowlist.h"
+#include "util/crypto_util.h"
+
+#define LOG_NAME "allowlistc"
+
+static const struct option allowlistc_options[] = {
+        {"hash-algorithm", required_argument, 0, 'g'},
+        {"help", no_argument, 0, 'h'},
+        {0}};
+
+static void allowlistc_print_help(const char* name) {
+    printf("Usage: %s [OPTIONS] LIST INDEX\n", name);
+    printf("Compiles the digest list LIST into the allowlist index INDEX.\n");
+    printf("Each line of LIST starts with a hex-encoded digest, optionally "
+           "prefixed with 'ALGORITHM:', as printed by sha256sum.\n");
+    printf(" -g, --hash-algorithm=ALGORITHM: The algorithm of the digests: "
+           "sha1, sha256, sha384 or sha512. Default is sha256.\n");
+    printf(" -h, --help:                     Print this help message.\n");
+}
+
+int main(int argc, char** argv) {
+    TPMI_ALG_HASH hash_alg = TPM2_ALG_SHA256;
+    uint64_t count = 0;
+
+    charra_log_set_level(CHARRA_LOG_INFO);
+
+    for (;;) {
+        const int c = getopt_long(argc, argv, "g:h", allowlistc_options, NULL);
+        if (c == -1) {
+            break;
+        } else if (c == 'g') {
+            hash_alg = charra_crypto_tpm2_hash_alg_from_name(
+                    optarg, strlen(optarg));
+            if (hash_alg == TPM2_ALG_ERROR) {
+                charra_log_error("[" LOG_NAME
+                                 "] Unsupported hash algorithm: '%s'",
+                        optarg);
+                return CHARRA_RC_CLI_ERROR;
+            }
+        } else if (c == 'h') {
+            allowlistc_print_help(argv[0]);
+            return CHARRA_RC_SUCCESS;
+        } else {
+            allowlistc_print_help(argv[0]);
+            return CHARRA_RC_CLI_ERROR;
+        }
+    }
+    if (argc - optind != 2) {
+        allowlistc_print_help(argv[0]);
+        return CHARRA_RC_CLI_ERROR;
+    }
+
+    CHARRA_RC r = charra_allowlist_build(
+            argv[optind], hash_alg, argv[optind + 1], &count);
+    if (r != CHARRA_RC_SUCCESS) {
+        charra_log_error("[" LOG_NAME "] Compiling '%s' failed.", argv[optind]);
+        return r;
+    }
+    charra_log_info("[" LOG_NAME "] Wrote %" PRIu64 " digests to '%s'.", count,
+            argv[optind + 1]);
+
+    return CHARRA_RC_SUCCESS;
+}
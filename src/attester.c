@@ -21,14 +21,17 @@
 
 #include <arpa/inet.h>
 #include <coap3/coap.h>
+#include <inttypes.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/select.h>
 #include <tinydtls/session.h>
 #include <tss2/tss2_mu.h>
+#include <tss2/tss2_tcti.h>
 #include <tss2/tss2_tctildr.h>
 #include <tss2/tss2_tpm2_types.h>
 
@@ -37,12 +40,15 @@
 #include "common/charra_macro.h"
 #include "core/charra_helper.h"
 #include "core/charra_key_mgr.h"
+#include "core/charra_response_cache.h"
 #include "core/charra_tap/charra_tap_cbor.h"
 #include "core/charra_tap/charra_tap_dto.h"
 #include "util/cli/cli_util_attester.h"
 #include "util/cli/cli_util_common.h"
 #include "util/coap_util.h"
+#include "util/ima_util.h"
 #include "util/io_util.h"
+#include "util/merkle_util.h"
 #include "util/parser_util.h"
 #include "util/tpm2_util.h"
 
@@ -76,6 +82,19 @@ char* dtls_rpk_public_key_path = "keys/attester.pub.der";
 char* dtls_rpk_peer_public_key_path = "keys/verifier.pub.der";
 bool dtls_rpk_verify_peer_public_key = true;
 
+/* long-lived TPM connection, (re-)established on demand */
+static tpm2_esys_context tpm2_ctx = {0};
+
+/* attestation keys kept resident in the TPM across requests */
+static charra_key_table key_table = {0};
+
+/* recent responses, answers retransmitted requests without the TPM */
+static charra_response_cache response_cache = {0};
+
+/* offsets of the IMA log events, extended as the log grows */
+static charra_ima_index ima_index = {0};
+static bool ima_index_valid = false;
+
 /**
  * @brief SIGINT handler: set quit to 1 for graceful termination.
  *
@@ -90,6 +109,211 @@ static void coap_attest_handler(struct coap_resource_t* resource,
         struct coap_session_t* session, const struct coap_pdu_t* request,
         const struct coap_string_t* query, struct coap_pdu_t* response);
 
+/**
+ * @brief An attestation request whose TPM quote is queued or in progress. It
+ * is attached to the libcoap async entry of the request, which is triggered
+ * once the quote is done so that the response is sent as separate response.
+ */
+typedef struct attest_job {
+    coap_session_t* session;
+    coap_async_t* async;
+    charra_tap_msg_attestation_request_dto req;
+    TPML_PCR_SELECTION pcr_selection;
+    TPM2B_DATA qualifying_data;
+    uint8_t selection_digest[TPM2_SHA256_DIGEST_SIZE];
+    coap_tick_t received;
+    bool retried;
+    bool done;
+    CHARRA_RC result;
+    TPM2B_ATTEST* attest_buf;
+    TPMT_SIGNATURE* signature;
+    /* set if the quote was coalesced with other requests */
+    bool has_nonce_inclusion_proof;
+    charra_tap_nonce_inclusion_proof_dto nonce_inclusion_proof;
+    /* values of the selected PCRs, read after the quote if asked for */
+    charra_tap_tpm2_pcr_values_dto* pcr_values;
+    struct attest_job* next;
+} attest_job;
+
+/* maximum number of requests coalesced into one quote */
+#define ATTESTER_COALESCE_MAX_BATCH 64
+
+/* default bounds of the quote queue */
+#define ATTESTER_DEFAULT_QUEUE_MAX 32
+#define ATTESTER_DEFAULT_QUEUE_MAX_PER_PEER 8
+
+/* quote latency assumed until the first quote has been measured */
+#define ATTESTER_INITIAL_QUOTE_LATENCY_MS 500
+
+/* largest Block2 size generated (SZX 6: 1024 bytes) */
+#define ATTESTER_BLOCK_SZX_MAX 6
+
+/* quote jobs waiting for the TPM, and the batch the TPM is working on */
+static attest_job* job_queue_head = NULL;
+static attest_job* job_queue_tail = NULL;
+static attest_job* job_in_flight = NULL;
+
+/* admission control statistics of the quote queue */
+static struct {
+    /* queued jobs, not counting the batch in flight */
+    uint32_t depth;
+    uint32_t depth_peak;
+    uint64_t admitted;
+    uint64_t rejected_full;
+    uint64_t rejected_peer;
+    /* moving average of the TPM quote latency, 0 if not yet measured */
+    uint32_t quote_latency_ms;
+} queue_stats = {0};
+
+/* start time of the quote in flight */
+static coap_tick_t quote_started = 0;
+
+/* qualifying data of the batch in flight (nonce or Merkle root of nonces) */
+static TPM2B_DATA batch_qualifying_data = {0};
+
+/* TCTI poll handles to wait for the TPM response of the batch in flight */
+static TSS2_TCTI_POLL_HANDLE* tcti_poll_handles = NULL;
+static size_t tcti_poll_handles_len = 0;
+
+/* PCR values read after the quote of the batch in flight, if asked for */
+static bool pcr_read_in_flight = false;
+static tpm2_pcr_read_state pcr_read_state = {0};
+static tpm2_pcr_value pcr_read_values[CHARRA_TAP_PCR_VALUES_MAX] = {0};
+
+/**
+ * @brief Frees a quote job including its results and releases its session.
+ *
+ * @param job The job, may be NULL.
+ */
+static void attest_job_free(attest_job* job);
+
+/**
+ * @brief Frees all queued jobs and the job in flight.
+ */
+static void attester_free_jobs(void);
+
+/**
+ * @brief Decides whether a request of the peer of \a session may be queued.
+ * Requests are rejected if the queue is full or the peer already has its
+ * share of the queue, so that a single verifier cannot starve the others.
+ *
+ * @param[in] session The CoAP session of the request.
+ * @param[out] max_age_s The time in seconds after which the peer should retry
+ * if the request is rejected, derived from the measured quote latency.
+ * @return true if the request may be queued.
+ * @return false if the request is rejected.
+ */
+static bool attester_admit(const coap_session_t* session, uint32_t* max_age_s);
+
+/**
+ * @brief Returns the time in milliseconds to wait for further requests to
+ * coalesce with the oldest queued one, or 0 if its batch is due.
+ */
+static uint32_t attester_coalesce_wait_ms(void);
+
+/**
+ * @brief Takes the oldest queued job and, if coalescing is enabled, all queued
+ * jobs that can share its quote (same key and PCR selection) off the queue.
+ * For more than one job the qualifying data is the Merkle root over their
+ * nonces and every job gets its inclusion proof.
+ *
+ * @param[out] batch The jobs as linked list.
+ * @param[out] qualifying_data The qualifying data for the quote.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_ERROR on errors.
+ */
+static CHARRA_RC attester_dequeue_batch(
+        attest_job** batch, TPM2B_DATA* qualifying_data);
+
+/**
+ * @brief Starts the TPM quote of \a batch using the attestation key selected
+ * by its sig_key_id and the long-lived TPM connection.
+ *
+ * @param[in,out] batch The batch of jobs.
+ * @param[in] qualifying_data The qualifying data for the quote.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_NO_MATCH if no attestation key matches the sig_key_id.
+ * @return CHARRA_RC_ERROR on errors.
+ */
+static CHARRA_RC attester_start_quote(
+        attest_job* batch, const TPM2B_DATA* qualifying_data);
+
+/**
+ * @brief Waits for the TPM response in the event loop if the TCTI can be
+ * polled, otherwise blocks in the next _Finish call.
+ */
+static void attester_poll_tpm(void);
+
+/**
+ * @brief Collects the TPM response for the job in flight, if available.
+ */
+static void attester_finish_tpm(void);
+
+/**
+ * @brief Collects the TPM quote result of the job in flight, if available.
+ */
+static void attester_finish_quote(void);
+
+/**
+ * @brief Starts reading the values of the PCRs quoted for \a batch right
+ * after the quote if any of its jobs asked for them, otherwise completes the
+ * batch. The PCRs may have been extended since the quote; the verifier detects
+ * this as the values then do not match the quoted PCR digest. The quote is
+ * sent without values if they cannot be read.
+ *
+ * @param[in,out] batch The batch of jobs.
+ */
+static void attester_start_pcr_read(attest_job* batch);
+
+/**
+ * @brief Collects the PCR values read for the job in flight, if available,
+ * and completes its batch.
+ */
+static void attester_finish_pcr_read(void);
+
+/**
+ * @brief Starts queued jobs as long as the TPM is idle.
+ */
+static void attester_run_jobs(void);
+
+/**
+ * @brief Recovers from a failed TPM operation: reconnects if the TPM is no
+ * longer reachable, otherwise drops the (possibly flushed) attestation key of
+ * \a job so that it gets reloaded.
+ *
+ * @param[in] job The job whose TPM operation failed.
+ * @return CHARRA_RC_SUCCESS if the operation can be retried.
+ * @return CHARRA_RC_ERROR otherwise.
+ */
+static CHARRA_RC attester_recover_tpm(const attest_job* job);
+
+/**
+ * @brief Hands the quote result to every job of \a batch, marks them as done
+ * and triggers their separate CoAP responses.
+ *
+ * @param[in,out] batch The batch of jobs.
+ * @param[in] result The result of the TPM quote.
+ */
+static void attester_complete_batch(attest_job* batch, CHARRA_RC result);
+
+/**
+ * @brief Sends the attestation response of a finished job.
+ */
+static void attester_send_response(struct coap_resource_t* resource,
+        struct coap_session_t* session, const struct coap_pdu_t* request,
+        const struct coap_string_t* query, struct coap_pdu_t* response,
+        attest_job* job);
+
+/**
+ * @brief Sends the block of a marshaled response requested by the Block2
+ * option of \a request, reading only that part of the response.
+ *
+ * @return Whether further blocks of the response follow.
+ */
+static bool attester_send_block(struct coap_session_t* session,
+        const struct coap_pdu_t* request, struct coap_pdu_t* response,
+        const charra_response_cache_stream* stream);
+
 /* --- main --------------------------------------------------------------- */
 
 int main(int argc, char** argv) {
@@ -126,8 +350,11 @@ int main(int argc, char** argv) {
         },
         .specific_config.attester_config = {
             .dtls_psk_hint = &dtls_psk_hint,
-            .attestation_key_format = CLI_UTIL_ATTESTATION_KEY_FORMAT_FILE,
-            .attestation_key.ctx_path = NULL,
+            .attestation_keys_len = 0,
+            .coalesce_window_ms = 0,
+            .response_cache_ttl_ms = CHARRA_RESPONSE_CACHE_DEFAULT_TTL_MS,
+            .queue_max = ATTESTER_DEFAULT_QUEUE_MAX,
+            .queue_max_per_peer = ATTESTER_DEFAULT_QUEUE_MAX_PER_PEER,
             .ima_log_path = NULL,
             .tcg_boot_log_path = NULL,
         },
@@ -164,11 +391,56 @@ int main(int argc, char** argv) {
         charra_log_debug("[" LOG_NAME "]         Peers' public key path: '%s'",
                 dtls_rpk_peer_public_key_path);
     }
+    for (uint32_t i = 0; i < cli_attester_config.specific_config.attester_config
+                                    .attestation_keys_len;
+            ++i) {
+        const cli_config_attestation_key* key =
+                &cli_attester_config.specific_config.attester_config
+                         .attestation_keys[i];
+        charra_log_debug("[" LOG_NAME "]     Attestation key ID: '%s'",
+                (key->id != NULL) ? key->id : "(default)");
+    }
 
     /* set varaibles here such that they are valid in case of an 'goto error' */
     coap_context_t* coap_context = NULL;
     coap_endpoint_t* coap_endpoint = NULL;
 
+    /* set up attestation key table */
+    if (charra_key_table_init(&key_table,
+                &cli_attester_config.specific_config.attester_config,
+                CHARRA_KEY_TABLE_DEFAULT_LOADED_MAX) != CHARRA_RC_SUCCESS) {
+        charra_log_error("[" LOG_NAME "] Cannot set up attestation keys.");
+        goto error;
+    }
+
+    /* set up response cache for retransmitted requests */
+    charra_response_cache_init(&response_cache,
+            cli_attester_config.specific_config.attester_config
+                    .response_cache_ttl_ms);
+
+    /* index IMA log once; later requests only index new events */
+    if (cli_attester_config.specific_config.attester_config.ima_log_path !=
+            NULL) {
+        charra_log_info("[" LOG_NAME "] Indexing IMA log.");
+        if (charra_ima_index_init(&ima_index,
+                    cli_attester_config.specific_config.attester_config
+                            .ima_log_path) != CHARRA_RC_SUCCESS) {
+            charra_log_error("[" LOG_NAME "] Cannot index IMA log.");
+            goto error;
+        }
+        ima_index_valid = true;
+        charra_log_info("[" LOG_NAME "] IMA log has %" PRIu64 " events.",
+                ima_index.count);
+    }
+
+    /* connect to the TPM once; the connection is kept for all requests */
+    charra_log_info("[" LOG_NAME "] Initializing ESAPI.");
+    if (tpm2_esys_context_init(&tpm2_ctx, getenv("CHARRA_TCTI")) !=
+            TSS2_RC_SUCCESS) {
+        charra_log_error("[" LOG_NAME "] Cannot connect to the TPM.");
+        goto error;
+    }
+
     if (use_dtls_psk && use_dtls_rpk) {
         charra_log_error(
                 "[" LOG_NAME "] Configuration enables both DTSL with PSK "
@@ -181,6 +453,12 @@ int main(int argc, char** argv) {
         coap_show_tls_version(LOG_DEBUG);
     }
 
+    if (!coap_async_is_supported()) {
+        charra_log_error("[" LOG_NAME "] CoAP does not support separate "
+                         "responses (async). Aborting!");
+        goto error;
+    }
+
     if ((use_dtls_psk || use_dtls_psk) && !coap_dtls_is_supported()) {
         charra_log_error("[" LOG_NAME "] CoAP does not support DTLS but the "
                          "configuration enables DTLS. Aborting!");
@@ -255,12 +533,41 @@ int main(int argc, char** argv) {
     /* enter main loop */
     charra_log_debug("[" LOG_NAME "] Entering main loop.");
     while (!quit) {
+        /* wait for further requests to coalesce with, if enabled */
+        uint32_t timeout_ms = COAP_IO_WAIT;
+        if (job_in_flight == NULL && attester_coalesce_wait_ms() > 0) {
+            timeout_ms = attester_coalesce_wait_ms();
+        }
+
+        /* wait for the TPM as well while a quote is in progress */
+        fd_set readfds;
+        int nfds = 0;
+        FD_ZERO(&readfds);
+        for (size_t i = 0; i < tcti_poll_handles_len; ++i) {
+            FD_SET(tcti_poll_handles[i].fd, &readfds);
+            if (tcti_poll_handles[i].fd >= nfds) {
+                nfds = tcti_poll_handles[i].fd + 1;
+            }
+        }
+
         /* process CoAP I/O */
-        if (coap_io_process(coap_context, COAP_IO_WAIT) == -1) {
+        if (coap_io_process_with_fds(coap_context, timeout_ms, nfds,
+                    (nfds > 0) ? &readfds : NULL, NULL, NULL) == -1) {
             charra_log_error(
                     "[" LOG_NAME "] Error during CoAP I/O processing.");
             goto error;
         }
+
+        /* collect TPM response */
+        for (size_t i = 0; i < tcti_poll_handles_len; ++i) {
+            if (FD_ISSET(tcti_poll_handles[i].fd, &readfds)) {
+                attester_finish_tpm();
+                break;
+            }
+        }
+
+        /* start next quote, e.g. once a coalescing window has elapsed */
+        attester_run_jobs();
     }
 
     result = EXIT_SUCCESS;
@@ -270,11 +577,26 @@ error:
     result = EXIT_FAILURE;
 
 finish:
+    /* drop pending quotes; releases their CoAP sessions */
+    attester_free_jobs();
+
     /* free CoAP memory */
     charra_free_and_null_ex(coap_endpoint, coap_free_endpoint);
     charra_free_and_null_ex(coap_context, coap_free_context);
     coap_cleanup();
 
+    /* drop cached responses */
+    charra_response_cache_free(&response_cache);
+
+    /* close IMA log */
+    if (ima_index_valid) {
+        charra_ima_index_free(&ima_index);
+    }
+
+    /* release attestation key and finalize ESAPI */
+    charra_key_table_free(&key_table, &tpm2_ctx);
+    tpm2_esys_context_finalize(&tpm2_ctx);
+
     return result;
 }
 
@@ -292,8 +614,20 @@ static void coap_attest_handler(struct coap_resource_t* resource,
         const struct coap_string_t* query, struct coap_pdu_t* response) {
     CHARRA_RC charra_r = CHARRA_RC_SUCCESS;
     int coap_r = 0;
-    TSS2_RC tss_r = 0;
-    ESYS_TR sig_key_handle = ESYS_TR_NONE;
+    attest_job* job = NULL;
+
+    /* a triggered async entry means the quote is done */
+    coap_async_t* async =
+            coap_find_async(session, coap_pdu_get_token(request));
+    if (async != NULL) {
+        job = coap_async_get_app_data(async);
+        if (job != NULL && job->done) {
+            attester_send_response(
+                    resource, session, request, query, response, job);
+        }
+        return;
+    }
+
     /* --- receive incoming data --- */
 
     charra_log_info(
@@ -316,11 +650,15 @@ static void coap_attest_handler(struct coap_resource_t* resource,
                 data_total_len);
     }
 
+    if ((job = calloc(1, sizeof(attest_job))) == NULL) {
+        charra_log_error("[" LOG_NAME "] Cannot allocate memory.");
+        goto error;
+    }
+
     /* unmarshal data */
     charra_log_info("[" LOG_NAME "] Parsing received CBOR data.");
-    charra_tap_msg_attestation_request_dto req = {0};
     if ((charra_r = charra_tap_unmarshal_attestation_request(
-                 data_len, data, &req)) != CHARRA_RC_SUCCESS) {
+                 data_len, data, &job->req)) != CHARRA_RC_SUCCESS) {
         charra_log_error("[" LOG_NAME "] Could not parse CBOR data.");
         goto error;
     }
@@ -330,62 +668,127 @@ static void coap_attest_handler(struct coap_resource_t* resource,
     charra_log_info("[" LOG_NAME "] Preparing TPM quote data.");
 
     /* nonce */
-    if (req.nonce_len > sizeof(TPMU_HA)) {
+    if (job->req.nonce_len > sizeof(TPMU_HA)) {
         charra_log_error("[" LOG_NAME "] Nonce too long.");
         goto error;
     }
-    TPM2B_DATA qualifying_data = {.size = 0, .buffer = {0}};
-    qualifying_data.size = req.nonce_len;
-    memcpy(qualifying_data.buffer, req.nonce, req.nonce_len);
+    job->qualifying_data.size = job->req.nonce_len;
+    memcpy(job->qualifying_data.buffer, job->req.nonce, job->req.nonce_len);
 
     charra_log_info("[" LOG_NAME
                     "] Received qualifying data (nonce) of length %d:",
-            req.nonce_len);
-    charra_print_hex(CHARRA_LOG_INFO, req.nonce_len, req.nonce,
+            job->req.nonce_len);
+    charra_print_hex(CHARRA_LOG_INFO, job->req.nonce_len, job->req.nonce,
             "                                              0x", "\n", false);
 
     /* PCR selection */
-    TPML_PCR_SELECTION pcr_selection = {0};
     if ((charra_r = charra_pcr_selections_to_tpm_pcr_selections(
-                 req.pcr_selections_len, req.pcr_selections, &pcr_selection)) !=
-            CHARRA_RC_SUCCESS) {
+                 job->req.pcr_selections_len, job->req.pcr_selections,
+                 &job->pcr_selection)) != CHARRA_RC_SUCCESS) {
         charra_log_error("[" LOG_NAME "] PCR selection conversion error.");
         goto error;
     }
 
-    /* initialize ESAPI */
-    ESYS_CONTEXT* esys_ctx = NULL;
-    TSS2_TCTI_CONTEXT* tcti_ctx = NULL;
-    if ((tss_r = Tss2_TctiLdr_Initialize(getenv("CHARRA_TCTI"), &tcti_ctx)) !=
-            TSS2_RC_SUCCESS) {
-        charra_log_error("[" LOG_NAME "] Tss2_TctiLdr_Initialize.");
+    /* answer retransmitted requests from the response cache */
+    if ((charra_r = charra_response_cache_selection_digest(
+                 &job->req, job->selection_digest)) != CHARRA_RC_SUCCESS) {
+        charra_log_error("[" LOG_NAME "] Cannot hash request.");
         goto error;
     }
-    if ((tss_r = Esys_Initialize(&esys_ctx, tcti_ctx, NULL)) !=
-            TSS2_RC_SUCCESS) {
-        charra_log_error("[" LOG_NAME "] Esys_Initialize.");
-        goto error;
+    coap_block_b_t block = {0};
+    const bool further_block =
+            coap_get_block_b(session, request, COAP_OPTION_BLOCK2, &block) &&
+            block.num > 0;
+    charra_response_cache_stream* cached = NULL;
+    charra_r = charra_response_cache_lookup(&response_cache,
+            coap_session_get_addr_remote(session), job->req.nonce_len,
+            job->req.nonce, job->selection_digest, further_block, &cached);
+    if (response_cache.ttl_ms > 0) {
+        charra_log_debug("[" LOG_NAME "] Response cache: %" PRIu64
+                         " hits, %" PRIu64 " misses (%.1f%% hit rate).",
+                response_cache.hits, response_cache.misses,
+                charra_response_cache_hit_rate(&response_cache));
+    }
+    if (charra_r == CHARRA_RC_SUCCESS) {
+        /* retransmission or request for a further block */
+        charra_response_cache_pin(&response_cache, cached,
+                attester_send_block(session, request, response, cached));
+        attest_job_free(job);
+        return;
     }
 
-    /* load TPM key */
-    charra_log_info("[" LOG_NAME "] Loading TPM (attestation) key.");
-    if ((charra_r = charra_load_tpm2_key(esys_ctx, &sig_key_handle,
-                 &cli_attester_config.specific_config.attester_config)) !=
-            CHARRA_RC_SUCCESS) {
-        charra_log_error(
-                "[" LOG_NAME "] Could not load TPM (attestation) key.");
+    /* further blocks are only served from the response they belong to */
+    if (further_block) {
+        charra_log_error("[" LOG_NAME "] Block %u requested for a response "
+                         "that is no longer cached.",
+                block.num);
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_REQUEST);
+        attest_job_free(job);
+        return;
+    }
+
+    /* shed load if the TPM cannot keep up */
+    uint32_t max_age_s = 0;
+    if (!attester_admit(session, &max_age_s)) {
+        uint8_t max_age_buf[4] = {0};
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_SERVICE_UNAVAILABLE);
+        coap_add_option(response, COAP_OPTION_MAXAGE,
+                coap_encode_var_safe(
+                        max_age_buf, sizeof(max_age_buf), max_age_s),
+                max_age_buf);
+        attest_job_free(job);
+        return;
+    }
+
+    /* defer the response until the TPM has finished the quote */
+    if ((job->async = coap_register_async(session, request, 0)) == NULL) {
+        charra_log_error("[" LOG_NAME "] Cannot defer CoAP response.");
         goto error;
     }
+    job->session = coap_session_reference(session);
+    coap_async_set_app_data(job->async, job);
+    coap_ticks(&job->received);
 
-    /* perform TPM quote */
-    charra_log_info("[" LOG_NAME "] Perform TPM2 Quote.");
-    TPM2B_ATTEST* attest_buf = NULL;
-    TPMT_SIGNATURE* signature = NULL;
-    if ((tss_r = tpm2_quote(esys_ctx, sig_key_handle, &pcr_selection,
-                 &qualifying_data, &attest_buf, &signature)) !=
-            TSS2_RC_SUCCESS) {
-        charra_log_error(
-                "[" LOG_NAME "] TPM2 quote unsuccessful. Error: %d", tss_r);
+    /* enqueue TPM quote */
+    if (job_queue_tail != NULL) {
+        job_queue_tail->next = job;
+    } else {
+        job_queue_head = job;
+    }
+    job_queue_tail = job;
+    queue_stats.depth += 1;
+    queue_stats.admitted += 1;
+    if (queue_stats.depth > queue_stats.depth_peak) {
+        queue_stats.depth_peak = queue_stats.depth;
+    }
+    charra_log_info("[" LOG_NAME "] Queued TPM2 Quote.");
+    charra_log_debug("[" LOG_NAME "] Quote queue: depth %" PRIu32
+                     " (peak %" PRIu32 "), %" PRIu64 " admitted, %" PRIu64
+                     " rejected (queue full), %" PRIu64
+                     " rejected (peer share).",
+            queue_stats.depth, queue_stats.depth_peak, queue_stats.admitted,
+            queue_stats.rejected_full, queue_stats.rejected_peer);
+
+    attester_run_jobs();
+    return;
+
+error:
+    attest_job_free(job);
+}
+
+static void attester_send_response(struct coap_resource_t* resource,
+        struct coap_session_t* session, const struct coap_pdu_t* request,
+        const struct coap_string_t* query, struct coap_pdu_t* response,
+        attest_job* job) {
+    CHARRA_RC charra_r = CHARRA_RC_SUCCESS;
+    int coap_r = 0;
+    pcr_log_response_dto* pcr_log_responses = NULL;
+    charra_tap_marshaled_response marshaled = {0};
+    charra_response_cache_stream* stream = NULL;
+    uint8_t* res_buf = NULL;
+
+    if (job->result != CHARRA_RC_SUCCESS) {
+        charra_log_error("[" LOG_NAME "] TPM2 quote unsuccessful.");
         goto error;
     } else {
         charra_log_info("[" LOG_NAME "] TPM2 Quote successful.");
@@ -393,17 +796,19 @@ static void coap_attest_handler(struct coap_resource_t* resource,
 
     /* --- send response data --- */
 
-    pcr_log_response_dto* pcr_log_responses = NULL;
-    pcr_log_responses = malloc(req.pcr_log_len * sizeof(pcr_log_response_dto));
+    pcr_log_responses =
+            calloc(job->req.pcr_log_len, sizeof(pcr_log_response_dto));
+    if (job->req.pcr_log_len > 0 && pcr_log_responses == NULL) {
+        charra_log_error("[" LOG_NAME "] Cannot allocate memory.");
+        goto error;
+    }
 
     /* parse log files if requested */
-    for (uint32_t i = 0; i < req.pcr_log_len; i++) {
-        parse_pcr_log_request(LOG_NAME,
-                cli_attester_config.specific_config.attester_config
-                        .ima_log_path,
+    for (uint32_t i = 0; i < job->req.pcr_log_len; i++) {
+        parse_pcr_log_request(LOG_NAME, ima_index_valid ? &ima_index : NULL,
                 cli_attester_config.specific_config.attester_config
                         .tcg_boot_log_path,
-                req.pcr_logs + i, pcr_log_responses + i);
+                job->req.pcr_logs + i, pcr_log_responses + i);
     }
 
     /* prepare response */
@@ -413,88 +818,640 @@ static void coap_attest_handler(struct coap_resource_t* resource,
     charra_tap_msg_attestation_response_dto res = {
             .tpm2_quote =
                     {
-                            .attestation_data_len = attest_buf->size,
+                            .attestation_data_len = job->attest_buf->size,
                             .attestation_data =
                                     {0},  // must be memcpy'd, see below
-                            .tpm2_signature_len = sizeof(*signature),
+                            .tpm2_signature_len = sizeof(*job->signature),
                             .tpm2_signature =
                                     {0},  // must be memcpy'd, see below
                     },
-            .pcr_log_len = req.pcr_log_len,
+            .pcr_log_len = job->req.pcr_log_len,
             .pcr_logs = pcr_log_responses,
+            .has_nonce_inclusion_proof = job->has_nonce_inclusion_proof,
+            .nonce_inclusion_proof = job->nonce_inclusion_proof,
+            .has_pcr_values =
+                    job->req.disclose_pcr_values && job->pcr_values != NULL,
     };
-    memcpy(res.tpm2_quote.attestation_data, attest_buf->attestationData,
+    memcpy(res.tpm2_quote.attestation_data, job->attest_buf->attestationData,
             res.tpm2_quote.attestation_data_len);
-    memcpy(res.tpm2_quote.tpm2_signature, signature,
+    memcpy(res.tpm2_quote.tpm2_signature, job->signature,
             res.tpm2_quote.tpm2_signature_len);
+    if (res.has_pcr_values) {
+        res.pcr_values = *job->pcr_values;
+    }
 
-    /* clean up */
-    charra_free_and_null(signature);
-    charra_free_and_null(attest_buf);
-
-    /* marshal response */
+    /* marshal response, referencing the PCR logs instead of reading them */
     charra_log_info("[" LOG_NAME "] Marshaling response to CBOR.");
-    uint32_t res_buf_len = 0;
-    uint8_t* res_buf = NULL;
-    if ((charra_r = charra_tap_marshal_attestation_response(
-                 &res, &res_buf_len, &res_buf)) != CHARRA_RC_SUCCESS) {
+    if ((charra_r = charra_tap_marshal_attestation_response_segments(
+                 &res, &marshaled)) != CHARRA_RC_SUCCESS) {
         charra_log_error("[" LOG_NAME "] Error marshaling data.");
         goto error;
     }
-    charra_log_info("[" LOG_NAME "] Size of marshaled response is %d bytes.",
-            res_buf_len);
+    charra_log_info("[" LOG_NAME "] Size of marshaled response is %zu bytes.",
+            marshaled.len);
 
-    // TODO(any) In case an error occurred, an error respone should be sent.
-    // TODO(any): The verifier should be able to handle this error reponse.
+    if (response_cache.ttl_ms > 0) {
+        /* keep response for retransmissions and further blocks */
+        if ((stream = calloc(1, sizeof(charra_response_cache_stream))) ==
+                NULL) {
+            charra_log_error("[" LOG_NAME "] Cannot allocate memory.");
+            goto error;
+        }
+        stream->marshaled = marshaled;
+        stream->pcr_logs_len = job->req.pcr_log_len;
+        stream->pcr_logs = pcr_log_responses;
+        marshaled = (charra_tap_marshaled_response){0};
+        pcr_log_responses = NULL;
+        if (charra_response_cache_insert(&response_cache,
+                    coap_session_get_addr_remote(session), job->req.nonce_len,
+                    job->req.nonce, job->selection_digest,
+                    stream) == CHARRA_RC_SUCCESS) {
+            /* generate blocks as the verifier asks for them */
+            charra_response_cache_pin(&response_cache, stream,
+                    attester_send_block(session, request, response, stream));
+            stream = NULL;
+        } else {
+            /* all entries are busy with transfers, send it uncached */
+            charra_log_warn("[" LOG_NAME "] Cannot cache response.");
+            marshaled = stream->marshaled;
+            pcr_log_responses = stream->pcr_logs;
+            free(stream);
+            stream = NULL;
+        }
+    }
+    if (marshaled.len > 0) {
+        /* without cache, the response has to be sent as a whole */
+        if ((res_buf = malloc(marshaled.len)) == NULL) {
+            charra_log_error("[" LOG_NAME "] Cannot allocate memory.");
+            goto error;
+        }
+        if ((charra_r = charra_tap_marshaled_response_read(&marshaled, 0,
+                     marshaled.len, res_buf)) != CHARRA_RC_SUCCESS) {
+            charra_log_error("[" LOG_NAME "] Error reading PCR logs.");
+            goto error;
+        }
 
-    /* add response data to outgoing PDU and send it */
-    charra_log_info(
-            "[" LOG_NAME
-            "] Adding marshaled data to CoAP response PDU and send it.");
-    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
-    if ((coap_r = coap_add_data_large_response(resource, session, request,
-                 response, query, COAP_MEDIATYPE_APPLICATION_CBOR, -1, 0,
-                 res_buf_len, res_buf, release_data, res_buf)) == 0) {
-        charra_log_error("[" LOG_NAME
-                         "] Error invoking coap_add_data_large_response().");
-        goto error;
+        /* add response data to outgoing PDU and send it */
+        charra_log_info(
+                "[" LOG_NAME
+                "] Adding marshaled data to CoAP response PDU and send it.");
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+        coap_r = coap_add_data_large_response(resource, session, request,
+                response, query, COAP_MEDIATYPE_APPLICATION_CBOR, -1, 0,
+                marshaled.len, res_buf, release_data, res_buf);
+        /* libcoap frees the buffer once sent or on errors */
+        res_buf = NULL;
+        if (coap_r == 0) {
+            charra_log_error("[" LOG_NAME "] Error invoking "
+                             "coap_add_data_large_response().");
+            goto error;
+        }
     }
 
 error:
+    /* a separate response must not be empty */
+    if (coap_pdu_get_code(response) == COAP_EMPTY_CODE) {
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_INTERNAL_ERROR);
+    }
+
     /* free heap objects */
-    charra_free_if_not_null(signature);
-    charra_free_if_not_null(attest_buf);
-    for (uint32_t i = 0; i < req.pcr_log_len; i++) {
-        charra_free_if_not_null(pcr_log_responses[i].identifier);
-        charra_free_if_not_null(pcr_log_responses[i].content);
-    }
-    charra_free_and_null(req.pcr_logs);
-    charra_free_if_not_null(pcr_log_responses);
+    charra_free_if_not_null(res_buf);
+    charra_response_cache_stream_free(stream);
+    charra_tap_marshaled_response_free(&marshaled);
+    if (pcr_log_responses != NULL) {
+        for (uint32_t i = 0; i < job->req.pcr_log_len; i++) {
+            charra_free_if_not_null(pcr_log_responses[i].identifier);
+            charra_free_if_not_null(pcr_log_responses[i].content);
+        }
+        charra_free_and_null(pcr_log_responses);
+    }
     // charra_io_free_continuous_file_buffer(&ima_event_log);
 
-    /* flush handles */
-    if (sig_key_handle != ESYS_TR_NONE) {
-        TSS2_RC r = TSS2_RC_SUCCESS;
-        if (cli_attester_config.specific_config.attester_config
-                        .attestation_key_format ==
-                CLI_UTIL_ATTESTATION_KEY_FORMAT_HANDLE) {
-            /* close persistent key */
-            r = Esys_TR_Close(esys_ctx, &sig_key_handle);
-        } else {
-            /* flush transient key */
-            r = Esys_FlushContext(esys_ctx, sig_key_handle);
+    /* the async entry is removed by libcoap on return */
+    attest_job_free(job);
+}
+
+static bool attester_send_block(struct coap_session_t* session,
+        const struct coap_pdu_t* request, struct coap_pdu_t* response,
+        const charra_response_cache_stream* stream) {
+    uint8_t opt_buf[4] = {0};
+    uint8_t block_buf[1 << (ATTESTER_BLOCK_SZX_MAX + 4)] = {0};
+    const size_t len = stream->marshaled.len;
+
+    /* the block asked for, else the first one */
+    coap_block_b_t block = {0};
+    if (!coap_get_block_b(session, request, COAP_OPTION_BLOCK2, &block)) {
+        block.num = 0;
+        block.szx = ATTESTER_BLOCK_SZX_MAX;
+    } else if (block.szx > ATTESTER_BLOCK_SZX_MAX) {
+        block.szx = ATTESTER_BLOCK_SZX_MAX;
+    }
+
+    coap_pdu_set_code(response, COAP_RESPONSE_CODE_CONTENT);
+    coap_add_option(response, COAP_OPTION_ETAG,
+            coap_encode_var_safe(opt_buf, sizeof(opt_buf), stream->etag),
+            opt_buf);
+    coap_add_option(response, COAP_OPTION_CONTENT_FORMAT,
+            coap_encode_var_safe(opt_buf, sizeof(opt_buf),
+                    COAP_MEDIATYPE_APPLICATION_CBOR),
+            opt_buf);
+
+    /* may shrink the block to fit the PDU */
+    if (coap_write_block_b_opt(
+                session, &block, COAP_OPTION_BLOCK2, response, len) < 0) {
+        charra_log_error("[" LOG_NAME "] Block %u out of range.", block.num);
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_OPTION);
+        return false;
+    }
+    coap_add_option(response, COAP_OPTION_SIZE2,
+            coap_encode_var_safe(opt_buf, sizeof(opt_buf), (unsigned int)len),
+            opt_buf);
+
+    /* read only this block of framing and PCR logs */
+    const size_t block_size = (size_t)1 << (block.szx + 4);
+    const size_t offset = (size_t)block.num * block_size;
+    if (offset >= len) {
+        charra_log_error("[" LOG_NAME "] Block %u out of range.", block.num);
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_BAD_OPTION);
+        return false;
+    }
+    const size_t block_len =
+            (len - offset < block_size) ? len - offset : block_size;
+    if (charra_tap_marshaled_response_read(
+                &stream->marshaled, offset, block_len, block_buf) !=
+            CHARRA_RC_SUCCESS) {
+        charra_log_error("[" LOG_NAME "] Error reading PCR logs.");
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_INTERNAL_ERROR);
+        return false;
+    }
+    charra_log_info("[" LOG_NAME "] Sending block %u (%zu bytes) of %zu "
+                    "bytes.",
+            block.num, block_len, len);
+    if (coap_add_data(response, block_len, block_buf) == 0) {
+        charra_log_error("[" LOG_NAME "] Error adding CoAP response data.");
+        coap_pdu_set_code(response, COAP_RESPONSE_CODE_INTERNAL_ERROR);
+        return false;
+    }
+
+    return block.m != 0;
+}
+
+static void attest_job_free(attest_job* job) {
+    if (job == NULL) {
+        return;
+    }
+    charra_free_if_not_null(job->signature);
+    charra_free_if_not_null(job->attest_buf);
+    charra_free_if_not_null(job->pcr_values);
+    charra_free_if_not_null(job->req.pcr_logs);
+    if (job->session != NULL) {
+        coap_session_release(job->session);
+    }
+    free(job);
+}
+
+static void attester_free_jobs(void) {
+    while (job_in_flight != NULL) {
+        attest_job* job = job_in_flight;
+        job_in_flight = job->next;
+        attest_job_free(job);
+    }
+    while (job_queue_head != NULL) {
+        attest_job* job = job_queue_head;
+        job_queue_head = job->next;
+        attest_job_free(job);
+    }
+    job_queue_tail = NULL;
+    queue_stats.depth = 0;
+    charra_free_if_not_null(tcti_poll_handles);
+    tcti_poll_handles_len = 0;
+    pcr_read_in_flight = false;
+}
+
+static bool attester_admit(const coap_session_t* session, uint32_t* max_age_s) {
+    const cli_config_attester* config =
+            &cli_attester_config.specific_config.attester_config;
+    const coap_address_t* peer = coap_session_get_addr_remote(session);
+
+    /* queued requests of the peer */
+    uint32_t peer_depth = 0;
+    for (const attest_job* job = job_queue_head; job != NULL;
+            job = job->next) {
+        if (coap_address_equals(
+                    coap_session_get_addr_remote(job->session), peer)) {
+            peer_depth += 1;
         }
-        if (r != TSS2_RC_SUCCESS) {
-            charra_log_error(
-                    "[" LOG_NAME "] TSS cleanup sig_key_handle failed.");
+    }
+
+    uint32_t wait_depth = 0;
+    if (queue_stats.depth >= config->queue_max) {
+        queue_stats.rejected_full += 1;
+        wait_depth = queue_stats.depth;
+    } else if (peer_depth >= config->queue_max_per_peer) {
+        queue_stats.rejected_peer += 1;
+        wait_depth = peer_depth;
+    } else {
+        return true;
+    }
+
+    /* retry once the requests ahead are expected to be quoted */
+    const uint64_t latency_ms = (queue_stats.quote_latency_ms > 0)
+                                        ? queue_stats.quote_latency_ms
+                                        : ATTESTER_INITIAL_QUOTE_LATENCY_MS;
+    const uint64_t wait_ms = (uint64_t)wait_depth * latency_ms;
+    *max_age_s = (uint32_t)((wait_ms + 999) / 1000);
+    if (*max_age_s == 0) {
+        *max_age_s = 1;
+    }
+
+    charra_log_warn("[" LOG_NAME "] Rejecting request: %s (depth %" PRIu32
+                    ", peer %" PRIu32 "), retry in %" PRIu32 " s. %" PRIu64
+                    " rejected (queue full), %" PRIu64
+                    " rejected (peer share).",
+            (wait_depth == peer_depth) ? "peer share exhausted"
+                                       : "queue full",
+            queue_stats.depth, peer_depth, *max_age_s,
+            queue_stats.rejected_full, queue_stats.rejected_peer);
+
+    return false;
+}
+
+static uint32_t attester_coalesce_wait_ms(void) {
+    const uint32_t window_ms = cli_attester_config.specific_config
+                                       .attester_config.coalesce_window_ms;
+    if (window_ms == 0 || job_queue_head == NULL) {
+        return 0;
+    }
+
+    coap_tick_t now = 0;
+    coap_ticks(&now);
+    const uint64_t elapsed_ms =
+            (uint64_t)(now - job_queue_head->received) * 1000 /
+            COAP_TICKS_PER_SECOND;
+
+    return (elapsed_ms < window_ms) ? (uint32_t)(window_ms - elapsed_ms) : 0;
+}
+
+/**
+ * @brief Whether \a a and \a b can be answered with the same quote.
+ */
+static bool attester_jobs_coalescable(
+        const attest_job* a, const attest_job* b) {
+    return a->req.sig_key_id_len == b->req.sig_key_id_len &&
+           memcmp(a->req.sig_key_id, b->req.sig_key_id,
+                   a->req.sig_key_id_len) == 0 &&
+           memcmp(&a->pcr_selection, &b->pcr_selection,
+                   sizeof(TPML_PCR_SELECTION)) == 0;
+}
+
+static CHARRA_RC attester_dequeue_batch(
+        attest_job** batch, TPM2B_DATA* qualifying_data) {
+    CHARRA_RC charra_r = CHARRA_RC_SUCCESS;
+    uint8_t(*leaf_hashes)[CHARRA_MERKLE_HASH_SIZE] = NULL;
+
+    /* dequeue oldest job */
+    attest_job* head = job_queue_head;
+    job_queue_head = head->next;
+    head->next = NULL;
+    attest_job* tail = head;
+    size_t batch_len = 1;
+
+    /* move all jobs that can share the quote into the batch */
+    if (cli_attester_config.specific_config.attester_config
+                    .coalesce_window_ms > 0) {
+        attest_job** link = &job_queue_head;
+        while (*link != NULL && batch_len < ATTESTER_COALESCE_MAX_BATCH) {
+            attest_job* job = *link;
+            if (attester_jobs_coalescable(head, job)) {
+                *link = job->next;
+                job->next = NULL;
+                tail->next = job;
+                tail = job;
+                batch_len += 1;
+            } else {
+                link = &job->next;
+            }
         }
     }
+    job_queue_tail = job_queue_head;
+    while (job_queue_tail != NULL && job_queue_tail->next != NULL) {
+        job_queue_tail = job_queue_tail->next;
+    }
+    *batch = head;
+    queue_stats.depth -= batch_len;
+
+    /* a single request is quoted over its own nonce */
+    if (batch_len == 1) {
+        *qualifying_data = head->qualifying_data;
+        return CHARRA_RC_SUCCESS;
+    }
 
-    /* finalize ESAPI */
-    if (esys_ctx != NULL) {
-        Esys_Finalize(&esys_ctx);
+    /* quote over the Merkle root of all nonces */
+    charra_log_info("[" LOG_NAME "] Coalescing %zu requests into one quote.",
+            batch_len);
+    if ((leaf_hashes = calloc(batch_len, CHARRA_MERKLE_HASH_SIZE)) == NULL) {
+        charra_log_error("[" LOG_NAME "] Cannot allocate memory.");
+        charra_r = CHARRA_RC_ERROR;
+        goto error;
+    }
+    size_t i = 0;
+    for (attest_job* job = head; job != NULL; job = job->next, ++i) {
+        if ((charra_r = charra_merkle_leaf_hash(job->qualifying_data.size,
+                     job->qualifying_data.buffer, leaf_hashes[i])) !=
+                CHARRA_RC_SUCCESS) {
+            goto error;
+        }
     }
-    if (tcti_ctx != NULL) {
-        Tss2_TctiLdr_Finalize(&tcti_ctx);
+    if ((charra_r = charra_merkle_root(batch_len,
+                 (const uint8_t(*)[CHARRA_MERKLE_HASH_SIZE])leaf_hashes,
+                 qualifying_data->buffer)) != CHARRA_RC_SUCCESS) {
+        goto error;
+    }
+    qualifying_data->size = CHARRA_MERKLE_HASH_SIZE;
+
+    /* inclusion proof for every request */
+    i = 0;
+    for (attest_job* job = head; job != NULL; job = job->next, ++i) {
+        job->nonce_inclusion_proof.leaf_index = i;
+        job->nonce_inclusion_proof.tree_size = batch_len;
+        if ((charra_r = charra_merkle_inclusion_proof(batch_len,
+                     (const uint8_t(*)[CHARRA_MERKLE_HASH_SIZE])leaf_hashes, i,
+                     &job->nonce_inclusion_proof.path_len,
+                     job->nonce_inclusion_proof.path)) != CHARRA_RC_SUCCESS) {
+            goto error;
+        }
+        job->has_nonce_inclusion_proof = true;
+    }
+
+error:
+    charra_free_if_not_null(leaf_hashes);
+    if (charra_r != CHARRA_RC_SUCCESS) {
+        charra_log_error("[" LOG_NAME "] Cannot compute Merkle root.");
+    }
+
+    return charra_r;
+}
+
+static CHARRA_RC attester_start_quote(
+        attest_job* batch, const TPM2B_DATA* qualifying_data) {
+    CHARRA_RC charra_r = CHARRA_RC_SUCCESS;
+    TSS2_RC tss_r = TSS2_RC_SUCCESS;
+    ESYS_TR sig_key_handle = ESYS_TR_NONE;
+
+    if (tpm2_ctx.esys_ctx == NULL) {
+        charra_log_error("[" LOG_NAME "] No connection to the TPM.");
+        return CHARRA_RC_ERROR;
+    }
+
+    /* get TPM key, loading it only if it is not resident yet */
+    if ((charra_r = charra_key_table_get(&key_table, &tpm2_ctx,
+                 batch->req.sig_key_id_len, batch->req.sig_key_id,
+                 &sig_key_handle)) != CHARRA_RC_SUCCESS) {
+        charra_log_error(
+                "[" LOG_NAME "] Could not load TPM (attestation) key.");
+        return charra_r;
+    }
+
+    /* send TPM quote command */
+    charra_log_info("[" LOG_NAME "] Perform TPM2 Quote.");
+    if ((tss_r = tpm2_quote_async(tpm2_ctx.esys_ctx, sig_key_handle,
+                 &batch->pcr_selection, qualifying_data)) != TSS2_RC_SUCCESS) {
+        charra_log_error("[" LOG_NAME "] Esys_Quote_Async failed. Error: 0x%x",
+                tss_r);
+        return CHARRA_RC_ERROR;
+    }
+
+    attester_poll_tpm();
+    coap_ticks(&quote_started);
+
+    return CHARRA_RC_SUCCESS;
+}
+
+static void attester_poll_tpm(void) {
+    /* wait for the TPM in the event loop if the TCTI can be polled */
+    if (Esys_GetPollHandles(tpm2_ctx.esys_ctx, &tcti_poll_handles,
+                &tcti_poll_handles_len) != TSS2_RC_SUCCESS) {
+        charra_log_debug("[" LOG_NAME "] TCTI provides no poll handles, "
+                         "waiting for the TPM.");
+        tcti_poll_handles = NULL;
+        tcti_poll_handles_len = 0;
+        Esys_SetTimeout(tpm2_ctx.esys_ctx, TSS2_TCTI_TIMEOUT_BLOCK);
+    } else {
+        Esys_SetTimeout(tpm2_ctx.esys_ctx, 0);
+    }
+}
+
+static void attester_finish_tpm(void) {
+    if (pcr_read_in_flight) {
+        attester_finish_pcr_read();
+    } else {
+        attester_finish_quote();
+    }
+}
+
+static void attester_finish_quote(void) {
+    attest_job* batch = job_in_flight;
+    if (batch == NULL) {
+        return;
+    }
+
+    TSS2_RC tss_r = tpm2_quote_finish(
+            tpm2_ctx.esys_ctx, &batch->attest_buf, &batch->signature);
+    if (tss_r == TSS2_ESYS_RC_TRY_AGAIN) {
+        /* TPM not done yet */
+        return;
+    }
+    charra_free_if_not_null(tcti_poll_handles);
+    tcti_poll_handles_len = 0;
+    job_in_flight = NULL;
+
+    if (tss_r == TSS2_RC_SUCCESS) {
+        /* measure quote latency for the Max-Age of rejected requests */
+        coap_tick_t now = 0;
+        coap_ticks(&now);
+        const uint32_t latency_ms = (uint32_t)((now - quote_started) * 1000 /
+                                               COAP_TICKS_PER_SECOND);
+        queue_stats.quote_latency_ms =
+                (queue_stats.quote_latency_ms == 0)
+                        ? latency_ms
+                        : (7 * queue_stats.quote_latency_ms + latency_ms) / 8;
+        attester_start_pcr_read(batch);
+        return;
+    }
+
+    charra_log_error(
+            "[" LOG_NAME "] TPM2 quote unsuccessful. Error: 0x%x", tss_r);
+    if (!batch->retried && attester_recover_tpm(batch) == CHARRA_RC_SUCCESS) {
+        batch->retried = true;
+        if (attester_start_quote(batch, &batch_qualifying_data) ==
+                CHARRA_RC_SUCCESS) {
+            job_in_flight = batch;
+            return;
+        }
+    }
+    attester_complete_batch(batch, CHARRA_RC_ERROR);
+}
+
+static void attester_start_pcr_read(attest_job* batch) {
+    bool asked = false;
+    for (attest_job* job = batch; job != NULL; job = job->next) {
+        asked = asked || job->req.disclose_pcr_values;
+    }
+    if (!asked) {
+        attester_complete_batch(batch, CHARRA_RC_SUCCESS);
+        return;
+    }
+
+    /* the quote is done, the TPM is free for reading the PCRs */
+    TSS2_RC tss_r = tpm2_pcr_read_async(tpm2_ctx.esys_ctx,
+            &batch->pcr_selection, CHARRA_TAP_PCR_VALUES_MAX, pcr_read_values,
+            &pcr_read_state);
+    if (tss_r != TSS2_RC_SUCCESS) {
+        charra_log_warn("[" LOG_NAME "] Could not read PCR values, sending "
+                        "the quote without them. Error: 0x%x",
+                tss_r);
+        attester_complete_batch(batch, CHARRA_RC_SUCCESS);
+        return;
+    }
+    attester_poll_tpm();
+    job_in_flight = batch;
+    pcr_read_in_flight = true;
+}
+
+static void attester_finish_pcr_read(void) {
+    attest_job* batch = job_in_flight;
+    if (batch == NULL) {
+        return;
+    }
+
+    TSS2_RC tss_r = tpm2_pcr_read_finish(tpm2_ctx.esys_ctx, &pcr_read_state);
+    if (tss_r == TSS2_ESYS_RC_TRY_AGAIN) {
+        /* TPM not done yet */
+        return;
+    }
+    charra_free_if_not_null(tcti_poll_handles);
+    tcti_poll_handles_len = 0;
+    job_in_flight = NULL;
+    pcr_read_in_flight = false;
+
+    if (tss_r != TSS2_RC_SUCCESS) {
+        charra_log_warn("[" LOG_NAME "] Could not read PCR values, sending "
+                        "the quote without them. Error: 0x%x",
+                tss_r);
+        attester_complete_batch(batch, CHARRA_RC_SUCCESS);
+        return;
+    }
+    if ((batch->pcr_values = calloc(1, sizeof(*batch->pcr_values))) == NULL) {
+        charra_log_error("[" LOG_NAME "] Cannot allocate memory.");
+        attester_complete_batch(batch, CHARRA_RC_SUCCESS);
+        return;
+    }
+    for (size_t i = 0; i < pcr_read_state.pcr_values_len; i++) {
+        charra_tap_pcr_value_dto* pcr_value =
+                &batch->pcr_values->pcr_values[i];
+        pcr_value->tcg_hash_alg_id = pcr_read_values[i].hash;
+        pcr_value->pcr = pcr_read_values[i].pcr;
+        pcr_value->value_len = pcr_read_values[i].value.size;
+        memcpy(pcr_value->value, pcr_read_values[i].value.buffer,
+                pcr_read_values[i].value.size);
+    }
+    batch->pcr_values->pcr_values_len =
+            (uint32_t)pcr_read_state.pcr_values_len;
+    charra_log_info("[" LOG_NAME "] Read %zu PCR values.",
+            pcr_read_state.pcr_values_len);
+    attester_complete_batch(batch, CHARRA_RC_SUCCESS);
+}
+
+static void attester_run_jobs(void) {
+    for (;;) {
+        if (job_in_flight != NULL) {
+            if (tcti_poll_handles_len > 0) {
+                /* result is collected from the event loop */
+                return;
+            }
+            /* TCTI cannot be polled, wait for the TPM right away */
+            attester_finish_tpm();
+            continue;
+        }
+        if (job_queue_head == NULL || attester_coalesce_wait_ms() > 0) {
+            return;
+        }
+
+        attest_job* batch = NULL;
+        CHARRA_RC charra_r =
+                attester_dequeue_batch(&batch, &batch_qualifying_data);
+        if (charra_r == CHARRA_RC_SUCCESS) {
+            charra_r = attester_start_quote(batch, &batch_qualifying_data);
+            if (charra_r == CHARRA_RC_ERROR &&
+                    attester_recover_tpm(batch) == CHARRA_RC_SUCCESS) {
+                batch->retried = true;
+                charra_r =
+                        attester_start_quote(batch, &batch_qualifying_data);
+            }
+        }
+        if (charra_r == CHARRA_RC_SUCCESS) {
+            job_in_flight = batch;
+        } else {
+            attester_complete_batch(batch, charra_r);
+        }
+    }
+}
+
+static CHARRA_RC attester_recover_tpm(const attest_job* job) {
+    if (!tpm2_esys_context_is_alive(&tpm2_ctx)) {
+        /* TPM or resource manager went away; reconnect */
+        charra_log_warn("[" LOG_NAME "] Lost connection to the TPM.");
+        return (tpm2_esys_context_reconnect(&tpm2_ctx) == TSS2_RC_SUCCESS)
+                       ? CHARRA_RC_SUCCESS
+                       : CHARRA_RC_ERROR;
+    }
+
+    /* cached key may have been flushed (e.g. TPM reset); reload it */
+    charra_log_warn("[" LOG_NAME "] Reloading TPM (attestation) key.");
+    charra_key_table_invalidate(&key_table, &tpm2_ctx, job->req.sig_key_id_len,
+            job->req.sig_key_id);
+
+    return CHARRA_RC_SUCCESS;
+}
+
+static void attester_complete_batch(attest_job* batch, CHARRA_RC result) {
+    charra_log_debug("[" LOG_NAME "] Key table: %" PRIu64 " hits, %" PRIu64
+                     " misses, %" PRIu64 " evictions.",
+            key_table.hits, key_table.misses, key_table.evictions);
+
+    attest_job* job = batch;
+    while (job != NULL) {
+        attest_job* next = job->next;
+        job->next = NULL;
+        job->result = result;
+
+        /* coalesced requests get a copy of the shared quote */
+        if (result == CHARRA_RC_SUCCESS && job != batch) {
+            job->attest_buf = malloc(sizeof(TPM2B_ATTEST));
+            job->signature = malloc(sizeof(TPMT_SIGNATURE));
+            if (job->attest_buf != NULL && job->signature != NULL) {
+                memcpy(job->attest_buf, batch->attest_buf,
+                        sizeof(TPM2B_ATTEST));
+                memcpy(job->signature, batch->signature,
+                        sizeof(TPMT_SIGNATURE));
+            } else {
+                charra_log_error("[" LOG_NAME "] Cannot allocate memory.");
+                job->result = CHARRA_RC_ERROR;
+            }
+            if (batch->pcr_values != NULL && job->req.disclose_pcr_values) {
+                job->pcr_values = malloc(sizeof(*job->pcr_values));
+                if (job->pcr_values != NULL) {
+                    memcpy(job->pcr_values, batch->pcr_values,
+                            sizeof(*job->pcr_values));
+                } else {
+                    charra_log_error(
+                            "[" LOG_NAME "] Cannot allocate memory.");
+                }
+            }
+        }
+
+        job->done = true;
+        coap_async_trigger(job->async);
+        job = next;
     }
 }
@@ -0,0 +1,414 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_allowlist.c
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Compiles file digest allowlists into a binary index and looks up
+ * digests in the index mapped into memory.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+/* posix_madvise() */
+#define _POSIX_C_SOURCE 200809L
+
+#include "charra_allowlist.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "../common/charra_log.h"
+#include "../common/charra_macro.h"
+#include "../util/crypto_util.h"
+
+#define ALLOWLIST_MAGIC "CHARRAAL"
+#define ALLOWLIST_VERSION 1
+#define ALLOWLIST_HEADER_SIZE 64
+
+/* filter bits per digest and probes, for a false positive rate of ~1% */
+#define ALLOWLIST_FILTER_BITS_PER_DIGEST 10
+#define ALLOWLIST_FILTER_PROBES 7
+#define ALLOWLIST_FILTER_PROBES_MAX 32
+
+/* bounds of the table sizes (log2) */
+#define ALLOWLIST_SLOTS_LOG2_MIN 4
+#define ALLOWLIST_FILTER_LOG2_MIN 10
+#define ALLOWLIST_LOG2_MAX 40
+
+static uint32_t allowlist_get_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static uint64_t allowlist_get_u64(const uint8_t* p) {
+    return (uint64_t)allowlist_get_u32(p) |
+           ((uint64_t)allowlist_get_u32(p + 4) << 32);
+}
+
+static void allowlist_put_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void allowlist_put_u32(uint8_t* p, uint32_t v) {
+    allowlist_put_u16(p, (uint16_t)v);
+    allowlist_put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void allowlist_put_u64(uint8_t* p, uint64_t v) {
+    allowlist_put_u32(p, (uint32_t)v);
+    allowlist_put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static bool allowlist_is_zero(const uint8_t* digest, size_t digest_len) {
+    for (size_t i = 0; i < digest_len; ++i) {
+        if (digest[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Returns the smallest log2 of a power of two of at least \a n, but
+ * not less than \a min.
+ */
+static uint32_t allowlist_log2_ceil(uint64_t n, uint32_t min) {
+    uint32_t log2 = min;
+    while (log2 < ALLOWLIST_LOG2_MAX && ((uint64_t)1 << log2) < n) {
+        ++log2;
+    }
+    return log2;
+}
+
+static uint64_t allowlist_filter_bit(
+        const uint8_t* digest, uint16_t digest_size, uint32_t probe) {
+    const uint64_t h1 = allowlist_get_u64(digest + 8);
+    const uint64_t h2 = allowlist_get_u64(digest + digest_size - 8) | 1;
+    return h1 + probe * h2;
+}
+
+static int allowlist_hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Parses a line of a digest list.
+ *
+ * @return 1 if a digest of \a hash_alg was parsed, 0 if the line is to be
+ * skipped, -1 if it is malformed.
+ */
+static int allowlist_parse_line(const char* line, size_t line_len,
+        TPMI_ALG_HASH hash_alg, uint16_t digest_size, uint8_t* digest) {
+    size_t pos = 0;
+    while (pos < line_len && (line[pos] == ' ' || line[pos] == '\t')) {
+        ++pos;
+    }
+    if (pos == line_len || line[pos] == '#') {
+        return 0;
+    }
+
+    /* digest field, with optional algorithm prefix */
+    size_t end = pos;
+    while (end < line_len && line[end] != ' ' && line[end] != '\t') {
+        ++end;
+    }
+    const char* colon = memchr(line + pos, ':', end - pos);
+    if (colon != NULL) {
+        const size_t name_len = (size_t)(colon - (line + pos));
+        if (charra_crypto_tpm2_hash_alg_from_name(line + pos, name_len) !=
+                hash_alg) {
+            return 0;
+        }
+        pos += name_len + 1;
+    }
+    if (end - pos != 2 * (size_t)digest_size) {
+        return -1;
+    }
+    for (size_t i = 0; i < digest_size; ++i) {
+        const int hi = allowlist_hex_value(line[pos + 2 * i]);
+        const int lo = allowlist_hex_value(line[pos + 2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return -1;
+        }
+        digest[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return 1;
+}
+
+/**
+ * @brief Inserts a digest into the slots and the filter.
+ *
+ * @return true if the digest was inserted, false if it is a duplicate.
+ */
+static bool allowlist_insert(uint8_t* filter, uint64_t filter_mask,
+        uint8_t* slots, uint64_t slots_mask, uint16_t digest_size,
+        const uint8_t* digest) {
+    uint64_t i = allowlist_get_u64(digest) & slots_mask;
+    for (;; i = (i + 1) & slots_mask) {
+        uint8_t* slot = slots + i * digest_size;
+        if (memcmp(slot, digest, digest_size) == 0) {
+            return false;
+        }
+        if (allowlist_is_zero(slot, digest_size)) {
+            memcpy(slot, digest, digest_size);
+            break;
+        }
+    }
+    for (uint32_t p = 0; p < ALLOWLIST_FILTER_PROBES; ++p) {
+        const uint64_t bit =
+                allowlist_filter_bit(digest, digest_size, p) & filter_mask;
+        filter[bit / 8] |= (uint8_t)(1u << (bit % 8));
+    }
+    return true;
+}
+
+CHARRA_RC charra_allowlist_build(const char* list_path,
+        TPMI_ALG_HASH hash_alg, const char* index_path, uint64_t* count) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    charra_io_file_buffer list = {0};
+    uint8_t* digests = NULL;
+    uint8_t* index = NULL;
+    char* tmp_path = NULL;
+    FILE* file = NULL;
+    size_t digests_len = 0;
+    size_t digests_cap = 0;
+
+    const uint16_t digest_size = charra_crypto_tpm2_hash_size(hash_alg);
+    if (digest_size == 0) {
+        charra_log_error("Unsupported allowlist hash algorithm 0x%04x.",
+                hash_alg);
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+    if ((r = charra_io_map_file(list_path, &list)) != CHARRA_RC_SUCCESS) {
+        return r;
+    }
+
+    /* parse digests */
+    const char* text = (const char*)list.data;
+    uint64_t line_no = 0;
+    for (size_t pos = 0; pos < list.len; ++line_no) {
+        const char* eol = memchr(text + pos, '\n', list.len - pos);
+        size_t line_len = (eol != NULL) ? (size_t)(eol - (text + pos))
+                                        : list.len - pos;
+        const size_t next = pos + line_len + 1;
+        if (line_len > 0 && text[pos + line_len - 1] == '\r') {
+            --line_len;
+        }
+
+        if (digests_len == digests_cap) {
+            const size_t cap = (digests_cap == 0) ? 1024 : 2 * digests_cap;
+            uint8_t* grown = realloc(digests, cap * digest_size);
+            if (grown == NULL) {
+                charra_log_error("Cannot allocate memory for allowlist.");
+                r = CHARRA_RC_ERROR;
+                goto error;
+            }
+            digests = grown;
+            digests_cap = cap;
+        }
+        uint8_t* digest = digests + digests_len * digest_size;
+        const int parsed = allowlist_parse_line(
+                text + pos, line_len, hash_alg, digest_size, digest);
+        if (parsed < 0) {
+            charra_log_error("Malformed digest in line %" PRIu64 " of '%s'.",
+                    line_no + 1, list_path);
+            r = CHARRA_RC_MARSHALING_ERROR;
+            goto error;
+        }
+        /* empty slots are all zeros, so the zero digest cannot be stored */
+        if (parsed > 0 && !allowlist_is_zero(digest, digest_size)) {
+            ++digests_len;
+        }
+        pos = next;
+    }
+
+    /* build index */
+    const uint32_t slots_log2 =
+            allowlist_log2_ceil(2 * (uint64_t)digests_len + 1,
+                    ALLOWLIST_SLOTS_LOG2_MIN);
+    const uint32_t filter_log2 = allowlist_log2_ceil(
+            ALLOWLIST_FILTER_BITS_PER_DIGEST * (uint64_t)digests_len,
+            ALLOWLIST_FILTER_LOG2_MIN);
+    const size_t filter_size = ((size_t)1 << filter_log2) / 8;
+    const size_t index_size = ALLOWLIST_HEADER_SIZE + filter_size +
+                              ((size_t)1 << slots_log2) * digest_size;
+    if ((index = calloc(1, index_size)) == NULL) {
+        charra_log_error("Cannot allocate memory for allowlist index.");
+        r = CHARRA_RC_ERROR;
+        goto error;
+    }
+    uint8_t* filter = index + ALLOWLIST_HEADER_SIZE;
+    uint8_t* slots = filter + filter_size;
+    uint64_t unique = 0;
+    for (size_t i = 0; i < digests_len; ++i) {
+        if (allowlist_insert(filter, ((uint64_t)1 << filter_log2) - 1, slots,
+                    ((uint64_t)1 << slots_log2) - 1, digest_size,
+                    digests + i * digest_size)) {
+            ++unique;
+        }
+    }
+    memcpy(index, ALLOWLIST_MAGIC, 8);
+    allowlist_put_u32(index + 8, ALLOWLIST_VERSION);
+    allowlist_put_u16(index + 12, hash_alg);
+    allowlist_put_u16(index + 14, digest_size);
+    allowlist_put_u64(index + 16, unique);
+    allowlist_put_u32(index + 24, slots_log2);
+    allowlist_put_u32(index + 28, filter_log2);
+    allowlist_put_u32(index + 32, ALLOWLIST_FILTER_PROBES);
+
+    /* write index, replacing the old one atomically */
+    if ((tmp_path = malloc(strlen(index_path) + sizeof(".tmp"))) == NULL) {
+        r = CHARRA_RC_ERROR;
+        goto error;
+    }
+    strcpy(tmp_path, index_path);
+    strcat(tmp_path, ".tmp");
+    if ((file = fopen(tmp_path, "wb")) == NULL ||
+            fwrite(index, 1, index_size, file) != index_size) {
+        charra_log_error("Cannot write allowlist index '%s'.", tmp_path);
+        r = CHARRA_RC_ERROR;
+        goto error;
+    }
+    if (fclose(file) != 0) {
+        file = NULL;
+        charra_log_error("Cannot write allowlist index '%s'.", tmp_path);
+        r = CHARRA_RC_ERROR;
+        goto error;
+    }
+    file = NULL;
+    if (rename(tmp_path, index_path) != 0) {
+        charra_log_error("Cannot rename '%s' to '%s'.", tmp_path, index_path);
+        r = CHARRA_RC_ERROR;
+        goto error;
+    }
+    *count = unique;
+
+error:
+    if (file != NULL) {
+        fclose(file);
+    }
+    if (r != CHARRA_RC_SUCCESS && tmp_path != NULL) {
+        remove(tmp_path);
+    }
+    charra_free_if_not_null(tmp_path);
+    charra_free_if_not_null(index);
+    charra_free_if_not_null(digests);
+    charra_io_unmap_file(&list);
+
+    return r;
+}
+
+CHARRA_RC charra_allowlist_open(
+        const char* index_path, charra_allowlist* allowlist) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+
+    *allowlist = (charra_allowlist){0};
+    if ((r = charra_io_map_file(index_path, &allowlist->file)) !=
+            CHARRA_RC_SUCCESS) {
+        return r;
+    }
+    const uint8_t* header = allowlist->file.data;
+    const size_t len = allowlist->file.len;
+    if (len < ALLOWLIST_HEADER_SIZE ||
+            memcmp(header, ALLOWLIST_MAGIC, 8) != 0 ||
+            allowlist_get_u32(header + 8) != ALLOWLIST_VERSION) {
+        goto malformed;
+    }
+
+    allowlist->hash_alg = (TPMI_ALG_HASH)(header[12] | (header[13] << 8));
+    allowlist->digest_size = (uint16_t)(header[14] | (header[15] << 8));
+    allowlist->count = allowlist_get_u64(header + 16);
+    const uint32_t slots_log2 = allowlist_get_u32(header + 24);
+    const uint32_t filter_log2 = allowlist_get_u32(header + 28);
+    allowlist->filter_probes = allowlist_get_u32(header + 32);
+    if (allowlist->digest_size == 0 ||
+            allowlist->digest_size !=
+                    charra_crypto_tpm2_hash_size(allowlist->hash_alg) ||
+            slots_log2 > ALLOWLIST_LOG2_MAX ||
+            filter_log2 < ALLOWLIST_FILTER_LOG2_MIN ||
+            filter_log2 > ALLOWLIST_LOG2_MAX ||
+            allowlist->filter_probes == 0 ||
+            allowlist->filter_probes > ALLOWLIST_FILTER_PROBES_MAX ||
+            allowlist->count > ((uint64_t)1 << slots_log2) / 2) {
+        goto malformed;
+    }
+    const uint64_t filter_size = ((uint64_t)1 << filter_log2) / 8;
+    const uint64_t slots_size =
+            ((uint64_t)1 << slots_log2) * allowlist->digest_size;
+    if ((uint64_t)len != ALLOWLIST_HEADER_SIZE + filter_size + slots_size) {
+        goto malformed;
+    }
+    allowlist->filter = header + ALLOWLIST_HEADER_SIZE;
+    allowlist->filter_mask = ((uint64_t)1 << filter_log2) - 1;
+    allowlist->slots = allowlist->filter + filter_size;
+    allowlist->slots_mask = ((uint64_t)1 << slots_log2) - 1;
+
+    /* lookups hit random pages, read ahead would only waste memory */
+    if (allowlist->file.mapped) {
+        posix_madvise(allowlist->file.data, len, POSIX_MADV_RANDOM);
+    }
+
+    return CHARRA_RC_SUCCESS;
+
+malformed:
+    charra_log_error("'%s' is not a valid allowlist index.", index_path);
+    charra_allowlist_close(allowlist);
+    return CHARRA_RC_MARSHALING_ERROR;
+}
+
+void charra_allowlist_close(charra_allowlist* allowlist) {
+    charra_io_unmap_file(&allowlist->file);
+    *allowlist = (charra_allowlist){0};
+}
+
+bool charra_allowlist_contains(const charra_allowlist* allowlist,
+        TPMI_ALG_HASH hash_alg, size_t digest_len, const uint8_t* digest) {
+    const uint16_t digest_size = allowlist->digest_size;
+    if (hash_alg != allowlist->hash_alg || digest_len != digest_size ||
+            allowlist->count == 0 || allowlist_is_zero(digest, digest_len)) {
+        return false;
+    }
+
+    /* filter */
+    for (uint32_t p = 0; p < allowlist->filter_probes; ++p) {
+        const uint64_t bit = allowlist_filter_bit(digest, digest_size, p) &
+                             allowlist->filter_mask;
+        if ((allowlist->filter[bit / 8] & (1u << (bit % 8))) == 0) {
+            return false;
+        }
+    }
+
+    /* slots, up to the next empty one */
+    uint64_t i = allowlist_get_u64(digest) & allowlist->slots_mask;
+    for (uint64_t n = 0; n <= allowlist->slots_mask; ++n) {
+        const uint8_t* slot = allowlist->slots + i * digest_size;
+        if (memcmp(slot, digest, digest_size) == 0) {
+            return true;
+        }
+        if (allowlist_is_zero(slot, digest_size)) {
+            return false;
+        }
+        i = (i + 1) & allowlist->slots_mask;
+    }
+    return false;
+}
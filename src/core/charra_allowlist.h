@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_allowlist.h
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Compiles file digest allowlists into a binary index and looks up
+ * digests in the index mapped into memory.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ *
+ * The index consists of a header, a Bloom filter and an open-addressed hash
+ * table of the digests, all stored in the layout they are used in, so that
+ * the index can be used right after mapping it without parsing:
+ *
+ * | Offset | Size        | Field                                        |
+ * |--------|-------------|----------------------------------------------|
+ * | 0      | 8           | magic "CHARRAAL"                             |
+ * | 8      | 4           | version (1)                                  |
+ * | 12     | 2           | hash algorithm (TPM2_ALG_ID)                 |
+ * | 14     | 2           | digest size                                  |
+ * | 16     | 8           | number of digests                            |
+ * | 24     | 4           | log2 of the number of slots                  |
+ * | 28     | 4           | log2 of the number of filter bits            |
+ * | 32     | 4           | number of filter probes                      |
+ * | 36     | 28          | reserved (zero)                              |
+ * | 64     | bits / 8    | Bloom filter                                 |
+ * |        | slots * size| slots, empty slots are all zeros             |
+ *
+ * Integers are little-endian. A digest is placed in the slot given by its
+ * first 8 bytes (linear probing), its filter bits are derived from bytes 8 to
+ * 15 and its last 8 bytes (double hashing). At most half of the slots are
+ * used.
+ */
+
+#ifndef CHARRA_ALLOWLIST_H
+#define CHARRA_ALLOWLIST_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <tss2/tss2_tpm2_types.h>
+
+#include "../common/charra_error.h"
+#include "../util/io_util.h"
+
+/**
+ * @brief A digest allowlist index mapped into memory.
+ */
+typedef struct {
+    charra_io_file_buffer file;
+    TPMI_ALG_HASH hash_alg;
+    uint16_t digest_size;
+    /* number of digests */
+    uint64_t count;
+    const uint8_t* filter;
+    uint64_t filter_mask;
+    uint32_t filter_probes;
+    const uint8_t* slots;
+    uint64_t slots_mask;
+} charra_allowlist;
+
+/**
+ * @brief Compiles a digest list into an index.
+ *
+ * Each line of the list starts with a hex-encoded digest, optionally prefixed
+ * with "ALGORITHM:", followed by white space and anything else, such as the
+ * output of sha256sum. Empty lines and lines starting with '#' are skipped,
+ * as are digests of other algorithms. Duplicates are stored once. The index
+ * is written to a temporary file first and then renamed to \a index_path.
+ *
+ * @param[in] list_path The digest list.
+ * @param[in] hash_alg The algorithm of the digests.
+ * @param[in] index_path The index file to write.
+ * @param[out] count The number of digests in the index.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_BAD_ARGUMENT if the algorithm is not supported.
+ * @return CHARRA_RC_MARSHALING_ERROR if a line cannot be parsed.
+ * @return CHARRA_RC_ERROR on I/O or memory errors.
+ */
+CHARRA_RC charra_allowlist_build(const char* list_path,
+        TPMI_ALG_HASH hash_alg, const char* index_path, uint64_t* count);
+
+/**
+ * @brief Maps an index into memory. Only the header and the file size are
+ * checked, nothing is parsed.
+ *
+ * @param[in] index_path The index file.
+ * @param[out] allowlist The allowlist, to be closed with
+ * charra_allowlist_close().
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_MARSHALING_ERROR if the file is not a valid index.
+ * @return CHARRA_RC_ERROR if the file cannot be read.
+ */
+CHARRA_RC charra_allowlist_open(
+        const char* index_path, charra_allowlist* allowlist);
+
+/**
+ * @brief Unmaps an index.
+ *
+ * @param[in,out] allowlist The allowlist.
+ */
+void charra_allowlist_close(charra_allowlist* allowlist);
+
+/**
+ * @brief Looks up a digest, in constant expected time: digests not in the
+ * list are mostly rejected by the filter without touching the slots.
+ *
+ * @param[in] allowlist The allowlist.
+ * @param[in] hash_alg The algorithm of the digest.
+ * @param[in] digest_len The length of \a digest.
+ * @param[in] digest The digest.
+ * @return true if the digest is in the list.
+ */
+bool charra_allowlist_contains(const charra_allowlist* allowlist,
+        TPMI_ALG_HASH hash_alg, size_t digest_len, const uint8_t* digest);
+
+#endif /* CHARRA_ALLOWLIST_H */
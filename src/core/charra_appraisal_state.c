@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_appraisal_state.c
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Keeps the state of the last successful appraisal of each attester so
+ * that later rounds only need to appraise the new entries of its logs.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#include "charra_appraisal_state.h"
+
+#include <string.h>
+
+static charra_appraisal_state* appraisal_state_lookup(
+        const charra_appraisal_states* states, const char* host,
+        uint16_t port) {
+    for (uint32_t i = 0; i < CHARRA_APPRAISAL_STATES_MAX; ++i) {
+        const charra_appraisal_state* state = &states->states[i];
+        if (state->valid && state->port == port &&
+                strcmp(state->host, host) == 0) {
+            return (charra_appraisal_state*)state;
+        }
+    }
+    return NULL;
+}
+
+const charra_appraisal_state* charra_appraisal_state_find(
+        const charra_appraisal_states* states, const char* host,
+        uint16_t port) {
+    return appraisal_state_lookup(states, host, port);
+}
+
+bool charra_appraisal_state_continues(const charra_appraisal_state* state,
+        const TPMS_CLOCK_INFO* clock_info) {
+    return state->reset_count == clock_info->resetCount &&
+           state->restart_count == clock_info->restartCount;
+}
+
+CHARRA_RC charra_appraisal_state_save(charra_appraisal_states* states,
+        const char* host, uint16_t port, const TPMS_CLOCK_INFO* clock_info,
+        const charra_ima_replay* ima_replay) {
+    if (strlen(host) >= CHARRA_APPRAISAL_HOST_MAX_LEN) {
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+
+    /* the attester's slot, else a free one, else the oldest one */
+    charra_appraisal_state* state = appraisal_state_lookup(states, host, port);
+    for (uint32_t i = 0; state == NULL && i < CHARRA_APPRAISAL_STATES_MAX;
+            ++i) {
+        if (!states->states[i].valid) {
+            state = &states->states[i];
+        }
+    }
+    if (state == NULL) {
+        state = &states->states[states->next_evict];
+        states->next_evict =
+                (states->next_evict + 1) % CHARRA_APPRAISAL_STATES_MAX;
+    }
+
+    state->valid = true;
+    strcpy(state->host, host);
+    state->port = port;
+    state->reset_count = clock_info->resetCount;
+    state->restart_count = clock_info->restartCount;
+    state->ima_replay = *ima_replay;
+
+    return CHARRA_RC_SUCCESS;
+}
+
+void charra_appraisal_state_forget(
+        charra_appraisal_states* states, const char* host, uint16_t port) {
+    charra_appraisal_state* state = appraisal_state_lookup(states, host, port);
+    if (state != NULL) {
+        state->valid = false;
+    }
+}
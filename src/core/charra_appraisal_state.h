@@ -0,0 +1,116 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_appraisal_state.h
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Keeps the state of the last successful appraisal of each attester so
+ * that later rounds only need to appraise the new entries of its logs.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#ifndef CHARRA_APPRAISAL_STATE_H
+#define CHARRA_APPRAISAL_STATE_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <tss2/tss2_tpm2_types.h>
+
+#include "../common/charra_error.h"
+#include "charra_ima_log.h"
+
+/* maximum number of attesters whose appraisal state is kept */
+#define CHARRA_APPRAISAL_STATES_MAX 64
+
+/* maximum length of an attester's host name, including \0 */
+#define CHARRA_APPRAISAL_HOST_MAX_LEN 256
+
+/**
+ * @brief The appraisal state of one attester.
+ */
+typedef struct {
+    bool valid;
+    /* the attester */
+    char host[CHARRA_APPRAISAL_HOST_MAX_LEN];
+    uint16_t port;
+    /* TPM reset and restart counters of the quote of the last appraisal */
+    uint32_t reset_count;
+    uint32_t restart_count;
+    /* IMA PCR after replaying events 1 to ima_replay.events */
+    charra_ima_replay ima_replay;
+} charra_appraisal_state;
+
+/**
+ * @brief The appraisal states of all attesters.
+ */
+typedef struct {
+    charra_appraisal_state states[CHARRA_APPRAISAL_STATES_MAX];
+    /* slot overwritten next when all slots are in use */
+    uint32_t next_evict;
+} charra_appraisal_states;
+
+/**
+ * @brief Looks up the appraisal state of an attester.
+ *
+ * @param[in] states The appraisal states.
+ * @param[in] host The host of the attester.
+ * @param[in] port The port of the attester.
+ * @return The state, NULL if the attester has none.
+ */
+const charra_appraisal_state* charra_appraisal_state_find(
+        const charra_appraisal_states* states, const char* host,
+        uint16_t port);
+
+/**
+ * @brief Returns whether the TPM was neither reset nor restarted since the
+ * state was saved, i.e. whether the IMA PCR still continues from the state.
+ *
+ * The counters in quotes of keys outside the endorsement hierarchy are
+ * obfuscated, but consistently for the same key, so comparing them stays
+ * meaningful as long as the attester quotes with the same key.
+ *
+ * @param[in] state The appraisal state.
+ * @param[in] clock_info The clock info of the current quote.
+ * @return true if the state can be continued.
+ */
+bool charra_appraisal_state_continues(const charra_appraisal_state* state,
+        const TPMS_CLOCK_INFO* clock_info);
+
+/**
+ * @brief Saves the appraisal state of an attester, replacing its previous one.
+ * If all slots are in use by other attesters, the oldest slot is reused.
+ *
+ * @param[in,out] states The appraisal states.
+ * @param[in] host The host of the attester.
+ * @param[in] port The port of the attester.
+ * @param[in] clock_info The clock info of the appraised quote.
+ * @param[in] ima_replay The IMA PCR after replaying the appraised events.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_BAD_ARGUMENT if the host name is too long.
+ */
+CHARRA_RC charra_appraisal_state_save(charra_appraisal_states* states,
+        const char* host, uint16_t port, const TPMS_CLOCK_INFO* clock_info,
+        const charra_ima_replay* ima_replay);
+
+/**
+ * @brief Drops the appraisal state of an attester, so that its logs are
+ * replayed in full in the next round.
+ *
+ * @param[in,out] states The appraisal states.
+ * @param[in] host The host of the attester.
+ * @param[in] port The port of the attester.
+ */
+void charra_appraisal_state_forget(
+        charra_appraisal_states* states, const char* host, uint16_t port);
+
+#endif /* CHARRA_APPRAISAL_STATE_H */
@@ -0,0 +1,368 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_ima_log.c
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Parses the binary IMA event log received from the attester,
+ * recomputes the template hashes and replays them into the IMA PCR.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#include "charra_ima_log.h"
+
+#include <mbedtls/sha1.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/sha512.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "../common/charra_error.h"
+#include "../common/charra_log.h"
+#include "../util/crypto_util.h"
+#include "../util/ima_util.h"
+
+/* name of the legacy template, whose binary format has no data length */
+#define IMA_TEMPLATE_NAME_IMA "ima"
+
+/* name of the event of the boot aggregate, which is not a file */
+#define IMA_BOOT_AGGREGATE_NAME "boot_aggregate"
+
+/* the legacy template hashes the file name padded to this length */
+#define IMA_EVENT_NAME_LEN_MAX (CHARRA_IMA_TEMPLATE_NAME_MAX_LEN + 1)
+
+/**
+ * @brief A hash context of a supported PCR bank.
+ */
+typedef struct {
+    TPMI_ALG_HASH alg;
+    union {
+        mbedtls_sha1_context sha1;
+        mbedtls_sha256_context sha256;
+        mbedtls_sha512_context sha512;
+    } ctx;
+} ima_hash_ctx;
+
+static int ima_hash_starts(ima_hash_ctx* h, TPMI_ALG_HASH alg) {
+    h->alg = alg;
+    if (alg == TPM2_ALG_SHA1) {
+        mbedtls_sha1_init(&h->ctx.sha1);
+        return mbedtls_sha1_starts(&h->ctx.sha1);
+    } else if (alg == TPM2_ALG_SHA256) {
+        mbedtls_sha256_init(&h->ctx.sha256);
+        return mbedtls_sha256_starts(&h->ctx.sha256, 0);
+    } else {
+        mbedtls_sha512_init(&h->ctx.sha512);
+        return mbedtls_sha512_starts(
+                &h->ctx.sha512, (alg == TPM2_ALG_SHA384) ? 1 : 0);
+    }
+}
+
+static int ima_hash_update(ima_hash_ctx* h, const uint8_t* data, size_t len) {
+    if (h->alg == TPM2_ALG_SHA1) {
+        return mbedtls_sha1_update(&h->ctx.sha1, data, len);
+    } else if (h->alg == TPM2_ALG_SHA256) {
+        return mbedtls_sha256_update(&h->ctx.sha256, data, len);
+    } else {
+        return mbedtls_sha512_update(&h->ctx.sha512, data, len);
+    }
+}
+
+static int ima_hash_finish(ima_hash_ctx* h, uint8_t* digest) {
+    int r = 0;
+    if (h->alg == TPM2_ALG_SHA1) {
+        r = mbedtls_sha1_finish(&h->ctx.sha1, digest);
+        mbedtls_sha1_free(&h->ctx.sha1);
+    } else if (h->alg == TPM2_ALG_SHA256) {
+        r = mbedtls_sha256_finish(&h->ctx.sha256, digest);
+        mbedtls_sha256_free(&h->ctx.sha256);
+    } else {
+        r = mbedtls_sha512_finish(&h->ctx.sha512, digest);
+        mbedtls_sha512_free(&h->ctx.sha512);
+    }
+    return r;
+}
+
+/**
+ * @brief Reads a length field in little-endian (canonical) byte order.
+ */
+static uint32_t ima_get_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Computes the template hash of an event with algorithm \a alg. The
+ * legacy template hashes the file digest and the zero-padded file name, all
+ * others their template data as found in the log.
+ */
+static CHARRA_RC ima_template_digest(TPMI_ALG_HASH alg, bool legacy,
+        size_t data_len, const uint8_t* data, uint8_t* digest) {
+    static const uint8_t zeros[IMA_EVENT_NAME_LEN_MAX] = {0};
+    ima_hash_ctx h = {0};
+    int r = 0;
+
+    if (legacy) {
+        /* file digest, file name length, file name */
+        const size_t name_len = data_len - CHARRA_IMA_TEMPLATE_DIGEST_SIZE - 4;
+        const uint8_t* name = data + CHARRA_IMA_TEMPLATE_DIGEST_SIZE + 4;
+        if ((r = ima_hash_starts(&h, alg)) != 0 ||
+                (r = ima_hash_update(
+                         &h, data, CHARRA_IMA_TEMPLATE_DIGEST_SIZE)) != 0 ||
+                (r = ima_hash_update(&h, name, name_len)) != 0 ||
+                (r = ima_hash_update(&h, zeros,
+                         IMA_EVENT_NAME_LEN_MAX - name_len)) != 0) {
+            goto error;
+        }
+    } else {
+        if ((r = ima_hash_starts(&h, alg)) != 0 ||
+                (r = ima_hash_update(&h, data, data_len)) != 0) {
+            goto error;
+        }
+    }
+
+error:
+    if (ima_hash_finish(&h, digest) != 0 || r != 0) {
+        return CHARRA_RC_CRYPTO_ERROR;
+    }
+    return CHARRA_RC_SUCCESS;
+}
+
+/**
+ * @brief Extends \a digest into the replayed PCR of a bank:
+ * PCR := H(PCR || digest).
+ */
+static CHARRA_RC ima_replay_extend(
+        charra_ima_bank* bank, const uint8_t* digest) {
+    ima_hash_ctx h = {0};
+    uint8_t* pcr = (uint8_t*)&bank->pcr;
+    int r = 0;
+
+    if ((r = ima_hash_starts(&h, bank->alg)) != 0 ||
+            (r = ima_hash_update(&h, pcr, bank->pcr_size)) != 0 ||
+            (r = ima_hash_update(&h, digest, bank->pcr_size)) != 0) {
+        goto error;
+    }
+
+error:
+    if (ima_hash_finish(&h, pcr) != 0 || r != 0) {
+        return CHARRA_RC_CRYPTO_ERROR;
+    }
+    return CHARRA_RC_SUCCESS;
+}
+
+/**
+ * @brief Looks up the file digest of an event in the allowlist of the replay
+ * state and counts the event if it is not found.
+ */
+static void ima_appraise_event(charra_ima_replay* replay, bool legacy,
+        size_t data_len, const uint8_t* data) {
+    TPMI_ALG_HASH alg = TPM2_ALG_SHA1;
+    const uint8_t* digest = data;
+    size_t digest_len = CHARRA_IMA_TEMPLATE_DIGEST_SIZE;
+    const uint8_t* name = NULL;
+    size_t name_len = 0;
+
+    if (legacy) {
+        /* file digest, file name length, file name */
+        name = data + CHARRA_IMA_TEMPLATE_DIGEST_SIZE + 4;
+        name_len = data_len - CHARRA_IMA_TEMPLATE_DIGEST_SIZE - 4;
+    } else if (data_len >= 4 && ima_get_u32(data) <= data_len - 4) {
+        /* file digest field (d-ng or d), file name field (n-ng or n) */
+        const size_t field_len = ima_get_u32(data);
+        const uint8_t* field = data + 4;
+        const uint8_t* colon = memchr(field, ':', field_len);
+        if (colon != NULL && (size_t)(colon - field) + 2 <= field_len &&
+                colon[1] == '\0') {
+            alg = charra_crypto_tpm2_hash_alg_from_name(
+                    (const char*)field, (size_t)(colon - field));
+            digest = colon + 2;
+            digest_len = field_len - (size_t)(colon - field) - 2;
+        } else {
+            digest = field;
+            digest_len = field_len;
+        }
+        const size_t rest = data_len - 4 - field_len;
+        if (rest >= 4 && ima_get_u32(field + field_len) <= rest - 4) {
+            name = field + field_len + 4;
+            name_len = ima_get_u32(field + field_len);
+        }
+    } else {
+        digest_len = 0;
+    }
+    while (name_len > 0 && name[name_len - 1] == '\0') {
+        --name_len;
+    }
+
+    if (name_len == strlen(IMA_BOOT_AGGREGATE_NAME) &&
+            memcmp(name, IMA_BOOT_AGGREGATE_NAME, name_len) == 0) {
+        return;
+    }
+    if (digest_len > 0 && charra_allowlist_contains(replay->allowlist, alg,
+                                  digest_len, digest)) {
+        return;
+    }
+    replay->unknown += 1;
+    charra_log_warn("File '%.*s' of IMA event %" PRIu64
+                    " is not in the allowlist.",
+            (int)name_len, (name != NULL) ? (const char*)name : "",
+            replay->events + 1);
+}
+
+CHARRA_RC charra_ima_replay_init(charra_ima_replay* replay,
+        uint32_t banks_len, const TPMI_ALG_HASH* banks, uint32_t pcr_index) {
+    memset(replay, 0, sizeof(*replay));
+    if (banks_len > CHARRA_IMA_BANKS_MAX) {
+        charra_log_error("Too many PCR banks for IMA replay.");
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+    for (uint32_t b = 0; b < banks_len; b++) {
+        const uint16_t pcr_size = charra_crypto_tpm2_hash_size(banks[b]);
+        if (pcr_size == 0 ||
+                charra_ima_replay_get_pcr(replay, banks[b]) != NULL) {
+            charra_log_error("Unsupported PCR bank 0x%04x for IMA replay.",
+                    banks[b]);
+            return CHARRA_RC_BAD_ARGUMENT;
+        }
+        replay->banks[b].alg = banks[b];
+        replay->banks[b].pcr_size = pcr_size;
+        replay->banks_len += 1;
+    }
+    replay->pcr_index = pcr_index;
+    return CHARRA_RC_SUCCESS;
+}
+
+CHARRA_RC charra_ima_replay_log(
+        charra_ima_replay* replay, size_t log_len, const uint8_t* log) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    static const uint8_t zero_hash[CHARRA_IMA_TEMPLATE_DIGEST_SIZE] = {0};
+    uint8_t template_digest[TPM2_SHA1_DIGEST_SIZE] = {0};
+    uint8_t digest[sizeof(TPMU_HA)] = {0};
+    size_t pos = 0;
+
+    while (pos < log_len) {
+        const uint8_t* event = log + pos;
+        const size_t left = log_len - pos;
+
+        /* PCR index, template hash, template name */
+        size_t len = 4 + CHARRA_IMA_TEMPLATE_DIGEST_SIZE + 4;
+        if (left < len) {
+            goto malformed;
+        }
+        const uint32_t pcr_index = ima_get_u32(event);
+        const uint8_t* template_hash = event + 4;
+        const uint32_t name_len =
+                ima_get_u32(event + 4 + CHARRA_IMA_TEMPLATE_DIGEST_SIZE);
+        if (name_len > CHARRA_IMA_TEMPLATE_NAME_MAX_LEN ||
+                left - len < name_len) {
+            goto malformed;
+        }
+        const uint8_t* name = event + len;
+        len += name_len;
+
+        /* template data */
+        const bool legacy = name_len == strlen(IMA_TEMPLATE_NAME_IMA) &&
+                            memcmp(name, IMA_TEMPLATE_NAME_IMA, name_len) == 0;
+        const uint8_t* data = event + len;
+        size_t data_len = 0;
+        if (legacy) {
+            /* file digest and file name with length prefix */
+            if (left - len < CHARRA_IMA_TEMPLATE_DIGEST_SIZE + 4) {
+                goto malformed;
+            }
+            const uint32_t file_name_len =
+                    ima_get_u32(data + CHARRA_IMA_TEMPLATE_DIGEST_SIZE);
+            if (file_name_len > IMA_EVENT_NAME_LEN_MAX) {
+                goto malformed;
+            }
+            data_len = CHARRA_IMA_TEMPLATE_DIGEST_SIZE + 4 + file_name_len;
+        } else {
+            if (left - len < 4) {
+                goto malformed;
+            }
+            data_len = ima_get_u32(data);
+            if (data_len > CHARRA_IMA_TEMPLATE_DATA_MAX_LEN) {
+                goto malformed;
+            }
+            len += 4;
+            data += 4;
+        }
+        if (left - len < data_len) {
+            goto malformed;
+        }
+        len += data_len;
+
+        const bool violation =
+                memcmp(template_hash, zero_hash, sizeof(zero_hash)) == 0;
+        if (violation) {
+            /* measurement could not be taken reliably */
+            replay->violations += 1;
+        } else {
+            /* recompute template hash */
+            if ((r = ima_template_digest(TPM2_ALG_SHA1, legacy, data_len, data,
+                         template_digest)) != CHARRA_RC_SUCCESS) {
+                return r;
+            }
+            if (memcmp(template_digest, template_hash,
+                        CHARRA_IMA_TEMPLATE_DIGEST_SIZE) != 0) {
+                charra_log_error("Template hash of IMA event %" PRIu64
+                                 " does not match its template data.",
+                        replay->events + 1);
+                return CHARRA_RC_VERIFICATION_FAILED;
+            }
+            if (replay->allowlist != NULL) {
+                ima_appraise_event(replay, legacy, data_len, data);
+            }
+        }
+
+        /* extend each bank with its own digest of the event */
+        for (uint32_t b = 0;
+                pcr_index == replay->pcr_index && b < replay->banks_len; b++) {
+            charra_ima_bank* bank = &replay->banks[b];
+            if (violation) {
+                memset(digest, 0xff, bank->pcr_size);
+            } else if (bank->alg == TPM2_ALG_SHA1) {
+                memcpy(digest, template_digest, sizeof(template_digest));
+            } else if ((r = ima_template_digest(bank->alg, legacy, data_len,
+                                data, digest)) != CHARRA_RC_SUCCESS) {
+                return r;
+            }
+            if ((r = ima_replay_extend(bank, digest)) != CHARRA_RC_SUCCESS) {
+                return r;
+            }
+        }
+        if (pcr_index == replay->pcr_index) {
+            replay->extends += 1;
+        }
+
+        replay->events += 1;
+        pos += len;
+    }
+
+    return CHARRA_RC_SUCCESS;
+
+malformed:
+    charra_log_error("Malformed IMA event %" PRIu64 " at offset %zu.",
+            replay->events + 1, pos);
+    return CHARRA_RC_MARSHALING_ERROR;
+}
+
+const uint8_t* charra_ima_replay_get_pcr(
+        const charra_ima_replay* replay, TPMI_ALG_HASH bank) {
+    for (uint32_t b = 0; b < replay->banks_len; b++) {
+        if (replay->banks[b].alg == bank) {
+            return (const uint8_t*)&replay->banks[b].pcr;
+        }
+    }
+    return NULL;
+}
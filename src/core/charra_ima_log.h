@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_ima_log.h
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Parses the binary IMA event log received from the attester,
+ * recomputes the template hashes and replays them into the IMA PCR.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#ifndef CHARRA_IMA_LOG_H
+#define CHARRA_IMA_LOG_H
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <tss2/tss2_tpm2_types.h>
+
+#include "../common/charra_error.h"
+#include "charra_allowlist.h"
+
+/* PCR the kernel extends IMA measurements into by default */
+#define CHARRA_IMA_PCR 10
+
+/* banks replayed at once, one each of SHA-1, SHA-256, SHA-384 and SHA-512 */
+#define CHARRA_IMA_BANKS_MAX 4
+
+/**
+ * @brief The replayed PCR of one bank.
+ */
+typedef struct {
+    TPMI_ALG_HASH alg;
+    uint16_t pcr_size;
+    /* expected value of the PCR after the events replayed so far */
+    TPMU_HA pcr;
+} charra_ima_bank;
+
+/**
+ * @brief The state of replaying an IMA event log into one PCR of several
+ * banks.
+ */
+typedef struct {
+    uint32_t banks_len;
+    charra_ima_bank banks[CHARRA_IMA_BANKS_MAX];
+    uint32_t pcr_index;
+    /* number of events parsed, extended into pcr_index, and violations */
+    uint64_t events;
+    uint64_t extends;
+    uint64_t violations;
+    /* allowlist the file digests are appraised against, NULL to not appraise
+     * them, and number of events whose file digest is not in the allowlist */
+    const charra_allowlist* allowlist;
+    uint64_t unknown;
+} charra_ima_replay;
+
+/**
+ * @brief Starts replaying an IMA event log from the reset state of the PCR.
+ *
+ * @param[out] replay The replay state.
+ * @param[in] banks_len The number of PCR banks.
+ * @param[in] banks The PCR banks, each of TPM2_ALG_SHA1, TPM2_ALG_SHA256,
+ * TPM2_ALG_SHA384 and TPM2_ALG_SHA512 at most once.
+ * @param[in] pcr_index The PCR the measurements are extended into.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_BAD_ARGUMENT if a bank is not supported or given twice.
+ */
+CHARRA_RC charra_ima_replay_init(charra_ima_replay* replay,
+        uint32_t banks_len, const TPMI_ALG_HASH* banks, uint32_t pcr_index);
+
+/**
+ * @brief Parses the events of a binary IMA event log (templates ima, ima-ng,
+ * ima-sig and others in the same format) in place and extends them into the
+ * replayed PCR.
+ *
+ * The SHA-1 template hash of each event is recomputed from its template data
+ * and checked against the one in the log. For the other banks, the digest
+ * extended is the hash over the template data with the bank's algorithm, as
+ * done by the kernel since it extends each bank with its own algorithm.
+ * Violations (template hash of
+ * zeros) are extended as all ones. Length fields are read in little-endian
+ * (canonical) byte order.
+ *
+ * If the replay state has an allowlist, the file digest of each event (the
+ * first template field, "ALGORITHM:\0DIGEST" or a SHA-1 digest) is looked up
+ * in it and each file not found is logged and counted. The boot_aggregate
+ * event is not a file and is not appraised.
+ *
+ * @param[in,out] replay The replay state.
+ * @param[in] log_len The length of \a log.
+ * @param[in] log The events, starting at the first event of the log.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_VERIFICATION_FAILED if a template hash does not match.
+ * @return CHARRA_RC_MARSHALING_ERROR on malformed events.
+ * @return CHARRA_RC_CRYPTO_ERROR on hashing errors.
+ */
+CHARRA_RC charra_ima_replay_log(
+        charra_ima_replay* replay, size_t log_len, const uint8_t* log);
+
+/**
+ * @brief Returns the expected value of the replayed PCR in a bank.
+ *
+ * @param[in] replay The replay state.
+ * @param[in] bank The PCR bank.
+ * @return The PCR value of the size of the bank's digests, NULL if the bank
+ * is not replayed.
+ */
+const uint8_t* charra_ima_replay_get_pcr(
+        const charra_ima_replay* replay, TPMI_ALG_HASH bank);
+
+#endif /* CHARRA_IMA_LOG_H */
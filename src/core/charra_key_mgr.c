@@ -28,21 +28,122 @@
 
 #include "../common/charra_error.h"
 #include "../common/charra_log.h"
+#include "../common/charra_macro.h"
 #include "../util/tpm2_util.h"
 
+/**
+ * @brief Finds the table entry for \a key_id, or the default entry.
+ */
+static charra_key_table_entry* key_table_lookup(
+        charra_key_table* table, size_t key_id_len, const uint8_t* key_id) {
+    charra_key_table_entry* default_entry = NULL;
+
+    for (uint32_t i = 0; i < table->entries_len; ++i) {
+        const char* id = table->entries[i].config->id;
+        if (id == NULL) {
+            if (default_entry == NULL) {
+                default_entry = &table->entries[i];
+            }
+        } else if (strlen(id) == key_id_len &&
+                   memcmp(id, key_id, key_id_len) == 0) {
+            return &table->entries[i];
+        }
+    }
+
+    return default_entry;
+}
+
+/**
+ * @brief Releases the key of \a entry in the TPM and forgets its handle.
+ */
+static void key_table_release(
+        charra_key_table_entry* entry, tpm2_esys_context* ctx) {
+    if (entry->key_handle == ESYS_TR_NONE) {
+        return;
+    }
+
+    /* release the key only if it belongs to the current ESAPI context */
+    if (ctx != NULL && ctx->esys_ctx != NULL &&
+            entry->esys_generation == ctx->generation) {
+        TSS2_RC r = TSS2_RC_SUCCESS;
+        if (entry->config->format == CLI_UTIL_ATTESTATION_KEY_FORMAT_HANDLE) {
+            /* close persistent key */
+            r = Esys_TR_Close(ctx->esys_ctx, &entry->key_handle);
+        } else {
+            /* flush transient key; may fail if it is already gone */
+            r = Esys_FlushContext(ctx->esys_ctx, entry->key_handle);
+        }
+        if (r != TSS2_RC_SUCCESS) {
+            charra_log_debug("Releasing TPM key failed: 0x%x", r);
+        }
+    }
+
+    entry->key_handle = ESYS_TR_NONE;
+}
+
+/**
+ * @brief Forgets the handle and saved context of \a entry if they belong to
+ * an earlier ESAPI context, as they do not survive a new one.
+ */
+static void key_table_forget_stale(
+        charra_key_table_entry* entry, const tpm2_esys_context* ctx) {
+    if (entry->esys_generation != ctx->generation) {
+        entry->key_handle = ESYS_TR_NONE;
+        charra_free_and_null(entry->saved_context);
+        entry->esys_generation = ctx->generation;
+    }
+}
+
+/**
+ * @brief Swaps out the least recently used loaded transient key if the
+ * maximum number of loaded transient keys is reached. Keys of an earlier
+ * ESAPI context are no longer loaded and are not swapped out.
+ */
+static void key_table_make_room(
+        charra_key_table* table, tpm2_esys_context* ctx) {
+    charra_key_table_entry* lru = NULL;
+    uint32_t loaded = 0;
+
+    for (uint32_t i = 0; i < table->entries_len; ++i) {
+        charra_key_table_entry* entry = &table->entries[i];
+        key_table_forget_stale(entry, ctx);
+        if (entry->key_handle == ESYS_TR_NONE ||
+                entry->config->format != CLI_UTIL_ATTESTATION_KEY_FORMAT_FILE) {
+            continue;
+        }
+        loaded += 1;
+        if (lru == NULL || entry->last_used < lru->last_used) {
+            lru = entry;
+        }
+    }
+    if (lru == NULL || loaded < table->loaded_max) {
+        return;
+    }
+
+    /* save context so the key can be swapped in without reading the file */
+    TSS2_RC r = Esys_ContextSave(
+            ctx->esys_ctx, lru->key_handle, &lru->saved_context);
+    if (r != TSS2_RC_SUCCESS) {
+        charra_log_debug("Esys_ContextSave failed: 0x%x", r);
+        lru->saved_context = NULL;
+    }
+    key_table_release(lru, ctx);
+    table->evictions += 1;
+}
+
 CHARRA_RC charra_load_tpm2_key(ESYS_CONTEXT* const ctx,
-        ESYS_TR* const key_handle, cli_config_attester* config) {
+        ESYS_TR* const key_handle, const cli_config_attestation_key* key) {
     TSS2_RC r = TSS2_RC_SUCCESS;
 
     /* load TPM2 attestation key */
-    switch (config->attestation_key_format) {
+    switch (key->format) {
     case CLI_UTIL_ATTESTATION_KEY_FORMAT_FILE:
         r = tpm2_load_tpm_context_from_path(
-                ctx, key_handle, config->attestation_key.ctx_path);
+                ctx, key_handle, key->key.ctx_path);
         break;
     case CLI_UTIL_ATTESTATION_KEY_FORMAT_HANDLE:
         r = tpm2_load_tpm_context_from_handle(
-                ctx, config->attestation_key.tpm2_handle, key_handle);
+                ctx, key->key.tpm2_handle, key_handle);
         break;
     case CLI_UTIL_ATTESTATION_KEY_FORMAT_UNKNOWN:
         charra_log_error("Unknown format for TPM key.");
@@ -55,6 +156,107 @@ CHARRA_RC charra_load_tpm2_key(ESYS_CONTEXT* const ctx,
     return CHARRA_RC_SUCCESS;
 }
 
+CHARRA_RC charra_key_table_init(charra_key_table* table,
+        const cli_config_attester* config, uint32_t loaded_max) {
+    if (table == NULL || config == NULL || loaded_max == 0 ||
+            config->attestation_keys_len > CLI_UTIL_MAX_ATTESTATION_KEYS) {
+        charra_log_error("Bad argument for key table.");
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+
+    *table = (charra_key_table){0};
+    table->entries_len = config->attestation_keys_len;
+    table->loaded_max = loaded_max;
+    for (uint32_t i = 0; i < table->entries_len; ++i) {
+        table->entries[i].config = &config->attestation_keys[i];
+        table->entries[i].key_handle = ESYS_TR_NONE;
+    }
+
+    return CHARRA_RC_SUCCESS;
+}
+
+CHARRA_RC charra_key_table_get(charra_key_table* table, tpm2_esys_context* ctx,
+        size_t key_id_len, const uint8_t* key_id, ESYS_TR* key_handle) {
+    CHARRA_RC charra_r = CHARRA_RC_SUCCESS;
+
+    if (table == NULL || ctx == NULL || ctx->esys_ctx == NULL ||
+            key_handle == NULL) {
+        charra_log_error("Bad argument for key table.");
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+
+    charra_key_table_entry* entry =
+            key_table_lookup(table, key_id_len, key_id);
+    if (entry == NULL) {
+        charra_log_error("No attestation key for key ID '%.*s'.",
+                (int)key_id_len, (const char*)key_id);
+        return CHARRA_RC_NO_MATCH;
+    }
+    entry->last_used = ++table->clock;
+
+    /* handles and saved contexts do not survive a new ESAPI context */
+    key_table_forget_stale(entry, ctx);
+
+    if (entry->key_handle != ESYS_TR_NONE) {
+        table->hits += 1;
+        *key_handle = entry->key_handle;
+        return CHARRA_RC_SUCCESS;
+    }
+    table->misses += 1;
+
+    if (entry->config->format == CLI_UTIL_ATTESTATION_KEY_FORMAT_FILE) {
+        key_table_make_room(table, ctx);
+    }
+
+    /* swap in saved context, fall back to the configured location */
+    if (entry->saved_context != NULL) {
+        TSS2_RC r = Esys_ContextLoad(
+                ctx->esys_ctx, entry->saved_context, &entry->key_handle);
+        charra_free_and_null(entry->saved_context);
+        if (r != TSS2_RC_SUCCESS) {
+            charra_log_debug("Esys_ContextLoad failed: 0x%x", r);
+            entry->key_handle = ESYS_TR_NONE;
+        }
+    }
+    if (entry->key_handle == ESYS_TR_NONE) {
+        charra_log_info("Loading TPM (attestation) key.");
+        if ((charra_r = charra_load_tpm2_key(ctx->esys_ctx,
+                     &entry->key_handle, entry->config)) != CHARRA_RC_SUCCESS) {
+            entry->key_handle = ESYS_TR_NONE;
+            return charra_r;
+        }
+    }
+
+    *key_handle = entry->key_handle;
+
+    return CHARRA_RC_SUCCESS;
+}
+
+void charra_key_table_invalidate(charra_key_table* table,
+        tpm2_esys_context* ctx, size_t key_id_len, const uint8_t* key_id) {
+    if (table == NULL) {
+        return;
+    }
+
+    charra_key_table_entry* entry =
+            key_table_lookup(table, key_id_len, key_id);
+    if (entry != NULL) {
+        key_table_release(entry, ctx);
+        charra_free_and_null(entry->saved_context);
+    }
+}
+
+void charra_key_table_free(charra_key_table* table, tpm2_esys_context* ctx) {
+    if (table == NULL) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < table->entries_len; ++i) {
+        key_table_release(&table->entries[i], ctx);
+        charra_free_and_null(table->entries[i].saved_context);
+    }
+}
+
 CHARRA_RC charra_load_external_public_key(ESYS_CONTEXT* ctx,
         TPM2B_PUBLIC* external_public_key, ESYS_TR* key_handle,
         const char* path) {
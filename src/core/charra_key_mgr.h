@@ -28,9 +28,98 @@
 
 #include "../common/charra_error.h"
 #include "../util/cli/cli_util_common.h"
+#include "../util/tpm2_util.h"
+
+/* number of transient attestation keys kept loaded in the TPM at once */
+#define CHARRA_KEY_TABLE_DEFAULT_LOADED_MAX 2
+
+/**
+ * @brief An attestation key known to the key table.
+ */
+typedef struct {
+    /* the configured key (ID, format, location) */
+    const cli_config_attestation_key* config;
+    /* the loaded key, or ESYS_TR_NONE if not loaded */
+    ESYS_TR key_handle;
+    /* saved context of an evicted transient key, or NULL */
+    TPMS_CONTEXT* saved_context;
+    /* generation of the ESAPI context the handle belongs to */
+    uint32_t esys_generation;
+    /* logical time of the last use, for LRU eviction */
+    uint64_t last_used;
+} charra_key_table_entry;
+
+/**
+ * @brief Keeps attestation keys resident in the TPM across requests, routed
+ * by the sig_key_id of the attestation request. Only a limited number of
+ * transient keys is kept loaded; the least recently used one is swapped out
+ * with TPM2_ContextSave and swapped in again with TPM2_ContextLoad.
+ */
+typedef struct {
+    charra_key_table_entry entries[CLI_UTIL_MAX_ATTESTATION_KEYS];
+    uint32_t entries_len;
+    uint32_t loaded_max;
+    uint64_t clock;
+    /* statistics */
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} charra_key_table;
 
 CHARRA_RC charra_load_tpm2_key(ESYS_CONTEXT* const ctx,
-        ESYS_TR* const key_handle, cli_config_attester* config);
+        ESYS_TR* const key_handle, const cli_config_attestation_key* key);
+
+/**
+ * @brief Initializes the key table with the attestation keys of the attester
+ * configuration. No key is loaded into the TPM yet.
+ *
+ * @param[out] table The key table.
+ * @param[in] config The attester configuration. Must outlive \a table.
+ * @param[in] loaded_max The maximum number of transient keys loaded at once.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_BAD_ARGUMENT on invalid arguments.
+ */
+CHARRA_RC charra_key_table_init(charra_key_table* table,
+        const cli_config_attester* config, uint32_t loaded_max);
+
+/**
+ * @brief Returns the handle of the attestation key selected by \a key_id,
+ * loading it into the TPM first if it is not resident. Falls back to the
+ * default key (configured without ID) if no key matches \a key_id.
+ *
+ * @param[in,out] table The key table.
+ * @param[in] ctx The long-lived ESAPI context.
+ * @param[in] key_id_len The length of \a key_id.
+ * @param[in] key_id The sig_key_id of the attestation request.
+ * @param[out] key_handle The handle of the loaded key.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_NO_MATCH if there is neither a matching nor a default
+ * key.
+ * @return CHARRA_RC_ERROR on errors.
+ */
+CHARRA_RC charra_key_table_get(charra_key_table* table, tpm2_esys_context* ctx,
+        size_t key_id_len, const uint8_t* key_id, ESYS_TR* key_handle);
+
+/**
+ * @brief Drops the key selected by \a key_id from the TPM, e.g. after the TPM
+ * was reset or the resource manager flushed the object. The next call to
+ * charra_key_table_get() loads the key again from its configured location.
+ *
+ * @param[in,out] table The key table.
+ * @param[in] ctx The long-lived ESAPI context.
+ * @param[in] key_id_len The length of \a key_id.
+ * @param[in] key_id The sig_key_id of the attestation request.
+ */
+void charra_key_table_invalidate(charra_key_table* table,
+        tpm2_esys_context* ctx, size_t key_id_len, const uint8_t* key_id);
+
+/**
+ * @brief Releases all keys of the table in the TPM and frees saved contexts.
+ *
+ * @param[in,out] table The key table.
+ * @param[in] ctx The long-lived ESAPI context.
+ */
+void charra_key_table_free(charra_key_table* table, tpm2_esys_context* ctx);
 
 CHARRA_RC charra_load_external_public_key(ESYS_CONTEXT* ctx,
         TPM2B_PUBLIC* external_public_key, ESYS_TR* key_handle,
@@ -0,0 +1,262 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_response_cache.c
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Caches marshaled attestation responses of the attester so that
+ * retransmitted requests are answered without a new TPM quote.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#include "charra_response_cache.h"
+
+#include <mbedtls/sha256.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../common/charra_error.h"
+#include "../common/charra_macro.h"
+
+/**
+ * @brief Hashes \a value as fixed-size big-endian integer.
+ */
+static int sha256_update_u64(mbedtls_sha256_context* ctx, uint64_t value) {
+    uint8_t buf[8] = {0};
+    for (int i = 7; i >= 0; --i) {
+        buf[i] = (uint8_t)value;
+        value >>= 8;
+    }
+    return mbedtls_sha256_update(ctx, buf, sizeof(buf));
+}
+
+/**
+ * @brief Hashes \a len and \a data, such that adjacent fields cannot be
+ * confused.
+ */
+static int sha256_update_field(
+        mbedtls_sha256_context* ctx, size_t len, const uint8_t* data) {
+    int r = sha256_update_u64(ctx, len);
+    if (r == 0 && len > 0) {
+        r = mbedtls_sha256_update(ctx, data, len);
+    }
+    return r;
+}
+
+void charra_response_cache_init(
+        charra_response_cache* cache, uint32_t ttl_ms) {
+    memset(cache, 0, sizeof(*cache));
+    cache->ttl_ms = ttl_ms;
+}
+
+CHARRA_RC charra_response_cache_selection_digest(
+        const charra_tap_msg_attestation_request_dto* req,
+        uint8_t digest[TPM2_SHA256_DIGEST_SIZE]) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    int mbedtls_r = 0;
+
+    /* init */
+    mbedtls_sha256_context ctx = {0};
+    mbedtls_sha256_init(&ctx);
+    if ((mbedtls_r = mbedtls_sha256_starts(&ctx, 0)) != 0) {
+        goto error;
+    }
+
+    /* attestation key */
+    if ((mbedtls_r = sha256_update_field(
+                 &ctx, req->sig_key_id_len, req->sig_key_id)) != 0) {
+        goto error;
+    }
+
+    /* PCR selection */
+    if ((mbedtls_r = sha256_update_u64(&ctx, req->pcr_selections_len)) != 0) {
+        goto error;
+    }
+    for (uint32_t i = 0; i < req->pcr_selections_len; ++i) {
+        const pcr_selection_dto* sel = &req->pcr_selections[i];
+        if ((mbedtls_r = sha256_update_u64(&ctx, sel->tcg_hash_alg_id)) != 0 ||
+                (mbedtls_r = sha256_update_field(
+                         &ctx, sel->pcrs_len, sel->pcrs)) != 0) {
+            goto error;
+        }
+    }
+
+    /* PCR logs */
+    if ((mbedtls_r = sha256_update_u64(&ctx, req->pcr_log_len)) != 0) {
+        goto error;
+    }
+    for (uint32_t i = 0; i < req->pcr_log_len; ++i) {
+        const pcr_log_dto* log = &req->pcr_logs[i];
+        const size_t identifier_len =
+                (log->identifier != NULL) ? strlen(log->identifier) : 0;
+        if ((mbedtls_r = sha256_update_field(&ctx, identifier_len,
+                     (const uint8_t*)log->identifier)) != 0 ||
+                (mbedtls_r = sha256_update_u64(&ctx, log->start)) != 0 ||
+                (mbedtls_r = sha256_update_u64(&ctx, log->count)) != 0) {
+            goto error;
+        }
+    }
+
+    /* PCR values */
+    if ((mbedtls_r = sha256_update_u64(&ctx, req->disclose_pcr_values)) != 0) {
+        goto error;
+    }
+
+    mbedtls_r = mbedtls_sha256_finish(&ctx, digest);
+
+error:
+    if (mbedtls_r != 0) {
+        r = CHARRA_RC_CRYPTO_ERROR;
+    }
+
+    /* free */
+    mbedtls_sha256_free(&ctx);
+
+    return r;
+}
+
+/**
+ * @brief Drops the response of \a entry.
+ */
+static void response_cache_entry_clear(charra_response_cache_entry* entry) {
+    charra_response_cache_stream_free(entry->stream);
+    memset(entry, 0, sizeof(*entry));
+}
+
+/**
+ * @brief Returns the time a response kept from \a now on expires.
+ */
+static coap_tick_t response_cache_expires(
+        const charra_response_cache* cache, coap_tick_t now) {
+    return now +
+           ((coap_tick_t)cache->ttl_ms * COAP_TICKS_PER_SECOND) / 1000;
+}
+
+CHARRA_RC charra_response_cache_lookup(charra_response_cache* cache,
+        const coap_address_t* peer, size_t nonce_len, const uint8_t* nonce,
+        const uint8_t selection_digest[TPM2_SHA256_DIGEST_SIZE], bool block,
+        charra_response_cache_stream** stream) {
+    if (cache->ttl_ms == 0) {
+        return CHARRA_RC_NO_MATCH;
+    }
+
+    coap_tick_t now = 0;
+    coap_ticks(&now);
+
+    for (uint32_t i = 0; i < CHARRA_RESPONSE_CACHE_CAPACITY; ++i) {
+        charra_response_cache_entry* entry = &cache->entries[i];
+        if (entry->stream == NULL) {
+            continue;
+        }
+        if (entry->expires <= now) {
+            response_cache_entry_clear(entry);
+            continue;
+        }
+        if (entry->nonce_len == nonce_len &&
+                memcmp(entry->nonce, nonce, nonce_len) == 0 &&
+                memcmp(entry->selection_digest, selection_digest,
+                        TPM2_SHA256_DIGEST_SIZE) == 0 &&
+                coap_address_equals(&entry->peer, peer)) {
+            *stream = entry->stream;
+            entry->expires = response_cache_expires(cache, now);
+            if (!block) {
+                cache->hits += 1;
+            }
+            return CHARRA_RC_SUCCESS;
+        }
+    }
+
+    if (!block) {
+        cache->misses += 1;
+    }
+    return CHARRA_RC_NO_MATCH;
+}
+
+CHARRA_RC charra_response_cache_insert(charra_response_cache* cache,
+        const coap_address_t* peer, size_t nonce_len, const uint8_t* nonce,
+        const uint8_t selection_digest[TPM2_SHA256_DIGEST_SIZE],
+        charra_response_cache_stream* stream) {
+    if (cache->ttl_ms == 0 || nonce_len > sizeof(TPMU_HA)) {
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+
+    coap_tick_t now = 0;
+    coap_ticks(&now);
+
+    /* take a free or expired entry, else the unpinned one expiring first */
+    charra_response_cache_entry* entry = NULL;
+    for (uint32_t i = 0; i < CHARRA_RESPONSE_CACHE_CAPACITY; ++i) {
+        charra_response_cache_entry* candidate = &cache->entries[i];
+        if (candidate->stream == NULL || candidate->expires <= now) {
+            entry = candidate;
+            break;
+        }
+        if (!candidate->pinned &&
+                (entry == NULL || candidate->expires < entry->expires)) {
+            entry = candidate;
+        }
+    }
+    if (entry == NULL) {
+        return CHARRA_RC_ERROR;
+    }
+    response_cache_entry_clear(entry);
+
+    cache->etag += 1;
+    stream->etag = cache->etag;
+    entry->stream = stream;
+    entry->peer = *peer;
+    entry->nonce_len = nonce_len;
+    memcpy(entry->nonce, nonce, nonce_len);
+    memcpy(entry->selection_digest, selection_digest,
+            TPM2_SHA256_DIGEST_SIZE);
+    entry->expires = response_cache_expires(cache, now);
+
+    return CHARRA_RC_SUCCESS;
+}
+
+void charra_response_cache_pin(charra_response_cache* cache,
+        const charra_response_cache_stream* stream, bool pinned) {
+    for (uint32_t i = 0; i < CHARRA_RESPONSE_CACHE_CAPACITY; ++i) {
+        if (cache->entries[i].stream == stream) {
+            cache->entries[i].pinned = pinned;
+            return;
+        }
+    }
+}
+
+void charra_response_cache_stream_free(charra_response_cache_stream* stream) {
+    if (stream == NULL) {
+        return;
+    }
+    charra_tap_marshaled_response_free(&stream->marshaled);
+    if (stream->pcr_logs != NULL) {
+        for (uint32_t i = 0; i < stream->pcr_logs_len; ++i) {
+            charra_free_if_not_null(stream->pcr_logs[i].identifier);
+            charra_free_if_not_null(stream->pcr_logs[i].content);
+        }
+        free(stream->pcr_logs);
+    }
+    free(stream);
+}
+
+double charra_response_cache_hit_rate(const charra_response_cache* cache) {
+    const uint64_t lookups = cache->hits + cache->misses;
+    return (lookups > 0) ? (100.0 * (double)cache->hits / (double)lookups)
+                         : 0.0;
+}
+
+void charra_response_cache_free(charra_response_cache* cache) {
+    for (uint32_t i = 0; i < CHARRA_RESPONSE_CACHE_CAPACITY; ++i) {
+        response_cache_entry_clear(&cache->entries[i]);
+    }
+}
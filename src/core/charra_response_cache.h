@@ -0,0 +1,181 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_response_cache.h
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Caches marshaled attestation responses of the attester so that
+ * retransmitted requests are answered without a new TPM quote.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#ifndef CHARRA_RESPONSE_CACHE_H
+#define CHARRA_RESPONSE_CACHE_H
+
+#include <coap3/coap.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <tss2/tss2_tpm2_types.h>
+
+#include "../common/charra_error.h"
+#include "charra_tap/charra_tap_cbor.h"
+#include "charra_tap/charra_tap_dto.h"
+
+/* number of responses kept at once */
+#define CHARRA_RESPONSE_CACHE_CAPACITY 32
+
+/* covers all CoAP retransmissions of a request (MAX_TRANSMIT_SPAN, RFC 7252) */
+#define CHARRA_RESPONSE_CACHE_DEFAULT_TTL_MS 45000
+
+/**
+ * @brief A marshaled response that is read block by block as the peer asks
+ * for it, so that PCR logs are never held in memory as a whole.
+ */
+typedef struct {
+    /* identifies the response across its blocks (ETag) */
+    uint32_t etag;
+    /* CBOR framing and references to the PCR logs */
+    charra_tap_marshaled_response marshaled;
+    /* the PCR logs referenced by the framing */
+    uint32_t pcr_logs_len;
+    pcr_log_response_dto* pcr_logs;
+} charra_response_cache_stream;
+
+/**
+ * @brief A cached response, keyed by peer, nonce and selection digest.
+ */
+typedef struct {
+    /* NULL if the entry is unused */
+    charra_response_cache_stream* stream;
+    coap_address_t peer;
+    size_t nonce_len;
+    uint8_t nonce[sizeof(TPMU_HA)];
+    uint8_t selection_digest[TPM2_SHA256_DIGEST_SIZE];
+    coap_tick_t expires;
+    /* a Block2 transfer of the response is in progress */
+    bool pinned;
+} charra_response_cache_entry;
+
+/**
+ * @brief Holds the marshaled responses of recent attestation requests for a
+ * short time.
+ */
+typedef struct {
+    charra_response_cache_entry entries[CHARRA_RESPONSE_CACHE_CAPACITY];
+    /* 0 disables the cache */
+    uint32_t ttl_ms;
+    /* ETag of the last inserted response */
+    uint32_t etag;
+    /* statistics */
+    uint64_t hits;
+    uint64_t misses;
+} charra_response_cache;
+
+/**
+ * @brief Initializes an empty response cache.
+ *
+ * @param[out] cache The response cache.
+ * @param[in] ttl_ms The time in milliseconds a response is kept, 0 disables
+ * the cache.
+ */
+void charra_response_cache_init(charra_response_cache* cache, uint32_t ttl_ms);
+
+/**
+ * @brief Computes the digest over everything of an attestation request that
+ * determines the response besides the nonce: the PCR selection, the
+ * sig_key_id, the requested PCR logs and whether the PCR values are asked for.
+ *
+ * @param[in] req The attestation request.
+ * @param[out] digest The SHA-256 selection digest.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_CRYPTO_ERROR on errors.
+ */
+CHARRA_RC charra_response_cache_selection_digest(
+        const charra_tap_msg_attestation_request_dto* req,
+        uint8_t digest[TPM2_SHA256_DIGEST_SIZE]);
+
+/**
+ * @brief Looks up the response to a request. The stream stays owned by the
+ * cache and is valid until the next insertion. A hit keeps the response for
+ * another TTL, so that a transfer of many blocks does not expire halfway.
+ *
+ * @param[in,out] cache The response cache.
+ * @param[in] peer The address of the requesting peer.
+ * @param[in] nonce_len The length of \a nonce.
+ * @param[in] nonce The nonce of the request.
+ * @param[in] selection_digest The selection digest of the request.
+ * @param[in] block Whether the request asks for a further block of the
+ * response, which is not counted in the statistics.
+ * @param[out] stream The cached response.
+ * @return CHARRA_RC_SUCCESS on a hit.
+ * @return CHARRA_RC_NO_MATCH on a miss.
+ */
+CHARRA_RC charra_response_cache_lookup(charra_response_cache* cache,
+        const coap_address_t* peer, size_t nonce_len, const uint8_t* nonce,
+        const uint8_t selection_digest[TPM2_SHA256_DIGEST_SIZE], bool block,
+        charra_response_cache_stream** stream);
+
+/**
+ * @brief Stores the response to a request and assigns its ETag, replacing an
+ * expired or else the oldest entry that is not pinned if the cache is full. On
+ * success, the cache owns \a stream.
+ *
+ * @param[in,out] cache The response cache.
+ * @param[in] peer The address of the requesting peer.
+ * @param[in] nonce_len The length of \a nonce.
+ * @param[in] nonce The nonce of the request.
+ * @param[in] selection_digest The selection digest of the request.
+ * @param[in] stream The marshaled response.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_BAD_ARGUMENT on invalid arguments or if the cache is
+ * disabled.
+ * @return CHARRA_RC_ERROR if all entries are pinned.
+ */
+CHARRA_RC charra_response_cache_insert(charra_response_cache* cache,
+        const coap_address_t* peer, size_t nonce_len, const uint8_t* nonce,
+        const uint8_t selection_digest[TPM2_SHA256_DIGEST_SIZE],
+        charra_response_cache_stream* stream);
+
+/**
+ * @brief Pins the entry of a cached response while a Block2 transfer of it is
+ * in progress, so that it is not replaced by insertions until it expires.
+ *
+ * @param[in,out] cache The response cache.
+ * @param[in] stream The cached response.
+ * @param[in] pinned Whether further blocks of the response are to be sent.
+ */
+void charra_response_cache_pin(charra_response_cache* cache,
+        const charra_response_cache_stream* stream, bool pinned);
+
+/**
+ * @brief Frees \a stream and the PCR logs it references.
+ *
+ * @param[in] stream The stream, may be NULL.
+ */
+void charra_response_cache_stream_free(charra_response_cache_stream* stream);
+
+/**
+ * @brief Returns the share of lookups that were hits, in percent.
+ *
+ * @param[in] cache The response cache.
+ */
+double charra_response_cache_hit_rate(const charra_response_cache* cache);
+
+/**
+ * @brief Drops all entries of the cache.
+ *
+ * @param[in,out] cache The response cache.
+ */
+void charra_response_cache_free(charra_response_cache* cache);
+
+#endif /* CHARRA_RESPONSE_CACHE_H */
@@ -22,71 +22,659 @@
 #include "charra_rim_mgr.h"
 
 #include <ctype.h>
+#include <mbedtls/md.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <yaml.h>
 
 #include "../common/charra_error.h"
 #include "../common/charra_log.h"
 #include "../common/charra_macro.h"
+#include "../util/charra_util.h"
 #include "../util/crypto_util.h"
 #include "../util/io_util.h"
 #include "../util/parser_util.h"
 
-static uint32_t pcr_selection_index = 0;
-static uint32_t pcr_set_index = 0;
-static uint32_t pcr_set_ending_line = 0;
+#define RIM_BIN_MAGIC "CHARRARM"
+#define RIM_BIN_VERSION 3
+#define RIM_BIN_BYTE_ORDER_MARK 0x01020304
+#define RIM_BIN_HEADER_SIZE 64
+#define RIM_BIN_CHECKSUM_OFFSET 32
 
-static void free_reference_pcrs(
-        uint8_t** reference_pcrs, uint32_t reference_pcr_selection_len) {
-    for (uint32_t i = 0; i < reference_pcr_selection_len; i++) {
-        free(reference_pcrs[i]);
+/* maximum number of selected PCRs over all banks */
+#define RIM_SELECTED_PCRS_MAX (CHARRA_RIM_BANKS_MAX * TPM2_MAX_PCRS)
+
+/**
+ * @brief The header of binary reference PCR files, see
+ * charra_rim_store_save().
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint32_t sets_len;
+    uint32_t banks_len;
+    uint32_t indexes_len;
+    uint16_t slot_size;
+    uint16_t reserved;
+    uint8_t checksum[TPM2_SHA256_DIGEST_SIZE];
+} rim_bin_header;
+
+/**
+ * @brief The description of a PCR bank in binary reference PCR files.
+ */
+typedef struct {
+    uint16_t alg;
+    uint16_t digest_size;
+    uint32_t alternatives_len;
+} rim_bin_bank;
+
+/**
+ * @brief The selected PCRs of one bank in binary reference PCR files.
+ */
+typedef struct {
+    uint16_t alg;
+    uint16_t pcrs_len;
+    uint8_t pcrs[TPM2_MAX_PCRS];
+} rim_bin_bank_selection;
+
+/**
+ * @brief The description of a composite digest index in binary reference PCR
+ * files.
+ */
+typedef struct {
+    uint16_t hash_alg;
+    uint16_t banks_len;
+    uint32_t flags;
+    uint64_t slots_len;
+    rim_bin_bank_selection banks[CHARRA_RIM_BANKS_MAX];
+} rim_bin_index;
+
+/* flags of binary indexes */
+#define RIM_BIN_INDEX_PARTIAL 0x1
+
+/**
+ * @brief The allowed values of the selected PCRs of a set, bank by bank:
+ * values[i] holds counts[i] values of size sizes[i] of the i-th selected PCR.
+ */
+typedef struct {
+    uint32_t len;
+    uint16_t sizes[RIM_SELECTED_PCRS_MAX];
+    uint32_t counts[RIM_SELECTED_PCRS_MAX];
+    const uint8_t* values[RIM_SELECTED_PCRS_MAX][CHARRA_RIM_ALTERNATIVES_MAX];
+} rim_pcr_choices;
+
+/**
+ * @brief The hash states of enumerating the composite digests of a PCR
+ * selection: ctxs[i] holds the state over the values chosen for the first i
+ * selected PCRs. The contexts are set up once and reused for all sets.
+ */
+typedef struct {
+    uint32_t len;
+    uint16_t digest_size;
+    mbedtls_md_context_t ctxs[RIM_SELECTED_PCRS_MAX + 1];
+} rim_hash_chain;
+
+/**
+ * @brief Called with each composite digest of the combinations of allowed PCR
+ * values. Returns true to stop.
+ */
+typedef bool (*rim_digest_visitor)(
+        void* arg, const uint8_t* digest, uint16_t digest_size);
+
+/**
+ * @brief The argument of index_insert_digest().
+ */
+typedef struct {
+    charra_rim_index* index;
+    uint32_t set;
+} rim_index_insert;
+
+/**
+ * @brief Rounds \a size up to a multiple of 8.
+ */
+static size_t rim_bin_align(size_t size) { return (size + 7) & ~(size_t)7; }
+
+/**
+ * @brief Returns the bank of algorithm \a alg, NULL if no set lists it.
+ */
+static const charra_rim_bank* find_bank(
+        const charra_rim_store* store, TPMI_ALG_HASH alg) {
+    for (uint32_t b = 0; b < store->banks_len; b++) {
+        if (store->banks[b].alg == alg) {
+            return &store->banks[b];
+        }
     }
-    free(reference_pcrs);
+    return NULL;
 }
 
 /**
- * @brief Check that the last reference PCR set was complete and then compute
- * its digest and compare it against the digest given in the attest_struct.
+ * @brief Returns whether a PCR selection is valid: one to
+ * CHARRA_RIM_BANKS_MAX banks of supported algorithms with PCRs below
+ * TPM2_MAX_PCRS, and a supported composite hash algorithm.
+ */
+static bool selection_valid(const charra_rim_selection* selection) {
+    if (charra_crypto_tpm2_hash_size(selection->hash_alg) == 0 ||
+            selection->banks_len == 0 ||
+            selection->banks_len > CHARRA_RIM_BANKS_MAX) {
+        return false;
+    }
+    for (uint32_t b = 0; b < selection->banks_len; b++) {
+        const charra_rim_bank_selection* bank = &selection->banks[b];
+        if (charra_crypto_tpm2_hash_size(bank->alg) == 0 ||
+                bank->pcrs_len > TPM2_MAX_PCRS) {
+            return false;
+        }
+        for (uint32_t i = 0; i < bank->pcrs_len; i++) {
+            if (bank->pcrs[i] >= TPM2_MAX_PCRS) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Returns whether two PCR selections are the same.
+ */
+static bool selection_equal(
+        const charra_rim_selection* a, const charra_rim_selection* b) {
+    if (a->hash_alg != b->hash_alg || a->banks_len != b->banks_len) {
+        return false;
+    }
+    for (uint32_t i = 0; i < a->banks_len; i++) {
+        if (a->banks[i].alg != b->banks[i].alg ||
+                a->banks[i].pcrs_len != b->banks[i].pcrs_len ||
+                memcmp(a->banks[i].pcrs, b->banks[i].pcrs,
+                        a->banks[i].pcrs_len) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Grows the arrays of the values of a bank to \a cap sets.
  *
- * @param reference_pcrs the 2D array holding all PCR values needed for the
- * PCR composite digest
- * @param reference_pcr_selection the array holding the PCR indexes used for
- * to compute the digest. Only used for logging purposes.
- * @param reference_pcr_selection_len the number of PCR indexes used for the
- * computation of the digest, also the length of both arrays
- * @param attest_struct The struct holding the attestation data from the
- * attester, including the PCR digest.
- * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_NO_MATCH when the digests
- * did not match, CHARRA_RC_ERROR on errors.
- */
-static CHARRA_RC handle_end_of_pcr_set(uint8_t** reference_pcrs,
-        const uint8_t* reference_pcr_selection,
-        const uint32_t reference_pcr_selection_len,
-        const TPMS_ATTEST* const attest_struct) {
-    if (pcr_selection_index < reference_pcr_selection_len) {
-        // we found an empty newline, but the previous set of PCRs was not
-        // complete.
-        charra_log_error(
-                "Error while parsing reference PCRs: "
-                "PCR set ending in line %d does not hold selected PCR %d.",
-                pcr_set_ending_line,
-                reference_pcr_selection[pcr_selection_index]);
+ * @param bank the bank
+ * @param cap the number of sets
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_ERROR on errors.
+ */
+static CHARRA_RC resize_bank(charra_rim_bank* bank, uint32_t cap) {
+    const size_t set_size = (size_t)TPM2_MAX_PCRS * bank->digest_size;
+
+    uint32_t* masks = realloc(bank->pcrs_masks, cap * sizeof(uint32_t));
+    if (masks == NULL) {
+        goto alloc_error;
+    }
+    bank->pcrs_masks = masks;
+    uint8_t* pcrs = realloc(bank->pcrs, cap * set_size);
+    if (pcrs == NULL) {
+        goto alloc_error;
+    }
+    bank->pcrs = pcrs;
+    return CHARRA_RC_SUCCESS;
+
+alloc_error:
+    charra_log_error("Cannot allocate memory for reference PCRs.");
+    return CHARRA_RC_ERROR;
+}
+
+/**
+ * @brief Appends an empty set to the store, growing the arrays of all banks
+ * as needed.
+ *
+ * @param store the sets of reference PCRs
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_ERROR on errors.
+ */
+static CHARRA_RC append_pcr_set(charra_rim_store* store) {
+    CHARRA_RC charra_rc = CHARRA_RC_SUCCESS;
+
+    if (store->sets_len == store->sets_cap) {
+        const uint32_t cap = (store->sets_cap == 0) ? 8 : 2 * store->sets_cap;
+        for (uint32_t b = 0; b < store->banks_len; b++) {
+            if ((charra_rc = resize_bank(&store->banks[b], cap)) !=
+                    CHARRA_RC_SUCCESS) {
+                return charra_rc;
+            }
+        }
+        store->sets_cap = cap;
+    }
+    for (uint32_t b = 0; b < store->banks_len; b++) {
+        charra_rim_bank* bank = &store->banks[b];
+        const size_t set_size = (size_t)TPM2_MAX_PCRS * bank->digest_size;
+        bank->pcrs_masks[store->sets_len] = 0;
+        memset(bank->pcrs + store->sets_len * set_size, 0, set_size);
+    }
+    store->sets_len++;
+    return CHARRA_RC_SUCCESS;
+}
+
+/**
+ * @brief Returns the bank of algorithm \a alg, adding it to the store if no
+ * set listed it before. The sets before hold no values in a new bank.
+ *
+ * @param store the sets of reference PCRs
+ * @param alg the algorithm of the bank
+ * @param bank where to store the bank
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_ERROR on errors.
+ */
+static CHARRA_RC get_bank(
+        charra_rim_store* store, TPMI_ALG_HASH alg, charra_rim_bank** bank) {
+    CHARRA_RC charra_rc = CHARRA_RC_SUCCESS;
+
+    *bank = (charra_rim_bank*)find_bank(store, alg);
+    if (*bank != NULL) {
+        return CHARRA_RC_SUCCESS;
+    }
+    if (store->banks_len == CHARRA_RIM_BANKS_MAX) {
         return CHARRA_RC_ERROR;
     }
 
-    charra_log_debug("Checking PCR composite digest at PCR set index %d:",
-            pcr_set_index);
-    CHARRA_RC rc = compute_and_check_PCR_digest(
-            reference_pcrs, reference_pcr_selection_len, attest_struct);
-    if (rc == CHARRA_RC_ERROR) {
-        charra_log_error("Unexpected error while computing PCR digest at index "
-                         "%d of the PCR sets",
-                pcr_set_index);
-    } else if (rc == CHARRA_RC_SUCCESS) {
-        charra_log_info("Found matching PCR composite digest at index %d of "
-                        "the PCR sets.",
-                pcr_set_index);
+    charra_rim_bank* new_bank = &store->banks[store->banks_len++];
+    new_bank->alg = alg;
+    new_bank->digest_size = charra_crypto_tpm2_hash_size(alg);
+    if ((charra_rc = resize_bank(new_bank, store->sets_cap)) !=
+            CHARRA_RC_SUCCESS) {
+        return charra_rc;
     }
-    return rc;
+    memset(new_bank->pcrs_masks, 0, store->sets_len * sizeof(uint32_t));
+    memset(new_bank->pcrs, 0,
+            (size_t)store->sets_len * TPM2_MAX_PCRS * new_bank->digest_size);
+    *bank = new_bank;
+    return CHARRA_RC_SUCCESS;
+}
+
+/**
+ * @brief Appends an alternative value of a PCR of a set to a bank, growing
+ * its arrays as needed.
+ *
+ * @param bank the bank
+ * @param set the set, the last one of the store
+ * @param pcr the PCR
+ * @param pcr_value where to store the value
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_ERROR on errors.
+ */
+static CHARRA_RC append_pcr_alternative(charra_rim_bank* bank, uint32_t set,
+        uint32_t pcr, uint8_t** pcr_value) {
+    if (bank->alternatives_len == bank->alternatives_cap) {
+        const uint32_t cap = (bank->alternatives_cap == 0)
+                                     ? 8
+                                     : 2 * bank->alternatives_cap;
+        charra_rim_alternative* alternatives = realloc(
+                bank->alternatives, cap * sizeof(charra_rim_alternative));
+        if (alternatives == NULL) {
+            goto alloc_error;
+        }
+        bank->alternatives = alternatives;
+        uint8_t* pcrs = realloc(
+                bank->alternatives_pcrs, (size_t)cap * bank->digest_size);
+        if (pcrs == NULL) {
+            goto alloc_error;
+        }
+        bank->alternatives_pcrs = pcrs;
+        bank->alternatives_cap = cap;
+    }
+    bank->alternatives[bank->alternatives_len] =
+            (charra_rim_alternative){.set = set, .pcr = pcr};
+    *pcr_value = bank->alternatives_pcrs +
+                 (size_t)bank->alternatives_len * bank->digest_size;
+    bank->alternatives_len++;
+    return CHARRA_RC_SUCCESS;
+
+alloc_error:
+    charra_log_error("Cannot allocate memory for reference PCRs.");
+    return CHARRA_RC_ERROR;
+}
+
+/**
+ * @brief Returns the first alternative PCR value of a set (or of a later set
+ * if it has none).
+ */
+static uint32_t find_first_alternative(
+        const charra_rim_bank* bank, uint32_t set) {
+    uint32_t low = 0;
+    uint32_t high = bank->alternatives_len;
+    while (low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+        if (bank->alternatives[mid].set < set) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Gathers the allowed values of the selected PCRs of a set, bank by
+ * bank, replacing them by replayed values where given.
+ *
+ * @param store the sets of reference PCRs
+ * @param set the set
+ * @param selection the PCR selection
+ * @param replayed_pcrs replayed PCR values indexed by bank of the selection
+ * and PCR, may be NULL
+ * @param choices the allowed values of the selected PCRs
+ * @returns -1 on success, else b * TPM2_MAX_PCRS + i for the first selected
+ * PCR i of the b-th bank of the selection the set does not hold.
+ */
+static int gather_pcr_choices(const charra_rim_store* store, uint32_t set,
+        const charra_rim_selection* selection,
+        const uint8_t* const* replayed_pcrs, rim_pcr_choices* choices) {
+    choices->len = 0;
+    for (uint32_t b = 0; b < selection->banks_len; b++) {
+        const charra_rim_bank_selection* bank_selection = &selection->banks[b];
+        const charra_rim_bank* bank = find_bank(store, bank_selection->alg);
+        const uint16_t digest_size =
+                charra_crypto_tpm2_hash_size(bank_selection->alg);
+        const uint8_t* const* replayed =
+                (replayed_pcrs != NULL) ? replayed_pcrs + b * TPM2_MAX_PCRS
+                                        : NULL;
+        int positions[TPM2_MAX_PCRS];
+
+        for (uint32_t pcr = 0; pcr < TPM2_MAX_PCRS; pcr++) {
+            positions[pcr] = -1;
+        }
+        for (uint32_t j = 0; j < bank_selection->pcrs_len; j++) {
+            const uint8_t pcr = bank_selection->pcrs[j];
+            const uint32_t i = choices->len++;
+            choices->sizes[i] = digest_size;
+            choices->counts[i] = 1;
+            if (replayed != NULL && replayed[pcr] != NULL) {
+                choices->values[i][0] = replayed[pcr];
+            } else if (bank != NULL &&
+                       (bank->pcrs_masks[set] & (1u << pcr)) != 0) {
+                choices->values[i][0] =
+                        bank->pcrs + ((size_t)set * TPM2_MAX_PCRS + pcr) *
+                                             digest_size;
+                positions[pcr] = (int)i;
+            } else {
+                return (int)(b * TPM2_MAX_PCRS + pcr);
+            }
+        }
+        if (bank == NULL) {
+            continue;
+        }
+
+        for (uint32_t a = find_first_alternative(bank, set);
+                a < bank->alternatives_len && bank->alternatives[a].set == set;
+                a++) {
+            const int i = positions[bank->alternatives[a].pcr];
+            if (i >= 0 && choices->counts[i] < CHARRA_RIM_ALTERNATIVES_MAX) {
+                choices->values[i][choices->counts[i]++] =
+                        bank->alternatives_pcrs +
+                        (size_t)a * bank->digest_size;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Returns the number of combinations of allowed PCR values, at most
+ * CHARRA_RIM_INDEX_COMBINATIONS_MAX + 1.
+ */
+static uint64_t count_combinations(const rim_pcr_choices* choices) {
+    uint64_t combinations = 1;
+    for (uint32_t i = 0; i < choices->len; i++) {
+        combinations *= choices->counts[i];
+        if (combinations > CHARRA_RIM_INDEX_COMBINATIONS_MAX) {
+            return CHARRA_RIM_INDEX_COMBINATIONS_MAX + 1;
+        }
+    }
+    return combinations;
+}
+
+/**
+ * @brief Sets up the hash states for enumerating the composite digests of a
+ * PCR selection.
+ *
+ * @param chain the hash states, to be freed with hash_chain_free()
+ * @param selection the PCR selection
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_CRYPTO_ERROR on errors.
+ */
+static CHARRA_RC hash_chain_setup(
+        rim_hash_chain* chain, const charra_rim_selection* selection) {
+    const mbedtls_md_info_t* hash_info = mbedtls_md_info_from_type(
+            charra_crypto_tpm2_to_mbedtls_hash_alg(selection->hash_alg));
+    uint32_t len = 0;
+
+    for (uint32_t b = 0; b < selection->banks_len; b++) {
+        len += selection->banks[b].pcrs_len;
+    }
+    chain->len = 0;
+    if (hash_info == NULL) {
+        return CHARRA_RC_CRYPTO_ERROR;
+    }
+    chain->digest_size = mbedtls_md_get_size(hash_info);
+    for (uint32_t i = 0; i <= len; i++) {
+        mbedtls_md_init(&chain->ctxs[i]);
+        chain->len++;
+        if (mbedtls_md_setup(&chain->ctxs[i], hash_info, 0) != 0) {
+            return CHARRA_RC_CRYPTO_ERROR;
+        }
+    }
+    return CHARRA_RC_SUCCESS;
+}
+
+/**
+ * @brief Frees the hash states set up by hash_chain_setup().
+ */
+static void hash_chain_free(rim_hash_chain* chain) {
+    for (uint32_t i = 0; i < chain->len; i++) {
+        mbedtls_md_free(&chain->ctxs[i]);
+    }
+    chain->len = 0;
+}
+
+/**
+ * @brief Computes the composite digests of the combinations of the allowed
+ * values of the selected PCRs from the i-th on, continuing the hash state
+ * over the values chosen for the PCRs before, and passes them to \a visit.
+ *
+ * @param choices the allowed values of the selected PCRs
+ * @param i the selected PCR to choose a value for
+ * @param chain the hash states, ctxs[i] over the values chosen for the PCRs
+ * before i
+ * @param visit the visitor of the composite digests
+ * @param arg the argument of the visitor
+ * @returns CHARRA_RC_SUCCESS if the visitor stopped, CHARRA_RC_NO_MATCH if all
+ * combinations were visited, CHARRA_RC_CRYPTO_ERROR on errors.
+ */
+static CHARRA_RC visit_composite_digests(const rim_pcr_choices* choices,
+        uint32_t i, rim_hash_chain* chain, rim_digest_visitor visit,
+        void* arg) {
+    CHARRA_RC charra_rc = CHARRA_RC_NO_MATCH;
+    mbedtls_md_context_t* next = &chain->ctxs[i + 1];
+    uint8_t digest[MBEDTLS_MD_MAX_SIZE] = {0};
+
+    for (uint32_t v = 0;
+            charra_rc == CHARRA_RC_NO_MATCH && v < choices->counts[i]; v++) {
+        if (mbedtls_md_clone(next, &chain->ctxs[i]) != 0 ||
+                mbedtls_md_update(next, choices->values[i][v],
+                        choices->sizes[i]) != 0) {
+            charra_rc = CHARRA_RC_CRYPTO_ERROR;
+        } else if (i + 1 < choices->len) {
+            charra_rc =
+                    visit_composite_digests(choices, i + 1, chain, visit, arg);
+        } else if (mbedtls_md_finish(next, digest) != 0) {
+            charra_rc = CHARRA_RC_CRYPTO_ERROR;
+        } else if (visit(arg, digest, chain->digest_size)) {
+            charra_rc = CHARRA_RC_SUCCESS;
+        }
+    }
+
+    return charra_rc;
+}
+
+/**
+ * @brief Passes the composite digests of all combinations of the allowed
+ * values of the selected PCRs of a set to \a visit, see
+ * visit_composite_digests(). The single combination of a set without
+ * alternative values is hashed in one pass.
+ */
+static CHARRA_RC visit_set_digests(const rim_pcr_choices* choices,
+        rim_hash_chain* chain, rim_digest_visitor visit, void* arg) {
+    mbedtls_md_context_t* ctx = &chain->ctxs[0];
+    uint8_t digest[MBEDTLS_MD_MAX_SIZE] = {0};
+
+    if (mbedtls_md_starts(ctx) != 0) {
+        return CHARRA_RC_CRYPTO_ERROR;
+    }
+    if (count_combinations(choices) > 1) {
+        return visit_composite_digests(choices, 0, chain, visit, arg);
+    }
+    for (uint32_t i = 0; i < choices->len; i++) {
+        if (mbedtls_md_update(ctx, choices->values[i][0], choices->sizes[i]) !=
+                0) {
+            return CHARRA_RC_CRYPTO_ERROR;
+        }
+    }
+    if (mbedtls_md_finish(ctx, digest) != 0) {
+        return CHARRA_RC_CRYPTO_ERROR;
+    }
+    return visit(arg, digest, chain->digest_size) ? CHARRA_RC_SUCCESS
+                                                  : CHARRA_RC_NO_MATCH;
+}
+
+/**
+ * @brief Returns the index of a PCR selection, NULL if it is not indexed.
+ */
+static const charra_rim_index* find_index(
+        const charra_rim_store* store, const charra_rim_selection* selection) {
+    for (uint32_t i = 0; i < store->indexes_len; i++) {
+        const charra_rim_index* index = &store->indexes[i];
+        if (selection_equal(&index->selection, selection)) {
+            return index;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns the key of a composite digest in an index: its first
+ * TPM2_SHA256_DIGEST_SIZE bytes, padded with zeros.
+ */
+static void index_key(const uint8_t* digest, uint16_t digest_size,
+        uint8_t key[TPM2_SHA256_DIGEST_SIZE]) {
+    const size_t len = (digest_size < TPM2_SHA256_DIGEST_SIZE)
+                               ? digest_size
+                               : TPM2_SHA256_DIGEST_SIZE;
+    memset(key, 0, TPM2_SHA256_DIGEST_SIZE);
+    memcpy(key, digest, len);
+}
+
+/**
+ * @brief Returns the slot of a key in an index: the slot holding it or the
+ * empty slot it is to be inserted into.
+ */
+static charra_rim_index_slot* find_index_slot(
+        const charra_rim_index* index, const uint8_t* key) {
+    uint64_t i = 0;
+    for (uint32_t j = 0; j < 8; j++) {
+        i |= (uint64_t)key[j] << (8 * j);
+    }
+    for (i &= index->slots_mask;; i = (i + 1) & index->slots_mask) {
+        charra_rim_index_slot* slot = &index->slots[i];
+        if (slot->set == 0 ||
+                memcmp(slot->digest, key, TPM2_SHA256_DIGEST_SIZE) == 0) {
+            return slot;
+        }
+    }
+}
+
+/**
+ * @brief Inserts a composite digest into an index, keeping the first of sets
+ * with the same digest.
+ */
+static bool index_insert_digest(
+        void* arg, const uint8_t* digest, uint16_t digest_size) {
+    const rim_index_insert* insert = arg;
+    uint8_t key[TPM2_SHA256_DIGEST_SIZE] = {0};
+
+    index_key(digest, digest_size, key);
+    charra_rim_index_slot* slot = find_index_slot(insert->index, key);
+    if (slot->set == 0) {
+        memcpy(slot->digest, key, TPM2_SHA256_DIGEST_SIZE);
+        slot->set = insert->set + 1;
+    }
+    return false;
+}
+
+/**
+ * @brief Returns whether a composite digest is the PCR digest of a quote.
+ */
+static bool check_quote_digest(
+        void* arg, const uint8_t* digest, uint16_t digest_size) {
+    return charra_verify_tpm2_quote_pcr_composite_digest(
+            arg, digest, digest_size);
+}
+
+/**
+ * @brief Returns whether a value is one of the allowed values of a PCR of a
+ * set.
+ */
+static bool pcr_value_allowed(const charra_rim_bank* bank, uint32_t set,
+        uint32_t pcr, const uint8_t* value) {
+    if (bank == NULL || (bank->pcrs_masks[set] & (1u << pcr)) == 0) {
+        return false;
+    }
+    if (memcmp(bank->pcrs + ((size_t)set * TPM2_MAX_PCRS + pcr) *
+                                    bank->digest_size,
+                value, bank->digest_size) == 0) {
+        return true;
+    }
+    for (uint32_t a = find_first_alternative(bank, set);
+            a < bank->alternatives_len && bank->alternatives[a].set == set;
+            a++) {
+        if (bank->alternatives[a].pcr == pcr &&
+                memcmp(bank->alternatives_pcrs +
+                                (size_t)a * bank->digest_size,
+                        value, bank->digest_size) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Counts the selected PCRs which are not replayed and whose disclosed
+ * value a set allows.
+ *
+ * @param store the sets of reference PCRs
+ * @param set the set
+ * @param selection the PCR selection
+ * @param pcr_values the disclosed PCR values indexed by bank of the selection
+ * and PCR
+ * @param replayed_pcrs replayed PCR values indexed likewise, may be NULL
+ * @param stop whether to stop counting at the first PCR not allowed
+ * @returns the number of PCRs allowed
+ */
+static uint32_t count_allowed_pcr_values(const charra_rim_store* store,
+        uint32_t set, const charra_rim_selection* selection,
+        const uint8_t* const* pcr_values, const uint8_t* const* replayed_pcrs,
+        bool stop) {
+    uint32_t allowed = 0;
+
+    for (uint32_t b = 0; b < selection->banks_len; b++) {
+        const charra_rim_bank_selection* bank_selection = &selection->banks[b];
+        const charra_rim_bank* bank = find_bank(store, bank_selection->alg);
+        for (uint32_t j = 0; j < bank_selection->pcrs_len; j++) {
+            const uint32_t k = b * TPM2_MAX_PCRS + bank_selection->pcrs[j];
+            if (replayed_pcrs != NULL && replayed_pcrs[k] != NULL) {
+                continue;
+            }
+            if (pcr_value_allowed(
+                        bank, set, bank_selection->pcrs[j], pcr_values[k])) {
+                allowed++;
+            } else if (stop) {
+                return allowed;
+            }
+        }
+    }
+    return allowed;
 }
 
 /**
@@ -111,28 +699,91 @@ static CHARRA_RC parse_token(yaml_parser_t* parser, yaml_token_t* token) {
 }
 
 /**
- * @brief Parses a YAML mapping containing a PCR list. All PCR values whose
- * indexes are included in `reference_pcr_selection` will be parsed and stored
- * in `reference_pcrs`. This function should only be called if the parser has
- * previously parsed a `YAML_BLOCK_MAPPING_START_TOKEN`.
+ * @brief Parses a PCR value of a YAML scalar into the last set of `store` in
+ * `bank`: the first value of a PCR is the reference value, further ones are
+ * alternatives. Repeated values are skipped.
+ *
+ * @param store the sets of reference PCRs
+ * @param bank the bank of the PCR
+ * @param pcr the PCR
+ * @param token the YAML scalar token
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_ERROR on errors.
+ */
+static CHARRA_RC parse_pcr_value_token(charra_rim_store* store,
+        charra_rim_bank* bank, uint32_t pcr, const yaml_token_t* token) {
+    CHARRA_RC charra_rc = CHARRA_RC_SUCCESS;
+    const uint32_t set = store->sets_len - 1;
+    uint8_t* set_pcr = bank->pcrs + ((size_t)set * TPM2_MAX_PCRS + pcr) *
+                                            bank->digest_size;
+    const bool first = (bank->pcrs_masks[set] & (1u << pcr)) == 0;
+    uint8_t* pcr_value = set_pcr;
+
+    if (!first && (charra_rc = append_pcr_alternative(bank, set, pcr,
+                           &pcr_value)) != CHARRA_RC_SUCCESS) {
+        return charra_rc;
+    }
+    charra_rc = parse_pcr_value((char*)token->data.scalar.value,
+            token->data.scalar.length, bank->digest_size, pcr_value);
+    if (token->data.scalar.style != YAML_PLAIN_SCALAR_STYLE) {
+        charra_rc = CHARRA_RC_ERROR;
+    }
+    if (charra_rc != CHARRA_RC_SUCCESS) {
+        charra_log_error("Error while parsing PCR value in "
+                         "line %d from reference PCR file.",
+                token->start_mark.line + 1);
+        return charra_rc;
+    }
+    if (first) {
+        bank->pcrs_masks[set] |= 1u << pcr;
+        return CHARRA_RC_SUCCESS;
+    }
+
+    /* compare with the other values of the PCR */
+    uint32_t values = 1;
+    bool repeated = memcmp(set_pcr, pcr_value, bank->digest_size) == 0;
+    for (uint32_t a = bank->alternatives_len - 1;
+            a > 0 && bank->alternatives[a - 1].set == set; a--) {
+        if (bank->alternatives[a - 1].pcr == pcr) {
+            values++;
+            repeated = repeated ||
+                       memcmp(bank->alternatives_pcrs +
+                                       (size_t)(a - 1) * bank->digest_size,
+                               pcr_value, bank->digest_size) == 0;
+        }
+    }
+    if (repeated) {
+        bank->alternatives_len--;
+    } else if (values == CHARRA_RIM_ALTERNATIVES_MAX) {
+        charra_log_error("Error while parsing line %d from reference PCR "
+                         "file: More than %d values of PCR %d.",
+                token->start_mark.line + 1, CHARRA_RIM_ALTERNATIVES_MAX, pcr);
+        return CHARRA_RC_ERROR;
+    }
+    return CHARRA_RC_SUCCESS;
+}
+
+/**
+ * @brief Parses a YAML mapping containing a PCR list. All PCR values are
+ * parsed and stored in the last set of `store` in `bank`. A PCR value is
+ * either a scalar or a flow or block sequence of scalars. This function
+ * should only be called if the parser has previously parsed a
+ * `YAML_BLOCK_MAPPING_START_TOKEN`.
  *
  * @param parser a pointer to the parser
- * @param reference_pcrs the 2D array holding all PCR values needed for the
- * PCR composite digest
- * @param reference_pcr_selection the array holding the PCR indexes used for
- * to compute the digest.
- * @param reference_pcr_selection_len the number of PCR indexes used for the
- * computation of the digest, also the length of both arrays
+ * @param store the sets of reference PCRs
+ * @param bank the bank of the PCRs
  * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_ERROR on errors.
  */
 static CHARRA_RC parse_pcr_mapping(yaml_parser_t* parser,
-        uint8_t** reference_pcrs, const uint8_t* reference_pcr_selection,
-        const uint32_t reference_pcr_selection_len) {
-    CHARRA_RC charra_rc = CHARRA_RC_ERROR;
+        charra_rim_store* store, charra_rim_bank* bank) {
+    CHARRA_RC charra_rc = CHARRA_RC_SUCCESS;
     yaml_token_t token = {0};
     bool mapping_end = false;
     bool is_key_scalar = false;
-    int file_pcr_index = 0;
+    int file_pcr_index = -1;
+    /* start token of the sequence of values being parsed, if any */
+    yaml_token_type_t sequence = YAML_NO_TOKEN;
+    const uint32_t set = store->sets_len - 1;
 
     do {
         charra_rc = parse_token(parser, &token);
@@ -141,17 +792,15 @@ static CHARRA_RC parse_pcr_mapping(yaml_parser_t* parser,
         }
         switch (token.type) {
         case YAML_KEY_TOKEN:
+            if (sequence != YAML_NO_TOKEN) {
+                goto mapping_parse_error;
+            }
             is_key_scalar = true;
             break;
         case YAML_VALUE_TOKEN:
             is_key_scalar = false;
             break;
         case YAML_SCALAR_TOKEN:
-            if (pcr_selection_index >= reference_pcr_selection_len) {
-                // only parse the line if we actually need another PCR for our
-                // digest, otherwise just skip it
-                break;
-            }
             if (is_key_scalar) {
                 file_pcr_index =
                         parse_pcr_index((char*)token.data.scalar.value);
@@ -164,29 +813,60 @@ static CHARRA_RC parse_pcr_mapping(yaml_parser_t* parser,
                     charra_rc = CHARRA_RC_ERROR;
                     goto mapping_error;
                 }
-            } else if (file_pcr_index ==
-                       reference_pcr_selection[pcr_selection_index]) {
-                // PCR in current line is part of the PCR selection
-                charra_rc = parse_pcr_value((char*)token.data.scalar.value,
-                        token.data.scalar.length,
-                        reference_pcrs[pcr_selection_index]);
-                if (token.data.scalar.style != YAML_PLAIN_SCALAR_STYLE) {
+                if ((bank->pcrs_masks[set] & (1u << file_pcr_index)) != 0) {
+                    charra_log_error("Error while parsing line %d from "
+                                     "reference PCR file: "
+                                     "Duplicate PCR Index.",
+                            token.start_mark.line + 1);
                     charra_rc = CHARRA_RC_ERROR;
+                    goto mapping_error;
                 }
+            } else if (file_pcr_index >= 0) {
+                charra_rc = parse_pcr_value_token(
+                        store, bank, (uint32_t)file_pcr_index, &token);
                 if (charra_rc != CHARRA_RC_SUCCESS) {
-                    charra_log_error("Error while parsing PCR value in "
-                                     "line %d from reference PCR file.",
-                            token.start_mark.line + 1);
                     goto mapping_error;
                 }
-
-                // current selected PCR parsed, increase index
-                pcr_selection_index++;
+                if (sequence == YAML_NO_TOKEN) {
+                    file_pcr_index = -1;
+                }
+            }
+            break;
+        case YAML_FLOW_SEQUENCE_START_TOKEN:
+        case YAML_BLOCK_SEQUENCE_START_TOKEN:
+            if (is_key_scalar || file_pcr_index < 0 ||
+                    sequence != YAML_NO_TOKEN) {
+                goto mapping_parse_error;
+            }
+            sequence = token.type;
+            break;
+        case YAML_FLOW_ENTRY_TOKEN:
+        case YAML_BLOCK_ENTRY_TOKEN:
+            if (sequence == YAML_NO_TOKEN) {
+                goto mapping_parse_error;
             }
             break;
+        case YAML_FLOW_SEQUENCE_END_TOKEN:
         case YAML_BLOCK_END_TOKEN:
-            mapping_end = true;
-            pcr_set_ending_line = token.end_mark.line + 1;
+            if (sequence == YAML_NO_TOKEN &&
+                    token.type == YAML_BLOCK_END_TOKEN) {
+                mapping_end = true;
+                break;
+            }
+            if ((sequence == YAML_FLOW_SEQUENCE_START_TOKEN) !=
+                    (token.type == YAML_FLOW_SEQUENCE_END_TOKEN)) {
+                goto mapping_parse_error;
+            }
+            if ((bank->pcrs_masks[set] & (1u << file_pcr_index)) == 0) {
+                charra_log_error("Error while parsing line %d from "
+                                 "reference PCR file: "
+                                 "Empty list of PCR values.",
+                        token.start_mark.line + 1);
+                charra_rc = CHARRA_RC_ERROR;
+                goto mapping_error;
+            }
+            sequence = YAML_NO_TOKEN;
+            file_pcr_index = -1;
             break;
         /* all other tokens should not be parsed in this stage */
         default:
@@ -208,31 +888,34 @@ mapping_error:
 }
 
 /**
- * @brief Parses a YAML document containing a mapping with a mapping as value
- * containing a PCR list. This function should only be called if the parser has
- * previously parsed a `YAML_DOCUMENT_START_TOKEN`.
+ * @brief Parses a YAML document containing a mapping from PCR banks to
+ * mappings containing a PCR list into a new set of `store`. This function
+ * should only be called if the parser has previously parsed a
+ * `YAML_DOCUMENT_START_TOKEN`.
  *
  * @param parser a pointer to the parser
- * @param reference_pcrs the 2D array holding all PCR values needed for the
- * PCR composite digest
- * @param reference_pcr_selection the array holding the PCR indexes used for
- * to compute the digest.
- * @param reference_pcr_selection_len the number of PCR indexes used for the
- * computation of the digest, also the length of both arrays
+ * @param store the sets of reference PCRs
  * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_ERROR on errors.
  */
-static CHARRA_RC parse_document(yaml_parser_t* parser, uint8_t** reference_pcrs,
-        const uint8_t* reference_pcr_selection,
-        const uint32_t reference_pcr_selection_len) {
+static CHARRA_RC parse_document(
+        yaml_parser_t* parser, charra_rim_store* store) {
     CHARRA_RC charra_rc = CHARRA_RC_ERROR;
     yaml_token_t token = {0};
     bool document_end = false;
     bool mapping_started = false;
     yaml_token_type_t expected_token = YAML_BLOCK_MAPPING_START_TOKEN;
+    TPMI_ALG_HASH alg = TPM2_ALG_ERROR;
+    charra_rim_bank* bank = NULL;
+    /* bit b is set if the document lists store->banks[b] */
+    uint32_t banks_listed = 0;
+
+    if ((charra_rc = append_pcr_set(store)) != CHARRA_RC_SUCCESS) {
+        return charra_rc;
+    }
 
     /* the parser should parse:
      * YAML_BLOCK_MAPPING_START_TOKEN,
-     * YAML_KEY_TOKEN, YAML_SCALAR_TOKEN: ("sha256"),
+     * once per bank: YAML_KEY_TOKEN, YAML_SCALAR_TOKEN: ("sha256"),
      * YAML_VALUE_TOKEN,
      * YAML_BLOCK_MAPPING_START_TOKEN: (pcr list), ...,
      * YAML_BLOCK_END_TOKEN (end of root mapping),
@@ -242,14 +925,16 @@ static CHARRA_RC parse_document(yaml_parser_t* parser, uint8_t** reference_pcrs,
         if (charra_rc != CHARRA_RC_SUCCESS) {
             goto document_error;
         }
-        if (token.type != expected_token) {
+        /* another bank may follow the PCR list of a bank */
+        if (token.type != expected_token &&
+                !(expected_token == YAML_BLOCK_END_TOKEN &&
+                        token.type == YAML_KEY_TOKEN)) {
             goto document_parse_error;
         }
         switch (token.type) {
         case YAML_BLOCK_MAPPING_START_TOKEN:
             if (mapping_started) {
-                charra_rc = parse_pcr_mapping(parser, reference_pcrs,
-                        reference_pcr_selection, reference_pcr_selection_len);
+                charra_rc = parse_pcr_mapping(parser, store, bank);
                 if (charra_rc != CHARRA_RC_SUCCESS) {
                     goto document_error;
                 }
@@ -263,12 +948,30 @@ static CHARRA_RC parse_document(yaml_parser_t* parser, uint8_t** reference_pcrs,
             expected_token = YAML_SCALAR_TOKEN;
             break;
         case YAML_SCALAR_TOKEN:
-            // TODO(any): Allow other hashing algorithms
             /* root mapping key should be the pcr digest algorithm */
-            if (strncmp((const char*)token.data.scalar.value, "sha256",
-                        token.data.scalar.length) != 0) {
-                goto document_parse_error;
+            alg = charra_crypto_tpm2_hash_alg_from_name(
+                    (const char*)token.data.scalar.value,
+                    token.data.scalar.length);
+            if (alg == TPM2_ALG_ERROR ||
+                    token.data.scalar.style != YAML_PLAIN_SCALAR_STYLE) {
+                charra_log_error("Error while parsing line %d from reference "
+                                 "PCR file: Unsupported PCR bank.",
+                        token.start_mark.line + 1);
+                charra_rc = CHARRA_RC_ERROR;
+                goto document_error;
             }
+            if ((charra_rc = get_bank(store, alg, &bank)) !=
+                    CHARRA_RC_SUCCESS) {
+                goto document_error;
+            }
+            if ((banks_listed & (1u << (bank - store->banks))) != 0) {
+                charra_log_error("Error while parsing line %d from reference "
+                                 "PCR file: Duplicate PCR bank.",
+                        token.start_mark.line + 1);
+                charra_rc = CHARRA_RC_ERROR;
+                goto document_error;
+            }
+            banks_listed |= 1u << (bank - store->banks);
             expected_token = YAML_VALUE_TOKEN;
             break;
         case YAML_VALUE_TOKEN:
@@ -299,103 +1002,766 @@ document_error:
     return charra_rc;
 }
 
-CHARRA_RC charra_check_pcr_digest_against_reference(const char* filename,
-        const uint8_t* reference_pcr_selection,
-        const uint32_t reference_pcr_selection_len,
-        const TPMS_ATTEST* const attest_struct) {
-    /* sanity check */
-    if (reference_pcr_selection_len >= TPM2_MAX_PCRS) {
+/**
+ * @brief Parses all sets of reference PCRs of a YAML file into \a store.
+ *
+ * @param filename the path of the YAML file
+ * @param store the sets of reference PCRs
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_ERROR on errors.
+ */
+static CHARRA_RC load_yaml(const char* filename, charra_rim_store* store) {
+    CHARRA_RC charra_rc = CHARRA_RC_ERROR;
+    yaml_parser_t parser = {0};
+    yaml_token_t token = {0};
+    FILE* yaml_file = NULL;
+
+    /* open YAML file*/
+    if ((yaml_file = fopen(filename, "rb")) == NULL) {
+        charra_log_error("Cannot open file '%s'.", filename);
+        return CHARRA_RC_ERROR;
+    }
+
+    /* initialize YAML parser with file */
+    if (yaml_parser_initialize(&parser) == 0) {
+        charra_log_error("Could not initialize YAML parser");
+        charra_rc = CHARRA_RC_ERROR;
+        goto returns;
+    }
+    yaml_parser_set_input_file(&parser, yaml_file);
+
+    /* parse YAML file*/
+    bool stream_end = false;
+    do {
+        charra_rc = parse_token(&parser, &token);
+        if (charra_rc != CHARRA_RC_SUCCESS) {
+            goto returns;
+        }
+        switch (token.type) {
+        case YAML_STREAM_START_TOKEN:
+            break;
+        case YAML_DOCUMENT_START_TOKEN:
+            charra_rc = parse_document(&parser, store);
+            if (charra_rc != CHARRA_RC_SUCCESS) {
+                goto returns;
+            }
+            break;
+        case YAML_STREAM_END_TOKEN:
+            stream_end = true;
+            break;
+        /* all other tokens should not be parsed in this stage */
+        default:
+            charra_rc = CHARRA_RC_ERROR;
+            goto returns;
+        }
+        yaml_token_delete(&token);
+    } while (!stream_end);
+
+returns:
+    yaml_token_delete(&token);
+    yaml_parser_delete(&parser);
+    fclose(yaml_file);
+    return charra_rc;
+}
+
+/**
+ * @brief Checks the slots of an index read from a binary file: every slot
+ * refers to an existing set, and at least one slot is empty, so that probing
+ * for a digest not in the index terminates.
+ *
+ * @param index the index
+ * @param sets_len the number of sets of reference PCRs
+ * @returns true if the slots are valid, false if not.
+ */
+static bool index_slots_valid(
+        const charra_rim_index* index, uint32_t sets_len) {
+    bool empty = false;
+    for (uint64_t i = 0; i <= index->slots_mask; i++) {
+        const uint32_t set = index->slots[i].set;
+        if (set > sets_len) {
+            return false;
+        }
+        empty = empty || set == 0;
+    }
+    return empty;
+}
+
+/**
+ * @brief Points a bank of \a store into the mapped binary file at \a pos and
+ * advances \a pos past its sections.
+ *
+ * @param store the sets of reference PCRs
+ * @param bank the bank
+ * @param alternatives_len the number of alternative PCR values of the bank
+ * @param pos the position of the bank's sections in the file
+ * @returns true if the sections are valid, false if not.
+ */
+static bool map_bin_bank(const charra_rim_store* store, charra_rim_bank* bank,
+        uint32_t alternatives_len, size_t* pos) {
+    const size_t len = store->file.len;
+
+    /* PCR masks and values of the sets */
+    const size_t set_size = (size_t)TPM2_MAX_PCRS * bank->digest_size;
+    const uint64_t masks_size =
+            rim_bin_align((uint64_t)store->sets_len * sizeof(uint32_t));
+    const uint64_t pcrs_size =
+            rim_bin_align((uint64_t)store->sets_len * set_size);
+    if (len - *pos < masks_size || len - *pos - masks_size < pcrs_size) {
+        return false;
+    }
+    bank->pcrs_masks = (uint32_t*)(store->file.data + *pos);
+    bank->pcrs = store->file.data + *pos + masks_size;
+    *pos += masks_size + pcrs_size;
+
+    /* alternative PCR values, ordered by set */
+    const uint64_t alternatives_size =
+            (uint64_t)alternatives_len * sizeof(charra_rim_alternative);
+    const uint64_t alternatives_pcrs_size =
+            rim_bin_align((uint64_t)alternatives_len * bank->digest_size);
+    if (len - *pos < alternatives_size ||
+            len - *pos - alternatives_size < alternatives_pcrs_size) {
+        return false;
+    }
+    bank->alternatives_len = alternatives_len;
+    bank->alternatives = (charra_rim_alternative*)(store->file.data + *pos);
+    bank->alternatives_pcrs = store->file.data + *pos + alternatives_size;
+    *pos += alternatives_size + alternatives_pcrs_size;
+    uint32_t values[TPM2_MAX_PCRS] = {0};
+    for (uint32_t a = 0; a < alternatives_len; a++) {
+        const charra_rim_alternative* alternative = &bank->alternatives[a];
+        if (alternative->set >= store->sets_len ||
+                alternative->pcr >= TPM2_MAX_PCRS ||
+                (bank->pcrs_masks[alternative->set] &
+                        (1u << alternative->pcr)) == 0 ||
+                (a > 0 && alternative->set < bank->alternatives[a - 1].set)) {
+            return false;
+        }
+        if (a == 0 || alternative->set != bank->alternatives[a - 1].set) {
+            memset(values, 0, sizeof(values));
+        }
+        if (++values[alternative->pcr] >= CHARRA_RIM_ALTERNATIVES_MAX) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Maps or reads a binary file of reference PCRs and points the banks
+ * and the indexes of \a store into it.
+ *
+ * @param filename the path of the binary file
+ * @param map whether to map the file instead of reading it
+ * @param store the sets of reference PCRs
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_ERROR on errors.
+ */
+static CHARRA_RC load_bin(
+        const char* filename, bool map, charra_rim_store* store) {
+    CHARRA_RC charra_rc = CHARRA_RC_SUCCESS;
+    rim_bin_header header = {0};
+    uint8_t checksum[TPM2_SHA256_DIGEST_SIZE] = {0};
+
+    if (map) {
+        charra_rc = charra_io_map_file(filename, &store->file);
+    } else {
+        charra_rc = charra_io_read_continuous_binary_file(
+                filename, &store->file.data, &store->file.len);
+    }
+    if (charra_rc != CHARRA_RC_SUCCESS) {
+        return charra_rc;
+    }
+    const uint8_t* data = store->file.data;
+    const size_t len = store->file.len;
+
+    /* header */
+    if (len < RIM_BIN_HEADER_SIZE) {
+        goto malformed;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, RIM_BIN_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != RIM_BIN_VERSION) {
+        goto malformed;
+    }
+    if (header.byte_order_mark != RIM_BIN_BYTE_ORDER_MARK) {
+        charra_log_error("Reference PCR file '%s' was compiled on a host with "
+                         "another byte order.",
+                filename);
+        goto error;
+    }
+    if (header.banks_len > CHARRA_RIM_BANKS_MAX ||
+            header.indexes_len > CHARRA_RIM_INDEXES_MAX ||
+            header.slot_size != sizeof(charra_rim_index_slot)) {
+        goto malformed;
+    }
+
+    /* the size of all parts must add up to the size of the file */
+    const size_t banks_size = header.banks_len * sizeof(rim_bin_bank);
+    const size_t indexes_size = header.indexes_len * sizeof(rim_bin_index);
+    if (len - RIM_BIN_HEADER_SIZE < banks_size + indexes_size) {
+        goto malformed;
+    }
+    size_t pos = RIM_BIN_HEADER_SIZE + banks_size + indexes_size;
+    store->sets_len = header.sets_len;
+    for (uint32_t b = 0; b < header.banks_len; b++) {
+        rim_bin_bank bin_bank = {0};
+        memcpy(&bin_bank, data + RIM_BIN_HEADER_SIZE + b * sizeof(rim_bin_bank),
+                sizeof(bin_bank));
+        if (bin_bank.digest_size == 0 ||
+                bin_bank.digest_size !=
+                        charra_crypto_tpm2_hash_size(bin_bank.alg) ||
+                find_bank(store, bin_bank.alg) != NULL) {
+            goto malformed;
+        }
+        charra_rim_bank* bank = &store->banks[b];
+        bank->alg = bin_bank.alg;
+        bank->digest_size = bin_bank.digest_size;
+        store->banks_len++;
+        if (!map_bin_bank(store, bank, bin_bank.alternatives_len, &pos)) {
+            goto malformed;
+        }
+    }
+
+    for (uint32_t i = 0; i < header.indexes_len; i++) {
+        rim_bin_index bin_index = {0};
+        memcpy(&bin_index,
+                data + RIM_BIN_HEADER_SIZE + banks_size +
+                        i * sizeof(rim_bin_index),
+                sizeof(bin_index));
+        if (bin_index.banks_len > CHARRA_RIM_BANKS_MAX) {
+            goto malformed;
+        }
+        charra_rim_index* index = &store->indexes[i];
+        index->selection.hash_alg = bin_index.hash_alg;
+        index->selection.banks_len = bin_index.banks_len;
+        for (uint32_t b = 0; b < bin_index.banks_len; b++) {
+            charra_rim_bank_selection* bank = &index->selection.banks[b];
+            bank->alg = bin_index.banks[b].alg;
+            bank->pcrs_len = bin_index.banks[b].pcrs_len;
+            memcpy(bank->pcrs, bin_index.banks[b].pcrs, sizeof(bank->pcrs));
+        }
+        const uint64_t slots_len = bin_index.slots_len;
+        if (!selection_valid(&index->selection) || slots_len == 0 ||
+                slots_len < 2 * (uint64_t)header.sets_len ||
+                (slots_len & (slots_len - 1)) != 0 ||
+                (len - pos) / header.slot_size < slots_len) {
+            goto malformed;
+        }
+        index->slots_mask = slots_len - 1;
+        index->slots = (charra_rim_index_slot*)(store->file.data + pos);
+        index->partial = (bin_index.flags & RIM_BIN_INDEX_PARTIAL) != 0;
+        index->allocated = false;
+        store->indexes_len++;
+        if (!index_slots_valid(index, header.sets_len)) {
+            goto malformed;
+        }
+        pos += slots_len * header.slot_size;
+    }
+    if (pos != len) {
+        goto malformed;
+    }
+
+    /* checksum over everything after the header */
+    if ((charra_rc = hash_sha256(len - RIM_BIN_HEADER_SIZE,
+                 data + RIM_BIN_HEADER_SIZE, checksum)) != CHARRA_RC_SUCCESS) {
+        goto error;
+    }
+    if (memcmp(checksum, header.checksum, sizeof(checksum)) != 0) {
+        charra_log_error("Checksum of reference PCR file '%s' does not match.",
+                filename);
+        goto error;
+    }
+
+    return CHARRA_RC_SUCCESS;
+
+malformed:
+    charra_log_error(
+            "'%s' is not a valid binary reference PCR file.", filename);
+error:
+    return CHARRA_RC_ERROR;
+}
+
+CHARRA_RC charra_rim_store_load(const char* filename, charra_rim_format format,
+        bool map, charra_rim_store* store) {
+    CHARRA_RC charra_rc = CHARRA_RC_ERROR;
+
+    *store = (charra_rim_store){0};
+
+    if (filename == NULL) {
+        charra_log_error("No reference PCR file specified");
+        return CHARRA_RC_ERROR;
+    }
+
+    switch (format) {
+    case CHARRA_RIM_FORMAT_YAML:
+        charra_rc = load_yaml(filename, store);
+        break;
+    case CHARRA_RIM_FORMAT_BIN:
+        charra_rc = load_bin(filename, map, store);
+        break;
+    default:
+        charra_log_error("Unknown reference PCR file format.");
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+    if (charra_rc != CHARRA_RC_SUCCESS) {
+        charra_rim_store_free(store);
+        return charra_rc;
+    }
+
+    charra_log_info("Loaded %d sets of reference PCRs of %d PCR banks from "
+                    "'%s'.",
+            store->sets_len, store->banks_len, filename);
+    return CHARRA_RC_SUCCESS;
+}
+
+CHARRA_RC charra_rim_store_save(
+        const charra_rim_store* store, const char* filename) {
+    CHARRA_RC charra_rc = CHARRA_RC_SUCCESS;
+    rim_bin_header header = {0};
+    uint8_t* data = NULL;
+    char* tmp_filename = NULL;
+    FILE* file = NULL;
+
+    /* compute the layout */
+    const size_t masks_size =
+            rim_bin_align((size_t)store->sets_len * sizeof(uint32_t));
+    size_t len = RIM_BIN_HEADER_SIZE +
+                 store->banks_len * sizeof(rim_bin_bank) +
+                 store->indexes_len * sizeof(rim_bin_index);
+    for (uint32_t b = 0; b < store->banks_len; b++) {
+        const charra_rim_bank* bank = &store->banks[b];
+        len += masks_size +
+               rim_bin_align((size_t)store->sets_len * TPM2_MAX_PCRS *
+                             bank->digest_size) +
+               (size_t)bank->alternatives_len * sizeof(charra_rim_alternative) +
+               rim_bin_align(
+                       (size_t)bank->alternatives_len * bank->digest_size);
+    }
+    for (uint32_t i = 0; i < store->indexes_len; i++) {
+        len += (store->indexes[i].slots_mask + 1) *
+               sizeof(charra_rim_index_slot);
+    }
+    if ((data = calloc(1, len)) == NULL) {
+        charra_log_error("Cannot allocate memory for reference PCR file.");
+        return CHARRA_RC_ERROR;
+    }
+
+    /* bank and index descriptions, sets and slots */
+    size_t pos = RIM_BIN_HEADER_SIZE;
+    for (uint32_t b = 0; b < store->banks_len; b++) {
+        const charra_rim_bank* bank = &store->banks[b];
+        const rim_bin_bank bin_bank = {.alg = bank->alg,
+                .digest_size = bank->digest_size,
+                .alternatives_len = bank->alternatives_len};
+        memcpy(data + pos, &bin_bank, sizeof(bin_bank));
+        pos += sizeof(bin_bank);
+    }
+    for (uint32_t i = 0; i < store->indexes_len; i++) {
+        const charra_rim_index* index = &store->indexes[i];
+        rim_bin_index bin_index = {0};
+        bin_index.hash_alg = index->selection.hash_alg;
+        bin_index.banks_len = (uint16_t)index->selection.banks_len;
+        bin_index.flags = index->partial ? RIM_BIN_INDEX_PARTIAL : 0;
+        bin_index.slots_len = index->slots_mask + 1;
+        for (uint32_t b = 0; b < index->selection.banks_len; b++) {
+            const charra_rim_bank_selection* bank =
+                    &index->selection.banks[b];
+            bin_index.banks[b].alg = bank->alg;
+            bin_index.banks[b].pcrs_len = (uint16_t)bank->pcrs_len;
+            memcpy(bin_index.banks[b].pcrs, bank->pcrs, bank->pcrs_len);
+        }
+        memcpy(data + pos, &bin_index, sizeof(bin_index));
+        pos += sizeof(bin_index);
+    }
+    for (uint32_t b = 0; b < store->banks_len; b++) {
+        const charra_rim_bank* bank = &store->banks[b];
+        const size_t pcrs_size =
+                (size_t)store->sets_len * TPM2_MAX_PCRS * bank->digest_size;
+        const size_t alternatives_pcrs_size =
+                (size_t)bank->alternatives_len * bank->digest_size;
+        memcpy(data + pos, bank->pcrs_masks,
+                (size_t)store->sets_len * sizeof(uint32_t));
+        pos += masks_size;
+        memcpy(data + pos, bank->pcrs, pcrs_size);
+        pos += rim_bin_align(pcrs_size);
+        if (bank->alternatives_len > 0) {
+            memcpy(data + pos, bank->alternatives,
+                    (size_t)bank->alternatives_len *
+                            sizeof(charra_rim_alternative));
+            pos += (size_t)bank->alternatives_len *
+                   sizeof(charra_rim_alternative);
+            memcpy(data + pos, bank->alternatives_pcrs,
+                    alternatives_pcrs_size);
+            pos += rim_bin_align(alternatives_pcrs_size);
+        }
+    }
+    for (uint32_t i = 0; i < store->indexes_len; i++) {
+        const charra_rim_index* index = &store->indexes[i];
+        const size_t slots_size =
+                (index->slots_mask + 1) * sizeof(charra_rim_index_slot);
+        memcpy(data + pos, index->slots, slots_size);
+        pos += slots_size;
+    }
+
+    /* header */
+    memcpy(header.magic, RIM_BIN_MAGIC, sizeof(header.magic));
+    header.version = RIM_BIN_VERSION;
+    header.byte_order_mark = RIM_BIN_BYTE_ORDER_MARK;
+    header.sets_len = store->sets_len;
+    header.banks_len = store->banks_len;
+    header.indexes_len = store->indexes_len;
+    header.slot_size = sizeof(charra_rim_index_slot);
+    if ((charra_rc = hash_sha256(len - RIM_BIN_HEADER_SIZE,
+                 data + RIM_BIN_HEADER_SIZE, header.checksum)) !=
+            CHARRA_RC_SUCCESS) {
+        goto error;
+    }
+    memcpy(data, &header, sizeof(header));
+
+    /* write file, replacing the old one atomically */
+    if ((tmp_filename = malloc(strlen(filename) + sizeof(".tmp"))) == NULL) {
+        charra_rc = CHARRA_RC_ERROR;
+        goto error;
+    }
+    strcpy(tmp_filename, filename);
+    strcat(tmp_filename, ".tmp");
+    if ((file = fopen(tmp_filename, "wb")) == NULL ||
+            fwrite(data, 1, len, file) != len) {
+        charra_log_error("Cannot write reference PCR file '%s'.", tmp_filename);
+        charra_rc = CHARRA_RC_ERROR;
+        goto error;
+    }
+    if (fclose(file) != 0) {
+        file = NULL;
+        charra_log_error("Cannot write reference PCR file '%s'.", tmp_filename);
+        charra_rc = CHARRA_RC_ERROR;
+        goto error;
+    }
+    file = NULL;
+    if (rename(tmp_filename, filename) != 0) {
         charra_log_error(
-                "Bad PCR selection length: %d.", reference_pcr_selection_len);
+                "Cannot rename '%s' to '%s'.", tmp_filename, filename);
+        charra_rc = CHARRA_RC_ERROR;
+        goto error;
+    }
+
+error:
+    if (file != NULL) {
+        fclose(file);
+    }
+    if (charra_rc != CHARRA_RC_SUCCESS && tmp_filename != NULL) {
+        remove(tmp_filename);
+    }
+    charra_free_if_not_null(tmp_filename);
+    charra_free_if_not_null(data);
+    return charra_rc;
+}
+
+CHARRA_RC charra_rim_store_index(
+        charra_rim_store* store, const charra_rim_selection* selection) {
+    CHARRA_RC charra_rc = CHARRA_RC_SUCCESS;
+    rim_pcr_choices choices = {0};
+    rim_hash_chain chain = {0};
+    uint64_t combinations = 0;
+    uint32_t skipped = 0;
+    uint32_t too_many = 0;
+
+    if (!selection_valid(selection)) {
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+    if (find_index(store, selection) != NULL) {
+        return CHARRA_RC_SUCCESS;
+    }
+    if (store->indexes_len == CHARRA_RIM_INDEXES_MAX) {
+        charra_log_error("Too many PCR selections to index.");
         return CHARRA_RC_BAD_ARGUMENT;
     }
 
-    // allocate memory for the pcr values read from the file
-    uint8_t** reference_pcrs =
-            malloc(reference_pcr_selection_len * sizeof(uint8_t*));
-    for (uint32_t i = 0; i < reference_pcr_selection_len; i++) {
-        reference_pcrs[i] = malloc(TPM2_SHA256_DIGEST_SIZE * sizeof(uint8_t));
+    /* count the combinations of allowed PCR values to index */
+    for (uint32_t set = 0; set < store->sets_len; set++) {
+        if (gather_pcr_choices(store, set, selection, NULL, &choices) >= 0) {
+            skipped++;
+            continue;
+        }
+        const uint64_t set_combinations = count_combinations(&choices);
+        if (set_combinations > CHARRA_RIM_INDEX_COMBINATIONS_MAX) {
+            too_many++;
+            continue;
+        }
+        combinations += set_combinations;
     }
 
-    CHARRA_RC charra_rc = CHARRA_RC_ERROR;
+    /* at most half of the slots are used */
+    charra_rim_index* index = &store->indexes[store->indexes_len];
+    uint64_t slots_len = 16;
+    while (slots_len < 2 * (uint64_t)store->sets_len ||
+            slots_len < 2 * combinations) {
+        slots_len *= 2;
+    }
+    if ((index->slots = calloc(slots_len, sizeof(charra_rim_index_slot))) ==
+            NULL) {
+        charra_log_error("Cannot allocate memory for reference PCR index.");
+        return CHARRA_RC_ERROR;
+    }
+    index->slots_mask = slots_len - 1;
+    index->partial = too_many > 0;
+    index->allocated = true;
+    index->selection = *selection;
 
-    yaml_parser_t parser = {0};
-    yaml_token_t token = {0};
-    FILE* yaml_file = NULL;
-    bool no_digest_match = true;
+    if ((charra_rc = hash_chain_setup(&chain, selection)) !=
+            CHARRA_RC_SUCCESS) {
+        goto error;
+    }
+    for (uint32_t set = 0; set < store->sets_len; set++) {
+        if (gather_pcr_choices(store, set, selection, NULL, &choices) >= 0 ||
+                count_combinations(&choices) >
+                        CHARRA_RIM_INDEX_COMBINATIONS_MAX) {
+            continue;
+        }
+        rim_index_insert insert = {.index = index, .set = set};
+        charra_rc = visit_set_digests(
+                &choices, &chain, index_insert_digest, &insert);
+        if (charra_rc != CHARRA_RC_NO_MATCH) {
+            goto error;
+        }
+    }
+    hash_chain_free(&chain);
+    store->indexes_len++;
+
+    charra_log_info("Indexed %" PRIu64 " composite digests of %d sets of "
+                    "reference PCRs (%d sets do not hold all selected PCRs, "
+                    "%d sets have too many combinations of PCR values).",
+            combinations, store->sets_len - skipped - too_many, skipped,
+            too_many);
+    if (too_many > 0) {
+        charra_log_warn("%d sets of reference PCRs allow more than %d "
+                        "combinations of PCR values and only match quotes "
+                        "whose PCR values are disclosed.",
+                too_many, CHARRA_RIM_INDEX_COMBINATIONS_MAX);
+    }
+    return CHARRA_RC_SUCCESS;
+
+error:
+    hash_chain_free(&chain);
+    charra_free_if_not_null(index->slots);
+    return CHARRA_RC_ERROR;
+}
+
+void charra_rim_store_free(charra_rim_store* store) {
+    for (uint32_t i = 0; i < store->indexes_len; i++) {
+        if (store->indexes[i].allocated) {
+            charra_free_if_not_null(store->indexes[i].slots);
+        }
+    }
+    if (store->file.data != NULL) {
+        /* the sets are part of the mapped file */
+        charra_io_unmap_file(&store->file);
+    } else {
+        for (uint32_t b = 0; b < store->banks_len; b++) {
+            charra_rim_bank* bank = &store->banks[b];
+            charra_free_if_not_null(bank->pcrs_masks);
+            charra_free_if_not_null(bank->pcrs);
+            charra_free_if_not_null(bank->alternatives);
+            charra_free_if_not_null(bank->alternatives_pcrs);
+        }
+    }
+    *store = (charra_rim_store){0};
+}
+
+CHARRA_RC charra_check_pcr_digest_against_reference(
+        const charra_rim_store* store, const charra_rim_selection* selection,
+        const uint8_t* const* replayed_pcrs,
+        const TPMS_ATTEST* const attest_struct) {
+    CHARRA_RC charra_rc = CHARRA_RC_VERIFICATION_FAILED;
+    rim_pcr_choices choices = {0};
+    rim_hash_chain chain = {0};
 
-    if (filename != NULL) {
-        /* open YAML file*/
-        if ((yaml_file = fopen(filename, "rb")) == NULL) {
-            charra_log_error("Cannot open file '%s'.", filename);
+    /* sanity check */
+    if (!selection_valid(selection)) {
+        charra_log_error("Bad PCR selection.");
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+
+    /* look up the digest if the composite digests are indexed */
+    const charra_rim_index* index = find_index(store, selection);
+    for (uint32_t b = 0; index != NULL && replayed_pcrs != NULL &&
+                         b < selection->banks_len;
+            b++) {
+        const charra_rim_bank_selection* bank = &selection->banks[b];
+        for (uint32_t i = 0; i < bank->pcrs_len; i++) {
+            if (replayed_pcrs[b * TPM2_MAX_PCRS + bank->pcrs[i]] != NULL) {
+                index = NULL;
+                break;
+            }
+        }
+    }
+    if (index != NULL) {
+        const TPM2B_DIGEST* pcr_digest =
+                &attest_struct->attested.quote.pcrDigest;
+        uint8_t key[TPM2_SHA256_DIGEST_SIZE] = {0};
+        if (pcr_digest->size !=
+                charra_crypto_tpm2_hash_size(selection->hash_alg)) {
+            return CHARRA_RC_VERIFICATION_FAILED;
+        }
+        index_key(pcr_digest->buffer, pcr_digest->size, key);
+        const charra_rim_index_slot* slot = find_index_slot(index, key);
+        if (slot->set != 0) {
+            charra_log_info("Found matching PCR composite digest at index %d "
+                            "of the PCR sets.",
+                    slot->set - 1);
+            return CHARRA_RC_SUCCESS;
+        }
+        /* sets left out of a partial index are not enumerated either */
+        return CHARRA_RC_VERIFICATION_FAILED;
+    }
+
+    if (hash_chain_setup(&chain, selection) != CHARRA_RC_SUCCESS) {
+        charra_log_error("Cannot set up hashing of PCR composite digests.");
+        charra_rc = CHARRA_RC_ERROR;
+        goto returns;
+    }
+    for (uint32_t set = 0; set < store->sets_len; set++) {
+        /* PCRs replayed from event logs replace reference values */
+        const int missing_pcr = gather_pcr_choices(
+                store, set, selection, replayed_pcrs, &choices);
+        if (missing_pcr >= 0) {
+            charra_log_error("Error while checking reference PCRs: "
+                             "PCR set %d does not hold selected PCR %d of "
+                             "PCR bank 0x%04x.",
+                    set, missing_pcr % TPM2_MAX_PCRS,
+                    selection->banks[missing_pcr / TPM2_MAX_PCRS].alg);
             charra_rc = CHARRA_RC_ERROR;
             goto returns;
         }
+        if (count_combinations(&choices) > CHARRA_RIM_INDEX_COMBINATIONS_MAX) {
+            /* bound the composite digests computed per quote */
+            charra_log_debug("PCR set %d allows more than %d combinations "
+                             "of PCR values, it is only matched against "
+                             "disclosed PCR values.",
+                    set, CHARRA_RIM_INDEX_COMBINATIONS_MAX);
+            continue;
+        }
 
-        /* initialize YAML parser with file */
-        if (yaml_parser_initialize(&parser) == 0) {
-            charra_log_error("Could not initialize YAML parser");
+        /* check if the digest of any combination of PCR values matches */
+        charra_log_debug(
+                "Checking PCR composite digests at PCR set index %d:", set);
+        CHARRA_RC rc = visit_set_digests(
+                &choices, &chain, check_quote_digest, (void*)attest_struct);
+        if (rc == CHARRA_RC_CRYPTO_ERROR) {
+            charra_log_error("Unexpected error while computing PCR digest at "
+                             "index %d of the PCR sets",
+                    set);
             charra_rc = CHARRA_RC_ERROR;
             goto returns;
+        } else if (rc == CHARRA_RC_SUCCESS) {
+            charra_log_info("Found matching PCR composite digest at index %d "
+                            "of the PCR sets.",
+                    set);
+            charra_rc = CHARRA_RC_SUCCESS;
+            goto returns;
         }
-        yaml_parser_set_input_file(&parser, yaml_file);
+        // do not return when digests don't match, we have more PCR sets to
+        // try out
+    }
 
-        /* parse YAML file*/
-        bool stream_end = false;
-        do {
-            charra_rc = parse_token(&parser, &token);
-            if (charra_rc != CHARRA_RC_SUCCESS) {
-                goto returns;
-            }
-            switch (token.type) {
-            case YAML_STREAM_START_TOKEN:
-                break;
-            case YAML_DOCUMENT_START_TOKEN:
-                charra_rc = parse_document(&parser, reference_pcrs,
-                        reference_pcr_selection, reference_pcr_selection_len);
-                if (charra_rc != CHARRA_RC_SUCCESS) {
-                    goto returns;
-                }
-                /* check if digests match */
-                charra_rc = handle_end_of_pcr_set(reference_pcrs,
-                        reference_pcr_selection, reference_pcr_selection_len,
-                        attest_struct);
-                // do not return when digests don't match, we have more PCR sets
-                // to try out
-                if (charra_rc != CHARRA_RC_NO_MATCH) {
-                    no_digest_match = false;
-                    goto returns;
-                }
-                pcr_selection_index = 0;
-                pcr_set_index++;
-                break;
-            case YAML_STREAM_END_TOKEN:
-                stream_end = true;
-                break;
-            /* all other tokens should not be parsed in this stage */
-            default:
-                charra_rc = CHARRA_RC_ERROR;
-                goto returns;
+    // no match until end of reference PCR sets, verification failed.
+returns:
+    hash_chain_free(&chain);
+    return charra_rc;
+}
+
+CHARRA_RC charra_check_pcr_values_against_reference(
+        const charra_rim_store* store, const charra_rim_selection* selection,
+        const uint8_t* const* pcr_values, const uint8_t* const* replayed_pcrs) {
+    CHARRA_RC charra_rc = CHARRA_RC_SUCCESS;
+    uint32_t looked_up = 0;
+
+    /* sanity check */
+    if (!selection_valid(selection)) {
+        charra_log_error("Bad PCR selection.");
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+
+    /* PCRs replayed from event logs must have the disclosed values */
+    for (uint32_t b = 0; b < selection->banks_len; b++) {
+        const charra_rim_bank_selection* bank = &selection->banks[b];
+        const uint16_t digest_size = charra_crypto_tpm2_hash_size(bank->alg);
+        for (uint32_t j = 0; j < bank->pcrs_len; j++) {
+            const uint32_t k = b * TPM2_MAX_PCRS + bank->pcrs[j];
+            if (replayed_pcrs == NULL || replayed_pcrs[k] == NULL) {
+                looked_up++;
+            } else if (memcmp(replayed_pcrs[k], pcr_values[k], digest_size) !=
+                       0) {
+                charra_log_error("PCR %d of PCR bank 0x%04x does not match "
+                                 "the value replayed from its event log:",
+                        bank->pcrs[j], bank->alg);
+                charra_print_hex(CHARRA_LOG_ERROR, digest_size,
+                        replayed_pcrs[k], "    replayed 0x", "\n", false);
+                charra_print_hex(CHARRA_LOG_ERROR, digest_size, pcr_values[k],
+                        "    actual   0x", "\n", false);
+                charra_rc = CHARRA_RC_VERIFICATION_FAILED;
             }
-            yaml_token_delete(&token);
-        } while (!stream_end);
-    } else {
-        /* filename is NULL */
-        charra_log_error("No reference PCR file specified");
-        charra_rc = CHARRA_RC_ERROR;
-        goto returns;
+        }
+    }
+    if (charra_rc != CHARRA_RC_SUCCESS) {
+        return charra_rc;
     }
 
-returns:
-    if (charra_rc != CHARRA_RC_ERROR && no_digest_match) {
-        // no match until end of reference PCR file, verification failed.
-        charra_rc = CHARRA_RC_VERIFICATION_FAILED;
+    /* look the values up PCR by PCR, set by set */
+    for (uint32_t set = 0; set < store->sets_len; set++) {
+        if (count_allowed_pcr_values(store, set, selection, pcr_values,
+                    replayed_pcrs, true) == looked_up) {
+            charra_log_info("Found matching PCR values at index %d of the PCR "
+                            "sets.",
+                    set);
+            return CHARRA_RC_SUCCESS;
+        }
     }
-    yaml_token_delete(&token);
-    yaml_parser_delete(&parser);
-    if (yaml_file != NULL) {
-        fclose(yaml_file);
+
+    /* report the PCRs which do not match the closest set */
+    if (store->sets_len == 0) {
+        charra_log_error("No sets of reference PCRs.");
+        return CHARRA_RC_VERIFICATION_FAILED;
     }
-    free_reference_pcrs(reference_pcrs, reference_pcr_selection_len);
-    return charra_rc;
+    uint32_t closest = 0;
+    uint32_t closest_allowed = 0;
+    for (uint32_t set = 0; set < store->sets_len; set++) {
+        const uint32_t allowed = count_allowed_pcr_values(
+                store, set, selection, pcr_values, replayed_pcrs, false);
+        if (allowed > closest_allowed) {
+            closest = set;
+            closest_allowed = allowed;
+        }
+    }
+    charra_log_error("%d of %d PCRs do not match the closest PCR set at index "
+                     "%d:",
+            looked_up - closest_allowed, looked_up, closest);
+    for (uint32_t b = 0; b < selection->banks_len; b++) {
+        const charra_rim_bank_selection* bank_selection = &selection->banks[b];
+        const charra_rim_bank* bank = find_bank(store, bank_selection->alg);
+        const uint16_t digest_size =
+                charra_crypto_tpm2_hash_size(bank_selection->alg);
+        for (uint32_t j = 0; j < bank_selection->pcrs_len; j++) {
+            const uint8_t pcr = bank_selection->pcrs[j];
+            const uint32_t k = b * TPM2_MAX_PCRS + pcr;
+            if ((replayed_pcrs != NULL && replayed_pcrs[k] != NULL) ||
+                    pcr_value_allowed(bank, closest, pcr, pcr_values[k])) {
+                continue;
+            }
+            charra_log_error(
+                    "  PCR %d of PCR bank 0x%04x:", pcr, bank_selection->alg);
+            if (bank != NULL &&
+                    (bank->pcrs_masks[closest] & (1u << pcr)) != 0) {
+                charra_print_hex(CHARRA_LOG_ERROR, digest_size,
+                        bank->pcrs + ((size_t)closest * TPM2_MAX_PCRS + pcr) *
+                                             digest_size,
+                        "    expected 0x", "\n", false);
+            } else {
+                charra_log_log_raw(
+                        CHARRA_LOG_ERROR, "    expected (not in the set)\n");
+            }
+            charra_print_hex(CHARRA_LOG_ERROR, digest_size, pcr_values[k],
+                    "    actual   0x", "\n", false);
+        }
+    }
+
+    return CHARRA_RC_VERIFICATION_FAILED;
 }
@@ -27,13 +27,142 @@
 #include <tss2/tss2_tpm2_types.h>
 
 #include "../common/charra_error.h"
+#include "../util/io_util.h"
 
 /**
- * @brief Read all sets of reference PCRs from filename. Check if any of the
- * sets produces the same digest as the digest passed as attester_pcr_digest.
+ * @brief The formats of reference PCR files.
+ */
+typedef enum {
+    /* YAML documents as printed by tpm2_pcrread */
+    CHARRA_RIM_FORMAT_YAML,
+    /* binary files compiled by charra-rimc, see charra_rim_store_save() */
+    CHARRA_RIM_FORMAT_BIN,
+} charra_rim_format;
+
+/* maximum number of allowed values of one PCR in a set */
+#define CHARRA_RIM_ALTERNATIVES_MAX 16
+
+/**
+ * @brief A further allowed value of a PCR of a set, see charra_rim_bank.
+ */
+typedef struct {
+    uint32_t set;
+    uint32_t pcr;
+} charra_rim_alternative;
+
+/**
+ * @brief The reference values of all PCR sets for one PCR bank. The values of
+ * a set are stored contiguously, indexed by PCR: PCR i of set s is at
+ * pcrs[(s * TPM2_MAX_PCRS + i) * digest_size]. Sets which do not list the
+ * bank hold no values in it.
+ *
+ * A PCR may have several allowed values in a set; any combination of them
+ * is a valid state. The first value is stored in pcrs, the others are
+ * alternatives, ordered by set: alternatives[a] is another value of PCR
+ * alternatives[a].pcr of set alternatives[a].set, stored at
+ * alternatives_pcrs[a * digest_size].
+ */
+typedef struct {
+    TPMI_ALG_HASH alg;
+    uint16_t digest_size;
+    /* bit i of pcrs_masks[s] is set if set s holds a value for PCR i */
+    uint32_t* pcrs_masks;
+    uint8_t* pcrs;
+    uint32_t alternatives_len;
+    uint32_t alternatives_cap;
+    charra_rim_alternative* alternatives;
+    uint8_t* alternatives_pcrs;
+} charra_rim_bank;
+
+/* maximum number of PCR banks: SHA-1, SHA-256, SHA-384 and SHA-512 */
+#define CHARRA_RIM_BANKS_MAX 4
+
+/**
+ * @brief The selected PCRs of one bank, in ascending order.
+ */
+typedef struct {
+    TPMI_ALG_HASH alg;
+    uint32_t pcrs_len;
+    uint8_t pcrs[TPM2_MAX_PCRS];
+} charra_rim_bank_selection;
+
+/**
+ * @brief A PCR selection over one or more banks, as quoted by the attester.
+ * The composite digest is computed with \a hash_alg (the hash algorithm of
+ * the quote's signing scheme) over the values of the selected PCRs of each
+ * bank, bank by bank in the order given.
+ */
+typedef struct {
+    TPMI_ALG_HASH hash_alg;
+    uint32_t banks_len;
+    charra_rim_bank_selection banks[CHARRA_RIM_BANKS_MAX];
+} charra_rim_selection;
+
+/* maximum number of PCR selections the composite digests are indexed for */
+#define CHARRA_RIM_INDEXES_MAX 4
+
+/* maximum number of combinations of allowed PCR values of a set to index */
+#define CHARRA_RIM_INDEX_COMBINATIONS_MAX 65536
+
+/**
+ * @brief A slot of a composite digest index: the digest and the set it is
+ * the composite digest of, plus one (0 for empty slots). Composite digests
+ * are keyed by their first TPM2_SHA256_DIGEST_SIZE bytes; shorter (SHA-1)
+ * digests are padded with zeros.
+ */
+typedef struct {
+    uint8_t digest[TPM2_SHA256_DIGEST_SIZE];
+    uint32_t set;
+} charra_rim_index_slot;
+
+/**
+ * @brief The composite digests of all sets for one PCR selection, in an
+ * open-addressed hash table keyed by digest (linear probing).
+ */
+typedef struct {
+    charra_rim_selection selection;
+    uint64_t slots_mask;
+    charra_rim_index_slot* slots;
+    /* true if sets with too many combinations of allowed PCR values are not
+     * indexed; they only match disclosed PCR values */
+    bool partial;
+    /* false if the slots are part of a mapped binary file */
+    bool allocated;
+} charra_rim_index;
+
+/**
+ * @brief The sets of reference PCRs, loaded once from the reference PCR file.
+ */
+typedef struct {
+    uint32_t sets_len;
+    uint32_t sets_cap;
+    /* the banks listed by any of the sets */
+    uint32_t banks_len;
+    charra_rim_bank banks[CHARRA_RIM_BANKS_MAX];
+    /* composite digest indexes, see charra_rim_store_index() */
+    uint32_t indexes_len;
+    charra_rim_index indexes[CHARRA_RIM_INDEXES_MAX];
+    /* the binary file the sets are mapped from or read into, if any */
+    charra_io_file_buffer file;
+} charra_rim_store;
+
+/**
+ * @brief Reads all sets of reference PCRs from filename in format \a format
+ * into \a store.
+ *
+ * Binary files are mapped into memory, or read into it if \a map is false,
+ * and used in place after checking their header and checksum; they may
+ * already hold composite digest indexes. A mapped file must only be replaced
+ * by renaming a new file over it while the store is in use, as its pages
+ * change or disappear if it is rewritten in place.
+ *
+ * the YAML reference pcr file is expected to be formatted in the same way as
+ * the output of tpm2_pcrread, e.g.:
+ * sha1:
+ *   0 : 0x0000000000000000000000000000000000000000
+ *
+ *   ...
  *
- * the reference pcr file is expected to be formatted in the same way as the
- * output of tpm2_pcrread, e.g.:
  * sha256:
  *   0 : 0x0000000000000000000000000000000000000000000000000000000000000000
  *
@@ -41,25 +170,159 @@
  *
  *   23: 0x0000000000000000000000000000000000000000000000000000000000000000
  *
- * Entries are identified by the number at the start of the line.
- * Entries are allowed to be missing if they are not in the
- * reference_pcr_selection. Entries are expected to be in order.
- * Each set of PCR states starts with a YAML document start token `---` and
- * ends with a YAML document end token `...`.
+ * A set lists the values of one or more of the banks sha1, sha256, sha384
+ * and sha512. Entries are identified by the number at the start of the line.
+ * Banks and entries are allowed to be missing if they are not selected when
+ * checking against the set. Each set of PCR states starts with a YAML
+ * document start token `---` and ends with a YAML document end token `...`.
+ *
+ * Instead of a single value, an entry may list up to
+ * CHARRA_RIM_ALTERNATIVES_MAX allowed values as a sequence, e.g.
+ *   4 : [0x1111...1111, 0x2222...2222]
+ * so that a set covers all combinations of the allowed values of its PCRs.
+ *
+ * @param[in] filename The path of the file which holds the reference PCR
+ * values.
+ * @param[in] format The format of the file.
+ * @param[in] map Whether binary files are mapped instead of read.
+ * @param[out] store The sets of reference PCRs, to be freed with
+ * charra_rim_store_free().
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_ERROR on errors.
+ */
+CHARRA_RC charra_rim_store_load(const char* filename, charra_rim_format format,
+        bool map, charra_rim_store* store);
+
+/**
+ * @brief Writes the sets of reference PCRs and their composite digest indexes
+ * to a binary file, which can be mapped and used without parsing. The file is
+ * written to a temporary file first and then renamed to \a filename.
+ *
+ * All integers are stored in host byte order; files are only accepted on
+ * hosts with the same byte order. The file consists of:
  *
- * @param[in] filename The path of the file which holds the reference PCR values
- * @param[in] reference_pcr_selection An array of PCRs indexes that we need.
- * @param[in] reference_pcr_selection_len The number of PCRs indexes that we
- * need.
+ * | Size                  | Field                                       |
+ * |-----------------------|---------------------------------------------|
+ * | 8                     | magic "CHARRARM"                            |
+ * | 4                     | version (3)                                 |
+ * | 4                     | byte order mark 0x01020304                  |
+ * | 4                     | number of sets                              |
+ * | 4                     | number of banks                             |
+ * | 4                     | number of indexes                           |
+ * | 2                     | size of an index slot                       |
+ * | 2                     | reserved (0)                                |
+ * | 32                    | SHA-256 over everything after the header    |
+ * | 8 per bank            | PCR bank (TPM2_ALG_ID, 2), digest size (2), |
+ * |                       | number of alternative PCR values (4)        |
+ * | 160 per index         | composite hash algorithm (2), number of     |
+ * |                       | banks (2), flags (4, bit 0: partial),       |
+ * |                       | number of slots (8), and 4 bank selections: |
+ * |                       | PCR bank (2), length (2), PCRs (32)         |
+ * | per bank:             |                                             |
+ * | 4 per set             | PCR masks of the sets                       |
+ * | 32 digests per set    | PCR values of the sets                      |
+ * | 8 per alternative     | set (4) and PCR (4) of alternative values   |
+ * | 1 digest per altern.  | alternative PCR values                      |
+ * | slot size per slot    | slots of each index                         |
+ *
+ * Each section of a bank is padded to a multiple of 8 bytes.
+ *
+ * @param[in] store The sets of reference PCRs.
+ * @param[in] filename The binary file to write.
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_ERROR on errors.
+ */
+CHARRA_RC charra_rim_store_save(
+        const charra_rim_store* store, const char* filename);
+
+/**
+ * @brief Precomputes the composite digests of all sets for a PCR selection
+ * and indexes them by digest, so that quotes over this selection are checked
+ * with a single lookup. Sets which do not hold all selected PCRs of all
+ * selected banks are not indexed. Indexing a selection again has no effect.
+ *
+ * For sets with alternative PCR values, the composite digest of each
+ * combination of allowed values is indexed. Sets with more than
+ * CHARRA_RIM_INDEX_COMBINATIONS_MAX combinations are left out and the index
+ * is marked partial; such sets are only matched against disclosed PCR
+ * values, see charra_check_pcr_values_against_reference().
+ *
+ * @param[in,out] store The sets of reference PCRs.
+ * @param[in] selection The PCR selection.
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_BAD_ARGUMENT if too many
+ * selections are indexed or the selection is invalid, CHARRA_RC_ERROR on
+ * errors.
+ */
+CHARRA_RC charra_rim_store_index(
+        charra_rim_store* store, const charra_rim_selection* selection);
+
+/**
+ * @brief Frees the sets of reference PCRs and their indexes.
+ *
+ * @param[in,out] store The sets of reference PCRs.
+ */
+void charra_rim_store_free(charra_rim_store* store);
+
+/**
+ * @brief Check if any of the sets of reference PCRs produces the same digest
+ * as the PCR digest of the attestation data. No I/O or parsing is done.
+ *
+ * The function is reentrant: it keeps its state on the stack and only reads
+ * \a store, so any number of threads may check quotes against the same
+ * store concurrently.
+ *
+ * If the selection is indexed and none of the selected PCRs is replayed, the
+ * digest is only looked up in the index. Otherwise the composite digests of
+ * the combinations of allowed values of each set are computed until one
+ * matches. The
+ * combinations are enumerated depth-first, PCR by PCR and bank by bank, so
+ * that the hash state over the values chosen for the first PCRs is shared by
+ * all combinations that start with them. Replayed PCRs replace all allowed
+ * values of a set. Sets with more than CHARRA_RIM_INDEX_COMBINATIONS_MAX
+ * combinations are not enumerated but skipped, as they can only be matched
+ * against disclosed PCR values.
+ *
+ * @param[in] store The sets of reference PCRs.
+ * @param[in] selection The PCR selection of the quote.
+ * @param[in] replayed_pcrs PCR values replayed from event logs, indexed by
+ * bank and PCR: PCR i of the b-th bank of \a selection is at
+ * replayed_pcrs[b * TPM2_MAX_PCRS + i] (CHARRA_RIM_BANKS_MAX * TPM2_MAX_PCRS
+ * entries). Non-NULL entries replace the reference values of the sets. May be
+ * NULL.
  * @param[in] attest_struct The struct holding the attestation data from the
  * attester, including the PCR digest.
  * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_VERIFICATION_FAILED when
  * none of the reference PCR states matched the attestation state,
- * CHARRA_RC_ERROR on errors.
+ * CHARRA_RC_ERROR on errors, e.g. if a set does not hold a selected PCR.
  */
-CHARRA_RC charra_check_pcr_digest_against_reference(const char* filename,
-        const uint8_t* reference_pcr_selection,
-        const uint32_t reference_pcr_selection_len,
+CHARRA_RC charra_check_pcr_digest_against_reference(
+        const charra_rim_store* store, const charra_rim_selection* selection,
+        const uint8_t* const* replayed_pcrs,
         const TPMS_ATTEST* const attest_struct);
 
+/**
+ * @brief Check if any of the sets of reference PCRs allows the values of the
+ * selected PCRs disclosed by the attester. The values are looked up PCR by
+ * PCR, so no composite digests are computed; the caller must have checked
+ * that the values produce the PCR digest of the quote. No I/O or parsing is
+ * done and the function is reentrant, see
+ * charra_check_pcr_digest_against_reference().
+ *
+ * Replayed PCRs must equal the disclosed values and are not looked up in the
+ * sets. If no set matches, the mismatching PCRs of the set closest to the
+ * disclosed values are logged.
+ *
+ * @param[in] store The sets of reference PCRs.
+ * @param[in] selection The PCR selection of the quote.
+ * @param[in] pcr_values The disclosed PCR values, indexed like \a
+ * replayed_pcrs; all selected PCRs must be given.
+ * @param[in] replayed_pcrs PCR values replayed from event logs, indexed by
+ * bank and PCR: PCR i of the b-th bank of \a selection is at
+ * replayed_pcrs[b * TPM2_MAX_PCRS + i]. May be NULL.
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_VERIFICATION_FAILED when
+ * none of the sets allows the values or a replayed PCR does not match,
+ * CHARRA_RC_BAD_ARGUMENT if the selection is invalid.
+ */
+CHARRA_RC charra_check_pcr_values_against_reference(
+        const charra_rim_store* store, const charra_rim_selection* selection,
+        const uint8_t* const* pcr_values, const uint8_t* const* replayed_pcrs);
+
 #endif /* CHARRA_RIM_MGR_H */
@@ -0,0 +1,312 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_rim_reload.c
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Reloads the reference PCR file in the background whenever it
+ * changes and publishes the new sets of reference PCRs without blocking the
+ * appraisal.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+/* strdup(), nanosleep() */
+#define _POSIX_C_SOURCE 200809L
+
+#include "charra_rim_reload.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/charra_log.h"
+#include "../common/charra_macro.h"
+
+/* interval to check whether a replaced snapshot is still in use */
+#define RIM_RELOAD_GRACE_POLL_NS (1000 * 1000)
+
+/**
+ * @brief Loads and indexes the reference PCR file into a new snapshot.
+ */
+static CHARRA_RC rim_reload_load(
+        const charra_rim_reload* reload, charra_rim_store** store) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    charra_rim_store* s = NULL;
+
+    if ((s = malloc(sizeof(charra_rim_store))) == NULL) {
+        return CHARRA_RC_ERROR;
+    }
+    /* read, not mapped: the file may be rewritten in place while appraisals
+     * still use this snapshot */
+    if ((r = charra_rim_store_load(
+                 reload->filename, reload->format, false, s)) !=
+            CHARRA_RC_SUCCESS) {
+        free(s);
+        return r;
+    }
+    if ((r = charra_rim_store_index(s, &reload->selection)) !=
+            CHARRA_RC_SUCCESS) {
+        charra_rim_store_free(s);
+        free(s);
+        return r;
+    }
+
+    *store = s;
+    return CHARRA_RC_SUCCESS;
+}
+
+/**
+ * @brief Loads the changed file, publishes it and frees the replaced snapshot
+ * once no matcher uses it any longer.
+ */
+static void rim_reload_swap(charra_rim_reload* reload) {
+    charra_rim_store* next = NULL;
+
+    if (rim_reload_load(reload, &next) != CHARRA_RC_SUCCESS) {
+        charra_log_error("Cannot reload reference PCRs from '%s', keeping "
+                         "the current ones.",
+                reload->filename);
+        return;
+    }
+    charra_rim_store* old =
+            __atomic_exchange_n(&reload->current, next, __ATOMIC_SEQ_CST);
+    charra_log_info("Reloaded reference PCRs from '%s'.", reload->filename);
+
+    /* grace period: wait until no matcher uses the old snapshot; matchers
+     * acquiring it after the exchange see the new one and retry */
+    const struct timespec poll_interval = {0, RIM_RELOAD_GRACE_POLL_NS};
+    for (uint32_t i = 0; i < CHARRA_RIM_MATCHERS_MAX; i++) {
+        while (__atomic_load_n(&reload->hazards[i], __ATOMIC_SEQ_CST) == old) {
+            nanosleep(&poll_interval, NULL);
+        }
+    }
+    charra_rim_store_free(old);
+    free(old);
+}
+
+static void* rim_reload_thread(void* arg) {
+    charra_rim_reload* reload = arg;
+    union {
+        struct inotify_event event;
+        char buf[4096];
+    } events;
+    struct pollfd fds[2] = {
+            {.fd = reload->inotify_fd, .events = POLLIN},
+            {.fd = reload->stop_pipe[0], .events = POLLIN},
+    };
+
+    const char* name = strrchr(reload->filename, '/');
+    name = (name != NULL) ? name + 1 : reload->filename;
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+        const ssize_t len = read(reload->inotify_fd, events.buf,
+                sizeof(events.buf));
+        if (len <= 0) {
+            if (len < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        /* reload once for all events of the file read at once */
+        bool changed = false;
+        for (ssize_t pos = 0; pos < len;) {
+            const struct inotify_event* event =
+                    (const struct inotify_event*)(events.buf + pos);
+            if (event->len > 0 && strcmp(event->name, name) == 0) {
+                changed = true;
+            }
+            pos += sizeof(struct inotify_event) + event->len;
+        }
+        if (changed) {
+            rim_reload_swap(reload);
+        }
+    }
+
+    return NULL;
+}
+
+CHARRA_RC charra_rim_reload_start(charra_rim_reload* reload,
+        const char* filename, charra_rim_format format,
+        const charra_rim_selection* selection) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    char* dir = NULL;
+
+    *reload = (charra_rim_reload){
+            .inotify_fd = -1,
+            .stop_pipe = {-1, -1},
+    };
+    if (filename == NULL) {
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+    if ((reload->filename = strdup(filename)) == NULL) {
+        return CHARRA_RC_ERROR;
+    }
+    reload->format = format;
+    reload->selection = *selection;
+
+    /* initial snapshot */
+    if ((r = rim_reload_load(reload, &reload->current)) != CHARRA_RC_SUCCESS) {
+        goto error;
+    }
+
+    /* watch the directory, files are often replaced by renaming */
+    if ((dir = strdup(filename)) == NULL) {
+        r = CHARRA_RC_ERROR;
+        goto error;
+    }
+    char* slash = strrchr(dir, '/');
+    if (slash == NULL) {
+        strcpy(dir, ".");
+    } else if (slash == dir) {
+        slash[1] = '\0';
+    } else {
+        *slash = '\0';
+    }
+    if ((reload->inotify_fd = inotify_init1(IN_CLOEXEC)) < 0 ||
+            inotify_add_watch(reload->inotify_fd, dir,
+                    IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        charra_log_error("Cannot watch '%s' for changes: %s", dir,
+                strerror(errno));
+        r = CHARRA_RC_ERROR;
+        goto error;
+    }
+    if (pipe(reload->stop_pipe) != 0 ||
+            pthread_create(&reload->thread, NULL, rim_reload_thread, reload) !=
+                    0) {
+        charra_log_error("Cannot start reference PCR reload thread.");
+        r = CHARRA_RC_ERROR;
+        goto error;
+    }
+    reload->started = true;
+    charra_free_if_not_null(dir);
+
+    return CHARRA_RC_SUCCESS;
+
+error:
+    charra_free_if_not_null(dir);
+    charra_rim_reload_stop(reload);
+    return r;
+}
+
+CHARRA_RC charra_rim_matcher_init(
+        charra_rim_matcher* matcher, charra_rim_reload* reload) {
+    for (uint32_t i = 0; i < CHARRA_RIM_MATCHERS_MAX; i++) {
+        bool claimed = false;
+        if (__atomic_compare_exchange_n(&reload->matchers[i], &claimed, true,
+                    false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            *matcher = (charra_rim_matcher){.reload = reload, .slot = i};
+            return CHARRA_RC_SUCCESS;
+        }
+    }
+    charra_log_error("Too many threads checking reference PCRs.");
+    return CHARRA_RC_ERROR;
+}
+
+/**
+ * @brief Announces the current snapshot in the hazard pointer slot of a
+ * matcher and returns it, so that it is not freed until the slot is cleared.
+ */
+static const charra_rim_store* rim_matcher_acquire(
+        charra_rim_matcher* matcher) {
+    charra_rim_reload* reload = matcher->reload;
+    charra_rim_store** hazard = &reload->hazards[matcher->slot];
+    charra_rim_store* store = NULL;
+
+    /* announce the snapshot, retry if it was replaced meanwhile */
+    do {
+        store = __atomic_load_n(&reload->current, __ATOMIC_SEQ_CST);
+        __atomic_store_n(hazard, store, __ATOMIC_SEQ_CST);
+    } while (store != __atomic_load_n(&reload->current, __ATOMIC_SEQ_CST));
+
+    return store;
+}
+
+/**
+ * @brief Clears the hazard pointer slot of a matcher.
+ */
+static void rim_matcher_release(charra_rim_matcher* matcher) {
+    __atomic_store_n(&matcher->reload->hazards[matcher->slot], NULL,
+            __ATOMIC_SEQ_CST);
+}
+
+CHARRA_RC charra_rim_matcher_check(charra_rim_matcher* matcher,
+        const charra_rim_selection* selection,
+        const uint8_t* const* replayed_pcrs,
+        const TPMS_ATTEST* const attest_struct) {
+    const CHARRA_RC r = charra_check_pcr_digest_against_reference(
+            rim_matcher_acquire(matcher), selection, replayed_pcrs,
+            attest_struct);
+
+    rim_matcher_release(matcher);
+    return r;
+}
+
+CHARRA_RC charra_rim_matcher_check_values(charra_rim_matcher* matcher,
+        const charra_rim_selection* selection,
+        const uint8_t* const* pcr_values, const uint8_t* const* replayed_pcrs) {
+    const CHARRA_RC r = charra_check_pcr_values_against_reference(
+            rim_matcher_acquire(matcher), selection, pcr_values,
+            replayed_pcrs);
+
+    rim_matcher_release(matcher);
+    return r;
+}
+
+void charra_rim_matcher_free(charra_rim_matcher* matcher) {
+    if (matcher->reload != NULL) {
+        __atomic_store_n(&matcher->reload->matchers[matcher->slot], false,
+                __ATOMIC_SEQ_CST);
+    }
+    *matcher = (charra_rim_matcher){0};
+}
+
+void charra_rim_reload_stop(charra_rim_reload* reload) {
+    if (reload->started) {
+        if (write(reload->stop_pipe[1], "", 1) != 1) {
+            pthread_cancel(reload->thread);
+        }
+        pthread_join(reload->thread, NULL);
+        reload->started = false;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (reload->stop_pipe[i] >= 0) {
+            close(reload->stop_pipe[i]);
+        }
+    }
+    if (reload->inotify_fd >= 0) {
+        close(reload->inotify_fd);
+    }
+    if (reload->current != NULL) {
+        charra_rim_store_free(reload->current);
+        free(reload->current);
+    }
+    charra_free_if_not_null(reload->filename);
+    *reload = (charra_rim_reload){
+            .inotify_fd = -1,
+            .stop_pipe = {-1, -1},
+    };
+}
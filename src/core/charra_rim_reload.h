@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_rim_reload.h
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Reloads the reference PCR file in the background whenever it
+ * changes and publishes the new sets of reference PCRs without blocking the
+ * appraisal.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#ifndef CHARRA_RIM_RELOAD_H
+#define CHARRA_RIM_RELOAD_H
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <tss2/tss2_tpm2_types.h>
+
+#include "../common/charra_error.h"
+#include "charra_rim_mgr.h"
+
+/* maximum number of threads appraising concurrently */
+#define CHARRA_RIM_MATCHERS_MAX 64
+
+/**
+ * @brief Watches a reference PCR file and keeps the current snapshot of its
+ * sets of reference PCRs, indexed for one PCR selection.
+ *
+ * A reload thread waits for changes of the file (inotify on its directory, so
+ * that files replaced by rename are picked up), loads and indexes the new
+ * file and publishes it with an atomic pointer swap. Files which cannot be
+ * loaded are logged and the current snapshot is kept. Binary files are read
+ * rather than mapped, so that a snapshot does not change if its file is
+ * rewritten in place.
+ *
+ * Each appraising thread checks quotes through its own matcher
+ * (charra_rim_matcher), which announces the snapshot it uses in its hazard
+ * pointer slot. The reload thread frees a replaced snapshot only once no
+ * matcher uses it, so appraisals run concurrently against the shared
+ * read-only snapshot and never wait for a reload.
+ */
+typedef struct {
+    char* filename;
+    charra_rim_format format;
+    charra_rim_selection selection;
+    /* the current snapshot, and per matcher whether it is claimed and the
+     * snapshot it uses (hazard pointer) */
+    charra_rim_store* current;
+    bool matchers[CHARRA_RIM_MATCHERS_MAX];
+    charra_rim_store* hazards[CHARRA_RIM_MATCHERS_MAX];
+    /* inotify descriptor and pipe to stop the reload thread */
+    int inotify_fd;
+    int stop_pipe[2];
+    pthread_t thread;
+    bool started;
+} charra_rim_reload;
+
+/**
+ * @brief The context of one appraising thread for checking quotes against the
+ * reference PCRs of a charra_rim_reload. A matcher must only be used by one
+ * thread at a time.
+ */
+typedef struct {
+    charra_rim_reload* reload;
+    uint32_t slot;
+} charra_rim_matcher;
+
+/**
+ * @brief Loads and indexes the reference PCR file and starts watching it.
+ *
+ * @param[out] reload The reload state, to be stopped with
+ * charra_rim_reload_stop().
+ * @param[in] filename The reference PCR file.
+ * @param[in] format The format of the reference PCR file.
+ * @param[in] selection The PCR selection to index the sets for.
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_ERROR if the file cannot be
+ * loaded or watched.
+ */
+CHARRA_RC charra_rim_reload_start(charra_rim_reload* reload,
+        const char* filename, charra_rim_format format,
+        const charra_rim_selection* selection);
+
+/**
+ * @brief Claims a matcher for one appraising thread.
+ *
+ * @param[out] matcher The matcher, to be freed with charra_rim_matcher_free().
+ * @param[in,out] reload The reload state the matcher reads the snapshots of.
+ * @returns CHARRA_RC_SUCCESS on success, CHARRA_RC_ERROR if all
+ * CHARRA_RIM_MATCHERS_MAX matchers are in use.
+ */
+CHARRA_RC charra_rim_matcher_init(
+        charra_rim_matcher* matcher, charra_rim_reload* reload);
+
+/**
+ * @brief Checks the PCR digest of a quote against the current snapshot of the
+ * sets of reference PCRs, see charra_check_pcr_digest_against_reference().
+ * The snapshot is protected from being freed by a reload for the duration of
+ * the check.
+ *
+ * @param[in,out] matcher The matcher of the calling thread.
+ * @param[in] selection The PCR selection of the quote.
+ * @param[in] replayed_pcrs PCR values replayed from event logs, indexed by
+ * bank of the selection and PCR, may be NULL.
+ * @param[in] attest_struct The attestation data including the PCR digest.
+ * @returns The result of charra_check_pcr_digest_against_reference().
+ */
+CHARRA_RC charra_rim_matcher_check(charra_rim_matcher* matcher,
+        const charra_rim_selection* selection,
+        const uint8_t* const* replayed_pcrs,
+        const TPMS_ATTEST* const attest_struct);
+
+/**
+ * @brief Checks PCR values disclosed by the attester against the current
+ * snapshot of the sets of reference PCRs, see
+ * charra_check_pcr_values_against_reference(). The snapshot is protected from
+ * being freed by a reload for the duration of the check.
+ *
+ * @param[in,out] matcher The matcher of the calling thread.
+ * @param[in] selection The PCR selection of the quote.
+ * @param[in] pcr_values The disclosed PCR values, indexed by bank of the
+ * selection and PCR.
+ * @param[in] replayed_pcrs PCR values replayed from event logs, indexed
+ * likewise, may be NULL.
+ * @returns The result of charra_check_pcr_values_against_reference().
+ */
+CHARRA_RC charra_rim_matcher_check_values(charra_rim_matcher* matcher,
+        const charra_rim_selection* selection,
+        const uint8_t* const* pcr_values, const uint8_t* const* replayed_pcrs);
+
+/**
+ * @brief Releases the matcher for other threads.
+ *
+ * @param[in,out] matcher The matcher.
+ */
+void charra_rim_matcher_free(charra_rim_matcher* matcher);
+
+/**
+ * @brief Stops the reload thread and frees the current snapshot. All
+ * matchers must have been freed.
+ *
+ * @param[in,out] reload The reload state.
+ */
+void charra_rim_reload_stop(charra_rim_reload* reload);
+
+#endif /* CHARRA_RIM_RELOAD_H */
@@ -112,6 +112,11 @@ static CHARRA_RC charra_tap_attestation_request_internal(
     }
     QCBOREncode_CloseArray(&ec);
 
+    /* encode optional "pcr-values", left out if not asked for */
+    if (attestation_request->disclose_pcr_values) {
+        QCBOREncode_AddBool(&ec, true);
+    }
+
     /* close array: root_array_encoder */
     QCBOREncode_CloseArray(&ec);
 
@@ -199,11 +204,13 @@ CHARRA_RC charra_tap_unmarshal_attestation_request(
     QCBORDecodeContext dc = {0};
     QCBORItem item = {0};
     UsefulBufC item_str_buf = {0};
+    uint16_t root_array_len = 0;
 
     QCBORDecode_Init(&dc, marshaled_data_buf, QCBOR_DECODE_MODE_NORMAL);
 
     /* parse root array */
     QCBORDecode_EnterArray(&dc, &item);
+    root_array_len = item.val.uCount;
 
     /* parse "tap-spec-version"*/
     QCBORDecode_GetUInt64(&dc, &(req.tap_spec_version));
@@ -291,6 +298,11 @@ CHARRA_RC charra_tap_unmarshal_attestation_request(
     }
     QCBORDecode_ExitArray(&dc);
 
+    /* parse optional "pcr-values" (bool) */
+    if (root_array_len > 6) {
+        QCBORDecode_GetBool(&dc, &(req.disclose_pcr_values));
+    }
+
     /* exit root array */
     QCBORDecode_ExitArray(&dc);
 
@@ -320,23 +332,57 @@ cbor_parse_error:
     return CHARRA_RC_MARSHALING_ERROR;
 }
 
-static CHARRA_RC charra_tap_marshal_attestation_response_internal(
-        const charra_tap_msg_attestation_response_dto* attestation_response,
-        UsefulBuf buf_in, UsefulBufC* buf_out) {
-    charra_log_trace("<ENTER> %s()", __func__);
+/* CBOR major types (RFC 8949, section 3.1) */
+#define CBOR_MAJOR_TYPE_UINT 0
+#define CBOR_MAJOR_TYPE_BYTES 2
+#define CBOR_MAJOR_TYPE_TEXT 3
+#define CBOR_MAJOR_TYPE_ARRAY 4
 
-    /* verify input */
-    assert(attestation_response != NULL);
-    assert(attestation_response->tpm2_quote.attestation_data != NULL);
-    assert(attestation_response->tpm2_quote.tpm2_signature != NULL);
+/* maximum size of the head of a CBOR data item */
+#define CBOR_HEAD_MAX_SIZE 9
+
+/**
+ * @brief Writes the head of a CBOR data item in preferred serialization
+ * (RFC 8949, section 3) and returns its size.
+ */
+static size_t cbor_encode_head(
+        const uint8_t major_type, const uint64_t value, uint8_t* out) {
+    size_t value_size = 0;
+    if (value < 24) {
+        out[0] = (uint8_t)((major_type << 5) | value);
+        return 1;
+    } else if (value <= UINT8_MAX) {
+        out[0] = (uint8_t)((major_type << 5) | 24);
+        value_size = 1;
+    } else if (value <= UINT16_MAX) {
+        out[0] = (uint8_t)((major_type << 5) | 25);
+        value_size = 2;
+    } else if (value <= UINT32_MAX) {
+        out[0] = (uint8_t)((major_type << 5) | 26);
+        value_size = 4;
+    } else {
+        out[0] = (uint8_t)((major_type << 5) | 27);
+        value_size = 8;
+    }
+
+    /* argument in network byte order */
+    for (size_t i = 0; i < value_size; ++i) {
+        out[value_size - i] = (uint8_t)(value >> (8 * i));
+    }
+
+    return 1 + value_size;
+}
 
+/**
+ * @brief Encodes the tpm2-quote array as complete CBOR data item.
+ */
+static CHARRA_RC charra_tap_encode_tpm2_quote(
+        const charra_tap_explicit_attestation_tpm2_quote_dto* tpm2_quote,
+        UsefulBuf buf_in, UsefulBufC* buf_out) {
     QCBOREncodeContext ec = {0};
 
     QCBOREncode_Init(&ec, buf_in);
 
-    /* root array */
-    QCBOREncode_OpenArray(&ec);
-
     /* array tpm2_quote */
     QCBOREncode_OpenArray(&ec);
 
@@ -347,55 +393,95 @@ static CHARRA_RC charra_tap_marshal_attestation_response_internal(
     QCBOREncode_AddUInt64(&ec, CHARRA_TAP_ATTESTATION_TPM2_QUOTE);
 
     /* encode "attestation-data" */
-    UsefulBufC attestation_data = {
-            .ptr = attestation_response->tpm2_quote.attestation_data,
-            .len = attestation_response->tpm2_quote.attestation_data_len};
+    UsefulBufC attestation_data = {.ptr = tpm2_quote->attestation_data,
+            .len = tpm2_quote->attestation_data_len};
     QCBOREncode_AddBytes(&ec, attestation_data);
 
     /* encode "tpm2-signature" */
-    UsefulBufC tpm2_signature = {
-            .ptr = attestation_response->tpm2_quote.tpm2_signature,
-            .len = attestation_response->tpm2_quote.tpm2_signature_len};
+    UsefulBufC tpm2_signature = {.ptr = tpm2_quote->tpm2_signature,
+            .len = tpm2_quote->tpm2_signature_len};
     QCBOREncode_AddBytes(&ec, tpm2_signature);
 
     /* close array: tpm2_quote */
     QCBOREncode_CloseArray(&ec);
 
-    /* array pcr-logs */
+    if (QCBOREncode_Finish(&ec, buf_out) == QCBOR_SUCCESS) {
+        return CHARRA_RC_SUCCESS;
+    } else {
+        return CHARRA_RC_MARSHALING_ERROR;
+    }
+}
+
+/**
+ * @brief Encodes the nonce-inclusion-proof array as complete CBOR data item.
+ */
+static CHARRA_RC charra_tap_encode_nonce_inclusion_proof(
+        const charra_tap_nonce_inclusion_proof_dto* proof, UsefulBuf buf_in,
+        UsefulBufC* buf_out) {
+    QCBOREncodeContext ec = {0};
+
+    QCBOREncode_Init(&ec, buf_in);
+
+    /* array nonce-inclusion-proof */
     QCBOREncode_OpenArray(&ec);
 
-    for (uint32_t i = 0; i < attestation_response->pcr_log_len; ++i) {
-        /* array pcr-log */
-        QCBOREncode_OpenArray(&ec);
+    /* encode information element identifier */
+    QCBOREncode_AddUInt64(&ec, CHARRA_TAP_IE_NONCE_INCLUSION_PROOF);
 
-        /* encode information element identifier */
-        QCBOREncode_AddUInt64(&ec, CHARRA_TAP_IE_PCR_LOG);
+    /* encode leaf index and tree size */
+    QCBOREncode_AddUInt64(&ec, proof->leaf_index);
+    QCBOREncode_AddUInt64(&ec, proof->tree_size);
 
-        /* encode identifier */
-        UsefulBufC identifier = {
-                .ptr = attestation_response->pcr_logs[i].identifier,
-                .len = strlen(attestation_response->pcr_logs[i].identifier)};
-        QCBOREncode_AddText(&ec, identifier);
+    /* array audit path */
+    QCBOREncode_OpenArray(&ec);
+    for (uint32_t i = 0; i < proof->path_len; ++i) {
+        UsefulBufC hash = {.ptr = proof->path[i],
+                .len = CHARRA_MERKLE_HASH_SIZE};
+        QCBOREncode_AddBytes(&ec, hash);
+    }
+    QCBOREncode_CloseArray(&ec);
+
+    /* close array: nonce-inclusion-proof */
+    QCBOREncode_CloseArray(&ec);
 
-        /* encode start */
-        QCBOREncode_AddUInt64(&ec, attestation_response->pcr_logs[i].start);
+    if (QCBOREncode_Finish(&ec, buf_out) == QCBOR_SUCCESS) {
+        return CHARRA_RC_SUCCESS;
+    } else {
+        return CHARRA_RC_MARSHALING_ERROR;
+    }
+}
 
-        /* encode count */
-        QCBOREncode_AddUInt64(&ec, attestation_response->pcr_logs[i].count);
+/**
+ * @brief Encodes the tpm2-pcr-values array as complete CBOR data item.
+ */
+static CHARRA_RC charra_tap_encode_pcr_values(
+        const charra_tap_tpm2_pcr_values_dto* pcr_values, UsefulBuf buf_in,
+        UsefulBufC* buf_out) {
+    QCBOREncodeContext ec = {0};
 
-        /* encode content */
-        UsefulBufC content = {.ptr = attestation_response->pcr_logs[i].content,
-                .len = attestation_response->pcr_logs[i].content_len};
-        QCBOREncode_AddBytes(&ec, content);
+    QCBOREncode_Init(&ec, buf_in);
 
-        /* close array: pcr-log */
+    /* array tpm2-pcr-values */
+    QCBOREncode_OpenArray(&ec);
+
+    /* encode information element identifier */
+    QCBOREncode_AddUInt64(&ec, CHARRA_TAP_IE_TPM_2_0_PCR);
+
+    /* array pcr-values: bank, PCR and value of each PCR */
+    QCBOREncode_OpenArray(&ec);
+    for (uint32_t i = 0; i < pcr_values->pcr_values_len; ++i) {
+        const charra_tap_pcr_value_dto* pcr_value = &pcr_values->pcr_values[i];
+        QCBOREncode_OpenArray(&ec);
+        QCBOREncode_AddUInt64(&ec, pcr_value->tcg_hash_alg_id);
+        QCBOREncode_AddUInt64(&ec, pcr_value->pcr);
+        UsefulBufC value = {
+                .ptr = pcr_value->value, .len = pcr_value->value_len};
+        QCBOREncode_AddBytes(&ec, value);
         QCBOREncode_CloseArray(&ec);
     }
-
-    /* close array: pcr-logs */
     QCBOREncode_CloseArray(&ec);
 
-    /* close array: root_array_encoder */
+    /* close array: tpm2-pcr-values */
     QCBOREncode_CloseArray(&ec);
 
     if (QCBOREncode_Finish(&ec, buf_out) == QCBOR_SUCCESS) {
@@ -405,67 +491,256 @@ static CHARRA_RC charra_tap_marshal_attestation_response_internal(
     }
 }
 
-CHARRA_RC charra_tap_marshal_attestation_response_size(
+/**
+ * @brief Ends the current framing segment at \a pos.
+ */
+static void charra_tap_close_framing_segment(
+        charra_tap_marshaled_response* marshaled, size_t* segment_start,
+        const size_t pos) {
+    if (pos > *segment_start) {
+        charra_tap_segment* segment =
+                &marshaled->segments[marshaled->segments_len++];
+        segment->data = marshaled->framing + *segment_start;
+        segment->len = pos - *segment_start;
+        marshaled->len += segment->len;
+    }
+    *segment_start = pos;
+}
+
+CHARRA_RC charra_tap_marshal_attestation_response_segments(
         const charra_tap_msg_attestation_response_dto* attestation_response,
-        size_t* marshaled_data_len) {
+        charra_tap_marshaled_response* marshaled_response) {
     charra_log_trace("<ENTER> %s()", __func__);
 
     CHARRA_RC charra_r = CHARRA_RC_SUCCESS;
+    charra_tap_marshaled_response marshaled = {0};
+    const uint32_t pcr_log_len = attestation_response->pcr_log_len;
 
-    /* passing this buffer instructs QCBOR to return only the size and do no
-     * actual encoding */
-    UsefulBuf buf_in = {.len = SIZE_MAX, .ptr = NULL};
-    UsefulBufC buf_out = {0};
+    /* verify input */
+    assert(attestation_response != NULL);
+    assert(attestation_response->tpm2_quote.attestation_data != NULL);
+    assert(attestation_response->tpm2_quote.tpm2_signature != NULL);
 
-    if ((charra_r = charra_tap_marshal_attestation_response_internal(
-                 attestation_response, buf_in, &buf_out)) ==
-            CHARRA_RC_SUCCESS) {
-        *marshaled_data_len = buf_out.len;
+    /* upper bound of the framing size */
+    size_t framing_size =
+            4 * CBOR_HEAD_MAX_SIZE +
+            attestation_response->tpm2_quote.attestation_data_len +
+            attestation_response->tpm2_quote.tpm2_signature_len +
+            CBOR_HEAD_MAX_SIZE;
+    for (uint32_t i = 0; i < pcr_log_len; ++i) {
+        framing_size += 6 * CBOR_HEAD_MAX_SIZE +
+                        strlen(attestation_response->pcr_logs[i].identifier);
+    }
+    if (attestation_response->has_nonce_inclusion_proof) {
+        framing_size += 5 * CBOR_HEAD_MAX_SIZE +
+                        attestation_response->nonce_inclusion_proof.path_len *
+                                (CBOR_HEAD_MAX_SIZE + CHARRA_MERKLE_HASH_SIZE);
+    }
+    if (attestation_response->has_pcr_values) {
+        framing_size += 3 * CBOR_HEAD_MAX_SIZE +
+                        attestation_response->pcr_values.pcr_values_len *
+                                (4 * CBOR_HEAD_MAX_SIZE + sizeof(TPMU_HA));
+    }
+    framing_size += CBOR_HEAD_MAX_SIZE;
+
+    /* framing and content of each log, and the framing after them */
+    if ((marshaled.framing = malloc(framing_size)) == NULL ||
+            (marshaled.segments = calloc(2 * (size_t)pcr_log_len + 1,
+                     sizeof(charra_tap_segment))) == NULL) {
+        charra_log_error("Allocating memory failed.");
+        charra_r = CHARRA_RC_MARSHALING_ERROR;
+        goto error;
+    }
+    uint8_t* const framing = marshaled.framing;
+    size_t pos = 0;
+    size_t segment_start = 0;
+
+    /* root array */
+    pos += cbor_encode_head(CBOR_MAJOR_TYPE_ARRAY,
+            2 + (attestation_response->has_nonce_inclusion_proof ? 1 : 0) +
+                    (attestation_response->has_pcr_values ? 1 : 0),
+            framing + pos);
+
+    /* array tpm2_quote */
+    UsefulBufC item = {0};
+    if ((charra_r = charra_tap_encode_tpm2_quote(
+                 &attestation_response->tpm2_quote,
+                 (UsefulBuf){.ptr = framing + pos, .len = framing_size - pos},
+                 &item)) != CHARRA_RC_SUCCESS) {
+        goto error;
+    }
+    pos += item.len;
+
+    /* array pcr-logs */
+    pos += cbor_encode_head(CBOR_MAJOR_TYPE_ARRAY, pcr_log_len, framing + pos);
+
+    for (uint32_t i = 0; i < pcr_log_len; ++i) {
+        const pcr_log_response_dto* log = &attestation_response->pcr_logs[i];
+        const size_t identifier_len = strlen(log->identifier);
+
+        /* array pcr-log: identifier, start, count, content */
+        pos += cbor_encode_head(CBOR_MAJOR_TYPE_ARRAY, 5, framing + pos);
+        pos += cbor_encode_head(
+                CBOR_MAJOR_TYPE_UINT, CHARRA_TAP_IE_PCR_LOG, framing + pos);
+        pos += cbor_encode_head(
+                CBOR_MAJOR_TYPE_TEXT, identifier_len, framing + pos);
+        memcpy(framing + pos, log->identifier, identifier_len);
+        pos += identifier_len;
+        pos += cbor_encode_head(
+                CBOR_MAJOR_TYPE_UINT, log->start, framing + pos);
+        pos += cbor_encode_head(
+                CBOR_MAJOR_TYPE_UINT, log->count, framing + pos);
+        pos += cbor_encode_head(
+                CBOR_MAJOR_TYPE_BYTES, log->content_len, framing + pos);
+
+        /* reference content instead of copying it */
+        charra_tap_close_framing_segment(&marshaled, &segment_start, pos);
+        if (log->content_len > 0) {
+            if (log->content == NULL && log->content_source.read == NULL) {
+                charra_log_error("PCR log '%s' has no content.",
+                        log->identifier);
+                charra_r = CHARRA_RC_MARSHALING_ERROR;
+                goto error;
+            }
+            charra_tap_segment* segment =
+                    &marshaled.segments[marshaled.segments_len++];
+            segment->data = log->content;
+            segment->len = log->content_len;
+            if (log->content == NULL) {
+                segment->source = log->content_source;
+            }
+            marshaled.len += segment->len;
+        }
+    }
+
+    if (attestation_response->has_nonce_inclusion_proof) {
+        if ((charra_r = charra_tap_encode_nonce_inclusion_proof(
+                     &attestation_response->nonce_inclusion_proof,
+                     (UsefulBuf){
+                             .ptr = framing + pos, .len = framing_size - pos},
+                     &item)) != CHARRA_RC_SUCCESS) {
+            goto error;
+        }
+        pos += item.len;
     }
+    if (attestation_response->has_pcr_values) {
+        if ((charra_r = charra_tap_encode_pcr_values(
+                     &attestation_response->pcr_values,
+                     (UsefulBuf){
+                             .ptr = framing + pos, .len = framing_size - pos},
+                     &item)) != CHARRA_RC_SUCCESS) {
+            goto error;
+        }
+        pos += item.len;
+    }
+    charra_tap_close_framing_segment(&marshaled, &segment_start, pos);
+
+    /* set output parameters */
+    *marshaled_response = marshaled;
+
+    return CHARRA_RC_SUCCESS;
+
+error:
+    charra_tap_marshaled_response_free(&marshaled);
 
     return charra_r;
 }
 
+CHARRA_RC charra_tap_marshaled_response_read(
+        const charra_tap_marshaled_response* marshaled_response, size_t offset,
+        size_t len, uint8_t* out) {
+    CHARRA_RC charra_r = CHARRA_RC_SUCCESS;
+
+    if (offset > marshaled_response->len ||
+            len > marshaled_response->len - offset) {
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+
+    size_t segment_offset = 0;
+    for (uint32_t i = 0; i < marshaled_response->segments_len && len > 0;
+            ++i) {
+        const charra_tap_segment* segment = &marshaled_response->segments[i];
+
+        /* skip segments before the range */
+        if (offset >= segment_offset + segment->len) {
+            segment_offset += segment->len;
+            continue;
+        }
+
+        /* copy the part of the segment within the range */
+        const size_t inner = offset - segment_offset;
+        const size_t n =
+                (segment->len - inner < len) ? segment->len - inner : len;
+        if (segment->source.read != NULL) {
+            if ((charra_r = segment->source.read(segment->source.ctx,
+                         segment->source.offset + inner, n, out)) !=
+                    CHARRA_RC_SUCCESS) {
+                return CHARRA_RC_ERROR;
+            }
+        } else {
+            memcpy(out, segment->data + inner, n);
+        }
+        out += n;
+        offset += n;
+        len -= n;
+        segment_offset += segment->len;
+    }
+
+    return CHARRA_RC_SUCCESS;
+}
+
+void charra_tap_marshaled_response_free(
+        charra_tap_marshaled_response* marshaled_response) {
+    charra_free_if_not_null(marshaled_response->framing);
+    charra_free_if_not_null(marshaled_response->segments);
+    marshaled_response->segments_len = 0;
+    marshaled_response->len = 0;
+}
+
 CHARRA_RC charra_tap_marshal_attestation_response(
         const charra_tap_msg_attestation_response_dto* attestation_response,
         uint32_t* marshaled_data_len, uint8_t** marshaled_data) {
     charra_log_trace("<ENTER> %s()", __func__);
 
     CHARRA_RC charra_r = CHARRA_RC_SUCCESS;
+    charra_tap_marshaled_response marshaled = {0};
+    uint8_t* buf = NULL;
 
-    /* verify input */
-    assert(attestation_response != NULL);
-    assert(attestation_response->tpm2_quote.attestation_data != NULL);
-    assert(attestation_response->tpm2_quote.tpm2_signature != NULL);
-
-    /* compute size of marshaled data */
-    UsefulBuf buf_in = {.len = 0, .ptr = NULL};
-    if ((charra_r = charra_tap_marshal_attestation_response_size(
-                 attestation_response, &(buf_in.len))) != CHARRA_RC_SUCCESS) {
-        charra_log_error("Could not compute size of marshaled data.");
+    /* encode framing once, without copying PCR logs */
+    if ((charra_r = charra_tap_marshal_attestation_response_segments(
+                 attestation_response, &marshaled)) != CHARRA_RC_SUCCESS) {
+        charra_log_error("Could not marshal data.");
         return charra_r;
     }
-    charra_log_debug("Size of marshaled data is %zu bytes.", buf_in.len);
+    charra_log_debug("Size of marshaled data is %zu bytes.", marshaled.len);
+    if (marshaled.len > UINT32_MAX) {
+        charra_log_error("Marshaled data exceeds maximum size.");
+        charra_r = CHARRA_RC_MARSHALING_ERROR;
+        goto error;
+    }
 
     /* allocate buffer size */
-    if ((buf_in.ptr = malloc(buf_in.len)) == NULL) {
-        charra_log_error("Allocating %zu bytes of memory failed.", buf_in.len);
-        return CHARRA_RC_MARSHALING_ERROR;
+    if ((buf = malloc(marshaled.len)) == NULL) {
+        charra_log_error(
+                "Allocating %zu bytes of memory failed.", marshaled.len);
+        charra_r = CHARRA_RC_MARSHALING_ERROR;
+        goto error;
     }
-    charra_log_debug("Allocated %zu bytes of memory.", buf_in.len);
 
-    /* encode */
-    UsefulBufC buf_out = {.len = 0, .ptr = NULL};
-    if ((charra_r = charra_tap_marshal_attestation_response_internal(
-                 attestation_response, buf_in, &buf_out)) !=
-            CHARRA_RC_SUCCESS) {
-        charra_log_error("Could not marshal data.");
-        return charra_r;
+    /* gather framing and PCR logs */
+    if ((charra_r = charra_tap_marshaled_response_read(
+                 &marshaled, 0, marshaled.len, buf)) != CHARRA_RC_SUCCESS) {
+        charra_log_error("Could not read PCR log.");
+        charra_free_if_not_null(buf);
+        goto error;
     }
 
     /* set output parameters */
-    *marshaled_data_len = buf_out.len;
-    *marshaled_data = (uint8_t*)buf_out.ptr;
+    *marshaled_data_len = (uint32_t)marshaled.len;
+    *marshaled_data = buf;
+
+error:
+    charra_tap_marshaled_response_free(&marshaled);
 
     return charra_r;
 }
@@ -482,11 +757,14 @@ CHARRA_RC charra_tap_unmarshal_attestation_response(
     uint64_t ie_identifier = 0;
     uint64_t log_ie_identifier = 0;
     uint64_t attestation_subtype = 0;
+    uint64_t optional_ie_identifier = 0;
+    uint16_t root_array_len = 0;
 
     QCBORDecode_Init(&dc, marshaled_data_buf, QCBOR_DECODE_MODE_NORMAL);
 
     /* parse root array */
     QCBORDecode_EnterArray(&dc, &item);
+    root_array_len = item.val.uCount;
 
     /* parse tpm2-quote array */
     QCBORDecode_EnterArray(&dc, &item);
@@ -556,6 +834,84 @@ CHARRA_RC charra_tap_unmarshal_attestation_response(
     /* exit array pcr-logs */
     QCBORDecode_ExitArray(&dc);
 
+    /* parse optional arrays nonce-inclusion-proof and tpm2-pcr-values */
+    for (uint16_t e = 2; e < root_array_len; ++e) {
+        QCBORDecode_EnterArray(&dc, &item);
+
+        /* parse information element identifier */
+        QCBORDecode_GetUInt64(&dc, &optional_ie_identifier);
+        if (optional_ie_identifier == CHARRA_TAP_IE_NONCE_INCLUSION_PROOF &&
+                !res.has_nonce_inclusion_proof) {
+            charra_tap_nonce_inclusion_proof_dto* proof =
+                    &res.nonce_inclusion_proof;
+
+            /* parse leaf index and tree size */
+            QCBORDecode_GetUInt64(&dc, &proof->leaf_index);
+            QCBORDecode_GetUInt64(&dc, &proof->tree_size);
+
+            /* parse audit path */
+            QCBORDecode_EnterArray(&dc, &item);
+            if (item.val.uCount > CHARRA_MERKLE_MAX_PATH_LEN) {
+                charra_log_error(
+                        "CBOR parser: nonce inclusion proof too long.");
+                goto cbor_parse_error;
+            }
+            proof->path_len = item.val.uCount;
+            for (uint32_t i = 0; i < proof->path_len; ++i) {
+                QCBORDecode_GetByteString(&dc, &item_str_buf);
+                if (item_str_buf.len != CHARRA_MERKLE_HASH_SIZE) {
+                    goto cbor_parse_error;
+                }
+                memcpy(proof->path[i], item_str_buf.ptr,
+                        CHARRA_MERKLE_HASH_SIZE);
+            }
+            QCBORDecode_ExitArray(&dc);
+            res.has_nonce_inclusion_proof = true;
+        } else if (optional_ie_identifier == CHARRA_TAP_IE_TPM_2_0_PCR &&
+                   !res.has_pcr_values) {
+            charra_tap_tpm2_pcr_values_dto* pcr_values = &res.pcr_values;
+
+            /* parse array pcr-values */
+            QCBORDecode_EnterArray(&dc, &item);
+            if (item.val.uCount > CHARRA_TAP_PCR_VALUES_MAX) {
+                charra_log_error("CBOR parser: too many PCR values.");
+                goto cbor_parse_error;
+            }
+            pcr_values->pcr_values_len = item.val.uCount;
+            for (uint32_t i = 0; i < pcr_values->pcr_values_len; ++i) {
+                charra_tap_pcr_value_dto* pcr_value =
+                        &pcr_values->pcr_values[i];
+                uint64_t alg = 0;
+                uint64_t pcr = 0;
+                QCBORDecode_EnterArray(&dc, &item);
+                QCBORDecode_GetUInt64(&dc, &alg);
+                QCBORDecode_GetUInt64(&dc, &pcr);
+                QCBORDecode_GetByteString(&dc, &item_str_buf);
+                QCBORDecode_ExitArray(&dc);
+                if (QCBORDecode_GetError(&dc) != QCBOR_SUCCESS ||
+                        alg > UINT16_MAX || pcr >= TPM2_MAX_PCRS ||
+                        item_str_buf.len > sizeof(TPMU_HA)) {
+                    charra_log_error("CBOR parser: bad PCR value.");
+                    goto cbor_parse_error;
+                }
+                pcr_value->tcg_hash_alg_id = (TPM2_ALG_ID)alg;
+                pcr_value->pcr = (uint8_t)pcr;
+                pcr_value->value_len = (uint16_t)item_str_buf.len;
+                memcpy(pcr_value->value, item_str_buf.ptr, item_str_buf.len);
+            }
+            QCBORDecode_ExitArray(&dc);
+            res.has_pcr_values = true;
+        } else {
+            charra_log_error("CBOR parser: unexpected information element "
+                             "identifier: 0x%02x",
+                    (uint8_t)optional_ie_identifier);
+            goto cbor_parse_error;
+        }
+
+        /* exit optional array */
+        QCBORDecode_ExitArray(&dc);
+    }
+
     /* exit root array */
     QCBORDecode_ExitArray(&dc);
 
@@ -50,6 +50,68 @@ CHARRA_RC charra_tap_unmarshal_attestation_request(
         const uint32_t marshaled_data_len, const uint8_t* marshaled_data,
         charra_tap_msg_attestation_request_dto* attestation_request);
 
+/**
+ * @brief A piece of a marshaled attestation response: either CBOR framing or
+ * the content of a PCR log, which is not copied.
+ */
+typedef struct {
+    const uint8_t* data;
+    size_t len;
+    /* set if the content is read on demand instead of from data */
+    charra_tap_content_source source;
+} charra_tap_segment;
+
+/**
+ * @brief A marshaled attestation response as sequence of segments. Only the
+ * CBOR framing is held by this structure; PCR log contents are referenced and
+ * must outlive it.
+ */
+typedef struct {
+    uint8_t* framing;
+    charra_tap_segment* segments;
+    uint32_t segments_len;
+    /* total length of the marshaled response */
+    size_t len;
+} charra_tap_marshaled_response;
+
+/**
+ * @brief Marshals an attestation response DTO without copying the contents of
+ * its PCR logs. Only the small CBOR framing around them is built.
+ *
+ * @param attestation_response[in] The attestation response DTO.
+ * @param marshaled_response[out] The marshaled response. Must be freed with
+ * charra_tap_marshaled_response_free().
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_MARSHALING_ERROR on error.
+ */
+CHARRA_RC charra_tap_marshal_attestation_response_segments(
+        const charra_tap_msg_attestation_response_dto* attestation_response,
+        charra_tap_marshaled_response* marshaled_response);
+
+/**
+ * @brief Copies a range of a marshaled attestation response into \a out,
+ * reading PCR log contents from their source as needed.
+ *
+ * @param marshaled_response[in] The marshaled response.
+ * @param offset[in] The offset of the range.
+ * @param len[in] The length of the range.
+ * @param out[out] The buffer receiving the range.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_BAD_ARGUMENT if the range exceeds the response.
+ * @return CHARRA_RC_ERROR if a PCR log cannot be read.
+ */
+CHARRA_RC charra_tap_marshaled_response_read(
+        const charra_tap_marshaled_response* marshaled_response, size_t offset,
+        size_t len, uint8_t* out);
+
+/**
+ * @brief Frees the CBOR framing of a marshaled response.
+ *
+ * @param marshaled_response[in,out] The marshaled response.
+ */
+void charra_tap_marshaled_response_free(
+        charra_tap_marshaled_response* marshaled_response);
+
 /**
  * @brief Marshals an attestation response DTO.
  *
@@ -26,6 +26,9 @@
 #include <stdint.h>
 #include <tss2/tss2_tpm2_types.h>
 
+#include "../../common/charra_error.h"
+#include "../../util/merkle_util.h"
+
 #define SIG_KEY_ID_MAXLEN 256
 #define SUPPORTED_PCR_LOGS_COUNT 2
 #define CHARRA_TAP_SPEC_VERSION 0x00000000020200
@@ -78,20 +81,70 @@ typedef struct {
     pcr_selection_dto pcr_selections[TPM2_NUM_PCR_BANKS];
     uint32_t pcr_log_len;
     pcr_log_dto* pcr_logs;
+    /* ask for the values of the selected PCRs along with the quote */
+    bool disclose_pcr_values;
 } charra_tap_msg_attestation_request_dto;
 
+/**
+ * @brief Reads \a len bytes of content at \a offset into \a out.
+ */
+typedef CHARRA_RC (*charra_tap_content_read_cb)(
+        void* ctx, uint64_t offset, size_t len, uint8_t* out);
+
+/**
+ * @brief Content which is read on demand, e.g. directly from a log file,
+ * instead of being held in memory.
+ */
+typedef struct {
+    /* NULL if the content is held in memory */
+    charra_tap_content_read_cb read;
+    void* ctx;
+    /* offset of the content in the source */
+    uint64_t offset;
+} charra_tap_content_source;
+
 typedef struct {
     char* identifier;
     uint64_t start;
     uint64_t count;
     uint64_t content_len;
     uint8_t* content;
+    /* used instead of content if content is NULL */
+    charra_tap_content_source content_source;
 } pcr_log_response_dto;
 
+typedef struct {
+    uint64_t leaf_index;
+    uint64_t tree_size;
+    uint32_t path_len;
+    uint8_t path[CHARRA_MERKLE_MAX_PATH_LEN][CHARRA_MERKLE_HASH_SIZE];
+} charra_tap_nonce_inclusion_proof_dto;
+
+/* maximum number of PCR values disclosed: all PCRs of four banks */
+#define CHARRA_TAP_PCR_VALUES_MAX (4 * TPM2_MAX_PCRS)
+
+typedef struct {
+    TPM2_ALG_ID tcg_hash_alg_id;
+    uint8_t pcr;
+    uint16_t value_len;
+    uint8_t value[sizeof(TPMU_HA)];
+} charra_tap_pcr_value_dto;
+
+typedef struct {
+    uint32_t pcr_values_len;
+    charra_tap_pcr_value_dto pcr_values[CHARRA_TAP_PCR_VALUES_MAX];
+} charra_tap_tpm2_pcr_values_dto;
+
 typedef struct {
     charra_tap_explicit_attestation_tpm2_quote_dto tpm2_quote;
     uint32_t pcr_log_len;
     pcr_log_response_dto* pcr_logs;
+    /* only set if the quote was coalesced over several nonces */
+    bool has_nonce_inclusion_proof;
+    charra_tap_nonce_inclusion_proof_dto nonce_inclusion_proof;
+    /* only set if the PCR values were asked for and could be read */
+    bool has_pcr_values;
+    charra_tap_tpm2_pcr_values_dto pcr_values;
 } charra_tap_msg_attestation_response_dto;
 
 #endif /* CHARRA_TAP_DTO_H */
@@ -114,6 +114,14 @@ typedef enum charra_tap_ie_identifier_t {
      */
     CHARRA_TAP_IE_DICE_SK_ATTESTATION = (uint8_t)0x0D,
 
+    /**
+     * @brief Merkle inclusion proof of the nonce in a coalesced quote whose
+     * qualifying data is the Merkle root over several nonces (CHARRA
+     * extension, not part of the TAP Information Model)
+     *
+     */
+    CHARRA_TAP_IE_NONCE_INCLUSION_PROOF = (uint8_t)0x80,
+
 } charra_tap_ie_identifier_t;
 
 /**
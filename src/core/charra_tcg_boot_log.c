@@ -0,0 +1,280 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_tcg_boot_log.c
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Parses the TCG PC Client (crypto-agile) boot event log received from
+ * the attester and replays it into the PCRs of all banks it contains.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#include "charra_tcg_boot_log.h"
+
+#include <mbedtls/sha1.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/sha512.h>
+#include <string.h>
+
+#include "../common/charra_error.h"
+#include "../common/charra_log.h"
+#include "../util/crypto_util.h"
+
+/* event types (TCG PC Client Platform Firmware Profile) */
+#define EV_NO_ACTION 0x00000003
+
+/* signature of the Spec ID event of crypto-agile logs */
+#define SPEC_ID_EVENT_SIGNATURE "Spec ID Event03"
+
+/* signature of the StartupLocality event */
+#define STARTUP_LOCALITY_SIGNATURE "StartupLocality"
+
+/* size of the fixed part of the Spec ID event: signature, platformClass,
+ * specVersionMinor, specVersionMajor, specErrata, uintnSize,
+ * numberOfAlgorithms */
+#define SPEC_ID_EVENT_HEADER_SIZE (16 + 4 + 1 + 1 + 1 + 1 + 4)
+
+static uint32_t tcg_get_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static uint16_t tcg_get_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/**
+ * @brief Returns whether PCRs of bank \a alg can be replayed.
+ */
+static bool tcg_alg_supported(TPMI_ALG_HASH alg) {
+    return alg == TPM2_ALG_SHA1 || alg == TPM2_ALG_SHA256 ||
+           alg == TPM2_ALG_SHA384 || alg == TPM2_ALG_SHA512;
+}
+
+/**
+ * @brief Extends \a digest into \a pcr: PCR := H(PCR || digest).
+ */
+static CHARRA_RC tcg_extend(
+        const charra_tcg_boot_bank* bank, uint8_t* pcr, const uint8_t* digest) {
+    uint8_t buf[2 * sizeof(TPMU_HA)] = {0};
+    int r = 0;
+
+    memcpy(buf, pcr, bank->digest_size);
+    memcpy(buf + bank->digest_size, digest, bank->digest_size);
+    const size_t len = 2 * (size_t)bank->digest_size;
+    switch (bank->alg) {
+    case TPM2_ALG_SHA1:
+        r = mbedtls_sha1(buf, len, pcr);
+        break;
+    case TPM2_ALG_SHA256:
+        r = mbedtls_sha256(buf, len, pcr, 0);
+        break;
+    case TPM2_ALG_SHA384:
+        r = mbedtls_sha512(buf, len, pcr, 1);
+        break;
+    case TPM2_ALG_SHA512:
+        r = mbedtls_sha512(buf, len, pcr, 0);
+        break;
+    default:
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+    return (r == 0) ? CHARRA_RC_SUCCESS : CHARRA_RC_CRYPTO_ERROR;
+}
+
+/**
+ * @brief Parses the Spec ID event, the first event of the log in SHA-1 format
+ * (TCG_PCR_EVENT), and sets up the announced banks.
+ */
+static CHARRA_RC tcg_parse_spec_id_event(charra_tcg_boot_replay* replay,
+        size_t log_len, const uint8_t* log, size_t* event_len) {
+    /* pcrIndex, eventType, digest, eventSize */
+    size_t len = 4 + 4 + TPM2_SHA1_DIGEST_SIZE + 4;
+    if (log_len < len || tcg_get_u32(log + 4) != EV_NO_ACTION) {
+        return CHARRA_RC_MARSHALING_ERROR;
+    }
+    const uint32_t event_size = tcg_get_u32(log + len - 4);
+    const uint8_t* event = log + len;
+    if (log_len - len < event_size || event_size < SPEC_ID_EVENT_HEADER_SIZE ||
+            memcmp(event, SPEC_ID_EVENT_SIGNATURE,
+                    sizeof(SPEC_ID_EVENT_SIGNATURE)) != 0) {
+        charra_log_error("Boot event log is not in crypto-agile format.");
+        return CHARRA_RC_MARSHALING_ERROR;
+    }
+    len += event_size;
+
+    /* digest sizes of the banks */
+    const uint32_t algs_len =
+            tcg_get_u32(event + SPEC_ID_EVENT_HEADER_SIZE - 4);
+    if (algs_len == 0 || algs_len > TPM2_NUM_PCR_BANKS ||
+            (event_size - SPEC_ID_EVENT_HEADER_SIZE) / 4 < algs_len) {
+        return CHARRA_RC_MARSHALING_ERROR;
+    }
+    const uint8_t* alg = event + SPEC_ID_EVENT_HEADER_SIZE;
+    for (uint32_t i = 0; i < algs_len; ++i, alg += 4) {
+        charra_tcg_boot_bank* bank = &replay->banks[i];
+        bank->alg = tcg_get_u16(alg);
+        bank->digest_size = tcg_get_u16(alg + 2);
+        if (bank->digest_size == 0 || bank->digest_size > sizeof(TPMU_HA)) {
+            return CHARRA_RC_MARSHALING_ERROR;
+        }
+        /* the digest sizes drive the event walk, so they must be exact */
+        if (tcg_alg_supported(bank->alg) &&
+                bank->digest_size !=
+                        charra_crypto_tpm2_hash_size(bank->alg)) {
+            charra_log_error("Boot event log announces PCR bank 0x%04x with "
+                             "digest size %d.",
+                    bank->alg, bank->digest_size);
+            return CHARRA_RC_MARSHALING_ERROR;
+        }
+        for (uint32_t j = 0; j < i; ++j) {
+            if (replay->banks[j].alg == bank->alg) {
+                charra_log_error("Boot event log announces PCR bank 0x%04x "
+                                 "twice.",
+                        bank->alg);
+                return CHARRA_RC_MARSHALING_ERROR;
+            }
+        }
+        bank->replayed = tcg_alg_supported(bank->alg);
+        if (!bank->replayed) {
+            charra_log_info("Not replaying PCR bank 0x%04x of boot event log.",
+                    bank->alg);
+        }
+    }
+    replay->banks_len = algs_len;
+
+    *event_len = len;
+    return CHARRA_RC_SUCCESS;
+}
+
+/**
+ * @brief Returns the bank of algorithm \a alg, NULL if the log has none.
+ */
+static charra_tcg_boot_bank* tcg_find_bank(
+        const charra_tcg_boot_replay* replay, TPMI_ALG_HASH alg) {
+    for (uint32_t i = 0; i < replay->banks_len; ++i) {
+        if (replay->banks[i].alg == alg) {
+            return (charra_tcg_boot_bank*)&replay->banks[i];
+        }
+    }
+    return NULL;
+}
+
+CHARRA_RC charra_tcg_boot_log_replay(
+        charra_tcg_boot_replay* replay, size_t log_len, const uint8_t* log) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    size_t pos = 0;
+
+    memset(replay, 0, sizeof(*replay));
+    if ((r = tcg_parse_spec_id_event(replay, log_len, log, &pos)) !=
+            CHARRA_RC_SUCCESS) {
+        goto malformed;
+    }
+    replay->events = 1;
+
+    while (pos < log_len) {
+        const uint8_t* event = log + pos;
+        const size_t left = log_len - pos;
+
+        /* pcrIndex, eventType, digests.count */
+        size_t len = 4 + 4 + 4;
+        if (left < len) {
+            goto malformed;
+        }
+        const uint32_t pcr_index = tcg_get_u32(event);
+        const uint32_t event_type = tcg_get_u32(event + 4);
+        const uint32_t digests_len = tcg_get_u32(event + 8);
+        if (pcr_index >= TPM2_MAX_PCRS || digests_len > replay->banks_len) {
+            goto malformed;
+        }
+
+        /* digests: algorithm and digest of the size announced */
+        const uint8_t* digests = event + len;
+        for (uint32_t i = 0; i < digests_len; ++i) {
+            if (left - len < 2) {
+                goto malformed;
+            }
+            const charra_tcg_boot_bank* bank =
+                    tcg_find_bank(replay, tcg_get_u16(event + len));
+            if (bank == NULL || left - len - 2 < bank->digest_size) {
+                goto malformed;
+            }
+            len += 2 + bank->digest_size;
+        }
+
+        /* event data */
+        if (left - len < 4) {
+            goto malformed;
+        }
+        const uint32_t event_size = tcg_get_u32(event + len);
+        len += 4;
+        if (left - len < event_size) {
+            goto malformed;
+        }
+        const uint8_t* event_data = event + len;
+        len += event_size;
+
+        if (event_type == EV_NO_ACTION) {
+            /* PCR 0 starts at the locality the S-CRTM was started from */
+            if (pcr_index == 0 &&
+                    event_size >= sizeof(STARTUP_LOCALITY_SIGNATURE) + 1 &&
+                    memcmp(event_data, STARTUP_LOCALITY_SIGNATURE,
+                            sizeof(STARTUP_LOCALITY_SIGNATURE)) == 0) {
+                const uint8_t locality =
+                        event_data[sizeof(STARTUP_LOCALITY_SIGNATURE)];
+                for (uint32_t i = 0; i < replay->banks_len; ++i) {
+                    charra_tcg_boot_bank* bank = &replay->banks[i];
+                    memset(&bank->pcrs[0], 0, sizeof(TPMU_HA));
+                    ((uint8_t*)&bank->pcrs[0])[bank->digest_size - 1] =
+                            locality;
+                }
+                replay->pcrs_mask |= 1u;
+            }
+        } else {
+            /* extend each digest into its bank */
+            const uint8_t* digest = digests;
+            for (uint32_t i = 0; i < digests_len; ++i) {
+                charra_tcg_boot_bank* bank =
+                        tcg_find_bank(replay, tcg_get_u16(digest));
+                if (bank->replayed &&
+                        (r = tcg_extend(bank,
+                                 (uint8_t*)&bank->pcrs[pcr_index],
+                                 digest + 2)) != CHARRA_RC_SUCCESS) {
+                    return r;
+                }
+                digest += 2 + bank->digest_size;
+            }
+            replay->pcrs_mask |= 1u << pcr_index;
+        }
+
+        replay->events += 1;
+        pos += len;
+    }
+
+    return CHARRA_RC_SUCCESS;
+
+malformed:
+    charra_log_error("Malformed boot event %" PRIu64 " at offset %zu.",
+            replay->events + 1, pos);
+    return CHARRA_RC_MARSHALING_ERROR;
+}
+
+const uint8_t* charra_tcg_boot_replay_get_pcr(
+        const charra_tcg_boot_replay* replay, TPMI_ALG_HASH bank,
+        uint32_t pcr_index) {
+    const charra_tcg_boot_bank* b = tcg_find_bank(replay, bank);
+    if (b == NULL || !b->replayed || pcr_index >= TPM2_MAX_PCRS ||
+            (replay->pcrs_mask & (1u << pcr_index)) == 0) {
+        return NULL;
+    }
+    return (const uint8_t*)&b->pcrs[pcr_index];
+}
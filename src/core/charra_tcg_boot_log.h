@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_tcg_boot_log.h
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Parses the TCG PC Client (crypto-agile) boot event log received from
+ * the attester and replays it into the PCRs of all banks it contains.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#ifndef CHARRA_TCG_BOOT_LOG_H
+#define CHARRA_TCG_BOOT_LOG_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <tss2/tss2_tpm2_types.h>
+
+#include "../common/charra_error.h"
+
+/**
+ * @brief The replayed PCRs of one bank of the boot event log.
+ */
+typedef struct {
+    TPMI_ALG_HASH alg;
+    uint16_t digest_size;
+    /* false if the algorithm cannot be replayed, its digests are skipped */
+    bool replayed;
+    TPMU_HA pcrs[TPM2_MAX_PCRS];
+} charra_tcg_boot_bank;
+
+/**
+ * @brief The expected PCR values after replaying a boot event log.
+ */
+typedef struct {
+    /* banks as announced by the Spec ID event */
+    uint32_t banks_len;
+    charra_tcg_boot_bank banks[TPM2_NUM_PCR_BANKS];
+    /* bit i is set if the log sets PCR i */
+    uint32_t pcrs_mask;
+    /* number of events, including the Spec ID event */
+    uint64_t events;
+} charra_tcg_boot_replay;
+
+/**
+ * @brief Parses a TCG PC Client boot event log in crypto-agile format
+ * (TCG_PCR_EVENT2, as in binary_bios_measurements) in one pass and extends
+ * the digests of each event into all banks announced by the Spec ID event.
+ *
+ * The log is parsed in place, without allocations. Banks with algorithms
+ * other than SHA-1, SHA-256, SHA-384 and SHA-512 are parsed but not
+ * replayed. EV_NO_ACTION events are not extended; a StartupLocality event
+ * sets the initial value of PCR 0.
+ *
+ * @param[out] replay The expected PCR values.
+ * @param[in] log_len The length of \a log.
+ * @param[in] log The boot event log.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_MARSHALING_ERROR on malformed logs, including Spec ID
+ * events announcing a bank twice or a supported bank with a digest size other
+ * than that of its algorithm.
+ * @return CHARRA_RC_CRYPTO_ERROR on hashing errors.
+ */
+CHARRA_RC charra_tcg_boot_log_replay(
+        charra_tcg_boot_replay* replay, size_t log_len, const uint8_t* log);
+
+/**
+ * @brief Returns the expected value of a PCR after replaying the log.
+ *
+ * @param[in] replay The expected PCR values.
+ * @param[in] bank The PCR bank.
+ * @param[in] pcr_index The PCR.
+ * @return The PCR value of the size of the bank's digests, NULL if the bank
+ * was not replayed or the log does not set the PCR.
+ */
+const uint8_t* charra_tcg_boot_replay_get_pcr(
+        const charra_tcg_boot_replay* replay, TPMI_ALG_HASH bank,
+        uint32_t pcr_index);
+
+#endif /* CHARRA_TCG_BOOT_LOG_H */
@@ -0,0 +1,199 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_timer_wheel.c
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief A hierarchical timer wheel with a resolution of one millisecond, to
+ * schedule many timers at constant cost per timer.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#include "charra_timer_wheel.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define TIMER_WHEEL_SLOT_MASK ((uint64_t)CHARRA_TIMER_WHEEL_SLOTS - 1)
+
+/* time spanned by all levels */
+#define TIMER_WHEEL_RANGE_MS                                                   \
+    ((uint64_t)1 << (CHARRA_TIMER_WHEEL_LEVELS * CHARRA_TIMER_WHEEL_SLOT_BITS))
+
+static void timer_wheel_unlink(charra_timer_wheel* wheel, charra_timer* timer) {
+    *timer->pprev = timer->next;
+    if (timer->next != NULL) {
+        timer->next->pprev = timer->pprev;
+    }
+    timer->next = NULL;
+    timer->pprev = NULL;
+    wheel->pending[timer->level] -= 1;
+}
+
+/**
+ * @brief Links a timer into the slot its expiry falls into, on the lowest
+ * level whose slots reach that far from the time the wheel is at. Timers
+ * expiring before \a first_ms are linked as if they expired then.
+ */
+static void timer_wheel_link(
+        charra_timer_wheel* wheel, charra_timer* timer, uint64_t first_ms) {
+    uint64_t expires_ms = timer->expires_ms;
+    if (expires_ms < first_ms) {
+        expires_ms = first_ms;
+    } else if (expires_ms - wheel->now_ms >= TIMER_WHEEL_RANGE_MS) {
+        /* moved down again once it is in range */
+        expires_ms = wheel->now_ms + TIMER_WHEEL_RANGE_MS - 1;
+    }
+
+    const uint64_t delta = expires_ms - wheel->now_ms;
+    uint8_t level = 0;
+    while (level < CHARRA_TIMER_WHEEL_LEVELS - 1 &&
+            delta >= ((uint64_t)1
+                             << ((level + 1) * CHARRA_TIMER_WHEEL_SLOT_BITS))) {
+        level++;
+    }
+
+    const uint64_t index = expires_ms >> (level * CHARRA_TIMER_WHEEL_SLOT_BITS);
+    charra_timer** slot = &wheel->slots[level][index & TIMER_WHEEL_SLOT_MASK];
+    timer->level = level;
+    timer->next = *slot;
+    timer->pprev = slot;
+    if (*slot != NULL) {
+        (*slot)->pprev = &timer->next;
+    }
+    *slot = timer;
+    wheel->pending[level] += 1;
+}
+
+/**
+ * @brief Moves the timers of a slot that starts at the time the wheel is at to
+ * the lower levels.
+ */
+static void timer_wheel_cascade(
+        charra_timer_wheel* wheel, uint32_t level, uint64_t index) {
+    charra_timer** slot = &wheel->slots[level][index & TIMER_WHEEL_SLOT_MASK];
+    while (*slot != NULL) {
+        charra_timer* timer = *slot;
+        timer_wheel_unlink(wheel, timer);
+        timer_wheel_link(wheel, timer, wheel->now_ms);
+    }
+}
+
+void charra_timer_wheel_init(charra_timer_wheel* wheel, uint64_t now_ms) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now_ms = now_ms;
+}
+
+void charra_timer_init(
+        charra_timer* timer, charra_timer_callback callback, void* data) {
+    memset(timer, 0, sizeof(*timer));
+    timer->callback = callback;
+    timer->data = data;
+}
+
+bool charra_timer_pending(const charra_timer* timer) {
+    return timer->pprev != NULL;
+}
+
+void charra_timer_wheel_add(
+        charra_timer_wheel* wheel, charra_timer* timer, uint64_t expires_ms) {
+    if (charra_timer_pending(timer)) {
+        timer_wheel_unlink(wheel, timer);
+    }
+    timer->expires_ms = expires_ms;
+    /* the current tick has been run, expired timers run on the next one */
+    timer_wheel_link(wheel, timer, wheel->now_ms + 1);
+}
+
+void charra_timer_wheel_cancel(charra_timer_wheel* wheel, charra_timer* timer) {
+    if (charra_timer_pending(timer)) {
+        timer_wheel_unlink(wheel, timer);
+    }
+}
+
+uint32_t charra_timer_wheel_advance(
+        charra_timer_wheel* wheel, uint64_t now_ms) {
+    uint32_t run = 0;
+
+    while (wheel->now_ms < now_ms) {
+        uint32_t pending = 0;
+        for (uint32_t level = 0; level < CHARRA_TIMER_WHEEL_LEVELS; level++) {
+            pending += wheel->pending[level];
+        }
+        if (pending == 0) {
+            wheel->now_ms = now_ms;
+            break;
+        }
+
+        /* nothing happens before the next cascade if level 0 is empty */
+        uint64_t tick = wheel->now_ms + 1;
+        if (wheel->pending[0] == 0) {
+            tick = (wheel->now_ms | TIMER_WHEEL_SLOT_MASK) + 1;
+            if (tick > now_ms) {
+                wheel->now_ms = now_ms;
+                break;
+            }
+        }
+        wheel->now_ms = tick;
+
+        /* move down the timers of the slots starting at this tick */
+        for (uint32_t level = 1; level < CHARRA_TIMER_WHEEL_LEVELS; level++) {
+            const uint32_t shift = level * CHARRA_TIMER_WHEEL_SLOT_BITS;
+            if ((tick & (((uint64_t)1 << shift) - 1)) != 0) {
+                break;
+            }
+            timer_wheel_cascade(wheel, level, tick >> shift);
+        }
+
+        /* run the timers expiring at this tick */
+        charra_timer** slot = &wheel->slots[0][tick & TIMER_WHEEL_SLOT_MASK];
+        while (*slot != NULL) {
+            charra_timer* timer = *slot;
+            timer_wheel_unlink(wheel, timer);
+            timer->callback(timer, timer->data);
+            run++;
+        }
+    }
+
+    return run;
+}
+
+uint32_t charra_timer_wheel_timeout_ms(
+        const charra_timer_wheel* wheel, uint32_t max_ms) {
+    uint64_t timeout_ms = max_ms;
+
+    /* the next slot of each level holds the timers expiring first on it */
+    for (uint32_t level = 0; level < CHARRA_TIMER_WHEEL_LEVELS; level++) {
+        if (wheel->pending[level] == 0) {
+            continue;
+        }
+        const uint64_t index =
+                wheel->now_ms >> (level * CHARRA_TIMER_WHEEL_SLOT_BITS);
+        const charra_timer* timer = NULL;
+        for (uint64_t k = 1; timer == NULL && k <= CHARRA_TIMER_WHEEL_SLOTS;
+                k++) {
+            timer = wheel->slots[level][(index + k) & TIMER_WHEEL_SLOT_MASK];
+        }
+        for (; timer != NULL; timer = timer->next) {
+            /* expired timers wait for the next tick */
+            const uint64_t expires_ms = (timer->expires_ms > wheel->now_ms)
+                                                ? timer->expires_ms
+                                                : wheel->now_ms + 1;
+            if (expires_ms - wheel->now_ms < timeout_ms) {
+                timeout_ms = expires_ms - wheel->now_ms;
+            }
+        }
+    }
+
+    return (uint32_t)timeout_ms;
+}
@@ -0,0 +1,136 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file charra_timer_wheel.h
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief A hierarchical timer wheel with a resolution of one millisecond, to
+ * schedule many timers at constant cost per timer.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#ifndef CHARRA_TIMER_WHEEL_H
+#define CHARRA_TIMER_WHEEL_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/* levels of the wheel, each with 2^CHARRA_TIMER_WHEEL_SLOT_BITS slots of
+ * 2^(level * CHARRA_TIMER_WHEEL_SLOT_BITS) ms; together they span 2^32 ms
+ * (49 days), timers further ahead are moved down once they are in range */
+#define CHARRA_TIMER_WHEEL_LEVELS 4
+#define CHARRA_TIMER_WHEEL_SLOT_BITS 8
+#define CHARRA_TIMER_WHEEL_SLOTS (1u << CHARRA_TIMER_WHEEL_SLOT_BITS)
+
+typedef struct charra_timer charra_timer;
+
+/**
+ * @brief Called when a timer expires. The timer is no longer pending and may
+ * be added again.
+ *
+ * @param[in] timer The timer.
+ * @param[in] data The data the timer was initialized with.
+ */
+typedef void (*charra_timer_callback)(charra_timer* timer, void* data);
+
+/**
+ * @brief A timer, embedded in the structure it schedules work for.
+ */
+struct charra_timer {
+    /* the slot the timer is pending in, NULL pprev if it is not pending */
+    charra_timer* next;
+    charra_timer** pprev;
+    uint8_t level;
+    uint64_t expires_ms;
+    charra_timer_callback callback;
+    void* data;
+};
+
+/**
+ * @brief The timer wheel.
+ */
+typedef struct {
+    charra_timer* slots[CHARRA_TIMER_WHEEL_LEVELS][CHARRA_TIMER_WHEEL_SLOTS];
+    /* number of pending timers on each level */
+    uint32_t pending[CHARRA_TIMER_WHEEL_LEVELS];
+    /* time up to which the timers have been run, in ms */
+    uint64_t now_ms;
+} charra_timer_wheel;
+
+/**
+ * @brief Initializes an empty timer wheel.
+ *
+ * @param[out] wheel The timer wheel.
+ * @param[in] now_ms The current time in ms of a monotonic clock, the time of
+ * all later calls.
+ */
+void charra_timer_wheel_init(charra_timer_wheel* wheel, uint64_t now_ms);
+
+/**
+ * @brief Initializes a timer that is not pending.
+ *
+ * @param[out] timer The timer.
+ * @param[in] callback The function called when the timer expires.
+ * @param[in] data The data passed to \a callback.
+ */
+void charra_timer_init(
+        charra_timer* timer, charra_timer_callback callback, void* data);
+
+/**
+ * @brief Returns whether a timer is pending.
+ */
+bool charra_timer_pending(const charra_timer* timer);
+
+/**
+ * @brief Adds a timer, or moves it if it is pending already. A timer expiring
+ * at or before the time the wheel has been advanced to expires on the next
+ * advance.
+ *
+ * @param[in,out] wheel The timer wheel.
+ * @param[in,out] timer The timer.
+ * @param[in] expires_ms The time the timer expires at, in ms.
+ */
+void charra_timer_wheel_add(
+        charra_timer_wheel* wheel, charra_timer* timer, uint64_t expires_ms);
+
+/**
+ * @brief Cancels a timer. Does nothing if the timer is not pending.
+ *
+ * @param[in,out] wheel The timer wheel.
+ * @param[in,out] timer The timer.
+ */
+void charra_timer_wheel_cancel(charra_timer_wheel* wheel, charra_timer* timer);
+
+/**
+ * @brief Advances the wheel to \a now_ms and runs the callbacks of all timers
+ * expiring up to then, in the order they expire. Callbacks may add and cancel
+ * timers.
+ *
+ * @param[in,out] wheel The timer wheel.
+ * @param[in] now_ms The current time in ms, not before the last one.
+ * @return The number of timers run.
+ */
+uint32_t charra_timer_wheel_advance(charra_timer_wheel* wheel, uint64_t now_ms);
+
+/**
+ * @brief Returns the time until the next timer expires, e.g. as timeout of
+ * coap_io_process(). Only the next slot of each level is looked at.
+ *
+ * @param[in] wheel The timer wheel.
+ * @param[in] max_ms The time returned if no timer expires earlier.
+ * @return The time to wait in ms.
+ */
+uint32_t charra_timer_wheel_timeout_ms(
+        const charra_timer_wheel* wheel, uint32_t max_ms);
+
+#endif /* CHARRA_TIMER_WHEEL_H */
@@ -0,0 +1,148 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file rimc.c
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Compiles a YAML reference PCR file into the binary format the
+ * verifier maps without parsing, including the composite digests of the sets
+ * for the PCR selections given.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tss2/tss2_tpm2_types.h>
+
+#include "common/charra_error.h"
+#include "common/charra_log.h"
+#include "core/charra_rim_mgr.h"
+#include "util/crypto_util.h"
+#include "util/parser_util.h"
+
+#define LOG_NAME "rimc"
+
+/* the default PCR selection of the verifier */
+static const uint8_t rimc_default_pcr_selection[] = {0, 1, 2, 3, 4, 5, 6, 7,
+        10};
+
+static const struct option rimc_options[] = {
+        {"pcr-selection", required_argument, 0, 's'},
+        {"hash-algorithm", required_argument, 0, 'g'},
+        {"help", no_argument, 0, 'h'},
+        {0}};
+
+static void rimc_print_help(const char* name) {
+    printf("Usage: %s [OPTIONS] INPUT OUTPUT\n", name);
+    printf("Compiles the YAML reference PCR file INPUT into the binary "
+           "reference PCR file OUTPUT, to be read by the verifier with "
+           "'--pcr-file=bin:OUTPUT'.\n");
+    printf(" -s, --pcr-selection=BANK:X1[,X2...][+BANK:Y1[,Y2...]...]: "
+           "Precompute the composite digests of the sets for the PCRs X1, "
+           "X2, ... of bank BANK (sha1, sha256, sha384 or sha512), and so "
+           "on, as selected with the verifier's '--pcr-selection'. May be "
+           "given up to %d times. Default is sha256:0,1,2,3,4,5,6,7,10.\n",
+            CHARRA_RIM_INDEXES_MAX);
+    printf(" -g, --hash-algorithm=ALGORITHM:        Hash algorithm of the "
+           "composite digests, as selected with the verifier's "
+           "'--hash-algorithm': sha1, sha256, sha384 or sha512. Default is "
+           "sha256.\n");
+    printf(" -h, --help:                            Print this help "
+           "message.\n");
+}
+
+int main(int argc, char** argv) {
+    charra_rim_selection pcr_selections[CHARRA_RIM_INDEXES_MAX] = {{0}};
+    uint32_t selections = 0;
+    TPMI_ALG_HASH hash_alg = TPM2_ALG_SHA256;
+    charra_rim_store store = {0};
+
+    charra_log_set_level(CHARRA_LOG_INFO);
+
+    for (;;) {
+        const int c = getopt_long(argc, argv, "s:g:h", rimc_options, NULL);
+        if (c == -1) {
+            break;
+        } else if (c == 's') {
+            if (selections == CHARRA_RIM_INDEXES_MAX) {
+                charra_log_error("[" LOG_NAME "] Too many PCR selections.");
+                return CHARRA_RC_CLI_ERROR;
+            }
+            /* parse a copy, the selection is split in place */
+            char* arg = malloc(strlen(optarg) + 1);
+            if (arg == NULL ||
+                    parse_pcr_selection(strcpy(arg, optarg),
+                            &pcr_selections[selections]) != CHARRA_RC_SUCCESS) {
+                charra_log_error(
+                        "[" LOG_NAME "] Invalid PCR selection: '%s'", optarg);
+                free(arg);
+                return CHARRA_RC_CLI_ERROR;
+            }
+            free(arg);
+            selections++;
+        } else if (c == 'g') {
+            hash_alg = charra_crypto_tpm2_hash_alg_from_name(
+                    optarg, strlen(optarg));
+            if (hash_alg == TPM2_ALG_ERROR) {
+                charra_log_error(
+                        "[" LOG_NAME "] Invalid hash algorithm: '%s'", optarg);
+                return CHARRA_RC_CLI_ERROR;
+            }
+        } else if (c == 'h') {
+            rimc_print_help(argv[0]);
+            return CHARRA_RC_SUCCESS;
+        } else {
+            rimc_print_help(argv[0]);
+            return CHARRA_RC_CLI_ERROR;
+        }
+    }
+    if (argc - optind != 2) {
+        rimc_print_help(argv[0]);
+        return CHARRA_RC_CLI_ERROR;
+    }
+    if (selections == 0) {
+        pcr_selections[0].banks_len = 1;
+        pcr_selections[0].banks[0].alg = TPM2_ALG_SHA256;
+        memcpy(pcr_selections[0].banks[0].pcrs, rimc_default_pcr_selection,
+                sizeof(rimc_default_pcr_selection));
+        pcr_selections[0].banks[0].pcrs_len =
+                sizeof(rimc_default_pcr_selection);
+        selections = 1;
+    }
+    for (uint32_t i = 0; i < selections; i++) {
+        pcr_selections[i].hash_alg = hash_alg;
+    }
+
+    CHARRA_RC r = charra_rim_store_load(
+            argv[optind], CHARRA_RIM_FORMAT_YAML, true, &store);
+    for (uint32_t i = 0; r == CHARRA_RC_SUCCESS && i < selections; i++) {
+        r = charra_rim_store_index(&store, &pcr_selections[i]);
+    }
+    if (r == CHARRA_RC_SUCCESS) {
+        r = charra_rim_store_save(&store, argv[optind + 1]);
+    }
+    if (r != CHARRA_RC_SUCCESS) {
+        charra_log_error("[" LOG_NAME "] Compiling '%s' failed.", argv[optind]);
+        charra_rim_store_free(&store);
+        return r;
+    }
+    charra_log_info("[" LOG_NAME "] Wrote %" PRIu32 " sets of reference PCRs "
+                    "and %" PRIu32 " indexes to '%s'.",
+            store.sets_len, store.indexes_len, argv[optind + 1]);
+    charra_rim_store_free(&store);
+
+    return CHARRA_RC_SUCCESS;
+}
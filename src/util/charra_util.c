@@ -28,6 +28,7 @@
 
 #include <mbedtls/ctr_drbg.h>
 #include <mbedtls/entropy.h>
+#include <mbedtls/md.h>
 #include <mbedtls/sha1.h>
 #include <mbedtls/sha256.h>
 #include <mbedtls/sha512.h>
@@ -39,7 +40,9 @@
 
 #include "../common/charra_error.h"
 #include "../common/charra_log.h"
+#include "crypto_util.h"
 #include "io_util.h"
+#include "merkle_util.h"
 #include "tpm2_util.h"
 
 #define CHARRA_UNUSED __attribute__((unused))
@@ -235,6 +238,7 @@ bool charra_verify_tpm2_magic(const TPMS_ATTEST* const attest_struct) {
 bool charra_verify_tpm2_quote_qualifying_data(
         const uint16_t qualifying_data_len,
         const uint8_t* const qualifying_data,
+        const charra_tap_nonce_inclusion_proof_dto* const inclusion_proof,
         const TPMS_ATTEST* const attest_struct) {
     /* verify input parameters */
     if (qualifying_data == NULL) {
@@ -243,6 +247,23 @@ bool charra_verify_tpm2_quote_qualifying_data(
         return false;
     }
 
+    /* coalesced quote: nonce must be a leaf of the Merkle root */
+    if (inclusion_proof != NULL) {
+        uint8_t leaf_hash[CHARRA_MERKLE_HASH_SIZE] = {0};
+        if (attest_struct->extraData.size != CHARRA_MERKLE_HASH_SIZE) {
+            return false;
+        } else if (charra_merkle_leaf_hash(qualifying_data_len,
+                           qualifying_data, leaf_hash) != CHARRA_RC_SUCCESS) {
+            return false;
+        }
+        return charra_merkle_verify_inclusion(leaf_hash,
+                       inclusion_proof->leaf_index, inclusion_proof->tree_size,
+                       inclusion_proof->path_len,
+                       (const uint8_t(*)[CHARRA_MERKLE_HASH_SIZE])
+                               inclusion_proof->path,
+                       attest_struct->extraData.buffer) == CHARRA_RC_SUCCESS;
+    }
+
     /* compare sizes and content */
     if (attest_struct->extraData.size != qualifying_data_len) {
         return false;
@@ -254,17 +275,49 @@ bool charra_verify_tpm2_quote_qualifying_data(
     return true;
 }
 
-/* TODO Add specific versions of this function for all supported hash algos,
- * i.e. charra_compute_pcr_composite_digest_sha256_from_ptr_array, etc.,
- * invoking this generic funtion internally with TPM2_SHA256_DIGEST_SIZE, etc.
- */
 CHARRA_RC charra_compute_pcr_composite_digest_from_ptr_array(
-        uint16_t hash_algo_digest_size CHARRA_UNUSED,
-        const uint8_t* expected_pcr_values[] CHARRA_UNUSED,
-        size_t expected_pcr_values_len CHARRA_UNUSED,
-        uint8_t* pcr_composite_digest CHARRA_UNUSED) {
-    // TODO(any): to be implemented
-    return CHARRA_RC_NOT_YET_IMPLEMENTED;
+        const TPMI_ALG_HASH hash_algo, const uint8_t* const pcr_values[],
+        const uint16_t pcr_value_sizes[], const size_t pcr_values_len,
+        uint8_t* const pcr_composite_digest) {
+    CHARRA_RC charra_r = CHARRA_RC_SUCCESS;
+
+    /* init and setup */
+    const mbedtls_md_info_t* hash_info = mbedtls_md_info_from_type(
+            charra_crypto_tpm2_to_mbedtls_hash_alg(hash_algo));
+    if (hash_info == NULL) {
+        charra_log_error("Unsupported PCR composite digest algorithm 0x%04x.",
+                hash_algo);
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+    mbedtls_md_context_t ctx = {0};
+    mbedtls_md_init(&ctx);
+    if ((mbedtls_md_setup(&ctx, hash_info, 0)) != 0) {  // 0 = do not use HMAC
+        charra_r = CHARRA_RC_CRYPTO_ERROR;
+        goto error;
+    }
+
+    /* hash the concatenation of the PCR values */
+    if ((mbedtls_md_starts(&ctx)) != 0) {
+        charra_r = CHARRA_RC_CRYPTO_ERROR;
+        goto error;
+    }
+    for (size_t i = 0; i < pcr_values_len; ++i) {
+        if ((mbedtls_md_update(&ctx, pcr_values[i], pcr_value_sizes[i])) !=
+                0) {
+            charra_r = CHARRA_RC_CRYPTO_ERROR;
+            goto error;
+        }
+    }
+    if ((mbedtls_md_finish(&ctx, pcr_composite_digest)) != 0) {
+        charra_r = CHARRA_RC_CRYPTO_ERROR;
+        goto error;
+    }
+
+error:
+    /* free */
+    mbedtls_md_free(&ctx);
+
+    return charra_r;
 }
 
 bool charra_verify_tpm2_quote_pcr_composite_digest(
@@ -25,6 +25,7 @@
 #include <tss2/tss2_tpm2_types.h>
 
 #include "../common/charra_error.h"
+#include "../core/charra_tap/charra_tap_dto.h"
 
 #ifndef CHARRA_UTIL_H
 #define CHARRA_UTIL_H
@@ -82,10 +83,14 @@ bool charra_verify_tpm2_magic(const TPMS_ATTEST* const attest_struct);
 
 /**
  * @brief Verifies whether the qualifying data (nonce) matches the one in the
- * TPM2 attestation structure.
+ * TPM2 attestation structure. If the attester coalesced several requests into
+ * one quote, the qualifying data in the quote is a Merkle root and \p
+ * inclusion_proof must prove that the nonce is one of its leaves.
  *
  * @param[in] qualifying_data_len The length of the qualifying data (nonce).
  * @param[in] qualifying_data The qualifying data (nonce).
+ * @param[in] inclusion_proof The nonce inclusion proof, or NULL if the quote
+ * is over the nonce itself.
  * @param[in] attest_struct The TPM2 attestation structure (unmarshaled version,
  * i.e., native endianness).
  * @return true if the qualifying data (nonce) matches the one in \p
@@ -96,6 +101,7 @@ bool charra_verify_tpm2_magic(const TPMS_ATTEST* const attest_struct);
 bool charra_verify_tpm2_quote_qualifying_data(
         const uint16_t qualifying_data_len,
         const uint8_t* const qualifying_data,
+        const charra_tap_nonce_inclusion_proof_dto* const inclusion_proof,
         const TPMS_ATTEST* const attest_struct);
 
 // TODO(any): to be implemented
@@ -103,6 +109,28 @@ bool charra_verify_tpm2_quote_pcrs(const TPM2_ALG_ID hash_algo_id,
         const uint8_t* const qualifying_data,
         const TPMS_ATTEST* const attest_struct);
 
+/**
+ * @brief Computes the PCR composite digest over PCR values as a TPM does for
+ * a quote: the hash over the concatenation of the values of the selected PCRs
+ * of all selected banks, in the order of the PCR selection. The values may be
+ * of different sizes, i.e. of different banks, and the hash algorithm is the
+ * one of the quote's signing scheme, independent of the banks.
+ *
+ * @param[in] hash_algo The hash algorithm of the composite digest.
+ * @param[in] pcr_values The PCR values, in the order of the PCR selection.
+ * @param[in] pcr_value_sizes The size of each PCR value.
+ * @param[in] pcr_values_len The number of PCR values.
+ * @param[out] pcr_composite_digest The PCR composite digest, of the digest
+ * size of \p hash_algo.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_BAD_ARGUMENT if the hash algorithm is not supported.
+ * @return CHARRA_RC_CRYPTO_ERROR on hashing errors.
+ */
+CHARRA_RC charra_compute_pcr_composite_digest_from_ptr_array(
+        const TPMI_ALG_HASH hash_algo, const uint8_t* const pcr_values[],
+        const uint16_t pcr_value_sizes[], const size_t pcr_values_len,
+        uint8_t* const pcr_composite_digest);
+
 /**
  * @brief Verifies whether the PCR composite (hash digest) matches the one in
  * the TPM2 attestation structure.
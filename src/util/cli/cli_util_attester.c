@@ -31,10 +31,18 @@
 
 #define CLI_ATTESTER_PSK_HINT_LONG "psk-hint"
 #define CLI_ATTESTER_ATTESTATION_KEY_LONG "attestation-key"
+#define CLI_ATTESTER_COALESCE_WINDOW_LONG "coalesce-window"
+#define CLI_ATTESTER_RESPONSE_CACHE_TTL_LONG "response-cache-ttl"
+#define CLI_ATTESTER_QUEUE_MAX_LONG "queue-max"
+#define CLI_ATTESTER_QUEUE_MAX_PER_PEER_LONG "queue-max-per-peer"
 
 typedef enum {
     CLI_ATTESTER_PSK_HINT = 'h',
     CLI_ATTESTER_ATTESTATION_KEY = '6',
+    CLI_ATTESTER_COALESCE_WINDOW = '7',
+    CLI_ATTESTER_RESPONSE_CACHE_TTL = '8',
+    CLI_ATTESTER_QUEUE_MAX = '9',
+    CLI_ATTESTER_QUEUE_MAX_PER_PEER = 'A',
 } cli_util_attester_args_e;
 
 static const struct option attester_options[] = {
@@ -68,6 +76,14 @@ static const struct option attester_options[] = {
         /* attester specific options */
         {CLI_ATTESTER_ATTESTATION_KEY_LONG, required_argument, 0,
                 CLI_ATTESTER_ATTESTATION_KEY},
+        {CLI_ATTESTER_COALESCE_WINDOW_LONG, required_argument, 0,
+                CLI_ATTESTER_COALESCE_WINDOW},
+        {CLI_ATTESTER_RESPONSE_CACHE_TTL_LONG, required_argument, 0,
+                CLI_ATTESTER_RESPONSE_CACHE_TTL},
+        {CLI_ATTESTER_QUEUE_MAX_LONG, required_argument, 0,
+                CLI_ATTESTER_QUEUE_MAX},
+        {CLI_ATTESTER_QUEUE_MAX_PER_PEER_LONG, required_argument, 0,
+                CLI_ATTESTER_QUEUE_MAX_PER_PEER},
         {0}};
 
 /**
@@ -78,9 +94,8 @@ static const struct option attester_options[] = {
  * @param variables the cli config variables
  */
 static int charra_check_required_options(const cli_config* const variables) {
-    /* check if attestation key file was specified */
-    if (variables->specific_config.attester_config.attestation_key.ctx_path ==
-            NULL) {
+    /* check if at least one attestation key was specified */
+    if (variables->specific_config.attester_config.attestation_keys_len == 0) {
         charra_log_error("[%s] ERROR: no attestation key file", LOG_NAME);
         return -1;
     }
@@ -90,9 +105,30 @@ static int charra_check_required_options(const cli_config* const variables) {
 static void charra_print_attester_help_message(
         const cli_config* const variables) {
     /* print specific attester options */
-    printf("     --%s=FORMAT:VALUE:     Specifies the path to "
-           "the attestation key. Available are: context, handle.\n",
+    printf("     --%s=FORMAT:VALUE[:ID]: Specifies the path to "
+           "the attestation key. Available are: context, handle. May be "
+           "given multiple times; requests select a key by its ID, keys "
+           "without ID serve all other requests.\n",
             CLI_ATTESTER_ATTESTATION_KEY_LONG);
+    printf("     --%s=MS:        Coalesce attestation requests "
+           "arriving within MS milliseconds into one TPM quote over the "
+           "Merkle root of their nonces. Disabled by default.\n",
+            CLI_ATTESTER_COALESCE_WINDOW_LONG);
+    printf("     --%s=MS:     Answer retransmitted attestation "
+           "requests and requests for further blocks with the cached "
+           "response for MS milliseconds (default: %u, 0 disables the cache "
+           "and sends responses from memory as a whole).\n",
+            CLI_ATTESTER_RESPONSE_CACHE_TTL_LONG,
+            variables->specific_config.attester_config.response_cache_ttl_ms);
+    printf("     --%s=N:               Queue at most N attestation "
+           "requests for the TPM and answer further ones with 5.03 "
+           "(default: %u).\n",
+            CLI_ATTESTER_QUEUE_MAX_LONG,
+            variables->specific_config.attester_config.queue_max);
+    printf("     --%s=N:      Queue at most N attestation requests "
+           "of a single verifier (default: %u).\n",
+            CLI_ATTESTER_QUEUE_MAX_PER_PEER_LONG,
+            variables->specific_config.attester_config.queue_max_per_peer);
     printf("     --%s=PORT:                Open PORT instead of "
            "port %u.\n",
             CLI_COMMON_PORT_LONG, *(variables->common_config.port));
@@ -159,24 +195,35 @@ static int charra_cli_attester_attestation_key(cli_config* const variables) {
     char* format = NULL;
     char* value = NULL;
     uint64_t handle_value = 0;
+    cli_config_attester* const attester_config =
+            &variables->specific_config.attester_config;
+    if (attester_config->attestation_keys_len >=
+            CLI_UTIL_MAX_ATTESTATION_KEYS) {
+        charra_log_error("[%s] Too many attestation keys (max. %d).",
+                LOG_NAME, CLI_UTIL_MAX_ATTESTATION_KEYS);
+        return -1;
+    }
     if (charra_cli_util_common_split_option_string(optarg, &format, &value) !=
             0) {
         charra_log_error("[%s] Argument syntax error: please use "
-                         "'--%s=FORMAT:VALUE'",
+                         "'--%s=FORMAT:VALUE[:ID]'",
                 LOG_NAME, CLI_ATTESTER_ATTESTATION_KEY_LONG);
         return -1;
     }
-    variables->specific_config.attester_config.attestation_key_format =
-            charra_parse_attestation_key_format(format);
-    switch (variables->specific_config.attester_config.attestation_key_format) {
+    cli_config_attestation_key* const key =
+            &attester_config
+                     ->attestation_keys[attester_config->attestation_keys_len];
+    /* optional key ID following the value */
+    key->id = strtok(NULL, ":");
+    key->format = charra_parse_attestation_key_format(format);
+    switch (key->format) {
     case CLI_UTIL_ATTESTATION_KEY_FORMAT_FILE:
         if (charra_io_file_exists(value) != CHARRA_RC_SUCCESS) {
             charra_log_error("[%s] Attestation key: file '%s' does not exist.",
                     LOG_NAME, value);
             return -1;
         }
-        variables->specific_config.attester_config.attestation_key.ctx_path =
-                value;
+        key->key.ctx_path = value;
         break;
     case CLI_UTIL_ATTESTATION_KEY_FORMAT_HANDLE:
         if (charra_cli_util_common_parse_option_as_ulong(
@@ -186,14 +233,57 @@ static int charra_cli_attester_attestation_key(cli_config* const variables) {
                     LOG_NAME, value);
             return -1;
         }
-        variables->specific_config.attester_config.attestation_key.tpm2_handle =
-                (ESYS_TR)handle_value;
+        key->key.tpm2_handle = (ESYS_TR)handle_value;
         break;
     case CLI_UTIL_ATTESTATION_KEY_FORMAT_UNKNOWN:
         charra_log_error("[%s] Unknown format: '%s'", LOG_NAME, format);
         return -1;
     }
+    attester_config->attestation_keys_len += 1;
+
+    return 0;
+}
+
+static int charra_cli_attester_coalesce_window(cli_config* const variables) {
+    uint64_t window_ms = 0;
+    if (charra_cli_util_common_parse_option_as_ulong(optarg, 10, &window_ms) !=
+                    0 ||
+            window_ms > UINT32_MAX) {
+        charra_log_error("[%s] Coalesce window '%s' cannot be parsed.",
+                LOG_NAME, optarg);
+        return -1;
+    }
+    variables->specific_config.attester_config.coalesce_window_ms =
+            (uint32_t)window_ms;
+    return 0;
+}
+
+static int charra_cli_attester_response_cache_ttl(
+        cli_config* const variables) {
+    uint64_t ttl_ms = 0;
+    if (charra_cli_util_common_parse_option_as_ulong(optarg, 10, &ttl_ms) !=
+                    0 ||
+            ttl_ms > UINT32_MAX) {
+        charra_log_error("[%s] Response cache TTL '%s' cannot be parsed.",
+                LOG_NAME, optarg);
+        return -1;
+    }
+    variables->specific_config.attester_config.response_cache_ttl_ms =
+            (uint32_t)ttl_ms;
+    return 0;
+}
 
+static int charra_cli_attester_queue_max(
+        const char* const name, uint32_t* const value) {
+    uint64_t queue_max = 0;
+    if (charra_cli_util_common_parse_option_as_ulong(optarg, 10, &queue_max) !=
+                    0 ||
+            queue_max == 0 || queue_max > UINT32_MAX) {
+        charra_log_error(
+                "[%s] %s '%s' cannot be parsed.", LOG_NAME, name, optarg);
+        return -1;
+    }
+    *value = (uint32_t)queue_max;
     return 0;
 }
 
@@ -220,6 +310,21 @@ int charra_parse_command_line_attester_arguments(
         case CLI_ATTESTER_ATTESTATION_KEY:
             rc = charra_cli_attester_attestation_key(variables);
             break;
+        case CLI_ATTESTER_COALESCE_WINDOW:
+            rc = charra_cli_attester_coalesce_window(variables);
+            break;
+        case CLI_ATTESTER_RESPONSE_CACHE_TTL:
+            rc = charra_cli_attester_response_cache_ttl(variables);
+            break;
+        case CLI_ATTESTER_QUEUE_MAX:
+            rc = charra_cli_attester_queue_max("Queue size",
+                    &variables->specific_config.attester_config.queue_max);
+            break;
+        case CLI_ATTESTER_QUEUE_MAX_PER_PEER:
+            rc = charra_cli_attester_queue_max("Queue size per peer",
+                    &variables->specific_config.attester_config
+                             .queue_max_per_peer);
+            break;
         case CLI_ATTESTER_PSK_HINT:
             charra_cli_attester_psk_hint(variables);
             break;
@@ -23,6 +23,7 @@
 #define CLI_UTIL_COMMON_H
 
 #include "../../common/charra_log.h"
+#include "../../core/charra_rim_mgr.h"
 #include "../../core/charra_tap/charra_tap_dto.h"
 #include <coap3/coap.h>
 #include <getopt.h>
@@ -100,19 +101,39 @@ typedef enum {
     CLI_UTIL_ATTESTATION_KEY_FORMAT_UNKNOWN = '0',
 } cli_config_attester_attestation_key_format_e;
 
+#define CLI_UTIL_MAX_ATTESTATION_KEYS 16
+
 /**
- * A structure holding pointers to variables of the attester
- * which might geht modified by the CLI parser
+ * An attestation key as given on the command line.
  */
 typedef struct {
-    char** dtls_psk_hint;
-    cli_config_attester_attestation_key_format_e attestation_key_format;
+    /* the sig_key_id requests use to select this key, NULL for the default
+     * key which serves all requests with an unknown sig_key_id */
+    char* id;
+    cli_config_attester_attestation_key_format_e format;
     union {
         char* ctx_path;
         ESYS_TR tpm2_handle;
-    } attestation_key;
+    } key;
+} cli_config_attestation_key;
+
+/**
+ * A structure holding pointers to variables of the attester
+ * which might geht modified by the CLI parser
+ */
+typedef struct {
+    char** dtls_psk_hint;
+    cli_config_attestation_key attestation_keys[CLI_UTIL_MAX_ATTESTATION_KEYS];
+    uint32_t attestation_keys_len;
     char* ima_log_path;
     char* tcg_boot_log_path;
+    /* window to collect requests for one coalesced quote, 0 disables */
+    uint32_t coalesce_window_ms;
+    /* time to keep responses for retransmitted requests, 0 disables */
+    uint32_t response_cache_ttl_ms;
+    /* bounds of the quote queue, in total and per peer */
+    uint32_t queue_max;
+    uint32_t queue_max_per_peer;
 } cli_config_attester;
 
 #define TPM2_PCR_BANK_COUNT 4  // sha1, sha256, sha384, sha512
@@ -122,6 +143,19 @@ typedef struct {
     TPM2_ALG_ID tpm2_hash_algorithm;
 } cli_config_signature_hash_algorithm;
 
+#define CLI_UTIL_MAX_TARGETS 16
+
+/**
+ * An attester to attest as given on the command line.
+ */
+typedef struct {
+    char host[16];  // 15 characters for IPv4 plus \0
+    /* 0 for the port of all attesters */
+    unsigned int port;
+    /* seconds between attestations, 0 for the interval of all attesters */
+    uint32_t interval_s;
+} cli_config_verifier_target;
+
 /**
  * A structure holding pointers to variables of the verifier
  * which might geht modified by the CLI parser
@@ -131,12 +165,20 @@ typedef struct {
     uint16_t* timeout;
     char** attestation_public_key_path;
     char** reference_pcr_file_path;
+    charra_rim_format* reference_pcr_file_format;
     uint8_t (*tpm_pcr_selection)[TPM2_MAX_PCRS];
     uint32_t* tpm_pcr_selection_len;
     char** dtls_psk_identity;
     cli_config_signature_hash_algorithm* signature_hash_algorithm;
     uint32_t* pcr_log_len;
     pcr_log_dto (*pcr_logs)[SUPPORTED_PCR_LOGS_COUNT];
+    char** ima_allowlist_path;
+    bool* disclose_pcr_values;
+    cli_config_verifier_target (*targets)[CLI_UTIL_MAX_TARGETS];
+    uint32_t* targets_len;
+    uint32_t* interval_s;
+    uint32_t* jitter_percent;
+    uint32_t* max_backoff_s;
 } cli_config_verifier;
 
 /**
@@ -20,7 +20,9 @@
  */
 
 #include "cli_util_verifier.h"
+#include "../crypto_util.h"
 #include "../io_util.h"
+#include "../parser_util.h"
 #include "cli_util_common.h"
 #include <bits/getopt_core.h>
 #include <stdint.h>
@@ -38,6 +40,15 @@
 #define CLI_VERIFIER_PCR_FILE_LONG "pcr-file"
 #define CLI_VERIFIER_PCR_SELECTION_LONG "pcr-selection"
 #define CLI_VERIFIER_HASH_ALGORITHM_LONG "hash-algorithm"
+#define CLI_VERIFIER_IMA_ALLOWLIST_LONG "ima-allowlist"
+#define CLI_VERIFIER_PCR_VALUES_LONG "pcr-values"
+#define CLI_VERIFIER_TARGET_LONG "target"
+#define CLI_VERIFIER_INTERVAL_LONG "interval"
+#define CLI_VERIFIER_JITTER_LONG "jitter"
+#define CLI_VERIFIER_MAX_BACKOFF_LONG "max-backoff"
+
+/* largest interval in seconds whose milliseconds fit into 32 bits */
+#define CLI_VERIFIER_INTERVAL_MAX_S (UINT32_MAX / 1000)
 
 typedef enum {
     CLI_VERIFIER_PSK_IDENTITY = 'i',
@@ -47,6 +58,12 @@ typedef enum {
     CLI_VERIFIER_PCR_FILE = 'f',
     CLI_VERIFIER_PCR_SELECTION = 's',
     CLI_VERIFIER_HASH_ALGORITHM = 'g',
+    CLI_VERIFIER_IMA_ALLOWLIST = '7',
+    CLI_VERIFIER_PCR_VALUES = '8',
+    CLI_VERIFIER_TARGET = '9',
+    CLI_VERIFIER_INTERVAL = 'A',
+    CLI_VERIFIER_JITTER = 'B',
+    CLI_VERIFIER_MAX_BACKOFF = 'C',
 } cli_util_verifier_args_e;
 
 static const struct option verifier_options[] = {
@@ -88,6 +105,16 @@ static const struct option verifier_options[] = {
                 CLI_VERIFIER_PCR_SELECTION},
         {CLI_VERIFIER_HASH_ALGORITHM_LONG, required_argument, 0,
                 CLI_VERIFIER_HASH_ALGORITHM},
+        {CLI_VERIFIER_IMA_ALLOWLIST_LONG, required_argument, 0,
+                CLI_VERIFIER_IMA_ALLOWLIST},
+        {CLI_VERIFIER_PCR_VALUES_LONG, no_argument, 0,
+                CLI_VERIFIER_PCR_VALUES},
+        {CLI_VERIFIER_TARGET_LONG, required_argument, 0, CLI_VERIFIER_TARGET},
+        {CLI_VERIFIER_INTERVAL_LONG, required_argument, 0,
+                CLI_VERIFIER_INTERVAL},
+        {CLI_VERIFIER_JITTER_LONG, required_argument, 0, CLI_VERIFIER_JITTER},
+        {CLI_VERIFIER_MAX_BACKOFF_LONG, required_argument, 0,
+                CLI_VERIFIER_MAX_BACKOFF},
         {0}};
 
 /**
@@ -127,12 +154,33 @@ static void charra_print_verifier_help_message(
            "for the attestation answer. Default is %d seconds.\n",
             CLI_VERIFIER_TIMEOUT, CLI_VERIFIER_TIMEOUT_LONG,
             *(variables->specific_config.verifier_config.timeout));
+    printf("     --%s=IP[:PORT][@SECONDS]: Attest the attester at IP "
+           "and PORT every SECONDS seconds, instead of the one given with "
+           "'--%s'. PORT defaults to '--%s', SECONDS to '--%s'. May be given "
+           "up to %d times.\n",
+            CLI_VERIFIER_TARGET_LONG, CLI_VERIFIER_IP_LONG,
+            CLI_COMMON_PORT_LONG, CLI_VERIFIER_INTERVAL_LONG,
+            CLI_UTIL_MAX_TARGETS);
+    printf("     --%s=SECONDS:          Attest every SECONDS seconds "
+           "until interrupted. Default is %u, attesting once.\n",
+            CLI_VERIFIER_INTERVAL_LONG,
+            *(variables->specific_config.verifier_config.interval_s));
+    printf("     --%s=PERCENT:            Randomize each interval by up to "
+           "PERCENT percent, so that the attesters are not attested all at "
+           "once. Default is %u percent.\n",
+            CLI_VERIFIER_JITTER_LONG,
+            *(variables->specific_config.verifier_config.jitter_percent));
+    printf("     --%s=SECONDS:       Double the interval after each "
+           "attestation that fails without a result, e.g. on timeouts, up to "
+           "SECONDS seconds. Default is %u seconds, 0 disables the backoff.\n",
+            CLI_VERIFIER_MAX_BACKOFF_LONG,
+            *(variables->specific_config.verifier_config.max_backoff_s));
     printf("     --%s=PATH:      Specifies the path to "
            "the public portion of the attestation key.\n",
             CLI_VERIFIER_ATTESTATION_PUBLIC_KEY_LONG);
     printf(" -%c, --%s=FORMAT:PATH:     Read reference PCRs "
-           "from PATH in a specified FORMAT. Available is: "
-           "yaml.\n",
+           "from PATH in a specified FORMAT. Available are: "
+           "yaml, bin (compiled by charra-rimc).\n",
             CLI_VERIFIER_PCR_FILE, CLI_VERIFIER_PCR_FILE_LONG);
     printf(" -%c, --%s=X1[+X2...]: Specifies which PCRs "
            "to check on the attester. Each X refers to a PCR bank that "
@@ -162,6 +210,14 @@ static void charra_print_verifier_help_message(
            "                                 Available formats are: ima, "
            "tcg-boot.\n",
             CLI_COMMON_PCR_LOG_LONG);
+    printf("     --%s=PATH:       Appraise the file digests of the IMA "
+           "log against the allowlist index at PATH, as compiled by "
+           "charra-allowlistc.\n",
+            CLI_VERIFIER_IMA_ALLOWLIST_LONG);
+    printf("     --%s:               Ask the attester to disclose the "
+           "values of the selected PCRs along with the quote, so that they are "
+           "checked PCR by PCR against the reference PCRs.\n",
+            CLI_VERIFIER_PCR_VALUES_LONG);
     printf(" -%c, --%s=ALGORITHM: The hash algorithm used to digest "
            "the tpm quote.\n",
             CLI_VERIFIER_HASH_ALGORITHM, CLI_VERIFIER_HASH_ALGORITHM_LONG);
@@ -300,6 +356,70 @@ static int charra_cli_verifier_timeout(cli_config* const variables) {
     return 0;
 }
 
+static int charra_cli_verifier_uint32(
+        const char* const name, uint32_t max, uint32_t* const value) {
+    uint64_t number = 0;
+    if (charra_cli_util_common_parse_option_as_ulong(optarg, 10, &number) !=
+                    0 ||
+            number > max) {
+        charra_log_error(
+                "[%s] %s '%s' cannot be parsed.", LOG_NAME, name, optarg);
+        return -1;
+    }
+    *value = (uint32_t)number;
+    return 0;
+}
+
+static int charra_cli_verifier_target(cli_config* const variables) {
+    cli_config_verifier* const verifier_config =
+            &variables->specific_config.verifier_config;
+    if (*verifier_config->targets_len == CLI_UTIL_MAX_TARGETS) {
+        charra_log_error("[%s] Too many targets, at most %d are supported.",
+                LOG_NAME, CLI_UTIL_MAX_TARGETS);
+        return -1;
+    }
+    cli_config_verifier_target target = {0};
+
+    /* split "IP[:PORT][@SECONDS]" from the back */
+    char* interval = strchr(optarg, '@');
+    if (interval != NULL) {
+        uint64_t interval_s = 0;
+        *interval++ = '\0';
+        if (charra_cli_util_common_parse_option_as_ulong(
+                    interval, 10, &interval_s) != 0 ||
+                interval_s == 0 || interval_s > CLI_VERIFIER_INTERVAL_MAX_S) {
+            charra_log_error("[%s] Invalid interval '%s' of target '%s'.",
+                    LOG_NAME, interval, optarg);
+            return -1;
+        }
+        target.interval_s = (uint32_t)interval_s;
+    }
+    char* port = strchr(optarg, ':');
+    if (port != NULL) {
+        uint64_t port_value = 0;
+        *port++ = '\0';
+        if (charra_cli_util_common_parse_option_as_ulong(
+                    port, 10, &port_value) != 0 ||
+                port_value == 0 || port_value > UINT16_MAX) {
+            charra_log_error("[%s] Invalid port '%s' of target '%s'.",
+                    LOG_NAME, port, optarg);
+            return -1;
+        }
+        target.port = (unsigned int)port_value;
+    }
+    if (optarg[0] == '\0' || strlen(optarg) >= sizeof(target.host)) {
+        charra_log_error("[%s] Error while parsing '--%s': Invalid IPv4 "
+                         "address '%s'",
+                LOG_NAME, CLI_VERIFIER_TARGET_LONG, optarg);
+        return -1;
+    }
+    strcpy(target.host, optarg);
+
+    (*verifier_config->targets)[*verifier_config->targets_len] = target;
+    *verifier_config->targets_len += 1;
+    return 0;
+}
+
 static int charra_cli_verifier_attestation_public_key(
         cli_config* const variables) {
     if (charra_io_file_exists(optarg) != CHARRA_RC_SUCCESS) {
@@ -312,6 +432,16 @@ static int charra_cli_verifier_attestation_public_key(
     return 0;
 }
 
+static int charra_cli_verifier_ima_allowlist(cli_config* const variables) {
+    if (charra_io_file_exists(optarg) != CHARRA_RC_SUCCESS) {
+        charra_log_error(
+                "[%s] IMA allowlist '%s' does not exist.", LOG_NAME, optarg);
+        return -1;
+    }
+    *(variables->specific_config.verifier_config.ima_allowlist_path) = optarg;
+    return 0;
+}
+
 static int charra_cli_verifier_pcr_file(cli_config* const variables) {
     char* token = NULL;
     const char delimiter[] = ":";
@@ -334,7 +464,12 @@ static int charra_cli_verifier_pcr_file(cli_config* const variables) {
     path = token;
 
     /* check if format is valid */
-    if (strcmp(format, "yaml") != 0) {
+    charra_rim_format rim_format = CHARRA_RIM_FORMAT_YAML;
+    if (strcmp(format, "yaml") == 0) {
+        rim_format = CHARRA_RIM_FORMAT_YAML;
+    } else if (strcmp(format, "bin") == 0) {
+        rim_format = CHARRA_RIM_FORMAT_BIN;
+    } else {
         charra_log_error(
                 "[%s] File format '%s' is not supported.", LOG_NAME, format);
         return -1;
@@ -343,6 +478,8 @@ static int charra_cli_verifier_pcr_file(cli_config* const variables) {
     if (charra_io_file_exists(path) == CHARRA_RC_SUCCESS) {
         *(variables->specific_config.verifier_config.reference_pcr_file_path) =
                 path;
+        *(variables->specific_config.verifier_config
+                        .reference_pcr_file_format) = rim_format;
         return 0;
     } else {
         charra_log_error(
@@ -351,144 +488,39 @@ static int charra_cli_verifier_pcr_file(cli_config* const variables) {
     }
 }
 
-static char* charra_cli_verifier_strtok(
-        char* str, const char* const delim, char** saveptr) {
-    char* token = NULL;
-
-    if (str == NULL) {
-        /* get string from saveptr */
-        str = *saveptr;
-    }
-
-    if (*str == '\0') {
-        /* check if string reached its end */
-        *saveptr = str;
-        return NULL;
-    }
-
-    token = str;
-    /* get first character which is part of the delimiter */
-    str += strcspn(token, delim);
-    if (*str != '\0') {
-        /* setup next token */
-        *str = '\0';
-        *saveptr = str + 1;
-    } else {
-        /* there is no more token */
-        *saveptr = str;
-    }
-
-    return token;
-}
-
-static int charra_cli_verifier_parse_pcr_bank(uint8_t* tpm_pcr_selection_bank,
-        uint32_t* tpm_pcr_selection_len, char* pcr_list) {
-    if (strcmp(pcr_list, "all") == 0) {
-        for (uint8_t i = 0; i < TPM2_MAX_PCRS; i++) {
-            tpm_pcr_selection_bank[i] = true;
-        }
-        *tpm_pcr_selection_len = TPM2_MAX_PCRS;
-        return 0;
-    }
-    char* pcr_token = NULL;
-    char* next_token = pcr_list;
-    uint8_t tpm_pcr_selection_hash_set[TPM2_MAX_PCRS] = {0};
-    uint8_t pcr = 0;
-    uint64_t parse_value = 0;
-    /* fill the hash_set with  */
-    while ((pcr_token = charra_cli_verifier_strtok(NULL, ",", &next_token)) !=
-            NULL) {
-        if (charra_cli_util_common_parse_option_as_ulong(
-                    pcr_token, 10, &parse_value) != 0) {
-            charra_log_error("[%s] Could not parse '%s'.", LOG_NAME, pcr_token);
-            return -1;
-        }
-        if (parse_value >= TPM2_MAX_PCRS) {
-            charra_log_error(
-                    "[%s] Unsupported handle '%s'.", LOG_NAME, pcr_token);
-            return -1;
-        }
-        pcr = (uint8_t)parse_value;
-        tpm_pcr_selection_hash_set[pcr] = true;
-    }
-    /* add hash set values sorted into tpm_pcr_selection_bank */
-    *tpm_pcr_selection_len = 0;
-    for (uint8_t i = 0; i < TPM2_MAX_PCRS; i++) {
-        if (tpm_pcr_selection_hash_set[i] == 0) {
-            continue;
-        }
-        tpm_pcr_selection_bank[*tpm_pcr_selection_len] = i;
-        *tpm_pcr_selection_len = *tpm_pcr_selection_len + 1;
-    }
-    return 0;
-}
-
-static int charra_cli_verifier_parse_pcr_bank_to_index(
-        const char* const pcr_bank) {
-    if (strcmp(pcr_bank, "sha1") == 0) {
-        return 0;
-    } else if (strcmp(pcr_bank, "sha256") == 0) {
-        return 1;
-    } else if (strcmp(pcr_bank, "sha384") == 0) {
-        return 2;
-    } else if (strcmp(pcr_bank, "sha512") == 0) {
-        return 3;
-    }
-    return -1;
-}
+static int charra_cli_verifier_pcr_selection(cli_config* const variables) {
+    /* PCR banks in the order of tpm_pcr_selection */
+    static const TPMI_ALG_HASH banks[TPM2_PCR_BANK_COUNT] = {
+            TPM2_ALG_SHA1, TPM2_ALG_SHA256, TPM2_ALG_SHA384, TPM2_ALG_SHA512};
+    uint8_t(*tpm_pcr_selection)[TPM2_MAX_PCRS] =
+            variables->specific_config.verifier_config.tpm_pcr_selection;
+    uint32_t* tpm_pcr_selection_len =
+            variables->specific_config.verifier_config.tpm_pcr_selection_len;
+    charra_rim_selection selection = {0};
 
-static int charra_cli_verifier_parse_pcr_selection(
-        cli_config* const variables, char* pcr_selections) {
     /*
     Syntax of PCR selections is: "bank1:pcr1,pcr2,pcr3+bank2:pcr4,pcr5"
-    best way to parse is by splitting the string by '+' for each bank
     */
-    char* bank_token = NULL;
-    char* next_token = pcr_selections;
-    char* bank_name = NULL;
-    char* pcr_list = NULL;
-    int bank = -1;
-    while ((bank_token = charra_cli_verifier_strtok(NULL, "+", &next_token)) !=
-            NULL) {
-        bank_name = charra_cli_verifier_strtok(bank_token, ":", &pcr_list);
-        if (bank_name == NULL) {
-            charra_log_error("[%s] No bank defined '%s'", LOG_NAME);
-            return -1;
-        }
-        bank = charra_cli_verifier_parse_pcr_bank_to_index(bank_name);
-        if (bank < 0 || bank >= TPM2_PCR_BANK_COUNT) {
-            charra_log_error("[%s] Invalid PCR bank '%s'", LOG_NAME, bank_name);
-            return -1;
-        }
-        if (charra_cli_verifier_parse_pcr_bank(
-                    variables->specific_config.verifier_config
-                            .tpm_pcr_selection[bank],
-                    &variables->specific_config.verifier_config
-                             .tpm_pcr_selection_len[bank],
-                    pcr_list) != 0) {
-            return -1;
-        }
+    if (parse_pcr_selection(optarg, &selection) != CHARRA_RC_SUCCESS) {
+        charra_log_error("[%s] Invalid PCR selection.", LOG_NAME);
+        return -1;
     }
-    return 0;
-}
 
-static int charra_cli_verifier_pcr_selection(cli_config* const variables) {
-    uint8_t(*tpm_pcr_selection)[TPM2_MAX_PCRS] =
-            variables->specific_config.verifier_config.tpm_pcr_selection;
-    uint32_t* tpm_pcr_selection_len =
-            variables->specific_config.verifier_config.tpm_pcr_selection_len;
+    /*
+     * overwrite static config with zeros in case CLI config uses less PCRs
+     */
     for (uint32_t i = 0; i < TPM2_PCR_BANK_COUNT; i++) {
-        for (uint32_t j = 0; j < TPM2_MAX_PCRS; j++) {
-            /*
-             * overwrite static config with zeros in case CLI config uses
-             * less PCRs
-             */
-            tpm_pcr_selection[i][j] = 0;
-        }
+        memset(tpm_pcr_selection[i], 0, TPM2_MAX_PCRS);
         tpm_pcr_selection_len[i] = 0;
     }
-    if (charra_cli_verifier_parse_pcr_selection(variables, optarg) != 0) {
-        return -1;
+    for (uint32_t b = 0; b < selection.banks_len; b++) {
+        for (uint32_t i = 0; i < TPM2_PCR_BANK_COUNT; i++) {
+            if (banks[i] == selection.banks[b].alg) {
+                memcpy(tpm_pcr_selection[i], selection.banks[b].pcrs,
+                        selection.banks[b].pcrs_len);
+                tpm_pcr_selection_len[i] = selection.banks[b].pcrs_len;
+            }
+        }
     }
     return 0;
 }
@@ -496,25 +528,18 @@ static int charra_cli_verifier_pcr_selection(cli_config* const variables) {
 static int charra_cli_verifier_hash_algorithm(cli_config* const variables) {
     cli_config_signature_hash_algorithm* const hash_algo =
             variables->specific_config.verifier_config.signature_hash_algorithm;
-    if (strcmp(optarg, "sha1") == 0) {
-        hash_algo->mbedtls_hash_algorithm = MBEDTLS_MD_SHA1;
-        hash_algo->tpm2_hash_algorithm = TPM2_ALG_SHA1;
-    } else if (strcmp(optarg, "sha256") == 0) {
-        hash_algo->mbedtls_hash_algorithm = MBEDTLS_MD_SHA256;
-        hash_algo->tpm2_hash_algorithm = TPM2_ALG_SHA256;
-    } else if (strcmp(optarg, "sha384") == 0) {
-        hash_algo->mbedtls_hash_algorithm = MBEDTLS_MD_SHA384;
-        hash_algo->tpm2_hash_algorithm = TPM2_ALG_SHA384;
-    } else if (strcmp(optarg, "sha512") == 0) {
-        hash_algo->mbedtls_hash_algorithm = MBEDTLS_MD_SHA512;
-        hash_algo->tpm2_hash_algorithm = TPM2_ALG_SHA512;
-    } else {
-        /* This algorithms are not supported by mbedTLS:
-        sm3_256, sha3_256, sha3_384, sha3_512 */
+    /* This algorithms are not supported by mbedTLS:
+    sm3_256, sha3_256, sha3_384, sha3_512 */
+    const TPMI_ALG_HASH alg =
+            charra_crypto_tpm2_hash_alg_from_name(optarg, strlen(optarg));
+    if (alg == TPM2_ALG_ERROR) {
         charra_log_error(
                 "[%s] Unsupported hash algorithm: '%s'", LOG_NAME, optarg);
         return -1;
     }
+    hash_algo->mbedtls_hash_algorithm =
+            charra_crypto_tpm2_to_mbedtls_hash_alg(alg);
+    hash_algo->tpm2_hash_algorithm = alg;
     return 0;
 }
 
@@ -554,6 +579,30 @@ int charra_parse_command_line_verifier_arguments(
         case CLI_VERIFIER_HASH_ALGORITHM:
             rc = charra_cli_verifier_hash_algorithm(variables);
             break;
+        case CLI_VERIFIER_IMA_ALLOWLIST:
+            rc = charra_cli_verifier_ima_allowlist(variables);
+            break;
+        case CLI_VERIFIER_PCR_VALUES:
+            *(variables->specific_config.verifier_config.disclose_pcr_values) =
+                    true;
+            break;
+        case CLI_VERIFIER_TARGET:
+            rc = charra_cli_verifier_target(variables);
+            break;
+        case CLI_VERIFIER_INTERVAL:
+            rc = charra_cli_verifier_uint32("Interval",
+                    CLI_VERIFIER_INTERVAL_MAX_S,
+                    variables->specific_config.verifier_config.interval_s);
+            break;
+        case CLI_VERIFIER_JITTER:
+            rc = charra_cli_verifier_uint32("Jitter", 100,
+                    variables->specific_config.verifier_config.jitter_percent);
+            break;
+        case CLI_VERIFIER_MAX_BACKOFF:
+            rc = charra_cli_verifier_uint32("Maximum backoff",
+                    CLI_VERIFIER_INTERVAL_MAX_S,
+                    variables->specific_config.verifier_config.max_backoff_s);
+            break;
         /* parse common options */
         default:
             rc = charra_cli_util_common_parse_command_line_argument(identifier,
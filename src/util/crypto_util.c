@@ -25,6 +25,7 @@
 #include <mbedtls/sha1.h>
 #include <mbedtls/sha256.h>
 #include <mbedtls/sha512.h>
+#include <string.h>
 #include <tss2/tss2_tpm2_types.h>
 
 #include "../common/charra_error.h"
@@ -95,40 +96,6 @@ error:
     return r;
 }
 
-CHARRA_RC hash_sha256_array(uint8_t* data[TPM2_SHA256_DIGEST_SIZE],
-        const size_t data_len, uint8_t digest[TPM2_SHA256_DIGEST_SIZE]) {
-    CHARRA_RC r = CHARRA_RC_SUCCESS;
-
-    /* init */
-    mbedtls_sha256_context ctx = {0};
-    mbedtls_sha256_init(&ctx);
-
-    /* hash */
-    if ((mbedtls_sha256_starts(&ctx, 0)) != 0) {
-        r = CHARRA_RC_CRYPTO_ERROR;
-        goto error;
-    }
-
-    for (size_t i = 0; i < data_len; ++i) {
-        if ((mbedtls_sha256_update(&ctx, data[i], TPM2_SHA256_DIGEST_SIZE)) !=
-                0) {
-            r = CHARRA_RC_CRYPTO_ERROR;
-            goto error;
-        }
-    }
-
-    if ((mbedtls_sha256_finish(&ctx, digest)) != 0) {
-        r = CHARRA_RC_CRYPTO_ERROR;
-        goto error;
-    }
-
-error:
-    /* free */
-    mbedtls_sha256_free(&ctx);
-
-    return r;
-}
-
 CHARRA_RC hash_sha512(const size_t data_len, const uint8_t* const data,
         uint8_t digest[TPM2_SHA512_DIGEST_SIZE]) {
     CHARRA_RC r = CHARRA_RC_SUCCESS;
@@ -160,6 +127,57 @@ error:
     return r;
 }
 
+uint16_t charra_crypto_tpm2_hash_size(TPMI_ALG_HASH hash_alg) {
+    switch (hash_alg) {
+    case TPM2_ALG_SHA1:
+        return TPM2_SHA1_DIGEST_SIZE;
+    case TPM2_ALG_SHA256:
+        return TPM2_SHA256_DIGEST_SIZE;
+    case TPM2_ALG_SHA384:
+        return TPM2_SHA384_DIGEST_SIZE;
+    case TPM2_ALG_SHA512:
+        return TPM2_SHA512_DIGEST_SIZE;
+    default:
+        return 0;
+    }
+}
+
+TPMI_ALG_HASH charra_crypto_tpm2_hash_alg_from_name(
+        const char* name, size_t name_len) {
+    static const struct {
+        const char* name;
+        TPMI_ALG_HASH alg;
+    } algs[] = {
+            {"sha1", TPM2_ALG_SHA1},
+            {"sha256", TPM2_ALG_SHA256},
+            {"sha384", TPM2_ALG_SHA384},
+            {"sha512", TPM2_ALG_SHA512},
+    };
+    for (size_t i = 0; i < sizeof(algs) / sizeof(algs[0]); ++i) {
+        if (strlen(algs[i].name) == name_len &&
+                memcmp(algs[i].name, name, name_len) == 0) {
+            return algs[i].alg;
+        }
+    }
+    return TPM2_ALG_ERROR;
+}
+
+mbedtls_md_type_t charra_crypto_tpm2_to_mbedtls_hash_alg(
+        TPMI_ALG_HASH hash_alg) {
+    switch (hash_alg) {
+    case TPM2_ALG_SHA1:
+        return MBEDTLS_MD_SHA1;
+    case TPM2_ALG_SHA256:
+        return MBEDTLS_MD_SHA256;
+    case TPM2_ALG_SHA384:
+        return MBEDTLS_MD_SHA384;
+    case TPM2_ALG_SHA512:
+        return MBEDTLS_MD_SHA512;
+    default:
+        return MBEDTLS_MD_NONE;
+    }
+}
+
 CHARRA_RC charra_crypto_hash(mbedtls_md_type_t hash_algo,
         const uint8_t* const data, const size_t data_len,
         uint8_t digest[MBEDTLS_MD_MAX_SIZE]) {
@@ -340,27 +358,3 @@ CHARRA_RC charra_crypto_rsa_verify_signature(
 error:
     return charra_r;
 }
-
-CHARRA_RC compute_and_check_PCR_digest(uint8_t** pcr_values,
-        uint32_t pcr_values_len, const TPMS_ATTEST* const attest_struct) {
-    uint8_t pcr_composite_digest[TPM2_SHA256_DIGEST_SIZE] = {0};
-    /* TODO use crypto-agile (generic) version
-     * charra_compute_pcr_composite_digest_from_ptr_array(), once
-     * implemented, instead of hash_sha256_array() (then maybe remove
-     * hash_sha256_array() function) */
-    CHARRA_RC charra_r =
-            hash_sha256_array(pcr_values, pcr_values_len, pcr_composite_digest);
-    if (charra_r != CHARRA_RC_SUCCESS) {
-        return CHARRA_RC_ERROR;
-    }
-    bool matching = charra_verify_tpm2_quote_pcr_composite_digest(
-            attest_struct, pcr_composite_digest, TPM2_SHA256_DIGEST_SIZE);
-    charra_print_hex(CHARRA_LOG_DEBUG, sizeof(pcr_composite_digest),
-            pcr_composite_digest,
-            "                                              0x", "\n", false);
-    if (matching) {
-        return CHARRA_RC_SUCCESS;
-    } else {
-        return CHARRA_RC_NO_MATCH;
-    }
-}
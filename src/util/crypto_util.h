@@ -41,9 +41,6 @@ CHARRA_RC hash_sha1_array(const size_t count, const uint8_t* const array,
 CHARRA_RC hash_sha256(const size_t data_len, const uint8_t* const data,
         uint8_t digest[TPM2_SHA256_DIGEST_SIZE]);
 
-CHARRA_RC hash_sha256_array(uint8_t* data[TPM2_SHA256_DIGEST_SIZE],
-        const size_t data_len, uint8_t digest[TPM2_SHA256_DIGEST_SIZE]);
-
 CHARRA_RC hash_sha384(const size_t data_len, const uint8_t* const data,
         uint8_t digest[TPM2_SHA384_DIGEST_SIZE]);
 
@@ -62,6 +59,35 @@ CHARRA_RC hash_sm3_256(const size_t data_len, const uint8_t* const data,
 CHARRA_RC hash_sm3_256_array(const size_t count, const uint8_t* const array,
         uint8_t digest[TPM2_SM3_256_DIGEST_SIZE]);
 
+/**
+ * @brief Returns the digest size of a TPM hash algorithm.
+ *
+ * @param[in] hash_alg The TPM hash algorithm.
+ * @return The digest size, 0 if the algorithm is not supported.
+ */
+uint16_t charra_crypto_tpm2_hash_size(TPMI_ALG_HASH hash_alg);
+
+/**
+ * @brief Returns the TPM hash algorithm of a name as used by sha256sum, IMA
+ * and the CLI, e.g. "sha256".
+ *
+ * @param[in] name The name, not necessarily terminated.
+ * @param[in] name_len The length of \a name.
+ * @return The algorithm, TPM2_ALG_ERROR if it is not supported.
+ */
+TPMI_ALG_HASH charra_crypto_tpm2_hash_alg_from_name(
+        const char* name, size_t name_len);
+
+/**
+ * @brief Returns the mbed TLS message digest type of a TPM hash algorithm.
+ *
+ * @param[in] hash_alg The TPM hash algorithm.
+ * @return The message digest type, MBEDTLS_MD_NONE if the algorithm is not
+ * supported.
+ */
+mbedtls_md_type_t charra_crypto_tpm2_to_mbedtls_hash_alg(
+        TPMI_ALG_HASH hash_alg);
+
 CHARRA_RC charra_crypto_hash(mbedtls_md_type_t hash_algo,
         const uint8_t* const data, const size_t data_len,
         uint8_t digest[MBEDTLS_MD_MAX_SIZE]);
@@ -80,17 +106,4 @@ CHARRA_RC charra_crypto_rsa_verify_signature(
         const unsigned char* data, size_t data_len,
         const unsigned char* signature, const TPM2B_PUBLIC* const tpm2_public);
 
-/**
- * @brief Compute PCR composite digest from PCR values and check if it matches
- * with the digest given in attest_struct.
- *
- * @param pcr_values 2D array of pcr values
- * @param pcr_values_len number of PCR values in pcr_values
- * @param attest_struct structure holding the digest to check against
- * @returns CHARRA_RC_SUCCESS on matching digests, CHARRA_RC_NO_MATCH
- * on non-matching digests, CHARRA_RC_ERROR on error
- */
-CHARRA_RC compute_and_check_PCR_digest(uint8_t** pcr_values,
-        uint32_t pcr_value_len, const TPMS_ATTEST* const attest_struct);
-
 #endif /* SITIMA_CRYPTO_H */
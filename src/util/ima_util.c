@@ -0,0 +1,346 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file ima_util.c
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Provides access to the binary IMA event log
+ * (binary_runtime_measurements).
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+/* pread(), fseeko(), strdup() */
+#define _POSIX_C_SOURCE 200809L
+
+#include "ima_util.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "../common/charra_error.h"
+#include "../common/charra_log.h"
+#include "../common/charra_macro.h"
+
+/* name of the legacy template, whose binary format has no data length */
+#define IMA_TEMPLATE_NAME_IMA "ima"
+
+/* initial number of indexed events */
+#define IMA_INDEX_INITIAL_CAPACITY 4096
+
+/**
+ * @brief Reads exactly \a len bytes from \a file and appends them to \a buf.
+ */
+static CHARRA_RC ima_read_field(FILE* file, size_t len, size_t buf_size,
+        uint8_t* buf, size_t* offset) {
+    if (len > buf_size - *offset) {
+        charra_log_error("IMA event exceeds buffer size.");
+        return CHARRA_RC_ERROR;
+    }
+    if (fread(buf + *offset, 1, len, file) != len) {
+        charra_log_debug("Truncated IMA event.");
+        return CHARRA_RC_ERROR;
+    }
+    *offset += len;
+    return CHARRA_RC_SUCCESS;
+}
+
+/**
+ * @brief Reads a length field in little-endian (canonical) byte order, as
+ * the verifier does.
+ */
+static CHARRA_RC ima_read_len(FILE* file, size_t buf_size, uint8_t* buf,
+        size_t* offset, uint32_t* len) {
+    CHARRA_RC r = ima_read_field(file, sizeof(*len), buf_size, buf, offset);
+    if (r == CHARRA_RC_SUCCESS) {
+        const uint8_t* p = buf + *offset - sizeof(*len);
+        *len = (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+               ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+    return r;
+}
+
+CHARRA_RC charra_ima_read_entry(
+        FILE* file, size_t buf_size, uint8_t* buf, size_t* entry_len) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    size_t offset = 0;
+    uint32_t name_len = 0;
+    uint32_t data_len = 0;
+
+    /* PCR index; a clean end of file ends the log */
+    if (buf_size < sizeof(uint32_t)) {
+        return CHARRA_RC_ERROR;
+    }
+    size_t read = fread(buf, 1, sizeof(uint32_t), file);
+    if (read == 0 && feof(file)) {
+        return CHARRA_RC_NO_MATCH;
+    } else if (read != sizeof(uint32_t)) {
+        charra_log_debug("Truncated IMA event.");
+        return CHARRA_RC_ERROR;
+    }
+    offset = sizeof(uint32_t);
+
+    /* template hash */
+    if ((r = ima_read_field(file, CHARRA_IMA_TEMPLATE_DIGEST_SIZE, buf_size,
+                 buf, &offset)) != CHARRA_RC_SUCCESS) {
+        return r;
+    }
+
+    /* template name */
+    if ((r = ima_read_len(file, buf_size, buf, &offset, &name_len)) !=
+            CHARRA_RC_SUCCESS) {
+        return r;
+    }
+    if (name_len > CHARRA_IMA_TEMPLATE_NAME_MAX_LEN) {
+        charra_log_error("IMA template name too long (%u bytes).", name_len);
+        return CHARRA_RC_ERROR;
+    }
+    const size_t name_offset = offset;
+    if ((r = ima_read_field(file, name_len, buf_size, buf, &offset)) !=
+            CHARRA_RC_SUCCESS) {
+        return r;
+    }
+
+    /* template data */
+    if (name_len == strlen(IMA_TEMPLATE_NAME_IMA) &&
+            memcmp(buf + name_offset, IMA_TEMPLATE_NAME_IMA, name_len) == 0) {
+        /* legacy template: file digest and file name with length prefix */
+        if ((r = ima_read_field(file, CHARRA_IMA_TEMPLATE_DIGEST_SIZE,
+                     buf_size, buf, &offset)) != CHARRA_RC_SUCCESS) {
+            return r;
+        }
+        if ((r = ima_read_len(file, buf_size, buf, &offset, &data_len)) !=
+                CHARRA_RC_SUCCESS) {
+            return r;
+        }
+        if (data_len > CHARRA_IMA_TEMPLATE_NAME_MAX_LEN + 1) {
+            charra_log_error("IMA file name too long (%u bytes).", data_len);
+            return CHARRA_RC_ERROR;
+        }
+    } else {
+        if ((r = ima_read_len(file, buf_size, buf, &offset, &data_len)) !=
+                CHARRA_RC_SUCCESS) {
+            return r;
+        }
+        if (data_len > CHARRA_IMA_TEMPLATE_DATA_MAX_LEN) {
+            charra_log_error(
+                    "IMA template data too long (%u bytes).", data_len);
+            return CHARRA_RC_ERROR;
+        }
+    }
+    if ((r = ima_read_field(file, data_len, buf_size, buf, &offset)) !=
+            CHARRA_RC_SUCCESS) {
+        return r;
+    }
+
+    *entry_len = offset;
+    return CHARRA_RC_SUCCESS;
+}
+
+CHARRA_RC charra_ima_index_init(charra_ima_index* index, const char* path) {
+    memset(index, 0, sizeof(*index));
+    index->fd = -1;
+
+    if ((index->path = strdup(path)) == NULL ||
+            (index->offsets = calloc(IMA_INDEX_INITIAL_CAPACITY,
+                     sizeof(*index->offsets))) == NULL) {
+        charra_log_error("Cannot allocate memory.");
+        goto error;
+    }
+    index->capacity = IMA_INDEX_INITIAL_CAPACITY;
+    if ((index->fd = open(path, O_RDONLY)) == -1 ||
+            (index->file = fopen(path, "rb")) == NULL) {
+        charra_log_error("Cannot open file '%s'.", path);
+        goto error;
+    }
+
+    /* index all events present so far */
+    if (charra_ima_index_update(index) != CHARRA_RC_SUCCESS) {
+        goto error;
+    }
+
+    return CHARRA_RC_SUCCESS;
+
+error:
+    charra_ima_index_free(index);
+    return CHARRA_RC_ERROR;
+}
+
+CHARRA_RC charra_ima_index_update(charra_ima_index* index) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    FILE* file = index->file;
+
+    if (index->scratch == NULL &&
+            (index->scratch = malloc(CHARRA_IMA_ENTRY_MAX_LEN)) == NULL) {
+        charra_log_error("Cannot allocate memory.");
+        return CHARRA_RC_ERROR;
+    }
+
+    /* continue after the last indexed event; the stream is only rewound if
+     * the previous update stopped inside an event still being appended */
+    clearerr(file);
+    if (ftello(file) != (off_t)index->offsets[index->count] &&
+            fseeko(file, (off_t)index->offsets[index->count], SEEK_SET) !=
+                    0) {
+        charra_log_error("Cannot seek in file '%s'.", index->path);
+        return CHARRA_RC_ERROR;
+    }
+
+    for (;;) {
+        size_t entry_len = 0;
+        r = charra_ima_read_entry(
+                file, CHARRA_IMA_ENTRY_MAX_LEN, index->scratch, &entry_len);
+        if (r == CHARRA_RC_NO_MATCH) {
+            r = CHARRA_RC_SUCCESS;
+            break;
+        } else if (r != CHARRA_RC_SUCCESS) {
+            /* event still being appended, index it next time */
+            if (feof(file)) {
+                r = CHARRA_RC_SUCCESS;
+            } else {
+                charra_log_error("Malformed IMA event %" PRIu64 " in '%s'.",
+                        index->count + 1, index->path);
+            }
+            break;
+        }
+
+        /* grow index geometrically */
+        if (index->count + 1 >= index->capacity) {
+            uint64_t* offsets = realloc(index->offsets,
+                    2 * index->capacity * sizeof(*index->offsets));
+            if (offsets == NULL) {
+                charra_log_error("Cannot allocate memory.");
+                r = CHARRA_RC_ERROR;
+                break;
+            }
+            index->offsets = offsets;
+            index->capacity *= 2;
+        }
+        index->offsets[index->count + 1] =
+                index->offsets[index->count] + entry_len;
+        index->count += 1;
+    }
+
+    return r;
+}
+
+CHARRA_RC charra_ima_index_locate(charra_ima_index* index, uint64_t start,
+        uint64_t count, uint64_t* offset, size_t* len,
+        uint64_t* entries_count) {
+    if (start == 0) {
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+
+    /* pick up new events if the slice is not fully indexed */
+    if (count == 0 || start - 1 + count > index->count) {
+        if (charra_ima_index_update(index) != CHARRA_RC_SUCCESS) {
+            return CHARRA_RC_ERROR;
+        }
+    }
+
+    *offset = 0;
+    *len = 0;
+    *entries_count = 0;
+    if (start > index->count) {
+        return CHARRA_RC_SUCCESS;
+    }
+    uint64_t end = index->count;
+    if (count != 0 && count < index->count - (start - 1)) {
+        end = start - 1 + count;
+    }
+
+    *offset = index->offsets[start - 1];
+    *len = (size_t)(index->offsets[end] - *offset);
+    *entries_count = end - (start - 1);
+
+    return CHARRA_RC_SUCCESS;
+}
+
+CHARRA_RC charra_ima_index_read_cb(
+        void* ctx, uint64_t offset, size_t len, uint8_t* out) {
+    const charra_ima_index* index = ctx;
+
+    size_t done = 0;
+    while (done < len) {
+        /* pseudo files return at most a page per call */
+        ssize_t n = pread(index->fd, out + done, len - done,
+                (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            charra_log_error("Cannot read file '%s'.", index->path);
+            return CHARRA_RC_ERROR;
+        }
+        done += (size_t)n;
+    }
+
+    return CHARRA_RC_SUCCESS;
+}
+
+CHARRA_RC charra_ima_index_read_entries(charra_ima_index* index,
+        uint64_t start, uint64_t count, uint8_t** entries, size_t* entries_len,
+        uint64_t* entries_count) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    uint64_t offset = 0;
+    size_t len = 0;
+    uint64_t n = 0;
+
+    *entries = NULL;
+    *entries_len = 0;
+    *entries_count = 0;
+    if ((r = charra_ima_index_locate(index, start, count, &offset, &len,
+                 &n)) != CHARRA_RC_SUCCESS) {
+        return r;
+    }
+    if (n == 0) {
+        return CHARRA_RC_SUCCESS;
+    }
+
+    /* read the slice at its offset */
+    uint8_t* buf = malloc(len);
+    if (buf == NULL) {
+        charra_log_error("Cannot allocate memory.");
+        return CHARRA_RC_ERROR;
+    }
+    if (charra_ima_index_read_cb(index, offset, len, buf) !=
+            CHARRA_RC_SUCCESS) {
+        free(buf);
+        return CHARRA_RC_ERROR;
+    }
+
+    *entries = buf;
+    *entries_len = len;
+    *entries_count = n;
+
+    return CHARRA_RC_SUCCESS;
+}
+
+void charra_ima_index_free(charra_ima_index* index) {
+    if (index->fd != -1) {
+        close(index->fd);
+        index->fd = -1;
+    }
+    if (index->file != NULL) {
+        fclose(index->file);
+        index->file = NULL;
+    }
+    charra_free_if_not_null(index->path);
+    charra_free_if_not_null(index->offsets);
+    charra_free_if_not_null(index->scratch);
+    index->count = 0;
+    index->capacity = 0;
+}
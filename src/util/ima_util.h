@@ -0,0 +1,164 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file ima_util.h
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Provides access to the binary IMA event log
+ * (binary_runtime_measurements).
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#ifndef IMA_UTIL_H
+#define IMA_UTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../common/charra_error.h"
+
+/* size of the (SHA-1) template hash of an IMA event */
+#define CHARRA_IMA_TEMPLATE_DIGEST_SIZE 20
+
+/* maximum length of an IMA template name (TCG_EVENT_NAME_LEN_MAX) */
+#define CHARRA_IMA_TEMPLATE_NAME_MAX_LEN 255
+
+/* sanity limit for the template data of a single IMA event */
+#define CHARRA_IMA_TEMPLATE_DATA_MAX_LEN (1024 * 1024)
+
+/* maximum length of an IMA event: PCR index, template hash, template name and
+ * template data, both with length prefix */
+#define CHARRA_IMA_ENTRY_MAX_LEN                                               \
+    (4 + CHARRA_IMA_TEMPLATE_DIGEST_SIZE + 4 +                                 \
+            CHARRA_IMA_TEMPLATE_NAME_MAX_LEN + 4 +                             \
+            CHARRA_IMA_TEMPLATE_DATA_MAX_LEN)
+
+/**
+ * @brief Reads the next IMA event from \a file into \a buf.
+ *
+ * Length fields are read in little-endian byte order, as written by the
+ * kernel on little-endian machines or with ima_canonical_fmt, and as
+ * expected by the verifier (see charra_ima_replay_log()).
+ *
+ * @param[in] file The binary IMA event log, positioned at an event.
+ * @param[in] buf_size The size of \a buf, at least CHARRA_IMA_ENTRY_MAX_LEN
+ * to read any event.
+ * @param[out] buf The event as found in the log.
+ * @param[out] entry_len The length of the event.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_NO_MATCH at the end of the log.
+ * @return CHARRA_RC_ERROR on read errors or malformed events.
+ */
+CHARRA_RC charra_ima_read_entry(
+        FILE* file, size_t buf_size, uint8_t* buf, size_t* entry_len);
+
+/**
+ * @brief An index from IMA event number to byte offset in the binary IMA event
+ * log. It is built once and extended by tailing the log, so that a slice of
+ * the log is read at a known offset.
+ */
+typedef struct {
+    char* path;
+    /* descriptor used for positioned reads of slices */
+    int fd;
+    /* stream tailing the log, positioned after the last indexed event */
+    FILE* file;
+    /* offsets[i] is the offset of event i + 1, offsets[count] the end of the
+     * last complete event */
+    uint64_t* offsets;
+    uint64_t count;
+    uint64_t capacity;
+    /* scratch buffer for events while tailing the log */
+    uint8_t* scratch;
+} charra_ima_index;
+
+/**
+ * @brief Opens the binary IMA event log and indexes all its events.
+ *
+ * @param[out] index The index.
+ * @param[in] path The path of the binary IMA event log.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_ERROR on errors.
+ */
+CHARRA_RC charra_ima_index_init(charra_ima_index* index, const char* path);
+
+/**
+ * @brief Indexes the events appended to the log since the last call.
+ *
+ * @param[in,out] index The index.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_ERROR on errors.
+ */
+CHARRA_RC charra_ima_index_update(charra_ima_index* index);
+
+/**
+ * @brief Locates a slice of the binary IMA event log without reading it. The
+ * index is extended first if the slice reaches beyond the indexed events.
+ *
+ * @param[in,out] index The index.
+ * @param[in] start The number of the first event (starting at 1).
+ * @param[in] count The maximum number of events, 0 for all remaining events.
+ * @param[out] offset The offset of the slice in the log.
+ * @param[out] len The length of the slice in bytes.
+ * @param[out] entries_count The number of events in the slice.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_BAD_ARGUMENT if \a start is 0.
+ * @return CHARRA_RC_ERROR on errors.
+ */
+CHARRA_RC charra_ima_index_locate(charra_ima_index* index, uint64_t start,
+        uint64_t count, uint64_t* offset, size_t* len,
+        uint64_t* entries_count);
+
+/**
+ * @brief Reads \a len bytes of the log at \a offset. Matches
+ * charra_tap_content_read_cb, so that a located slice is read only when it is
+ * encoded.
+ *
+ * @param[in] ctx The index (charra_ima_index*).
+ * @param[in] offset The offset in the log.
+ * @param[in] len The number of bytes to read.
+ * @param[out] out The buffer receiving the bytes.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_ERROR on read errors.
+ */
+CHARRA_RC charra_ima_index_read_cb(
+        void* ctx, uint64_t offset, size_t len, uint8_t* out);
+
+/**
+ * @brief Reads a slice of the binary IMA event log at its indexed offset. The
+ * index is extended first if the slice reaches beyond the indexed events.
+ *
+ * @param[in,out] index The index.
+ * @param[in] start The number of the first event (starting at 1).
+ * @param[in] count The maximum number of events, 0 for all remaining events.
+ * @param[out] entries The events, allocated by this function, NULL if no event
+ * was read. Must be freed by the caller.
+ * @param[out] entries_len The length of \a entries in bytes.
+ * @param[out] entries_count The number of events in \a entries.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_BAD_ARGUMENT if \a start is 0.
+ * @return CHARRA_RC_ERROR on errors.
+ */
+CHARRA_RC charra_ima_index_read_entries(charra_ima_index* index,
+        uint64_t start, uint64_t count, uint8_t** entries, size_t* entries_len,
+        uint64_t* entries_count);
+
+/**
+ * @brief Closes the log and frees the index.
+ *
+ * @param[in,out] index The index.
+ */
+void charra_ima_index_free(charra_ima_index* index);
+
+#endif /* IMA_UTIL_H */
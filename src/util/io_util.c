@@ -18,17 +18,28 @@
  * BSD-3-Clause).
  */
 
+/* mmap(), posix_madvise() */
+#define _POSIX_C_SOURCE 200809L
+
 #include "io_util.h"
 #include "../common/charra_log.h"
 #include "../common/charra_macro.h"
-#include "../core/charra_cvector.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 #include <unistd.h>
 
+/* size of the reads for files of unknown size */
+#define IO_READ_CHUNK_SIZE (1024 * 1024)
+
 void charra_print_hex(const charra_log_t level, const size_t buf_len,
         const uint8_t* const buf, const char* const prefix,
         const char* const postfix, const bool upper_case) {
@@ -74,121 +85,147 @@ CHARRA_RC charra_io_file_exists(const char* const filename) {
     }
 }
 
-CHARRA_RC charra_io_read_file(const char* filename, char** const file_content,
-        size_t* const file_content_len) {
-    CHARRA_RC r = CHARRA_RC_SUCCESS;
-    FILE* fp = NULL;
+/**
+ * @brief Reads \a fd until end of file into a heap buffer with large reads.
+ * Works for files whose size is unknown in advance, e.g. securityfs pseudo
+ * files which report a size of 0.
+ *
+ * @param[in] fd The file descriptor.
+ * @param[in] size_hint The expected size, 0 if unknown.
+ * @param[out] content The content, allocated by this function.
+ * @param[out] content_len The length of \a content.
+ */
+static CHARRA_RC io_read_fd(const int fd, const size_t size_hint,
+        uint8_t** const content, size_t* const content_len) {
+    size_t size = (size_hint > 0) ? size_hint : IO_READ_CHUNK_SIZE;
+    size_t len = 0;
+    uint8_t* buf = NULL;
 
-    /* open file */
-    if ((fp = fopen(filename, "r")) == NULL) {
-        charra_log_error("Cannot open file '%s'.", filename);
-        r = CHARRA_RC_ERROR;
-        goto error;
+    if ((buf = malloc(size)) == NULL) {
+        return CHARRA_RC_ERROR;
     }
 
-    /* get file size */
-    ssize_t file_size = -1;
-    {
-        /* go to end of file */
-        if (fseek(fp, 0L, SEEK_END) != 0) {
-            r = CHARRA_RC_ERROR;
-            goto error;
+    for (;;) {
+        /* grow geometrically, e.g. if the file grew meanwhile */
+        if (len == size) {
+            uint8_t* new_buf = realloc(buf, 2 * size);
+            if (new_buf == NULL) {
+                charra_free_if_not_null(buf);
+                return CHARRA_RC_ERROR;
+            }
+            buf = new_buf;
+            size *= 2;
         }
 
-        /* get position (i.e., the file size) */
-        if ((file_size = ftell(fp)) == -1) {
-            r = CHARRA_RC_ERROR;
-            goto error;
+        ssize_t n = read(fd, buf + len, size - len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0) {
+            charra_free_if_not_null(buf);
+            return CHARRA_RC_ERROR;
+        } else if (n == 0) {
+            break;
         }
+        len += (size_t)n;
 
-        /* go back to beginning of file */
-        if (fseek(fp, 0L, SEEK_SET) != 0) {
-            r = CHARRA_RC_ERROR;
-            goto error;
+        /* a regular file is complete once its size has been read */
+        if (size_hint > 0 && len == size_hint) {
+            break;
         }
     }
 
-    /* allocate memory */
-    char* file_buffer = NULL;
-    if ((file_buffer = malloc(file_size * sizeof(*file_buffer))) == NULL) {
-        r = CHARRA_RC_ERROR;
-        goto error;
-    }
+    *content = buf;
+    *content_len = len;
+    return CHARRA_RC_SUCCESS;
+}
 
-    size_t read_size = fread(file_buffer, sizeof(*file_buffer), file_size, fp);
-    if (read_size < (size_t)file_size) {
-        charra_log_error("Error while reading file '%s', expected size %zu, "
-                         "got size %zu.",
-                filename, file_size, read_size);
-        charra_free_if_not_null(file_buffer);
-        r = CHARRA_RC_ERROR;
-        goto error;
+CHARRA_RC charra_io_read_file(const char* filename, char** const file_content,
+        size_t* const file_content_len) {
+    uint8_t* content = NULL;
+    CHARRA_RC r = charra_io_read_continuous_binary_file(
+            filename, &content, file_content_len);
+    if (r == CHARRA_RC_SUCCESS) {
+        *file_content = (char*)content;
     }
+    return r;
+}
 
-    /* set output arguments */
-    *file_content = file_buffer;
-    *file_content_len = read_size;
+void charra_io_free_file_buffer(char** const file_content) {
+    charra_free_if_not_null(*file_content);
+}
 
-error:
+CHARRA_RC charra_io_read_continuous_binary_file(const char* const filename,
+        uint8_t** const file_content, size_t* const file_content_len) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    struct stat st = {0};
+    int fd = -1;
 
-    /* close file */
-    if (fp != NULL) {
-        if (fclose(fp) != 0) {
-            charra_log_error("Error closing file '%s'.", filename);
-            charra_free_if_not_null(file_buffer);
-            return CHARRA_RC_ERROR;
-        }
+    if ((fd = open(filename, O_RDONLY)) == -1) {
+        charra_log_error("Cannot open file '%s'.", filename);
+        return CHARRA_RC_ERROR;
+    }
+
+    /* pseudo files report no (or a wrong) size */
+    size_t size_hint = 0;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        size_hint = (size_t)st.st_size;
+    }
+
+    if ((r = io_read_fd(fd, size_hint, file_content, file_content_len)) !=
+            CHARRA_RC_SUCCESS) {
+        charra_log_error("Error while reading file '%s'.", filename);
     }
 
+    close(fd);
     return r;
 }
 
-void charra_io_free_file_buffer(char** const file_content) {
+void charra_io_free_continuous_file_buffer(uint8_t** const file_content) {
     charra_free_if_not_null(*file_content);
 }
 
-CHARRA_RC charra_io_read_continuous_binary_file(const char* const filename,
-        uint8_t** const file_content, size_t* const file_content_len) {
-    /* the size of the event log chunks which get read at once */
-#define IMA_EVENT_LOG_STEP_SIZE 1024
-    /*
-     * Use logarithmic growth for the cvector. Otherwise it would grow on
-     * every call to cvector_push_back().
-     */
-#define CVECTOR_LOGARITHMIC_GROWTH
-
-    cvector_vector_type(uint8_t) file_content_cvector = NULL;
-    FILE* fp = NULL;
-    if ((fp = fopen(filename, "rb")) == NULL) {
+CHARRA_RC charra_io_map_file(
+        const char* const filename, charra_io_file_buffer* const buffer) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    struct stat st = {0};
+    int fd = -1;
+
+    *buffer = (charra_io_file_buffer){0};
+
+    if ((fd = open(filename, O_RDONLY)) == -1) {
         charra_log_error("Cannot open file '%s'.", filename);
         return CHARRA_RC_ERROR;
     }
-    uint8_t processing_array[IMA_EVENT_LOG_STEP_SIZE] = {0};
-    size_t read_size = 0;
-    do {
-        read_size = fread(processing_array, sizeof(*processing_array),
-                IMA_EVENT_LOG_STEP_SIZE, fp);
-        for (size_t i = 0; i < read_size; ++i) {
-            cvector_push_back(file_content_cvector, processing_array[i]);
-        }
-    } while (read_size == IMA_EVENT_LOG_STEP_SIZE);
 
-    /* flush and close file */
-    if (fflush(fp) != 0) {
-        charra_log_error("Error flushing file '%s'.", filename);
-        charra_free_if_not_null_ex(file_content_cvector, cvector_free);
-        return CHARRA_RC_ERROR;
+    /* map regular files */
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* data = mmap(
+                NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+            buffer->data = data;
+            buffer->len = (size_t)st.st_size;
+            buffer->mapped = true;
+            goto finish;
+        }
     }
-    if (fclose(fp) != 0) {
-        charra_log_error("Error closing file '%s'.", filename);
-        charra_free_if_not_null_ex(file_content_cvector, cvector_free);
-        return CHARRA_RC_ERROR;
+
+    /* read pseudo files (and files which cannot be mapped) in bulk */
+    if ((r = io_read_fd(fd, 0, &buffer->data, &buffer->len)) !=
+            CHARRA_RC_SUCCESS) {
+        charra_log_error("Error while reading file '%s'.", filename);
     }
-    *file_content_len = cvector_size(file_content_cvector);
-    *file_content = file_content_cvector;
-    return CHARRA_RC_SUCCESS;
+
+finish:
+    close(fd);
+    return r;
 }
 
-void charra_io_free_continuous_file_buffer(uint8_t** const file_content) {
-    charra_free_if_not_null_ex(*file_content, cvector_free);
+void charra_io_unmap_file(charra_io_file_buffer* const buffer) {
+    if (buffer->mapped) {
+        munmap(buffer->data, buffer->len);
+    } else {
+        charra_free_if_not_null(buffer->data);
+    }
+    *buffer = (charra_io_file_buffer){0};
 }
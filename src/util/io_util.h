@@ -107,12 +107,12 @@ CHARRA_RC charra_io_read_file(const char* filename, char** const file_content,
 void charra_io_free_file_buffer(char** const file_content);
 
 /**
- * @brief read binary file of unknown length into a cvector. Used for IMA event
- * log reading, which is a char device. The cvector will be initialized inside
+ * @brief read binary file of unknown length into a buffer. Used for IMA event
+ * log reading, which is a pseudo file. The buffer will be initialized inside
  * this function.
  *
  * @param[in] filename the path of the file to be read
- * @param[out] file_content A pointer to the cvector, assumed to be
+ * @param[out] file_content A pointer to the buffer, assumed to be
  * uninitialized upon calling.
  * @param[out] file_content_len The actual length of the file (aka the size of
  * file_content).
@@ -122,10 +122,37 @@ CHARRA_RC charra_io_read_continuous_binary_file(const char* const filename,
         uint8_t** const file_content, size_t* const file_content_len);
 
 /**
- * @brief free cvector holding the file content.
+ * @brief free buffer holding the file content.
  *
- * @param[in] file_content A pointer to the cvector.
+ * @param[in] file_content A pointer to the buffer.
  */
 void charra_io_free_continuous_file_buffer(uint8_t** const file_content);
 
+/**
+ * @brief The content of a file, either memory-mapped or read into the heap.
+ */
+typedef struct {
+    uint8_t* data;
+    size_t len;
+    bool mapped;
+} charra_io_file_buffer;
+
+/**
+ * @brief Maps a regular file into memory read-only. Pseudo files (e.g.
+ * securityfs), which cannot be mapped, are read in bulk instead.
+ *
+ * @param[in] filename the path of the file
+ * @param[out] buffer the file content
+ * @return CHARRA_RC CHARRA_RC_SUCCESS on success, otherwise CHARRA_RC_ERROR
+ */
+CHARRA_RC charra_io_map_file(
+        const char* const filename, charra_io_file_buffer* const buffer);
+
+/**
+ * @brief Unmaps or frees the content of a file.
+ *
+ * @param[in,out] buffer the file content
+ */
+void charra_io_unmap_file(charra_io_file_buffer* const buffer);
+
 #endif /* IO_UTIL_H */
@@ -0,0 +1,205 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file merkle_util.c
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Provides SHA-256 Merkle trees (RFC 9162 style) for quote coalescing.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#include "merkle_util.h"
+
+#include <mbedtls/sha256.h>
+#include <string.h>
+
+#include "../common/charra_error.h"
+
+/* domain separation prefixes of RFC 9162, section 2.1.1 */
+#define MERKLE_LEAF_PREFIX 0x00
+#define MERKLE_NODE_PREFIX 0x01
+
+/**
+ * @brief Computes SHA-256(prefix || a || b), \a b may be NULL.
+ */
+static CHARRA_RC merkle_hash(const uint8_t prefix, const size_t a_len,
+        const uint8_t* const a, const size_t b_len, const uint8_t* const b,
+        uint8_t digest[CHARRA_MERKLE_HASH_SIZE]) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+
+    /* init */
+    mbedtls_sha256_context ctx = {0};
+    mbedtls_sha256_init(&ctx);
+
+    /* hash */
+    if ((mbedtls_sha256_starts(&ctx, 0)) != 0 ||
+            (mbedtls_sha256_update(&ctx, &prefix, 1)) != 0 ||
+            (mbedtls_sha256_update(&ctx, a, a_len)) != 0 ||
+            (b != NULL && (mbedtls_sha256_update(&ctx, b, b_len)) != 0) ||
+            (mbedtls_sha256_finish(&ctx, digest)) != 0) {
+        r = CHARRA_RC_CRYPTO_ERROR;
+    }
+
+    /* free */
+    mbedtls_sha256_free(&ctx);
+
+    return r;
+}
+
+/**
+ * @brief Returns the largest power of two smaller than \a n (n > 1).
+ */
+static size_t merkle_split(const size_t n) {
+    size_t k = 1;
+    while (k << 1 < n) {
+        k <<= 1;
+    }
+    return k;
+}
+
+static CHARRA_RC merkle_subtree_hash(const size_t leaves_len,
+        const uint8_t (*leaf_hashes)[CHARRA_MERKLE_HASH_SIZE],
+        uint8_t digest[CHARRA_MERKLE_HASH_SIZE]) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    uint8_t left[CHARRA_MERKLE_HASH_SIZE] = {0};
+    uint8_t right[CHARRA_MERKLE_HASH_SIZE] = {0};
+
+    if (leaves_len == 1) {
+        memcpy(digest, leaf_hashes[0], CHARRA_MERKLE_HASH_SIZE);
+        return CHARRA_RC_SUCCESS;
+    }
+
+    const size_t k = merkle_split(leaves_len);
+    if ((r = merkle_subtree_hash(k, leaf_hashes, left)) != CHARRA_RC_SUCCESS ||
+            (r = merkle_subtree_hash(leaves_len - k, leaf_hashes + k,
+                     right)) != CHARRA_RC_SUCCESS) {
+        return r;
+    }
+
+    return merkle_hash(MERKLE_NODE_PREFIX, sizeof(left), left, sizeof(right),
+            right, digest);
+}
+
+CHARRA_RC charra_merkle_leaf_hash(const size_t data_len,
+        const uint8_t* const data,
+        uint8_t leaf_hash[CHARRA_MERKLE_HASH_SIZE]) {
+    return merkle_hash(MERKLE_LEAF_PREFIX, data_len, data, 0, NULL, leaf_hash);
+}
+
+CHARRA_RC charra_merkle_root(const size_t leaves_len,
+        const uint8_t (*leaf_hashes)[CHARRA_MERKLE_HASH_SIZE],
+        uint8_t root[CHARRA_MERKLE_HASH_SIZE]) {
+    if (leaves_len == 0 || leaves_len > CHARRA_MERKLE_MAX_LEAVES ||
+            leaf_hashes == NULL) {
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+
+    return merkle_subtree_hash(leaves_len, leaf_hashes, root);
+}
+
+CHARRA_RC charra_merkle_inclusion_proof(const size_t leaves_len,
+        const uint8_t (*leaf_hashes)[CHARRA_MERKLE_HASH_SIZE],
+        const size_t index, uint32_t* path_len,
+        uint8_t (*path)[CHARRA_MERKLE_HASH_SIZE]) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    uint8_t (*subtree_path)[CHARRA_MERKLE_HASH_SIZE] = path;
+    size_t m = index;
+    size_t n = leaves_len;
+    size_t offset = 0;
+
+    if (leaves_len == 0 || leaves_len > CHARRA_MERKLE_MAX_LEAVES ||
+            leaf_hashes == NULL || index >= leaves_len || path_len == NULL ||
+            path == NULL) {
+        return CHARRA_RC_BAD_ARGUMENT;
+    }
+
+    /* descend from the root; the path is ordered leaf to root, so count the
+     * levels first and fill it from the back */
+    uint32_t depth = 0;
+    for (size_t i = m, j = n; j > 1; ++depth) {
+        const size_t k = merkle_split(j);
+        if (i < k) {
+            j = k;
+        } else {
+            i -= k;
+            j -= k;
+        }
+    }
+    *path_len = depth;
+
+    while (n > 1) {
+        const size_t k = merkle_split(n);
+        uint8_t(*sibling)[CHARRA_MERKLE_HASH_SIZE] = &subtree_path[depth - 1];
+        if (m < k) {
+            r = merkle_subtree_hash(n - k, leaf_hashes + offset + k, *sibling);
+            n = k;
+        } else {
+            r = merkle_subtree_hash(k, leaf_hashes + offset, *sibling);
+            offset += k;
+            m -= k;
+            n -= k;
+        }
+        if (r != CHARRA_RC_SUCCESS) {
+            return r;
+        }
+        depth -= 1;
+    }
+
+    return CHARRA_RC_SUCCESS;
+}
+
+CHARRA_RC charra_merkle_verify_inclusion(
+        const uint8_t leaf_hash[CHARRA_MERKLE_HASH_SIZE], const uint64_t index,
+        const uint64_t tree_size, const uint32_t path_len,
+        const uint8_t (*path)[CHARRA_MERKLE_HASH_SIZE],
+        const uint8_t root[CHARRA_MERKLE_HASH_SIZE]) {
+    CHARRA_RC r = CHARRA_RC_SUCCESS;
+    uint8_t digest[CHARRA_MERKLE_HASH_SIZE] = {0};
+
+    if (index >= tree_size || path_len > CHARRA_MERKLE_MAX_PATH_LEN ||
+            (path_len > 0 && path == NULL)) {
+        return CHARRA_RC_NO_MATCH;
+    }
+
+    /* RFC 9162, section 2.1.3.2 */
+    uint64_t fn = index;
+    uint64_t sn = tree_size - 1;
+    memcpy(digest, leaf_hash, CHARRA_MERKLE_HASH_SIZE);
+    for (uint32_t i = 0; i < path_len; ++i) {
+        if (sn == 0) {
+            return CHARRA_RC_NO_MATCH;
+        }
+        if ((fn & 1) == 1 || fn == sn) {
+            r = merkle_hash(MERKLE_NODE_PREFIX, CHARRA_MERKLE_HASH_SIZE,
+                    path[i], CHARRA_MERKLE_HASH_SIZE, digest, digest);
+            while ((fn & 1) == 0 && fn != 0) {
+                fn >>= 1;
+                sn >>= 1;
+            }
+        } else {
+            r = merkle_hash(MERKLE_NODE_PREFIX, CHARRA_MERKLE_HASH_SIZE,
+                    digest, CHARRA_MERKLE_HASH_SIZE, path[i], digest);
+        }
+        if (r != CHARRA_RC_SUCCESS) {
+            return r;
+        }
+        fn >>= 1;
+        sn >>= 1;
+    }
+
+    if (sn != 0 || memcmp(digest, root, CHARRA_MERKLE_HASH_SIZE) != 0) {
+        return CHARRA_RC_NO_MATCH;
+    }
+
+    return CHARRA_RC_SUCCESS;
+}
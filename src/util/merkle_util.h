@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+/*****************************************************************************
+ * Copyright 2026, Fraunhofer Institute for Secure Information Technology SIT.
+ * All rights reserved.
+ ****************************************************************************/
+
+/**
+ * @file merkle_util.h
+ * @author Michael Eckel (michael.eckel@sit.fraunhofer.de)
+ * @brief Provides SHA-256 Merkle trees (RFC 9162 style) for quote coalescing.
+ * @version 0.1
+ * @date 2026-10-15
+ *
+ * @copyright Copyright 2026, Fraunhofer Institute for Secure Information
+ * Technology SIT. All rights reserved.
+ *
+ * @license BSD 3-Clause "New" or "Revised" License (SPDX-License-Identifier:
+ * BSD-3-Clause).
+ */
+
+#ifndef MERKLE_UTIL_H
+#define MERKLE_UTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tss2/tss2_tpm2_types.h>
+
+#include "../common/charra_error.h"
+
+#define CHARRA_MERKLE_HASH_SIZE TPM2_SHA256_DIGEST_SIZE
+
+/* maximum length of an inclusion proof, i.e. at most 2^16 leaves */
+#define CHARRA_MERKLE_MAX_PATH_LEN 16
+#define CHARRA_MERKLE_MAX_LEAVES (1U << CHARRA_MERKLE_MAX_PATH_LEN)
+
+/**
+ * @brief Computes the leaf hash SHA-256(0x00 || data).
+ *
+ * @param[in] data_len The length of \a data.
+ * @param[in] data The leaf data, e.g. a nonce.
+ * @param[out] leaf_hash The leaf hash.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_CRYPTO_ERROR on errors.
+ */
+CHARRA_RC charra_merkle_leaf_hash(const size_t data_len,
+        const uint8_t* const data,
+        uint8_t leaf_hash[CHARRA_MERKLE_HASH_SIZE]);
+
+/**
+ * @brief Computes the Merkle tree hash over \a leaf_hashes.
+ *
+ * @param[in] leaves_len The number of leaves (at least 1).
+ * @param[in] leaf_hashes The leaf hashes.
+ * @param[out] root The root hash.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_BAD_ARGUMENT on invalid arguments.
+ * @return CHARRA_RC_CRYPTO_ERROR on errors.
+ */
+CHARRA_RC charra_merkle_root(const size_t leaves_len,
+        const uint8_t (*leaf_hashes)[CHARRA_MERKLE_HASH_SIZE],
+        uint8_t root[CHARRA_MERKLE_HASH_SIZE]);
+
+/**
+ * @brief Computes the inclusion proof (audit path) for leaf \a index.
+ *
+ * @param[in] leaves_len The number of leaves (at least 1).
+ * @param[in] leaf_hashes The leaf hashes.
+ * @param[in] index The index of the leaf to prove.
+ * @param[out] path_len The number of hashes in \a path.
+ * @param[out] path The audit path, CHARRA_MERKLE_MAX_PATH_LEN entries.
+ * @return CHARRA_RC_SUCCESS on success.
+ * @return CHARRA_RC_BAD_ARGUMENT on invalid arguments.
+ * @return CHARRA_RC_CRYPTO_ERROR on errors.
+ */
+CHARRA_RC charra_merkle_inclusion_proof(const size_t leaves_len,
+        const uint8_t (*leaf_hashes)[CHARRA_MERKLE_HASH_SIZE],
+        const size_t index, uint32_t* path_len,
+        uint8_t (*path)[CHARRA_MERKLE_HASH_SIZE]);
+
+/**
+ * @brief Verifies that \a leaf_hash is leaf \a index of the tree with
+ * \a tree_size leaves and root \a root.
+ *
+ * @param[in] leaf_hash The leaf hash.
+ * @param[in] index The index of the leaf.
+ * @param[in] tree_size The number of leaves of the tree.
+ * @param[in] path_len The number of hashes in \a path.
+ * @param[in] path The audit path.
+ * @param[in] root The expected root hash.
+ * @return CHARRA_RC_SUCCESS if the proof is valid.
+ * @return CHARRA_RC_NO_MATCH if the proof is invalid.
+ * @return CHARRA_RC_CRYPTO_ERROR on errors.
+ */
+CHARRA_RC charra_merkle_verify_inclusion(
+        const uint8_t leaf_hash[CHARRA_MERKLE_HASH_SIZE], const uint64_t index,
+        const uint64_t tree_size, const uint32_t path_len,
+        const uint8_t (*path)[CHARRA_MERKLE_HASH_SIZE],
+        const uint8_t root[CHARRA_MERKLE_HASH_SIZE]);
+
+#endif /* MERKLE_UTIL_H */
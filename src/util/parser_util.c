@@ -20,22 +20,24 @@
  */
 
 #include <errno.h>
+#include <inttypes.h>
 
 #include "../common/charra_error.h"
 #include "../common/charra_log.h"
 #include "../common/charra_macro.h"
+#include "../util/crypto_util.h"
+#include "../util/ima_util.h"
 #include "../util/io_util.h"
 #include "parser_util.h"
 
 #include <string.h>
 #include <tss2/tss2_tpm2_types.h>
 
-/* a byte is represented as 2 characters in a hex string + 2 bytes for the
- * characters "0x" */
-#define SHA256_HEX_STR_SIZE (TPM2_SHA256_DIGEST_SIZE * 2 + 2)
-
-CHARRA_RC parse_pcr_value(char* start, size_t length, uint8_t* pcr_value) {
-    if (length != SHA256_HEX_STR_SIZE) {
+CHARRA_RC parse_pcr_value(
+        char* start, size_t length, uint16_t digest_size, uint8_t* pcr_value) {
+    /* a byte is represented as 2 characters in a hex string + 2 bytes for the
+     * characters "0x" */
+    if (length != (size_t)digest_size * 2 + 2) {
         return CHARRA_RC_ERROR;
     }
     /* string should start with 0x */
@@ -45,7 +47,7 @@ CHARRA_RC parse_pcr_value(char* start, size_t length, uint8_t* pcr_value) {
     char* hex_start = start + 2;
 
     // iterate over all bytes of the digest
-    for (uint32_t digest_index = 0; digest_index < TPM2_SHA256_DIGEST_SIZE;
+    for (uint32_t digest_index = 0; digest_index < digest_size;
             digest_index++) {
         // hex_index is the byte in string representation at the
         // current digest_index
@@ -79,6 +81,85 @@ int parse_pcr_index(char* index_start) {
     return pcr_index;
 }
 
+/**
+ * @brief Parses the PCRs "X1[,X2...]" or "all" of a bank of a PCR selection.
+ */
+static CHARRA_RC parse_pcr_selection_bank(
+        char* pcrs, charra_rim_bank_selection* bank) {
+    uint32_t mask = 0;
+
+    if (strcmp(pcrs, "all") == 0) {
+        mask = (TPM2_MAX_PCRS < 32) ? (1u << TPM2_MAX_PCRS) - 1 : UINT32_MAX;
+    } else {
+        for (char* pcr = pcrs; pcr != NULL;) {
+            char* next = strchr(pcr, ',');
+            if (next != NULL) {
+                *next++ = '\0';
+            }
+            const int pcr_index = parse_pcr_index(pcr);
+            if (pcr_index < 0) {
+                charra_log_error("Invalid PCR '%s'.", pcr);
+                return CHARRA_RC_ERROR;
+            }
+            mask |= 1u << pcr_index;
+            pcr = next;
+        }
+    }
+
+    bank->pcrs_len = 0;
+    for (uint32_t i = 0; i < TPM2_MAX_PCRS; i++) {
+        if ((mask & (1u << i)) != 0) {
+            bank->pcrs[bank->pcrs_len++] = (uint8_t)i;
+        }
+    }
+    return CHARRA_RC_SUCCESS;
+}
+
+CHARRA_RC parse_pcr_selection(char* arg, charra_rim_selection* selection) {
+    selection->banks_len = 0;
+    for (char* bank = arg; bank != NULL;) {
+        char* next = strchr(bank, '+');
+        if (next != NULL) {
+            *next++ = '\0';
+        }
+        char* pcrs = strchr(bank, ':');
+        if (pcrs == NULL) {
+            charra_log_error("No PCRs selected for bank '%s'.", bank);
+            return CHARRA_RC_ERROR;
+        }
+        *pcrs++ = '\0';
+        const TPMI_ALG_HASH alg =
+                charra_crypto_tpm2_hash_alg_from_name(bank, strlen(bank));
+        if (alg == TPM2_ALG_ERROR) {
+            charra_log_error("Invalid PCR bank '%s'.", bank);
+            return CHARRA_RC_ERROR;
+        }
+
+        /* insert sorted by algorithm */
+        uint32_t b = selection->banks_len;
+        for (; b > 0 && selection->banks[b - 1].alg > alg; b--) {
+        }
+        if (b > 0 && selection->banks[b - 1].alg == alg) {
+            charra_log_error("PCR bank '%s' selected twice.", bank);
+            return CHARRA_RC_ERROR;
+        }
+        if (selection->banks_len == CHARRA_RIM_BANKS_MAX) {
+            charra_log_error("Too many PCR banks selected.");
+            return CHARRA_RC_ERROR;
+        }
+        memmove(&selection->banks[b + 1], &selection->banks[b],
+                (selection->banks_len - b) * sizeof(selection->banks[0]));
+        selection->banks[b].alg = alg;
+        selection->banks_len++;
+        if (parse_pcr_selection_bank(pcrs, &selection->banks[b]) !=
+                CHARRA_RC_SUCCESS) {
+            return CHARRA_RC_ERROR;
+        }
+        bank = next;
+    }
+    return CHARRA_RC_SUCCESS;
+}
+
 static charra_tap_pcr_logs_t parse_pcr_log_identifier(
         const char* const identifier) {
     if (strcmp("ima", identifier) == 0) {
@@ -91,38 +172,40 @@ static charra_tap_pcr_logs_t parse_pcr_log_identifier(
 }
 
 static CHARRA_RC parse_pcr_ima_log(const char* const log_name,
-        const char* const ima_log_path, const pcr_log_dto* const request,
+        charra_ima_index* const ima_index, const pcr_log_dto* const request,
         pcr_log_response_dto* response) {
+    uint64_t ima_log_offset = 0;
     size_t ima_log_len = 0;
-    uint8_t* ima_log = NULL;
-    if (request->start == 0 || ima_log_path == NULL ||
-            charra_io_file_exists(ima_log_path) == CHARRA_RC_ERROR) {
-        response->start = 1;
-        response->count = 0;
-        response->content_len = 0;
-        response->content = NULL;
+    uint64_t ima_log_count = 0;
+    response->start = request->start;
+    response->count = 0;
+    response->content_len = 0;
+    response->content = NULL;
+    response->content_source = (charra_tap_content_source){0};
+    if (request->start == 0 || ima_index == NULL) {
         charra_log_info("[%s] Sending empty ima log.", log_name);
         return CHARRA_RC_SUCCESS;
     }
-    // TODO: implement the actual parsing
-    charra_log_info("[%s] Reading IMA log.", log_name);
-    CHARRA_RC rc =
-            charra_io_read_file(ima_log_path, (char**)&ima_log, &ima_log_len);
+    charra_log_info("[%s] Reading IMA log entries from %" PRIu64 " (count: %"
+                    PRIu64 ").",
+            log_name, request->start, request->count);
+    CHARRA_RC rc = charra_ima_index_locate(ima_index, request->start,
+            request->count, &ima_log_offset, &ima_log_len, &ima_log_count);
     if (rc != CHARRA_RC_SUCCESS) {
         charra_log_error("[%s] Error while reading IMA log. "
                          "Sending empty log!",
                 log_name);
-        response->start = 1;
-        response->count = 0;
-        response->content_len = ima_log_len;
-        response->content = ima_log;
     } else {
-        charra_log_info(
-                "[%s] IMA log has a size of %d bytes.", log_name, ima_log_len);
-        response->start = 1;
-        response->count = 0;
+        charra_log_info("[%s] IMA log slice has %" PRIu64
+                        " entries and a size of %zu bytes.",
+                log_name, ima_log_count, ima_log_len);
+        /* the slice is read from the log when the response is encoded */
+        response->count = ima_log_count;
         response->content_len = ima_log_len;
-        response->content = ima_log;
+        response->content_source =
+                (charra_tap_content_source){.read = charra_ima_index_read_cb,
+                        .ctx = ima_index,
+                        .offset = ima_log_offset};
     }
     return rc;
 }
@@ -166,13 +249,13 @@ static CHARRA_RC parse_pcr_tcg_boot_log(const char* const log_name,
 }
 
 CHARRA_RC parse_pcr_log_request(const char* const log_name,
-        const char* const ima_log_path, const char* const tcg_boot_log_path,
+        charra_ima_index* const ima_index, const char* const tcg_boot_log_path,
         const pcr_log_dto* const request, pcr_log_response_dto* response) {
     /* TODO: handle memory allocations */
     response->identifier = request->identifier;
     switch (parse_pcr_log_identifier(request->identifier)) {
     case CHARRA_TAP_PCR_LOG_IMA:
-        return parse_pcr_ima_log(log_name, ima_log_path, request, response);
+        return parse_pcr_ima_log(log_name, ima_index, request, response);
     case CHARRA_TAP_PCR_LOG_TCG_BOOT:
         return parse_pcr_tcg_boot_log(
                 log_name, tcg_boot_log_path, request, response);
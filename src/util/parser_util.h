@@ -20,7 +20,9 @@
  */
 
 #include "../common/charra_error.h"
+#include "../core/charra_rim_mgr.h"
 #include "../core/charra_tap/charra_tap_dto.h"
+#include "ima_util.h"
 #include <stdint.h>
 
 /**
@@ -29,11 +31,14 @@
  *
  * @param start pointer to the start of the string
  * @param length length of the string
+ * @param digest_size the size of the PCR value, i.e. of the digests of its
+ * PCR bank
  * @param pcr_value pointer to an array in which the PCR value will be written.
- * Is expected to be able to hold TPM2_SHA256_DIGEST_SIZE values.
+ * Is expected to be able to hold digest_size values.
  * @returns CHARRA_RC_SUCCESS on success, otherwise CHARRA_RC_ERROR
  */
-CHARRA_RC parse_pcr_value(char* start, size_t length, uint8_t* pcr_value);
+CHARRA_RC parse_pcr_value(
+        char* start, size_t length, uint16_t digest_size, uint8_t* pcr_value);
 
 /**
  * @brief parse PCR index at the position given by index_start. Returns a
@@ -42,15 +47,28 @@ CHARRA_RC parse_pcr_value(char* start, size_t length, uint8_t* pcr_value);
  */
 int parse_pcr_index(char* index_start);
 
+/**
+ * @brief Parses a PCR selection of the form "BANK:X1[,X2...][+BANK:...]", as
+ * given to the verifier and charra-rimc, where BANK is sha1, sha256, sha384 or
+ * sha512 and the PCRs of a bank may be "all". The banks are sorted by their
+ * algorithm IDs, the order the verifier quotes them in, and the PCRs of each
+ * bank ascending. The hash algorithm of the selection is not set.
+ *
+ * @param[in,out] arg The PCR selection, split in place.
+ * @param[out] selection The PCR selection.
+ * @returns CHARRA_RC_SUCCESS on success, otherwise CHARRA_RC_ERROR
+ */
+CHARRA_RC parse_pcr_selection(char* arg, charra_rim_selection* selection);
+
 /**
  * @brief Parses a request for a PCR log into a response.
  *
  * @param[in] log_name application name for the logger
- * @param[in] ima_log_path path to the ima log file
+ * @param[in] ima_index index of the ima log, NULL if there is none
  * @param[in] tcg_boot_log_path path to the tcg-boot log file
  * @param[in] request pointer to the request
  * @param[out] response pointer to the response
  */
 CHARRA_RC parse_pcr_log_request(const char* const log_name,
-        const char* const ima_log_path, const char* const tcg_boot_log_path,
+        charra_ima_index* const ima_index, const char* const tcg_boot_log_path,
         const pcr_log_dto* const request, pcr_log_response_dto* response);
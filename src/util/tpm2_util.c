@@ -23,16 +23,98 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <tss2/tss2_common.h>
 #include <tss2/tss2_esys.h>
 #include <tss2/tss2_mu.h>
+#include <tss2/tss2_tctildr.h>
 #include <tss2/tss2_tpm2_types.h>
 
 #include "../common/charra_error.h"
 #include "../common/charra_log.h"
 #include "tpm2_tools_util.h"
 
+TSS2_RC tpm2_esys_context_init(tpm2_esys_context* ctx, const char* tcti_conf) {
+    TSS2_RC r = TSS2_RC_SUCCESS;
+    char* error_msg = NULL;
+
+    /* verify input parameters */
+    if (ctx == NULL) {
+        error_msg = "Bad ESAPI context wrapper.";
+        r = TSS2_ESYS_RC_BAD_VALUE;
+        goto error;
+    }
+
+    ctx->tcti_conf = tcti_conf;
+    ctx->tcti_ctx = NULL;
+    ctx->esys_ctx = NULL;
+
+    if ((r = Tss2_TctiLdr_Initialize(ctx->tcti_conf, &ctx->tcti_ctx)) !=
+            TSS2_RC_SUCCESS) {
+        error_msg = "Tss2_TctiLdr_Initialize.";
+        goto error;
+    }
+    if ((r = Esys_Initialize(&ctx->esys_ctx, ctx->tcti_ctx, NULL)) !=
+            TSS2_RC_SUCCESS) {
+        error_msg = "Esys_Initialize.";
+        goto error;
+    }
+
+    ctx->generation += 1;
+
+    return TSS2_RC_SUCCESS;
+
+error:
+    if (error_msg != NULL) {
+        charra_log_error("%s", error_msg);
+    }
+    if (ctx != NULL && ctx->tcti_ctx != NULL) {
+        Tss2_TctiLdr_Finalize(&ctx->tcti_ctx);
+    }
+
+    return r;
+}
+
+TSS2_RC tpm2_esys_context_reconnect(tpm2_esys_context* ctx) {
+    if (ctx == NULL) {
+        charra_log_error("Bad ESAPI context wrapper.");
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+
+    charra_log_info("Re-establishing connection to the TPM.");
+    tpm2_esys_context_finalize(ctx);
+
+    return tpm2_esys_context_init(ctx, ctx->tcti_conf);
+}
+
+bool tpm2_esys_context_is_alive(tpm2_esys_context* ctx) {
+    if (ctx == NULL || ctx->esys_ctx == NULL) {
+        return false;
+    }
+
+    TPMI_YES_NO more_data = TPM2_NO;
+    TPMS_CAPABILITY_DATA* capability_data = NULL;
+    TSS2_RC r = Esys_GetCapability(ctx->esys_ctx, ESYS_TR_NONE, ESYS_TR_NONE,
+            ESYS_TR_NONE, TPM2_CAP_TPM_PROPERTIES, TPM2_PT_MANUFACTURER, 1,
+            &more_data, &capability_data);
+    Esys_Free(capability_data);
+
+    return r == TSS2_RC_SUCCESS;
+}
+
+void tpm2_esys_context_finalize(tpm2_esys_context* ctx) {
+    if (ctx == NULL) {
+        return;
+    }
+    if (ctx->esys_ctx != NULL) {
+        Esys_Finalize(&ctx->esys_ctx);
+    }
+    if (ctx->tcti_ctx != NULL) {
+        Tss2_TctiLdr_Finalize(&ctx->tcti_ctx);
+    }
+}
+
 TSS2_RC tpm2_create_primary_key_rsa2048(
         ESYS_CONTEXT* ctx, ESYS_TR* primary_handle, TPM2B_PUBLIC** out_public) {
     TSS2_RC r = TSS2_RC_SUCCESS;
@@ -231,6 +313,154 @@ error:
     return r;
 }
 
+/* attempts to read a PCR selection without the PCRs being extended */
+#define TPM2_PCR_READ_ATTEMPTS 3
+
+/**
+ * @brief Checks whether any PCR is left in \a selection.
+ */
+static bool tpm2_pcr_selection_pending(const TPML_PCR_SELECTION* selection) {
+    for (uint32_t b = 0; b < selection->count; b++) {
+        const TPMS_PCR_SELECTION* bank = &selection->pcrSelections[b];
+        for (uint32_t i = 0; i < bank->sizeofSelect; i++) {
+            if (bank->pcrSelect[i] != 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Appends the PCR values of one TPM2_PCR_Read response to \a state
+ * and removes the PCRs read from its remaining selection.
+ */
+static TSS2_RC tpm2_pcr_read_collect(tpm2_pcr_read_state* state,
+        const TPML_PCR_SELECTION* selection_out, const TPML_DIGEST* values) {
+    /* the values are ordered as the PCRs read */
+    uint32_t v = 0;
+    for (uint32_t b = 0; b < selection_out->count; b++) {
+        const TPMS_PCR_SELECTION* read = &selection_out->pcrSelections[b];
+        TPMS_PCR_SELECTION* left = NULL;
+        for (uint32_t i = 0; i < state->remaining.count; i++) {
+            if (state->remaining.pcrSelections[i].hash == read->hash) {
+                left = &state->remaining.pcrSelections[i];
+            }
+        }
+        for (uint32_t pcr = 0; pcr < 8u * read->sizeofSelect; pcr++) {
+            if ((read->pcrSelect[pcr / 8] & (1u << (pcr % 8))) == 0) {
+                continue;
+            }
+            if (v == values->count ||
+                    state->pcr_values_len == state->pcr_values_cap ||
+                    left == NULL) {
+                charra_log_error("Unexpected PCR values read.");
+                return TSS2_ESYS_RC_BAD_VALUE;
+            }
+            state->pcr_values[state->pcr_values_len] = (tpm2_pcr_value){
+                    .hash = read->hash,
+                    .pcr = (uint8_t)pcr,
+                    .value = values->digests[v++],
+            };
+            state->pcr_values_len += 1;
+            left->pcrSelect[pcr / 8] &= (uint8_t)~(1u << (pcr % 8));
+        }
+    }
+
+    return TSS2_RC_SUCCESS;
+}
+
+TSS2_RC tpm2_pcr_read_async(ESYS_CONTEXT* ctx,
+        const TPML_PCR_SELECTION* pcr_selection, size_t pcr_values_cap,
+        tpm2_pcr_value* pcr_values, tpm2_pcr_read_state* state) {
+    TSS2_RC r = TSS2_RC_SUCCESS;
+
+    /* verify input parameters */
+    if (ctx == NULL) {
+        charra_log_error("Bad ESAPI context.");
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+
+    *state = (tpm2_pcr_read_state){
+            .selection = *pcr_selection,
+            .remaining = *pcr_selection,
+            .pcr_values_cap = pcr_values_cap,
+            .pcr_values = pcr_values,
+    };
+
+    /* send the first TPM2_PCR_Read command */
+    if ((r = Esys_PCR_Read_Async(ctx, ESYS_TR_NONE, ESYS_TR_NONE,
+                 ESYS_TR_NONE, &state->remaining)) != TSS2_RC_SUCCESS) {
+        charra_log_error("Esys_PCR_Read_Async");
+    }
+
+    return r;
+}
+
+TSS2_RC tpm2_pcr_read_finish(ESYS_CONTEXT* ctx, tpm2_pcr_read_state* state) {
+    TSS2_RC r = TSS2_RC_SUCCESS;
+    TPML_PCR_SELECTION* selection_out = NULL;
+    TPML_DIGEST* values = NULL;
+    UINT32 counter = 0;
+
+    /* verify input parameters */
+    if (ctx == NULL) {
+        charra_log_error("Bad ESAPI context.");
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+
+    /* receive the TPM2_PCR_Read response */
+    r = Esys_PCR_Read_Finish(ctx, &counter, &selection_out, &values);
+    if (r == TSS2_ESYS_RC_TRY_AGAIN) {
+        /* TPM still busy */
+        return r;
+    } else if (r != TSS2_RC_SUCCESS) {
+        charra_log_error("Esys_PCR_Read_Finish");
+        return r;
+    }
+
+    if (state->commands > 0 && counter != state->update_counter) {
+        /* PCRs extended in between commands, read them again from the start */
+        if (++state->attempts == TPM2_PCR_READ_ATTEMPTS) {
+            charra_log_error("PCRs kept changing while being read.");
+            r = TPM2_RC_RETRY;
+            goto cleanup;
+        }
+        charra_log_debug("PCRs changed while being read, reading them again.");
+        state->remaining = state->selection;
+        state->commands = 0;
+        state->pcr_values_len = 0;
+    } else {
+        state->update_counter = counter;
+        state->commands += 1;
+        if (values->count == 0) {
+            /* all PCRs the TPM implements have been read */
+            goto cleanup;
+        }
+        if ((r = tpm2_pcr_read_collect(state, selection_out, values)) !=
+                TSS2_RC_SUCCESS) {
+            goto cleanup;
+        }
+        if (!tpm2_pcr_selection_pending(&state->remaining)) {
+            goto cleanup;
+        }
+    }
+
+    /* the TPM returns at most eight values per command, read the rest */
+    if ((r = Esys_PCR_Read_Async(ctx, ESYS_TR_NONE, ESYS_TR_NONE,
+                 ESYS_TR_NONE, &state->remaining)) != TSS2_RC_SUCCESS) {
+        charra_log_error("Esys_PCR_Read_Async");
+        goto cleanup;
+    }
+    r = TSS2_ESYS_RC_TRY_AGAIN;
+
+cleanup:
+    Esys_Free(selection_out);
+    Esys_Free(values);
+
+    return r;
+}
+
 TSS2_RC tpm2_get_random(
         ESYS_CONTEXT* ctx, const uint32_t len, TPM2B_DIGEST** random_bytes) {
     TSS2_RC r = TSS2_RC_SUCCESS;
@@ -308,3 +538,63 @@ error:
 
     return r;
 }
+
+TSS2_RC tpm2_quote_async(ESYS_CONTEXT* ctx, const ESYS_TR sign_key_handle,
+        const TPML_PCR_SELECTION* pcr_selection,
+        const TPM2B_DATA* qualifying_data) {
+    TSS2_RC r = TSS2_RC_SUCCESS;
+    char* error_msg = NULL;
+
+    /* verify input parameters */
+    if (ctx == NULL) {
+        error_msg = "Bad ESAPI context.";
+        r = TSS2_ESYS_RC_BAD_VALUE;
+        goto error;
+    }
+
+    /* check whether size limit is exceeded */
+    if (qualifying_data->size > sizeof(TPMT_HA)) {
+        error_msg = "Size of qualifying data exceeded (max = sizeof(TPMT_HA)";
+        r = TSS2_ESYS_RC_BAD_VALUE;
+        goto error;
+    }
+
+    /* send the TPM quote command */
+    TPMT_SIG_SCHEME sig_scheme = {.scheme = TPM2_ALG_NULL};
+    r = Esys_Quote_Async(ctx, sign_key_handle, ESYS_TR_PASSWORD, ESYS_TR_NONE,
+            ESYS_TR_NONE, qualifying_data, &sig_scheme, pcr_selection);
+    /* ERROR CHECK */
+    if (r != TSS2_RC_SUCCESS) {
+        error_msg = "Esys_Quote_Async";
+        goto error;
+    }
+
+    return TSS2_RC_SUCCESS;
+
+error:
+    if (error_msg != NULL) {
+        charra_log_error("%s", error_msg);
+    }
+
+    return r;
+}
+
+TSS2_RC tpm2_quote_finish(ESYS_CONTEXT* ctx, TPM2B_ATTEST** attest_buf,
+        TPMT_SIGNATURE** signature) {
+    TSS2_RC r = TSS2_RC_SUCCESS;
+
+    /* verify input parameters */
+    if (ctx == NULL) {
+        charra_log_error("Bad ESAPI context.");
+        return TSS2_ESYS_RC_BAD_VALUE;
+    }
+
+    /* receive the TPM quote response */
+    r = Esys_Quote_Finish(ctx, attest_buf, signature);
+    /* ERROR CHECK (TRY_AGAIN just means the TPM is still busy) */
+    if (r != TSS2_RC_SUCCESS && r != TSS2_ESYS_RC_TRY_AGAIN) {
+        charra_log_error("Esys_Quote_Finish");
+    }
+
+    return r;
+}
@@ -25,9 +25,58 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <tss2/tss2_esys.h>
+#include <tss2/tss2_tcti.h>
 
 #include "../common/charra_error.h"
 
+/**
+ * @brief A long-lived ESAPI context together with the TCTI context it was
+ * created on. Owned by the caller and re-established on connection loss.
+ */
+typedef struct {
+    const char* tcti_conf;
+    TSS2_TCTI_CONTEXT* tcti_ctx;
+    ESYS_CONTEXT* esys_ctx;
+    /* incremented each time the connection is (re-)established */
+    uint32_t generation;
+} tpm2_esys_context;
+
+/**
+ * @brief Initializes the TCTI and ESAPI contexts of \a ctx.
+ *
+ * @param[out] ctx The context to initialize.
+ * @param[in] tcti_conf The TCTI configuration string (e.g. from the
+ * CHARRA_TCTI environment variable), or NULL for the TCTI loader default.
+ * @return TSS2_RC The TSS return code.
+ */
+TSS2_RC tpm2_esys_context_init(tpm2_esys_context* ctx, const char* tcti_conf);
+
+/**
+ * @brief Tears down the TCTI and ESAPI contexts of \a ctx and establishes
+ * new ones using the TCTI configuration given at initialization. All ESYS_TR
+ * handles obtained from the old context become invalid.
+ *
+ * @param[in,out] ctx The context to reconnect.
+ * @return TSS2_RC The TSS return code.
+ */
+TSS2_RC tpm2_esys_context_reconnect(tpm2_esys_context* ctx);
+
+/**
+ * @brief Checks whether the TPM is reachable through \a ctx by issuing a
+ * cheap TPM2_GetCapability command.
+ *
+ * @param[in,out] ctx The context to check.
+ * @return true if the TPM responded, false otherwise.
+ */
+bool tpm2_esys_context_is_alive(tpm2_esys_context* ctx);
+
+/**
+ * @brief Finalizes the ESAPI and TCTI contexts of \a ctx.
+ *
+ * @param[in,out] ctx The context to finalize.
+ */
+void tpm2_esys_context_finalize(tpm2_esys_context* ctx);
+
 /**
  * @brief Creates a primary key in the endorsement/user hierarchy in the TPM.
  *
@@ -94,6 +143,65 @@ TSS2_RC tpm2_store_key_in_nvram(ESYS_CONTEXT* ctx, const ESYS_TR* key_handle);
 TSS2_RC tpm2_pcr_extend(ESYS_CONTEXT* ctx, const uint32_t pcr_idx,
         const TPML_DIGEST_VALUES* digests);
 
+/**
+ * @brief The value of one PCR of one bank.
+ */
+typedef struct {
+    TPMI_ALG_HASH hash;
+    uint8_t pcr;
+    TPM2B_DIGEST value;
+} tpm2_pcr_value;
+
+/**
+ * @brief The state of a PCR read started with tpm2_pcr_read_async().
+ */
+typedef struct {
+    /* the PCRs to read, and those not read yet in the current attempt */
+    TPML_PCR_SELECTION selection;
+    TPML_PCR_SELECTION remaining;
+    /* PCR update counter of the first response of the current attempt */
+    UINT32 update_counter;
+    uint32_t commands;
+    uint32_t attempts;
+    size_t pcr_values_cap;
+    tpm2_pcr_value* pcr_values;
+    size_t pcr_values_len;
+} tpm2_pcr_read_state;
+
+/**
+ * @brief Starts reading the values of the selected PCRs without waiting for
+ * the TPM. The result is collected with tpm2_pcr_read_finish().
+ *
+ * @param ctx[in,out] The ESAPI context.
+ * @param pcr_selection[in] The PCR selection.
+ * @param pcr_values_cap[in] The capacity of \a pcr_values.
+ * @param pcr_values[out] The buffer receiving the PCR values, must stay valid
+ * until the read is finished.
+ * @param state[out] The state of the read.
+ * @return TSS2_RC The TSS return code.
+ */
+TSS2_RC tpm2_pcr_read_async(ESYS_CONTEXT* ctx,
+        const TPML_PCR_SELECTION* pcr_selection, size_t pcr_values_cap,
+        tpm2_pcr_value* pcr_values, tpm2_pcr_read_state* state);
+
+/**
+ * @brief Collects a response of a PCR read started with tpm2_pcr_read_async().
+ * The TPM returns at most eight values per command, so larger selections are
+ * read in several commands, each started by this function; if the PCRs are
+ * extended in between, they are read again from the start. PCRs of banks the
+ * TPM does not implement are left out. Waits at most as long as configured
+ * with Esys_SetTimeout().
+ *
+ * On success, state->pcr_values holds state->pcr_values_len values, bank by
+ * bank in the order of the PCR selection and by ascending PCR.
+ *
+ * @param ctx[in,out] The ESAPI context.
+ * @param state[in,out] The state of the read.
+ * @return TSS2_RC The TSS return code; TSS2_ESYS_RC_TRY_AGAIN if the read has
+ * not finished yet; TPM2_RC_RETRY if the PCRs kept changing while being read.
+ */
+TSS2_RC tpm2_pcr_read_finish(ESYS_CONTEXT* ctx, tpm2_pcr_read_state* state);
+
 /**
  * @brief Generates random bytes using the TPM 2.0.
  *
@@ -122,4 +230,33 @@ TSS2_RC tpm2_quote(ESYS_CONTEXT* ctx, const ESYS_TR sign_key_handle,
         const TPM2B_DATA* qualifyingData, TPM2B_ATTEST** attest,
         TPMT_SIGNATURE** signature);
 
+/**
+ * @brief Starts a TPM quote operation without waiting for the TPM. The result
+ * is collected with tpm2_quote_finish().
+ *
+ * @param ctx[in,out] The ESAPI context.
+ * @param sign_key_handle[in] The TPM2 handle of the signature key.
+ * @param pcr_selection[in] The PCR selection
+ * @param qualifying_data[in] The qualifying data, such as a nonce for
+ * freshness.
+ * @return TSS2_RC The TSS return code.
+ */
+TSS2_RC tpm2_quote_async(ESYS_CONTEXT* ctx, const ESYS_TR sign_key_handle,
+        const TPML_PCR_SELECTION* pcr_selection,
+        const TPM2B_DATA* qualifying_data);
+
+/**
+ * @brief Collects the result of a TPM quote operation started with
+ * tpm2_quote_async(). Waits at most as long as configured with
+ * Esys_SetTimeout().
+ *
+ * @param ctx[in,out] The ESAPI context.
+ * @param attest[out] The attestation data structure.
+ * @param signature[out] The TPM2 signature over \a attest->attestationData.
+ * @return TSS2_RC The TSS return code; TSS2_ESYS_RC_TRY_AGAIN if the TPM has
+ * not finished yet.
+ */
+TSS2_RC tpm2_quote_finish(
+        ESYS_CONTEXT* ctx, TPM2B_ATTEST** attest, TPMT_SIGNATURE** signature);
+
 #endif /* TPM2_UTIL_H */
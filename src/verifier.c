@@ -22,6 +22,7 @@
 #include <arpa/inet.h>
 #include <coap3/coap.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -33,8 +34,14 @@
 
 #include "common/charra_log.h"
 #include "common/charra_macro.h"
+#include "core/charra_allowlist.h"
+#include "core/charra_appraisal_state.h"
+#include "core/charra_ima_log.h"
 #include "core/charra_key_mgr.h"
 #include "core/charra_rim_mgr.h"
+#include "core/charra_rim_reload.h"
+#include "core/charra_tcg_boot_log.h"
+#include "core/charra_timer_wheel.h"
 #include "core/charra_tap/charra_tap_cbor.h"
 #include "core/charra_tap/charra_tap_dto.h"
 #include "util/charra_util.h"
@@ -51,7 +58,6 @@
 
 /* quit signal */
 static bool quit = false;
-static bool processing_response = false;
 static CHARRA_RC attestation_rc = CHARRA_RC_ERROR;
 
 /* logging */
@@ -64,14 +70,10 @@ charra_log_t charra_log_level = CHARRA_LOG_INFO;
 char dst_host[16] = "127.0.0.1";      // 15 characters for IPv4 plus \0
 unsigned int dst_port = 5683;         // default port
 #define COAP_IO_PROCESS_TIME_MS 2000  // CoAP IO process time in milliseconds
-#define PERIODIC_ATTESTATION_WAIT_TIME_S                                       \
-    2  // Wait time between attestations in seconds
 static const bool USE_TPM_FOR_RANDOM_NONCE_GENERATION = false;
 
 #define TPM_SIG_KEY_ID_LEN 14
 #define TPM_SIG_KEY_ID "PK.RSA.default"
-// TODO: Make PCR selection configurable via CLI
-// TODO: Implement integration of all PCR banks
 static uint8_t tpm_pcr_selection[TPM2_PCR_BANK_COUNT][TPM2_MAX_PCRS] = {
         /* sha1 */
         {0},
@@ -85,10 +87,21 @@ static uint32_t tpm_pcr_selection_len[TPM2_PCR_BANK_COUNT] = {0,  // sha1
         9,                                                        // sha256
         0,                                                        // sha384
         0};                                                       // sha512
+/* PCR banks in the order of tpm_pcr_selection */
+static const TPMI_ALG_HASH tpm_pcr_banks[TPM2_PCR_BANK_COUNT] = {
+        TPM2_ALG_SHA1, TPM2_ALG_SHA256, TPM2_ALG_SHA384, TPM2_ALG_SHA512};
 uint16_t attestation_response_timeout =
         30;  // timeout when waiting for attestation answer in seconds
+uint32_t attestation_interval_s = 0;       // 0 attests once
+uint32_t attestation_jitter_percent = 10;  // randomization of the intervals
+uint32_t attestation_max_backoff_s = 600;  // longest interval after failures
+cli_config_verifier_target targets[CLI_UTIL_MAX_TARGETS] = {0};
+uint32_t targets_len = 0;  // 0 attests dst_host only
 char* reference_pcr_file_path = NULL;
+charra_rim_format reference_pcr_file_format = CHARRA_RIM_FORMAT_YAML;
 char* attestation_public_key_path = NULL;
+char* ima_allowlist_path = NULL;
+bool disclose_pcr_values = false;
 cli_config_signature_hash_algorithm signature_hash_algorithm = {
         .mbedtls_hash_algorithm = MBEDTLS_MD_SHA256,
         .tpm2_hash_algorithm = TPM2_ALG_SHA256};
@@ -118,18 +131,168 @@ pcr_log_dto pcr_logs[SUPPORTED_PCR_LOGS_COUNT] = {0};
  */
 static void handle_sigint(int signum);
 
-static CHARRA_RC create_attestation_request(
+/**
+ * @brief Builds the PCR selection over all banks with selected PCRs, in the
+ * order they are requested and quoted in, and with the hash algorithm of the
+ * quote's signature for the composite digest.
+ *
+ * @param selection the PCR selection.
+ */
+static void build_pcr_selection(charra_rim_selection* selection);
+
+/**
+ * @brief An attester attested in rounds, each an attestation request and its
+ * response. Rounds are started and timed out by timers, so that any number
+ * of attesters are attested with their own intervals in one I/O loop.
+ */
+typedef struct {
+    char host[16];  // 15 characters for IPv4 plus \0
+    uint16_t port;
+    /* time between rounds, 0 to attest once */
+    uint32_t interval_ms;
+    /* session kept across rounds, connected anew after failed rounds */
+    coap_session_t* session;
+    bool reconnect;
+    /* request of the round in flight, whose nonce the response must carry */
+    bool in_flight;
+    charra_tap_msg_attestation_request_dto request;
+    uint8_t* request_buf;
+    /* rounds in a row that ended without an attestation result */
+    uint32_t failures;
+    /* result of the last round */
+    CHARRA_RC rc;
+    /* starts the next round, ends the round in flight on timeout */
+    charra_timer round_timer;
+    charra_timer deadline_timer;
+} verifier_target;
+
+/**
+ * @brief Returns the time of the monotonic clock of libcoap in milliseconds.
+ */
+static uint64_t verifier_now_ms(void);
+
+/**
+ * @brief Creates a CoAP client session to a target, using DTLS if configured.
+ *
+ * @param target the target.
+ * @return the session, NULL on errors.
+ */
+static coap_session_t* verifier_new_session(verifier_target* target);
+
+/**
+ * @brief Timer callback starting a round: sends a new attestation request to
+ * the target and arms the deadline of the response.
+ */
+static void verifier_start_round(charra_timer* timer, void* data);
+
+/**
+ * @brief Timer callback ending the round in flight if the response did not
+ * arrive before the deadline.
+ */
+static void verifier_round_timeout(charra_timer* timer, void* data);
+
+/**
+ * @brief Ends the round in flight of a target and schedules the next one,
+ * backing off if the round ended without an attestation result.
+ *
+ * @param target the target.
+ * @param rc the result of the round.
+ */
+static void verifier_end_round(verifier_target* target, CHARRA_RC rc);
+
+/**
+ * @brief Ends the round in flight of a target without a result and runs it
+ * again after \a delay_ms, without counting a failure. Also repeats rounds
+ * of single attestations.
+ *
+ * @param target the target.
+ * @param delay_ms the time until the round is run again, in milliseconds.
+ */
+static void verifier_retry_round(verifier_target* target, uint32_t delay_ms);
+
+/**
+ * @brief Returns the time until the next round of a target: its interval,
+ * doubled for each failed round in a row up to the maximum backoff, and
+ * randomized by the jitter.
+ *
+ * @param target the target.
+ * @return the delay in milliseconds.
+ */
+static uint32_t verifier_next_delay_ms(const verifier_target* target);
+
+/**
+ * @brief Returns whether any target has a round in flight or scheduled.
+ */
+static bool verifier_rounds_pending(void);
+
+/**
+ * @brief Returns a random number below \a bound, 0 if no random bytes can be
+ * generated.
+ */
+static uint64_t verifier_random(uint64_t bound);
+
+static CHARRA_RC create_attestation_request(const verifier_target* target,
         charra_tap_msg_attestation_request_dto* attestation_request);
 
+/**
+ * @brief Creates, marshals and sends the attestation request of a new round,
+ * reusing the session of the target.
+ *
+ * @param target the target.
+ * @return CHARRA_RC_SUCCESS on success.
+ */
+static CHARRA_RC send_attestation_request(verifier_target* target);
+
+/**
+ * @brief Maps the PCR values disclosed by the attester to the PCR selection
+ * and checks that they produce the PCR digest of the quote.
+ *
+ * @param pcr_values the disclosed PCR values.
+ * @param attest_struct the attestation data including the PCR digest.
+ * @param mapped the values indexed by bank of pcr_selection and PCR: PCR i of
+ * the b-th bank at mapped[b * TPM2_MAX_PCRS + i].
+ * @return true if all selected PCRs are disclosed and produce the PCR digest.
+ * @return false otherwise, e.g. if the PCRs were extended after the quote.
+ */
+static bool map_pcr_values(const charra_tap_tpm2_pcr_values_dto* pcr_values,
+        const TPMS_ATTEST* attest_struct, const uint8_t** mapped);
+
 static coap_response_t coap_attest_handler(coap_session_t* session,
         const coap_pdu_t* sent, const coap_pdu_t* received,
         const coap_mid_t mid);
 
 /* --- static variables --------------------------------------------------- */
 
-static charra_tap_msg_attestation_request_dto last_request = {0};
 static charra_tap_msg_attestation_response_dto last_response = {0};
 
+/* attesters to attest and the timers of their rounds */
+static verifier_target verifier_targets[CLI_UTIL_MAX_TARGETS] = {0};
+static uint32_t verifier_targets_len = 0;
+static charra_timer_wheel verifier_timers = {0};
+
+/* CoAP context and request options shared by all targets */
+static coap_context_t* coap_context = NULL;
+static coap_optlist_t* coap_options = NULL;
+
+/* expected PCR values replayed from the last tcg-boot log */
+static charra_tcg_boot_replay boot_replay = {0};
+
+/* PCR logs requested, the IMA log continuing from the last appraisal */
+static pcr_log_dto request_pcr_logs[SUPPORTED_PCR_LOGS_COUNT] = {0};
+
+/* sets of reference PCRs, reloaded when reference_pcr_file_path changes */
+static charra_rim_reload reference_pcrs = {0};
+static charra_rim_matcher reference_pcrs_matcher = {0};
+
+/* PCR selection of the attestation requests over all banks */
+static charra_rim_selection pcr_selection = {0};
+
+/* allowlist IMA file digests are appraised against */
+static charra_allowlist ima_allowlist = {0};
+
+/* state of the last successful appraisal of each attester */
+static charra_appraisal_states appraisal_states = {0};
+
 /* --- main --------------------------------------------------------------- */
 
 int main(int argc, char** argv) {
@@ -169,12 +332,20 @@ int main(int argc, char** argv) {
             .timeout = &attestation_response_timeout,
             .attestation_public_key_path = &attestation_public_key_path,
             .reference_pcr_file_path = &reference_pcr_file_path,
+            .reference_pcr_file_format = &reference_pcr_file_format,
             .tpm_pcr_selection = tpm_pcr_selection,
             .tpm_pcr_selection_len = tpm_pcr_selection_len,
             .dtls_psk_identity = &dtls_psk_identity,
             .signature_hash_algorithm = &signature_hash_algorithm,
             .pcr_log_len = &pcr_log_len,
-            .pcr_logs = &pcr_logs
+            .pcr_logs = &pcr_logs,
+            .ima_allowlist_path = &ima_allowlist_path,
+            .disclose_pcr_values = &disclose_pcr_values,
+            .targets = &targets,
+            .targets_len = &targets_len,
+            .interval_s = &attestation_interval_s,
+            .jitter_percent = &attestation_jitter_percent,
+            .max_backoff_s = &attestation_max_backoff_s,
         },
     };
     /* clang-format on */
@@ -194,23 +365,59 @@ int main(int argc, char** argv) {
     charra_log_set_level(charra_log_level);
     coap_set_log_level(coap_log_level);
 
+    /* attest the targets given, or else the destination host */
+    if (targets_len == 0) {
+        strcpy(targets[0].host, dst_host);
+        targets_len = 1;
+    }
+    for (uint32_t i = 0; i < targets_len; i++) {
+        verifier_target* target = &verifier_targets[i];
+        const unsigned int port =
+                (targets[i].port != 0) ? targets[i].port : dst_port;
+        const uint32_t interval_s = (targets[i].interval_s != 0)
+                                            ? targets[i].interval_s
+                                            : attestation_interval_s;
+        strcpy(target->host, targets[i].host);
+        target->port = (uint16_t)port;
+        target->interval_ms = interval_s * 1000;
+        target->rc = CHARRA_RC_ERROR;
+    }
+    verifier_targets_len = targets_len;
+
     charra_log_debug("[" LOG_NAME "] Verifier Configuration:");
-    charra_log_debug("[" LOG_NAME "]     Destination port: %d", dst_port);
-    charra_log_debug("[" LOG_NAME "]     Destination host: %s", dst_host);
+    for (uint32_t i = 0; i < verifier_targets_len; i++) {
+        charra_log_debug("[" LOG_NAME "]     Target: %s:%" PRIu16
+                         ", interval: %" PRIu32 " ms",
+                verifier_targets[i].host, verifier_targets[i].port,
+                verifier_targets[i].interval_ms);
+    }
+    charra_log_debug("[" LOG_NAME "]     Interval jitter: %" PRIu32 "%%",
+            attestation_jitter_percent);
+    charra_log_debug("[" LOG_NAME "]     Maximum backoff: %" PRIu32 "s",
+            attestation_max_backoff_s);
     charra_log_debug("[" LOG_NAME
                      "]     Timeout when waiting for attestation response: %ds",
             attestation_response_timeout);
     charra_log_debug("[" LOG_NAME "]     Reference PCR file path: '%s'",
             reference_pcr_file_path);
-    charra_log_debug("[" LOG_NAME "]     PCR selection with length %d:",
-            tpm_pcr_selection_len);
-    charra_log_log_raw(CHARRA_LOG_DEBUG,
-            "                                                      ");
-    for (uint32_t i = 0; i < tpm_pcr_selection_len[1]; i++) {
-        if (i != tpm_pcr_selection_len[1] - 1) {
-            charra_log_log_raw(CHARRA_LOG_DEBUG, "%d, ", tpm_pcr_selection[i]);
-        } else {
-            charra_log_log_raw(CHARRA_LOG_DEBUG, "%d\n", tpm_pcr_selection[i]);
+    charra_log_debug("[" LOG_NAME "]     IMA allowlist path: '%s'",
+            (ima_allowlist_path != NULL) ? ima_allowlist_path : "");
+    charra_log_debug("[" LOG_NAME "]     Ask for PCR values: %s",
+            disclose_pcr_values ? "true" : "false");
+    build_pcr_selection(&pcr_selection);
+    for (uint32_t b = 0; b < pcr_selection.banks_len; b++) {
+        const charra_rim_bank_selection* bank = &pcr_selection.banks[b];
+        charra_log_debug("[" LOG_NAME "]     PCR selection of bank 0x%04x "
+                         "with length %d:",
+                bank->alg, bank->pcrs_len);
+        charra_log_log_raw(CHARRA_LOG_DEBUG,
+                "                                                      ");
+        for (uint32_t i = 0; i < bank->pcrs_len; i++) {
+            if (i != bank->pcrs_len - 1) {
+                charra_log_log_raw(CHARRA_LOG_DEBUG, "%d, ", bank->pcrs[i]);
+            } else {
+                charra_log_log_raw(CHARRA_LOG_DEBUG, "%d\n", bank->pcrs[i]);
+            }
         }
     }
     charra_log_debug("[" LOG_NAME "]     DTLS with PSK enabled: %s",
@@ -232,13 +439,6 @@ int main(int argc, char** argv) {
                 dtls_rpk_peer_public_key_path);
     }
 
-    /* set varaibles here such that they are valid in case of an 'goto cleanup'
-     */
-    coap_context_t* coap_context = NULL;
-    coap_session_t* coap_session = NULL;
-    coap_optlist_t* coap_options = NULL;
-    uint8_t* req_buf = NULL;  // TODO(any): make dynamic
-
     if (use_dtls_psk && use_dtls_rpk) {
         charra_log_error(
                 "[" LOG_NAME "] Configuration enables both DTSL with PSK "
@@ -246,6 +446,26 @@ int main(int argc, char** argv) {
         goto cleanup;
     }
 
+    /* load reference PCRs and watch them for changes */
+    if ((result = charra_rim_reload_start(&reference_pcrs,
+                 reference_pcr_file_path, reference_pcr_file_format,
+                 &pcr_selection)) != CHARRA_RC_SUCCESS ||
+            (result = charra_rim_matcher_init(&reference_pcrs_matcher,
+                     &reference_pcrs)) != CHARRA_RC_SUCCESS) {
+        goto cleanup;
+    }
+
+    /* map IMA allowlist */
+    if (ima_allowlist_path != NULL) {
+        if ((result = charra_allowlist_open(ima_allowlist_path,
+                     &ima_allowlist)) != CHARRA_RC_SUCCESS) {
+            goto cleanup;
+        }
+        charra_log_info("[" LOG_NAME "] Using IMA allowlist '%s' with %" PRIu64
+                        " digests.",
+                ima_allowlist_path, ima_allowlist.count);
+    }
+
     if (use_dtls_psk || use_dtls_rpk) {
         // print TLS version when in debug mode
         coap_show_tls_version(LOG_DEBUG);
@@ -270,59 +490,6 @@ int main(int argc, char** argv) {
     charra_log_info("[" LOG_NAME "] Registering CoAP response handler.");
     coap_register_response_handler(coap_context, coap_attest_handler);
 
-    if (use_dtls_psk) {
-        charra_log_info("[" LOG_NAME
-                        "] Creating CoAP client session using DTLS with PSK.");
-        if ((coap_session = charra_coap_new_client_session_psk(coap_context,
-                     dst_host, dst_port, COAP_PROTO_DTLS, dtls_psk_identity,
-                     (uint8_t*)dtls_psk_key, strlen(dtls_psk_key))) == NULL) {
-            charra_log_error(
-                    "[" LOG_NAME
-                    "] Cannot create client session based on DTLS-PSK.");
-            result = CHARRA_RC_ERROR;
-            goto cleanup;
-        }
-    } else if (use_dtls_rpk) {
-        charra_log_info(
-                "[" LOG_NAME "] Creating CoAP client session using DTLS-RPK.");
-        coap_dtls_pki_t dtls_pki = {0};
-
-        result = charra_coap_setup_dtls_pki_for_rpk(&dtls_pki,
-                dtls_rpk_private_key_path, dtls_rpk_public_key_path,
-                dtls_rpk_peer_public_key_path, dtls_rpk_verify_peer_public_key);
-        if (result != CHARRA_RC_SUCCESS) {
-            charra_log_error("[" LOG_NAME
-                             "] Error while setting up DTLS-RPK structure.");
-            goto cleanup;
-        }
-
-        if ((coap_session = charra_coap_new_client_session_pki(coap_context,
-                     dst_host, dst_port, COAP_PROTO_DTLS, &dtls_pki)) == NULL) {
-            charra_log_error(
-                    "[" LOG_NAME
-                    "] Cannot create client session based on DTLS-RPK.");
-            result = CHARRA_RC_ERROR;
-            goto cleanup;
-        }
-    } else {
-        charra_log_info(
-                "[" LOG_NAME "] Creating CoAP client session using UDP.");
-        if ((coap_session = charra_coap_new_client_session(coap_context,
-                     dst_host, dst_port, COAP_PROTO_UDP)) == NULL) {
-            charra_log_error("[" LOG_NAME
-                             "] Cannot create client session based on UDP.");
-            result = CHARRA_RC_COAP_ERROR;
-            goto cleanup;
-        }
-    }
-
-    /* define needed variables */
-    charra_tap_msg_attestation_request_dto req = {0};
-    uint32_t req_buf_len = 0;
-    coap_pdu_t* pdu = NULL;
-    coap_mid_t mid = COAP_INVALID_MID;
-    int coap_io_process_time = -1;
-
     /* create CoAP option for content type */
     uint8_t coap_mediatype_cbor_buf[4] = {0};
     unsigned int coap_mediatype_cbor_buf_len = 0;
@@ -335,37 +502,6 @@ int main(int argc, char** argv) {
         goto cleanup;
     }
 
-    /* enter  periodic attestation loop */
-    // TODO(any): Enable periodic attestations.
-    // charra_log_info("[" LOG_NAME "] Entering periodic attestation loop.");
-    // while (!quit) {
-    //     /* cleanup */
-    //     memset(&req, 0, sizeof(req));
-    //     if (coap_options != NULL) {
-    //         coap_delete_optlist(coap_options);
-    //         coap_options = NULL;
-    //     }
-
-    /* create attestation request */
-    charra_log_info("[" LOG_NAME "] Creating attestation request.");
-    if ((result = create_attestation_request(&req)) != CHARRA_RC_SUCCESS) {
-        charra_log_error("[" LOG_NAME "] Cannot create attestation request.");
-        goto cleanup;
-    } else {
-        /* store request data */
-        last_request = req;
-    }
-
-    /* marshal attestation request */
-    charra_log_info(
-            "[" LOG_NAME "] Marshaling attestation request data to CBOR.");
-    if ((result = charra_tap_marshal_attestation_request(
-                 &req, &req_buf_len, &req_buf)) != CHARRA_RC_SUCCESS) {
-        charra_log_error(
-                "[" LOG_NAME "] Marshaling attestation request data failed.");
-        goto cleanup;
-    }
-
     /* CoAP options */
     charra_log_info("[" LOG_NAME "] Adding CoAP option URI_PATH.");
     if (coap_insert_optlist(
@@ -385,74 +521,62 @@ int main(int argc, char** argv) {
         goto cleanup;
     }
 
-    /* new CoAP request PDU */
-    charra_log_info("[" LOG_NAME "] Creating request PDU.");
-    if ((pdu = charra_coap_new_request(coap_session, COAP_MESSAGE_CON,
-                 COAP_REQUEST_CODE_FETCH, &coap_options, req_buf,
-                 req_buf_len)) == NULL) {
-        charra_log_error("[" LOG_NAME "] Cannot create request PDU.");
-        result = CHARRA_RC_ERROR;
-        goto cleanup;
+    /* schedule the first round of each target, spread over its jitter */
+    charra_timer_wheel_init(&verifier_timers, verifier_now_ms());
+    for (uint32_t i = 0; i < verifier_targets_len; i++) {
+        verifier_target* target = &verifier_targets[i];
+        charra_timer_init(&target->round_timer, verifier_start_round, target);
+        charra_timer_init(
+                &target->deadline_timer, verifier_round_timeout, target);
+        const uint64_t spread_ms = (uint64_t)target->interval_ms *
+                                   attestation_jitter_percent / 100;
+        charra_timer_wheel_add(&verifier_timers, &target->round_timer,
+                verifier_timers.now_ms + verifier_random(spread_ms + 1));
     }
 
-    /* set timeout length */
-    coap_fixed_point_t coap_timeout = {attestation_response_timeout, 0};
-    coap_session_set_ack_timeout(coap_session, coap_timeout);
-
-    /* send CoAP PDU */
-    charra_log_info("[" LOG_NAME "] Sending CoAP message.");
-    if ((mid = coap_send_large(coap_session, pdu)) == COAP_INVALID_MID) {
-        charra_log_error("[" LOG_NAME "] Cannot send CoAP message.");
-        result = CHARRA_RC_COAP_ERROR;
-        goto cleanup;
-    }
+    /* attest until interrupted, or until each target was attested once */
+    charra_log_info("[" LOG_NAME "] Entering attestation loop.");
+    while (!quit) {
+        /* start rounds and time out responses */
+        charra_timer_wheel_advance(&verifier_timers, verifier_now_ms());
+        if (!verifier_rounds_pending()) {
+            break;
+        }
 
-    /* processing and waiting for response */
-    charra_log_info("[" LOG_NAME "] Processing and waiting for response ...");
-    uint16_t response_wait_time = 0;
-    while (!processing_response && coap_io_pending(coap_context)) {
-        /* process CoAP I/O */
-        if ((coap_io_process_time = coap_io_process(
-                     coap_context, COAP_IO_PROCESS_TIME_MS)) == -1) {
+        /* process CoAP I/O until the next timer expires */
+        if (coap_io_process(coap_context,
+                    charra_timer_wheel_timeout_ms(&verifier_timers,
+                            COAP_IO_PROCESS_TIME_MS)) == -1) {
             charra_log_error(
                     "[" LOG_NAME "] Error during CoAP I/O processing.");
             result = CHARRA_RC_COAP_ERROR;
             goto cleanup;
         }
-        /* This wait time is not 100% accurate, it only includes the elapsed
-         * time inside the coap_io_process function. But should be good enough.
-         */
-        response_wait_time += coap_io_process_time;
-        if (response_wait_time >= (attestation_response_timeout * 1000)) {
-            charra_log_error("[" LOG_NAME
-                             "] Timeout after %d ms while waiting for or "
-                             "processing attestation response.",
-                    response_wait_time);
-            result = CHARRA_RC_TIMEOUT;
-            goto cleanup;
-        }
     }
 
-    // normal exit from processing loop, set result to result of attestation
-    result = attestation_rc;
-
-    /* wait until next attestation */
-    // TODO(any): Enable periodic attestations.
-    //     charra_log_info(
-    //             "[" LOG_NAME
-    //             "] Waiting %d seconds until next attestation request ...",
-    //             PERIODIC_ATTESTATION_WAIT_TIME_S);
-    //     sleep(PERIODIC_ATTESTATION_WAIT_TIME_S);
-    // }
+    /* exit with the first failed result of the last rounds */
+    result = CHARRA_RC_SUCCESS;
+    for (uint32_t i = 0; i < verifier_targets_len; i++) {
+        if (verifier_targets[i].rc != CHARRA_RC_SUCCESS) {
+            result = verifier_targets[i].rc;
+            break;
+        }
+    }
 
 cleanup:
     /* free CoAP memory */
+    for (uint32_t i = 0; i < verifier_targets_len; i++) {
+        charra_free_if_not_null_ex(
+                verifier_targets[i].session, coap_session_release);
+        charra_free_if_not_null(verifier_targets[i].request_buf);
+    }
     charra_free_if_not_null_ex(coap_options, coap_delete_optlist);
-    charra_free_if_not_null_ex(coap_session, coap_session_release);
     charra_free_if_not_null_ex(coap_context, coap_free_context);
 
     /* free variables */
-    charra_free_if_not_null(req_buf);
+    charra_allowlist_close(&ima_allowlist);
+    charra_rim_matcher_free(&reference_pcrs_matcher);
+    charra_rim_reload_stop(&reference_pcrs);
 
     coap_cleanup();
 
@@ -463,7 +587,232 @@ cleanup:
 
 static void handle_sigint(int signum CHARRA_UNUSED) { quit = true; }
 
-static CHARRA_RC create_attestation_request(
+static uint64_t verifier_now_ms(void) {
+    coap_tick_t now = 0;
+    coap_ticks(&now);
+    return (uint64_t)now * 1000 / COAP_TICKS_PER_SECOND;
+}
+
+static coap_session_t* verifier_new_session(verifier_target* target) {
+    coap_session_t* session = NULL;
+
+    if (use_dtls_psk) {
+        charra_log_info("[" LOG_NAME
+                        "] Creating CoAP client session using DTLS with PSK.");
+        if ((session = charra_coap_new_client_session_psk(coap_context,
+                     target->host, target->port, COAP_PROTO_DTLS,
+                     dtls_psk_identity, (uint8_t*)dtls_psk_key,
+                     strlen(dtls_psk_key))) == NULL) {
+            charra_log_error(
+                    "[" LOG_NAME
+                    "] Cannot create client session based on DTLS-PSK.");
+            return NULL;
+        }
+    } else if (use_dtls_rpk) {
+        charra_log_info(
+                "[" LOG_NAME "] Creating CoAP client session using DTLS-RPK.");
+        coap_dtls_pki_t dtls_pki = {0};
+
+        if (charra_coap_setup_dtls_pki_for_rpk(&dtls_pki,
+                    dtls_rpk_private_key_path, dtls_rpk_public_key_path,
+                    dtls_rpk_peer_public_key_path,
+                    dtls_rpk_verify_peer_public_key) != CHARRA_RC_SUCCESS) {
+            charra_log_error("[" LOG_NAME
+                             "] Error while setting up DTLS-RPK structure.");
+            return NULL;
+        }
+
+        if ((session = charra_coap_new_client_session_pki(coap_context,
+                     target->host, target->port, COAP_PROTO_DTLS,
+                     &dtls_pki)) == NULL) {
+            charra_log_error(
+                    "[" LOG_NAME
+                    "] Cannot create client session based on DTLS-RPK.");
+            return NULL;
+        }
+    } else {
+        charra_log_info(
+                "[" LOG_NAME "] Creating CoAP client session using UDP.");
+        if ((session = charra_coap_new_client_session(coap_context,
+                     target->host, target->port, COAP_PROTO_UDP)) == NULL) {
+            charra_log_error("[" LOG_NAME
+                             "] Cannot create client session based on UDP.");
+            return NULL;
+        }
+    }
+
+    /* set timeout length */
+    coap_fixed_point_t coap_timeout = {attestation_response_timeout, 0};
+    coap_session_set_ack_timeout(session, coap_timeout);
+
+    /* responses find their target through the session */
+    coap_session_set_app_data(session, target);
+
+    return session;
+}
+
+static void verifier_start_round(
+        charra_timer* timer CHARRA_UNUSED, void* data) {
+    verifier_target* target = (verifier_target*)data;
+
+    charra_log_info("[" LOG_NAME "] Attesting %s:%" PRIu16 ".", target->host,
+            target->port);
+    CHARRA_RC rc = send_attestation_request(target);
+    if (rc != CHARRA_RC_SUCCESS) {
+        verifier_end_round(target, rc);
+        return;
+    }
+
+    /* wait for the response, on the monotonic clock */
+    target->in_flight = true;
+    charra_timer_wheel_add(&verifier_timers, &target->deadline_timer,
+            verifier_now_ms() + (uint64_t)attestation_response_timeout * 1000);
+}
+
+static void verifier_round_timeout(
+        charra_timer* timer CHARRA_UNUSED, void* data) {
+    verifier_target* target = (verifier_target*)data;
+
+    charra_log_error("[" LOG_NAME "] Timeout after %d s while waiting for or "
+                     "processing attestation response of %s:%" PRIu16 ".",
+            attestation_response_timeout, target->host, target->port);
+    verifier_end_round(target, CHARRA_RC_TIMEOUT);
+}
+
+static void verifier_end_round(verifier_target* target, CHARRA_RC rc) {
+    charra_timer_wheel_cancel(&verifier_timers, &target->deadline_timer);
+    target->in_flight = false;
+    target->rc = rc;
+
+    /* only rounds without an attestation result are failures to back off
+     * from; the session might be broken, e.g. its DTLS state, so it is
+     * released before the next round, outside of libcoap's handlers */
+    if (rc == CHARRA_RC_SUCCESS || rc == CHARRA_RC_VERIFICATION_FAILED) {
+        target->failures = 0;
+    } else {
+        target->failures += 1;
+        target->reconnect = true;
+    }
+
+    if (target->interval_ms == 0) {
+        return;
+    }
+    const uint32_t delay_ms = verifier_next_delay_ms(target);
+    charra_log_info("[" LOG_NAME "] Attesting %s:%" PRIu16 " again in %" PRIu32
+                    " ms.",
+            target->host, target->port, delay_ms);
+    charra_timer_wheel_add(&verifier_timers, &target->round_timer,
+            verifier_now_ms() + delay_ms);
+}
+
+static void verifier_retry_round(verifier_target* target, uint32_t delay_ms) {
+    charra_timer_wheel_cancel(&verifier_timers, &target->deadline_timer);
+    target->in_flight = false;
+
+    charra_log_info("[" LOG_NAME "] Attesting %s:%" PRIu16 " again in %" PRIu32
+                    " ms.",
+            target->host, target->port, delay_ms);
+    charra_timer_wheel_add(&verifier_timers, &target->round_timer,
+            verifier_now_ms() + delay_ms);
+}
+
+static uint32_t verifier_next_delay_ms(const verifier_target* target) {
+    uint64_t delay_ms = target->interval_ms;
+
+    /* back off exponentially from attesters that fail to answer */
+    const uint64_t max_backoff_ms = (uint64_t)attestation_max_backoff_s * 1000;
+    for (uint32_t i = 0; i < target->failures && delay_ms < max_backoff_ms;
+            i++) {
+        delay_ms = (delay_ms * 2 < max_backoff_ms) ? delay_ms * 2
+                                                    : max_backoff_ms;
+    }
+
+    /* randomize by up to the jitter in both directions */
+    const uint64_t jitter_ms = delay_ms * attestation_jitter_percent / 100;
+    delay_ms = delay_ms - jitter_ms + verifier_random(2 * jitter_ms + 1);
+
+    return (delay_ms < UINT32_MAX) ? (uint32_t)delay_ms : UINT32_MAX;
+}
+
+static bool verifier_rounds_pending(void) {
+    for (uint32_t i = 0; i < verifier_targets_len; i++) {
+        if (verifier_targets[i].in_flight ||
+                charra_timer_pending(&verifier_targets[i].round_timer)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t verifier_random(uint64_t bound) {
+    uint64_t value = 0;
+    if (bound <= 1 || charra_random_bytes(sizeof(value), (uint8_t*)&value) !=
+                              CHARRA_RC_SUCCESS) {
+        return 0;
+    }
+    return value % bound;
+}
+
+static void build_pcr_selection(charra_rim_selection* selection) {
+    *selection = (charra_rim_selection){
+            .hash_alg = signature_hash_algorithm.tpm2_hash_algorithm};
+    for (uint32_t i = 0; i < TPM2_PCR_BANK_COUNT; i++) {
+        if (tpm_pcr_selection_len[i] == 0) {
+            continue;
+        }
+        charra_rim_bank_selection* bank =
+                &selection->banks[selection->banks_len++];
+        bank->alg = tpm_pcr_banks[i];
+        bank->pcrs_len = tpm_pcr_selection_len[i];
+        memcpy(bank->pcrs, tpm_pcr_selection[i], tpm_pcr_selection_len[i]);
+    }
+}
+
+static bool map_pcr_values(const charra_tap_tpm2_pcr_values_dto* pcr_values,
+        const TPMS_ATTEST* attest_struct, const uint8_t** mapped) {
+    const uint8_t* values[CHARRA_RIM_BANKS_MAX * TPM2_MAX_PCRS] = {0};
+    uint16_t value_sizes[CHARRA_RIM_BANKS_MAX * TPM2_MAX_PCRS] = {0};
+    size_t values_len = 0;
+    uint8_t digest[sizeof(TPMU_HA)] = {0};
+
+    for (uint32_t i = 0; i < pcr_values->pcr_values_len; i++) {
+        const charra_tap_pcr_value_dto* pcr_value = &pcr_values->pcr_values[i];
+        for (uint32_t b = 0; b < pcr_selection.banks_len; b++) {
+            if (pcr_selection.banks[b].alg == pcr_value->tcg_hash_alg_id &&
+                    pcr_value->value_len ==
+                            charra_crypto_tpm2_hash_size(
+                                    pcr_value->tcg_hash_alg_id)) {
+                mapped[b * TPM2_MAX_PCRS + pcr_value->pcr] = pcr_value->value;
+            }
+        }
+    }
+
+    /* the composite digest over the selected PCRs in the order quoted */
+    for (uint32_t b = 0; b < pcr_selection.banks_len; b++) {
+        const charra_rim_bank_selection* bank = &pcr_selection.banks[b];
+        for (uint32_t j = 0; j < bank->pcrs_len; j++) {
+            const uint8_t* value = mapped[b * TPM2_MAX_PCRS + bank->pcrs[j]];
+            if (value == NULL) {
+                charra_log_warn("[" LOG_NAME "] PCR %d of PCR bank 0x%04x "
+                                "was not disclosed.",
+                        bank->pcrs[j], bank->alg);
+                return false;
+            }
+            values[values_len] = value;
+            value_sizes[values_len] = charra_crypto_tpm2_hash_size(bank->alg);
+            values_len++;
+        }
+    }
+    if (charra_compute_pcr_composite_digest_from_ptr_array(
+                pcr_selection.hash_alg, values, value_sizes, values_len,
+                digest) != CHARRA_RC_SUCCESS) {
+        return false;
+    }
+    return charra_verify_tpm2_quote_pcr_composite_digest(attest_struct,
+            digest, charra_crypto_tpm2_hash_size(pcr_selection.hash_alg));
+}
+
+static CHARRA_RC create_attestation_request(const verifier_target* target,
         charra_tap_msg_attestation_request_dto* attestation_request) {
     CHARRA_RC err = CHARRA_RC_ERROR;
 
@@ -489,6 +838,20 @@ static CHARRA_RC create_attestation_request(
     charra_print_hex(CHARRA_LOG_INFO, nonce_len, nonce,
             "                                              0x", "\n", false);
 
+    /* request only the IMA events after the last appraised one */
+    const charra_appraisal_state* state = charra_appraisal_state_find(
+            &appraisal_states, target->host, target->port);
+    for (uint32_t i = 0; i < pcr_log_len; i++) {
+        request_pcr_logs[i] = pcr_logs[i];
+        if (state != NULL && strcmp(pcr_logs[i].identifier, "ima") == 0 &&
+                pcr_logs[i].start == 1 && pcr_logs[i].count == 0) {
+            request_pcr_logs[i].start = state->ima_replay.events + 1;
+            charra_log_info("[" LOG_NAME "] Requesting IMA log from event "
+                            "%" PRIu64 " on.",
+                    request_pcr_logs[i].start);
+        }
+    }
+
     /* build attestation request */
     charra_tap_msg_attestation_request_dto req = {
             .tap_spec_version = CHARRA_TAP_SPEC_VERSION,
@@ -497,21 +860,20 @@ static CHARRA_RC create_attestation_request(
             .sig_key_id = {0},  // must be memcpy'd, see below
             .nonce_len = nonce_len,
             .nonce = {0},  // must be memcpy'd, see below
-            .pcr_selections_len = 1,
-            .pcr_selections = {{
-                    .tcg_hash_alg_id = TPM2_ALG_SHA256,
-                    /* TODO: add other PCR banks */
-                    .pcrs_len = tpm_pcr_selection_len[1],
-                    .pcrs = {0}  // must be memcpy'd, see below
-            }},
+            .pcr_selections_len = pcr_selection.banks_len,
+            .pcr_selections = {{0}},  // must be memcpy'd, see below
             .pcr_log_len = pcr_log_len,
-            .pcr_logs = pcr_logs,
+            .pcr_logs = request_pcr_logs,
+            .disclose_pcr_values = disclose_pcr_values,
     };
     memcpy(req.sig_key_id, TPM_SIG_KEY_ID, TPM_SIG_KEY_ID_LEN);
     memcpy(req.nonce, nonce, nonce_len);
-    /* TODO: add other PCR banks */
-    memcpy(req.pcr_selections->pcrs, tpm_pcr_selection[1],
-            tpm_pcr_selection_len[1]);
+    for (uint32_t b = 0; b < pcr_selection.banks_len; b++) {
+        const charra_rim_bank_selection* bank = &pcr_selection.banks[b];
+        req.pcr_selections[b].tcg_hash_alg_id = bank->alg;
+        req.pcr_selections[b].pcrs_len = bank->pcrs_len;
+        memcpy(req.pcr_selections[b].pcrs, bank->pcrs, bank->pcrs_len);
+    }
 
     /* set output param(s) */
     *attestation_request = req;
@@ -520,10 +882,68 @@ static CHARRA_RC create_attestation_request(
     return CHARRA_RC_SUCCESS;
 }
 
+static CHARRA_RC send_attestation_request(verifier_target* target) {
+    CHARRA_RC result = CHARRA_RC_ERROR;
+    uint32_t req_buf_len = 0;
+    coap_pdu_t* pdu = NULL;
+
+    /* reuse the session of the last round unless that one failed */
+    if (target->reconnect && target->session != NULL) {
+        charra_log_info("[" LOG_NAME "] Releasing CoAP client session to "
+                        "%s:%" PRIu16 " after failed attestation.",
+                target->host, target->port);
+        /* late responses to the released session are ignored */
+        coap_session_set_app_data(target->session, NULL);
+        charra_free_and_null_ex(target->session, coap_session_release);
+    }
+    target->reconnect = false;
+    if (target->session == NULL &&
+            (target->session = verifier_new_session(target)) == NULL) {
+        return CHARRA_RC_COAP_ERROR;
+    }
+
+    /* create attestation request */
+    charra_log_info("[" LOG_NAME "] Creating attestation request.");
+    if ((result = create_attestation_request(target, &target->request)) !=
+            CHARRA_RC_SUCCESS) {
+        charra_log_error("[" LOG_NAME "] Cannot create attestation request.");
+        return result;
+    }
+
+    /* marshal attestation request, its buffer is kept until the next round */
+    charra_log_info(
+            "[" LOG_NAME "] Marshaling attestation request data to CBOR.");
+    charra_free_if_not_null(target->request_buf);
+    if ((result = charra_tap_marshal_attestation_request(&target->request,
+                 &req_buf_len, &target->request_buf)) != CHARRA_RC_SUCCESS) {
+        charra_log_error(
+                "[" LOG_NAME "] Marshaling attestation request data failed.");
+        return result;
+    }
+
+    /* new CoAP request PDU */
+    charra_log_info("[" LOG_NAME "] Creating request PDU.");
+    if ((pdu = charra_coap_new_request(target->session, COAP_MESSAGE_CON,
+                 COAP_REQUEST_CODE_FETCH, &coap_options, target->request_buf,
+                 req_buf_len)) == NULL) {
+        charra_log_error("[" LOG_NAME "] Cannot create request PDU.");
+        return CHARRA_RC_ERROR;
+    }
+
+    /* send CoAP PDU */
+    charra_log_info("[" LOG_NAME "] Sending CoAP message.");
+    if (coap_send_large(target->session, pdu) == COAP_INVALID_MID) {
+        charra_log_error("[" LOG_NAME "] Cannot send CoAP message.");
+        return CHARRA_RC_COAP_ERROR;
+    }
+
+    charra_log_info("[" LOG_NAME "] Processing and waiting for response ...");
+    return CHARRA_RC_SUCCESS;
+}
+
 /* --- resource handler definitions --------------------------------------- */
 
-static coap_response_t coap_attest_handler(
-        coap_session_t* session CHARRA_UNUSED,
+static coap_response_t coap_attest_handler(coap_session_t* session,
         const coap_pdu_t* sent CHARRA_UNUSED, const coap_pdu_t* received,
         const coap_mid_t mid CHARRA_UNUSED) {
     int coap_r = 0;
@@ -531,13 +951,48 @@ static coap_response_t coap_attest_handler(
 
     ESYS_TR sig_key_handle = ESYS_TR_NONE;
     TPMT_TK_VERIFIED* validation = NULL;
+    ESYS_CONTEXT* esys_ctx = NULL;
+    TSS2_TCTI_CONTEXT* tcti_ctx = NULL;
+    charra_tap_msg_attestation_response_dto res = {0};
 
-    processing_response = true;
+    verifier_target* target =
+            (verifier_target*)coap_session_get_app_data(session);
+    if (target == NULL || !target->in_flight) {
+        charra_log_debug("[" LOG_NAME "] Ignoring response outside of an "
+                         "attestation round.");
+        return COAP_RESPONSE_OK;
+    }
 
     charra_log_info(
             "[" LOG_NAME "] Resource '%s': Received message.", "attest");
     coap_show_pdu(LOG_DEBUG, received);
 
+    /* check response code */
+    const coap_pdu_code_t code = coap_pdu_get_code(received);
+    if (COAP_RESPONSE_CLASS(code) != 2) {
+        if (code == COAP_RESPONSE_CODE_SERVICE_UNAVAILABLE) {
+            coap_opt_iterator_t opt_iter;
+            coap_opt_t* max_age =
+                    coap_check_option(received, COAP_OPTION_MAXAGE, &opt_iter);
+            const unsigned int retry_after_s =
+                    (max_age != NULL)
+                            ? coap_decode_var_bytes(coap_opt_value(max_age),
+                                      coap_opt_length(max_age))
+                            : COAP_DEFAULT_MAX_AGE;
+            charra_log_warn("[" LOG_NAME "] Attester is busy, retry in %u s.",
+                    retry_after_s);
+            /* not a failure, the attester paces its verifiers */
+            verifier_retry_round(target,
+                    (retry_after_s < UINT32_MAX / 1000) ? retry_after_s * 1000
+                                                        : UINT32_MAX);
+            return COAP_RESPONSE_OK;
+        }
+        charra_log_error("[" LOG_NAME "] Attester responded with %d.%02d.",
+                COAP_RESPONSE_CLASS(code), code & 0x1F);
+        attestation_rc = CHARRA_RC_ERROR;
+        goto cleanup;
+    }
+
     /* --- receive incoming data --- */
 
     /* get data */
@@ -559,7 +1014,6 @@ static coap_response_t coap_attest_handler(
 
     /* unmarshal data */
     charra_log_info("[" LOG_NAME "] Parsing received CBOR data.");
-    charra_tap_msg_attestation_response_dto res = {0};
     if ((attestation_rc = charra_tap_unmarshal_attestation_response(
                  data_len, data, &res)) != CHARRA_RC_SUCCESS) {
         charra_log_error("[" LOG_NAME "] Could not parse CBOR data.");
@@ -588,8 +1042,6 @@ static coap_response_t coap_attest_handler(
     charra_log_info("[" LOG_NAME "] Starting verification.");
 
     /* initialize ESAPI */
-    ESYS_CONTEXT* esys_ctx = NULL;
-    TSS2_TCTI_CONTEXT* tcti_ctx = NULL;
     if ((tss_r = Tss2_TctiLdr_Initialize(getenv("CHARRA_TCTI"), &tcti_ctx)) !=
             TSS2_RC_SUCCESS) {
         charra_log_error("[" LOG_NAME "] Tss2_TctiLdr_Initialize.");
@@ -704,8 +1156,17 @@ static coap_response_t coap_attest_handler(
     {
         charra_log_info("[" LOG_NAME "] Verifying qualifying data (nonce) ...");
 
+        if (res.has_nonce_inclusion_proof) {
+            charra_log_info("[" LOG_NAME
+                            "]     Quote is coalesced over %" PRIu64
+                            " nonces, checking inclusion proof.",
+                    res.nonce_inclusion_proof.tree_size);
+        }
         attestation_result_nonce = charra_verify_tpm2_quote_qualifying_data(
-                last_request.nonce_len, last_request.nonce, &attest_struct);
+                target->request.nonce_len, target->request.nonce,
+                res.has_nonce_inclusion_proof ? &res.nonce_inclusion_proof
+                                              : NULL,
+                &attest_struct);
         if (attestation_result_nonce == true) {
             charra_log_info(
                     "[" LOG_NAME "]     => Qualifying data (nonce) in TPM2 "
@@ -718,6 +1179,135 @@ static coap_response_t coap_attest_handler(
         }
     }
 
+    /* --- replay PCR logs --- */
+    bool attestation_result_pcr_logs = true;
+    const uint8_t* replayed_pcrs[CHARRA_RIM_BANKS_MAX * TPM2_MAX_PCRS] = {0};
+    charra_ima_replay ima_replay = {0};
+    bool ima_log_replayed = false;
+    bool replay_in_full = false;
+    if (res.pcr_log_len == 0) {
+        charra_log_info("[" LOG_NAME "] No PCR logs received.");
+    }
+    for (uint32_t i = 0; i < res.pcr_log_len; i++) {
+        const pcr_log_response_dto* log = &res.pcr_logs[i];
+        charra_log_info("[" LOG_NAME "] Received PCR log %s [%lu Bytes, "
+                        "%" PRIu64 " entries from %" PRIu64 "]",
+                log->identifier, log->content_len, log->count, log->start);
+        if (strcmp(log->identifier, "tcg-boot") == 0) {
+            charra_log_info("[" LOG_NAME "] Replaying tcg-boot log ...");
+            if (charra_tcg_boot_log_replay(&boot_replay, log->content_len,
+                        log->content) != CHARRA_RC_SUCCESS) {
+                charra_log_error(
+                        "[" LOG_NAME "]     => tcg-boot log is NOT valid!");
+                attestation_result_pcr_logs = false;
+                continue;
+            }
+            charra_log_info("[" LOG_NAME "]     => tcg-boot log replayed "
+                            "(%" PRIu64 " events).",
+                    boot_replay.events);
+
+            for (uint32_t b = 0; b < pcr_selection.banks_len; b++) {
+                const charra_rim_bank_selection* bank =
+                        &pcr_selection.banks[b];
+                for (uint32_t j = 0; j < bank->pcrs_len; j++) {
+                    const uint8_t pcr_index = bank->pcrs[j];
+                    const uint8_t* pcr = charra_tcg_boot_replay_get_pcr(
+                            &boot_replay, bank->alg, pcr_index);
+                    const uint32_t k = b * TPM2_MAX_PCRS + pcr_index;
+                    if (pcr != NULL && replayed_pcrs[k] == NULL) {
+                        replayed_pcrs[k] = pcr;
+                    }
+                }
+            }
+            continue;
+        }
+        if (strcmp(log->identifier, "ima") != 0) {
+            continue;
+        }
+
+        /* the PCR can only be replayed from its reset state or from the
+         * state of the last appraisal */
+        const charra_appraisal_state* state = charra_appraisal_state_find(
+                &appraisal_states, target->host, target->port);
+        const bool continues = log->start != 1 && state != NULL &&
+                               log->start == state->ima_replay.events + 1;
+        if (continues && !charra_appraisal_state_continues(
+                                 state, &attest_struct.clockInfo)) {
+            charra_log_warn("[" LOG_NAME "] TPM was reset or restarted since "
+                            "the last appraisal, attesting again with the "
+                            "IMA log in full.");
+            charra_appraisal_state_forget(
+                    &appraisal_states, target->host, target->port);
+            replay_in_full = true;
+            break;
+        }
+        if (log->start != 1 && !continues) {
+            charra_log_info("[" LOG_NAME "] IMA log does not start at the "
+                            "first event, not replaying it.");
+            continue;
+        }
+        if (continues) {
+            charra_log_info("[" LOG_NAME "] Replaying IMA log into PCR %d "
+                            "from event %" PRIu64 " on ...",
+                    CHARRA_IMA_PCR, log->start);
+            ima_replay = state->ima_replay;
+        } else {
+            charra_log_info("[" LOG_NAME "] Replaying IMA log into PCR %d ...",
+                    CHARRA_IMA_PCR);
+            /* into every selected bank whose algorithm can be replayed */
+            TPMI_ALG_HASH ima_banks[CHARRA_IMA_BANKS_MAX] = {0};
+            uint32_t ima_banks_len = 0;
+            for (uint32_t b = 0; b < pcr_selection.banks_len &&
+                                 ima_banks_len < CHARRA_IMA_BANKS_MAX;
+                    b++) {
+                const TPMI_ALG_HASH alg = pcr_selection.banks[b].alg;
+                if (charra_crypto_tpm2_hash_size(alg) > 0) {
+                    ima_banks[ima_banks_len++] = alg;
+                }
+            }
+            if (charra_ima_replay_init(&ima_replay, ima_banks_len, ima_banks,
+                        CHARRA_IMA_PCR) != CHARRA_RC_SUCCESS) {
+                attestation_result_pcr_logs = false;
+                continue;
+            }
+        }
+        if (ima_allowlist_path != NULL) {
+            ima_replay.allowlist = &ima_allowlist;
+        }
+        if (charra_ima_replay_log(&ima_replay, log->content_len,
+                    log->content) != CHARRA_RC_SUCCESS) {
+            charra_log_error("[" LOG_NAME "]     => IMA log is NOT valid!");
+            attestation_result_pcr_logs = false;
+            continue;
+        }
+        charra_log_info("[" LOG_NAME "]     => IMA log replayed (%" PRIu64
+                        " events, %" PRIu64 " violations), PCR %d is:",
+                ima_replay.events, ima_replay.violations, CHARRA_IMA_PCR);
+        for (uint32_t b = 0; b < ima_replay.banks_len; b++) {
+            charra_print_hex(CHARRA_LOG_INFO, ima_replay.banks[b].pcr_size,
+                    (const uint8_t*)&ima_replay.banks[b].pcr,
+                    "                                              0x", "\n",
+                    false);
+        }
+        if (ima_replay.unknown > 0) {
+            charra_log_error("[" LOG_NAME "]     => IMA log has %" PRIu64
+                             " files NOT in the allowlist!",
+                    ima_replay.unknown);
+            attestation_result_pcr_logs = false;
+        }
+        for (uint32_t b = 0; b < pcr_selection.banks_len; b++) {
+            const uint8_t* pcr = charra_ima_replay_get_pcr(
+                    &ima_replay, pcr_selection.banks[b].alg);
+            if (pcr != NULL) {
+                replayed_pcrs[b * TPM2_MAX_PCRS + CHARRA_IMA_PCR] = pcr;
+            }
+        }
+        ima_log_replayed = true;
+    }
+    if (replay_in_full) {
+        goto cleanup;
+    }
+
     /* --- verify PCRs --- */
     bool attestation_result_pcrs = false;
     {
@@ -730,10 +1320,26 @@ static coap_response_t coap_attest_handler(
                 attest_struct.attested.quote.pcrDigest.buffer,
                 "                                              0x", "\n",
                 false);
-        /* TODO: add support for other hash algorithms */
-        CHARRA_RC pcr_check = charra_check_pcr_digest_against_reference(
-                reference_pcr_file_path, tpm_pcr_selection[1],
-                tpm_pcr_selection_len[1], &attest_struct);
+        const uint8_t* pcr_values[CHARRA_RIM_BANKS_MAX * TPM2_MAX_PCRS] = {
+                0};
+        CHARRA_RC pcr_check = CHARRA_RC_VERIFICATION_FAILED;
+        if (res.has_pcr_values &&
+                map_pcr_values(&res.pcr_values, &attest_struct, pcr_values)) {
+            charra_log_info("[" LOG_NAME "] Disclosed PCR values match the "
+                            "PCR composite digest, checking them PCR by "
+                            "PCR.");
+            pcr_check = charra_rim_matcher_check_values(
+                    &reference_pcrs_matcher, &pcr_selection, pcr_values,
+                    replayed_pcrs);
+        } else {
+            if (res.has_pcr_values) {
+                charra_log_warn("[" LOG_NAME "] Disclosed PCR values do not "
+                                "match the PCR composite digest, ignoring "
+                                "them.");
+            }
+            pcr_check = charra_rim_matcher_check(&reference_pcrs_matcher,
+                    &pcr_selection, replayed_pcrs, &attest_struct);
+        }
         if (pcr_check == CHARRA_RC_SUCCESS) {
             charra_log_info(
                     "[" LOG_NAME "]     => PCR composite digest is valid!");
@@ -747,22 +1353,11 @@ static coap_response_t coap_attest_handler(
         }
     }
 
-    /* check pcr logs */
-    if (res.pcr_log_len == 0) {
-        charra_log_info("[" LOG_NAME "] No PCR logs received.");
-    }
-
-    for (uint32_t i = 0; i < res.pcr_log_len; i++) {
-        charra_log_info("[" LOG_NAME "] Received PCR log %s [%lu Bytes]",
-                pcr_logs[i].identifier, res.pcr_logs[i].content_len);
-    }
-
-    // TODO(any): Implement real verification.
-
     /* --- output result --- */
 
     bool attestation_result = attestation_result_signature &&
                               attestation_result_nonce &&
+                              attestation_result_pcr_logs &&
                               attestation_result_pcrs;
 
     /* print attestation result */
@@ -776,6 +1371,18 @@ static coap_response_t coap_attest_handler(
     }
     charra_log_info("[" LOG_NAME "] +----------------------------+");
 
+    /* continue from this appraisal next round, or start over */
+    if (attestation_result && ima_log_replayed) {
+        if (charra_appraisal_state_save(&appraisal_states, target->host,
+                    target->port, &attest_struct.clockInfo,
+                    &ima_replay) != CHARRA_RC_SUCCESS) {
+            charra_log_error("[" LOG_NAME "] Could not save appraisal state.");
+        }
+    } else if (!attestation_result) {
+        charra_appraisal_state_forget(
+                &appraisal_states, target->host, target->port);
+    }
+
 cleanup:
     /* free heap objects*/
     for (uint32_t i = 0; i < res.pcr_log_len; i++) {
@@ -808,6 +1415,10 @@ cleanup:
         Tss2_TctiLdr_Finalize(&tcti_ctx);
     }
 
-    processing_response = false;
+    if (replay_in_full) {
+        verifier_retry_round(target, 0);
+    } else {
+        verifier_end_round(target, attestation_rc);
+    }
     return COAP_RESPONSE_OK;
 }